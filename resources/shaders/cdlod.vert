@@ -0,0 +1,58 @@
+#version 330 core
+// Shared grid corner in [0, 1]
+layout (location = 0) in vec2 aGrid;
+// Per instance, node minimum corner X and Z, node size and LOD
+layout (location = 1) in vec4 aNode;
+
+// World space
+out vec3 Normal;
+// Normalized, for coloring
+out float Height;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 cameraPosition;
+
+// World position of sample (0, 0) at height zero
+uniform vec3 terrainOrigin;
+uniform float sampleSpacing;
+uniform float heightScale;
+// Quads per side of the shared grid
+uniform float gridSize;
+// Start and end distance of every LOD's morph into the next one, CDLODDefaults::MAX_LODS entries
+uniform vec2 morphRanges[16];
+// One layer per LOD, texel i of layer L holds sample i * 2^L and the layers wrap around
+uniform sampler2DArray clipmap;
+uniform float clipmapSize;
+
+float SampleHeight(vec2 position, float lod)
+{
+	vec2 texel = (position - terrainOrigin.xz) / (sampleSpacing * exp2(lod));
+	return textureLod(clipmap, vec3((texel + 0.5f) / clipmapSize, lod), 0.f).r;
+}
+
+void main()
+{
+	float lod = aNode.w;
+	vec2 position = aNode.xy + aGrid * aNode.z;
+	float height = terrainOrigin.y + SampleHeight(position, lod) * heightScale;
+	float distance = length(vec3(position.x, height, position.y) - cameraPosition);
+	vec2 range = morphRanges[int(lod)];
+	float morph = clamp((distance - range.x) / max(range.y - range.x, 1e-6f), 0.f, 1.f);
+
+	// Odd grid vertices slide onto their even neighbour, fully morphed the node matches the next LOD's grid
+	vec2 grid = aGrid - fract(aGrid * gridSize * 0.5f) * 2.f / gridSize * morph;
+	position = aNode.xy + grid * aNode.z;
+	Height = SampleHeight(position, lod);
+
+	// Central differences one texel of this LOD apart
+	float step = sampleSpacing * exp2(lod);
+	float left = SampleHeight(position - vec2(step, 0.f), lod);
+	float right = SampleHeight(position + vec2(step, 0.f), lod);
+	float back = SampleHeight(position - vec2(0.f, step), lod);
+	float front = SampleHeight(position + vec2(0.f, step), lod);
+	vec2 slope = vec2(right - left, front - back) * heightScale / (2.f * step);
+	Normal = normalize(vec3(-slope.x, 1.f, -slope.y));
+
+	gl_Position = projection * view * vec4(position.x, terrainOrigin.y + Height * heightScale, position.y, 1.f);
+}
@@ -0,0 +1,6 @@
+#version 330 core
+
+// Depth pre-pass, nothing to shade
+void main()
+{
+}
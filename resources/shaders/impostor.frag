@@ -0,0 +1,15 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D atlas;
+
+void main()
+{
+	vec4 color = texture(atlas, TexCoord);
+	// Cells are cleared to transparent, cut out around the captured silhouette
+	if (color.a < 0.5f)
+		discard;
+	FragColor = vec4(color.rgb, 1.f);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+// Quad corner in [-1, 1]
+layout (location = 0) in vec2 aCorner;
+// Per instance, world center and the half axes of the captured view
+layout (location = 1) in vec3 aCenter;
+layout (location = 2) in vec3 aRight;
+layout (location = 3) in vec3 aUp;
+// Per instance, uv of the atlas cell's lower left corner
+layout (location = 4) in vec2 aCellOrigin;
+
+out vec2 TexCoord;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec2 cellSize;
+
+void main()
+{
+	// Same axes the cell was captured with, the image keeps its up whatever the camera roll
+	vec3 position = aCenter + aRight * aCorner.x + aUp * aCorner.y;
+
+	gl_Position = projection * view * vec4(position, 1.f);
+	TexCoord = aCellOrigin + (aCorner * 0.5f + 0.5f) * cellSize;
+}
@@ -0,0 +1,41 @@
+#version 430 core
+#include "vertex_format.glsl"
+
+// PackedTransform in src/PackedTransform.h, 7 words per object
+layout (std430, binding = 0) readonly buffer Transforms
+{
+	uint transforms[];
+};
+
+layout (std430, binding = 2) readonly buffer VisibleInstances
+{
+	uint visibleInstances[];
+};
+
+out vec2 TexCoord;
+
+uniform mat4 view;
+uniform mat4 projection;
+// Start of the current draw's range in the visible list, gl_InstanceID restarts at 0 every draw
+uniform int instanceOffset;
+
+mat4 UnpackTransform(uint objectID)
+{
+	uint base = objectID * 7u;
+	vec3 position = uintBitsToFloat(uvec3(transforms[base], transforms[base + 1u], transforms[base + 2u]));
+	// Renormalized, snorm rounding leaves it slightly off unit length
+	vec4 q = normalize(vec4(unpackSnorm2x16(transforms[base + 3u]), unpackSnorm2x16(transforms[base + 4u])));
+	vec3 scale = vec3(unpackHalf2x16(transforms[base + 5u]), unpackHalf2x16(transforms[base + 6u]).x);
+
+	vec3 x = vec3(1.f - 2.f * (q.y * q.y + q.z * q.z), 2.f * (q.x * q.y + q.z * q.w), 2.f * (q.x * q.z - q.y * q.w));
+	vec3 y = vec3(2.f * (q.x * q.y - q.z * q.w), 1.f - 2.f * (q.x * q.x + q.z * q.z), 2.f * (q.y * q.z + q.x * q.w));
+	vec3 z = vec3(2.f * (q.x * q.z + q.y * q.w), 2.f * (q.y * q.z - q.x * q.w), 1.f - 2.f * (q.x * q.x + q.y * q.y));
+	return mat4(vec4(x * scale.x, 0.f), vec4(y * scale.y, 0.f), vec4(z * scale.z, 0.f), vec4(position, 1.f));
+}
+
+void main()
+{
+	mat4 model = UnpackTransform(visibleInstances[instanceOffset + gl_InstanceID]);
+	gl_Position = projection * view * model * vec4(DecodePosition(), 1.f);
+	TexCoord = aTexCoord;
+}
@@ -0,0 +1,74 @@
+#version 330 core
+out vec4 FragColor;
+
+// Node words, see SparseVoxelOctree
+uniform usamplerBuffer nodes;
+uniform mat4 inverseViewProjection;
+uniform vec3 cameraPosition;
+// World position of the root's minimum corner and its edge in voxels
+uniform vec3 octreeOrigin;
+uniform float octreeSize;
+uniform vec2 viewportSize;
+uniform int maxSteps;
+// Tint per BlockID, VoxelBlocks::COUNT entries used
+uniform vec3 blockColors[16];
+
+const uint LEAF = 0x80000000u;
+const vec3 LIGHT_DIRECTION = normalize(vec3(0.4f, 1.f, 0.3f));
+// Along the ray past cell corners, the crossed face itself is cleared by half a voxel
+const float NUDGE = 1e-3f;
+
+void main()
+{
+	vec2 ndc = gl_FragCoord.xy / viewportSize * 2.f - 1.f;
+	vec4 farPoint = inverseViewProjection * vec4(ndc, 1.f, 1.f);
+	vec3 direction = normalize(farPoint.xyz / farPoint.w - cameraPosition);
+	// Axis parallel rays never reach that axis' borders
+	direction = mix(direction, vec3(1e-6f), lessThan(abs(direction), vec3(1e-6f)));
+	vec3 inverseDirection = 1.f / direction;
+	vec3 origin = cameraPosition - octreeOrigin;
+
+	// Into the root cube
+	vec3 t0 = -origin * inverseDirection;
+	vec3 t1 = (vec3(octreeSize) - origin) * inverseDirection;
+	vec3 tNear = min(t0, t1);
+	vec3 tFar = max(t0, t1);
+	float t = max(max(tNear.x, tNear.y), max(tNear.z, 0.f));
+	float tExit = min(min(tFar.x, tFar.y), tFar.z);
+	if (t >= tExit)
+		discard;
+	// Axis of the face the ray came in through, none when the camera is inside the root
+	vec3 crossed = t > 0.f ? vec3(equal(tNear, vec3(t))) : vec3(0.f);
+
+	for (int i = 0; i < maxSteps && t < tExit; i++)
+	{
+		// Down from the root to the cube holding the point, every step leaves one such cube.
+		// Borders are on whole voxels, half a voxel never lands back in the cube just left.
+		vec3 position = origin + direction * (t + NUDGE) + crossed * sign(direction) * 0.5f;
+		position = clamp(position, vec3(0.f), vec3(octreeSize - NUDGE));
+		uint node = texelFetch(nodes, 0).r;
+		vec3 cellMin = vec3(0.f);
+		float cellSize = octreeSize;
+		while (node != 0u && (node & LEAF) == 0u)
+		{
+			cellSize *= 0.5f;
+			vec3 upper = step(cellMin + cellSize, position);
+			cellMin += upper * cellSize;
+			node = texelFetch(nodes, int(node) + int(upper.x) + int(upper.y) * 2 + int(upper.z) * 4).r;
+		}
+
+		if (node != 0u)
+		{
+			vec3 normal = any(greaterThan(crossed, vec3(0.f))) ? -sign(direction) * crossed : -direction;
+			vec3 albedo = blockColors[int(node & ~LEAF)];
+			float diffuse = max(dot(normal, LIGHT_DIRECTION), 0.f);
+			FragColor = vec4(albedo * (0.35f + 0.65f * diffuse), 1.f);
+			return;
+		}
+
+		vec3 tBorder = (cellMin + step(0.f, direction) * cellSize - origin) * inverseDirection;
+		t = min(min(tBorder.x, tBorder.y), tBorder.z);
+		crossed = vec3(equal(tBorder, vec3(t)));
+	}
+	discard;
+}
@@ -0,0 +1,16 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 Normal;
+in float Height;
+
+const vec3 LIGHT_DIRECTION = normalize(vec3(0.4f, 1.f, 0.3f));
+const vec3 LOW_COLOR = vec3(0.25f, 0.4f, 0.2f);
+const vec3 HIGH_COLOR = vec3(0.55f, 0.5f, 0.45f);
+
+void main()
+{
+	vec3 albedo = mix(LOW_COLOR, HIGH_COLOR, smoothstep(0.4f, 0.8f, Height));
+	float diffuse = max(dot(normalize(Normal), LIGHT_DIRECTION), 0.f);
+	FragColor = vec4(albedo * (0.3f + 0.7f * diffuse), 1.f);
+}
@@ -0,0 +1,9 @@
+#version 400 core
+// Patch corner on the ground, world X and Z
+layout (location = 0) in vec2 aPosition;
+
+void main()
+{
+	// Height is applied after tessellation
+	gl_Position = vec4(aPosition.x, 0.f, aPosition.y, 1.f);
+}
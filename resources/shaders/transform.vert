@@ -1,6 +1,8 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoord;
+#include "vertex_format.glsl"
+
+// The depth pre-pass and the colour pass share this shader, both must produce the exact same depth
+invariant gl_Position;
 
 out vec2 TexCoord;
 
@@ -10,6 +12,6 @@ uniform mat4 projection;
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.f);
+	gl_Position = projection * view * model * vec4(DecodePosition(), 1.f);
 	TexCoord = aTexCoord;
 }
\ No newline at end of file
@@ -0,0 +1,26 @@
+// Packed mesh vertex (PackedVertex in src/VertexFormat.h), include after #version.
+// The fetch already normalizes positions to [0, 1] in the mesh bounds and expands the half float uvs.
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+// Octahedral normal in xy, zw spare
+layout (location = 2) in vec4 aNormal;
+
+layout (std140) uniform MeshQuantization
+{
+	vec4 positionOffset;
+	vec4 positionScale;
+};
+
+vec3 DecodePosition()
+{
+	return positionOffset.xyz + aPos * positionScale.xyz;
+}
+
+vec3 DecodeNormal()
+{
+	vec3 normal = vec3(aNormal.xy, 1.f - abs(aNormal.x) - abs(aNormal.y));
+	float fold = max(-normal.z, 0.f);
+	normal.x += normal.x >= 0.f ? -fold : fold;
+	normal.y += normal.y >= 0.f ? -fold : fold;
+	return normalize(normal);
+}
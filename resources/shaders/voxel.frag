@@ -0,0 +1,19 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec2 TexCoord;
+flat in uint Block;
+
+uniform sampler2D blockTexture;
+// Tint per BlockID, VoxelBlocks::COUNT entries used
+uniform vec3 blockColors[16];
+
+const vec3 LIGHT_DIRECTION = normalize(vec3(0.4f, 1.f, 0.3f));
+
+void main()
+{
+	vec3 albedo = texture(blockTexture, TexCoord).rgb * blockColors[Block];
+	float diffuse = max(dot(Normal, LIGHT_DIRECTION), 0.f);
+	FragColor = vec4(albedo * (0.35f + 0.65f * diffuse), 1.f);
+}
@@ -0,0 +1,33 @@
+#version 330 core
+// Chunk local corner in 6 bits per axis, face in 3, block in the top 11, see PackVoxelVertex
+layout (location = 0) in uint aVoxel;
+
+out vec3 Normal;
+out vec2 TexCoord;
+flat out uint Block;
+
+uniform mat4 view;
+uniform mat4 projection;
+// World position of the chunk's minimum corner
+uniform vec3 chunkOrigin;
+
+// VoxelFace order
+const vec3 FACE_NORMALS[6] = vec3[](
+	vec3(1.f, 0.f, 0.f), vec3(-1.f, 0.f, 0.f),
+	vec3(0.f, 1.f, 0.f), vec3(0.f, -1.f, 0.f),
+	vec3(0.f, 0.f, 1.f), vec3(0.f, 0.f, -1.f)
+);
+
+void main()
+{
+	vec3 local = vec3(aVoxel & 63u, (aVoxel >> 6) & 63u, (aVoxel >> 12) & 63u);
+	uint face = (aVoxel >> 18) & 7u;
+	Block = aVoxel >> 21;
+	Normal = FACE_NORMALS[face];
+
+	// One texel repeat per voxel, merged quads tile instead of stretching
+	uint axis = face / 2u;
+	TexCoord = axis == 0u ? local.zy : (axis == 1u ? local.xz : local.xy);
+
+	gl_Position = projection * view * vec4(chunkOrigin + local, 1.f);
+}
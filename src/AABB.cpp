@@ -0,0 +1,103 @@
+#include "AABB.h"
+
+#include <algorithm>
+
+Ray::Ray(const glm::vec3& origin, const glm::vec3& direction)
+	: Origin(origin), Direction(direction)
+{
+	// Division by zero gives +-inf which the slab test handles on purpose
+	InvDirection = 1.f / direction;
+}
+
+AABB::AABB(const glm::vec3& min, const glm::vec3& max)
+	: Min(min), Max(max)
+{
+}
+
+void AABB::Expand(const glm::vec3& point)
+{
+	Min = glm::min(Min, point);
+	Max = glm::max(Max, point);
+}
+
+void AABB::Expand(const AABB& other)
+{
+	Min = glm::min(Min, other.Min);
+	Max = glm::max(Max, other.Max);
+}
+
+bool AABB::IsEmpty() const
+{
+	return Min.x > Max.x || Min.y > Max.y || Min.z > Max.z;
+}
+
+glm::vec3 AABB::GetCenter() const
+{
+	return (Min + Max) * 0.5f;
+}
+
+glm::vec3 AABB::GetExtents() const
+{
+	return (Max - Min) * 0.5f;
+}
+
+float AABB::GetSurfaceArea() const
+{
+	if (IsEmpty())
+		return 0.f;
+
+	glm::vec3 size = Max - Min;
+	return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+bool AABB::Contains(const glm::vec3& point) const
+{
+	return point.x >= Min.x && point.x <= Max.x
+		&& point.y >= Min.y && point.y <= Max.y
+		&& point.z >= Min.z && point.z <= Max.z;
+}
+
+bool AABB::Overlaps(const AABB& other) const
+{
+	return Min.x <= other.Max.x && Max.x >= other.Min.x
+		&& Min.y <= other.Max.y && Max.y >= other.Min.y
+		&& Min.z <= other.Max.z && Max.z >= other.Min.z;
+}
+
+bool AABB::OverlapsSphere(const glm::vec3& center, float radius) const
+{
+	glm::vec3 closest = glm::clamp(center, Min, Max);
+	glm::vec3 delta = center - closest;
+	return glm::dot(delta, delta) <= radius * radius;
+}
+
+bool AABB::IntersectRay(const Ray& ray, float maxDistance, float& tNear) const
+{
+	glm::vec3 t0 = (Min - ray.Origin) * ray.InvDirection;
+	glm::vec3 t1 = (Max - ray.Origin) * ray.InvDirection;
+	glm::vec3 tMin = glm::min(t0, t1);
+	glm::vec3 tMax = glm::max(t0, t1);
+
+	float entry = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.f));
+	float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+	if (entry > exit)
+		return false;
+
+	tNear = entry;
+	return true;
+}
+
+AABB AABB::Transformed(const glm::mat4& transform) const
+{
+	if (IsEmpty())
+		return *this;
+
+	// Arvo's method, project the extents on each transformed axis
+	glm::vec3 center = glm::vec3(transform * glm::vec4(GetCenter(), 1.f));
+	glm::vec3 extents = GetExtents();
+	glm::vec3 newExtents = glm::abs(glm::vec3(transform[0])) * extents.x
+		+ glm::abs(glm::vec3(transform[1])) * extents.y
+		+ glm::abs(glm::vec3(transform[2])) * extents.z;
+
+	return AABB(center - newExtents, center + newExtents);
+}
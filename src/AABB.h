@@ -0,0 +1,46 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <glm/glm.hpp>
+
+#include <limits>
+
+struct Ray
+{
+	Ray() = default;
+	Ray(const glm::vec3& origin, const glm::vec3& direction);
+
+	glm::vec3 Origin = glm::vec3(0.f);
+	glm::vec3 Direction = glm::vec3(0.f, 0.f, -1.f);
+	// Cached for the slab test, 1 / Direction
+	glm::vec3 InvDirection = glm::vec3(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), -1.f);
+};
+
+struct AABB
+{
+	AABB() = default;
+	AABB(const glm::vec3& min, const glm::vec3& max);
+
+	// Default constructed boxes are empty so Expand() can grow them from nothing
+	glm::vec3 Min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 Max = glm::vec3(-std::numeric_limits<float>::max());
+
+	void Expand(const glm::vec3& point);
+	void Expand(const AABB& other);
+
+	bool IsEmpty() const;
+	glm::vec3 GetCenter() const;
+	glm::vec3 GetExtents() const;
+	float GetSurfaceArea() const;
+
+	bool Contains(const glm::vec3& point) const;
+	bool Overlaps(const AABB& other) const;
+	bool OverlapsSphere(const glm::vec3& center, float radius) const;
+	// Slab test, tNear is the entry distance along the ray
+	bool IntersectRay(const Ray& ray, float maxDistance, float& tNear) const;
+
+	// World bounds of this box after an affine transform
+	AABB Transformed(const glm::mat4& transform) const;
+};
+
+#endif // AABB_H
@@ -0,0 +1,556 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace
+{
+	constexpr uint32_t INVALID_NODE = 0xFFFFFFFFu;
+
+	struct BuildTask
+	{
+		uint32_t Node;
+		uint32_t First;
+		uint32_t Count;
+	};
+
+	struct Bin
+	{
+		AABB Bounds;
+		uint32_t Count = 0;
+	};
+}
+
+BVH::BVH()
+	: _buildCost(0.f), _areaCost(0.f)
+{
+}
+
+BVH::Tree BVH::BuildTree(const std::vector<AABB>& objectBounds)
+{
+	using namespace BVHDefaults;
+
+	Tree tree;
+	const uint32_t objectCount = static_cast<uint32_t>(objectBounds.size());
+	if (objectCount == 0)
+		return tree;
+
+	tree.ObjectIndices.resize(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++)
+		tree.ObjectIndices[i] = i;
+
+	std::vector<glm::vec3> centroids(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++)
+		centroids[i] = objectBounds[i].GetCenter();
+
+	tree.Nodes.reserve(2 * objectCount);
+	tree.Parents.reserve(2 * objectCount);
+	tree.Nodes.emplace_back();
+	tree.Parents.push_back(INVALID_NODE);
+
+	std::vector<BuildTask> stack;
+	stack.push_back({ 0, 0, objectCount });
+
+	while (!stack.empty())
+	{
+		BuildTask task = stack.back();
+		stack.pop_back();
+
+		AABB bounds;
+		AABB centroidBounds;
+		for (uint32_t i = task.First; i < task.First + task.Count; i++)
+		{
+			uint32_t object = tree.ObjectIndices[i];
+			bounds.Expand(objectBounds[object]);
+			centroidBounds.Expand(centroids[object]);
+		}
+		tree.Nodes[task.Node].Bounds = bounds;
+
+		auto makeLeaf = [&]()
+			{
+				tree.Nodes[task.Node].LeftFirst = task.First;
+				tree.Nodes[task.Node].Count = task.Count;
+			};
+
+		if (task.Count <= 1)
+		{
+			makeLeaf();
+			continue;
+		}
+
+		// Binned SAH, evaluate BIN_COUNT - 1 split planes on every axis
+		float bestCost = std::numeric_limits<float>::max();
+		int bestAxis = -1;
+		uint32_t bestSplit = 0;
+		glm::vec3 centroidExtent = centroidBounds.Max - centroidBounds.Min;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (centroidExtent[axis] <= 0.f)
+				continue;
+
+			Bin bins[BIN_COUNT];
+			const float scale = BIN_COUNT / centroidExtent[axis];
+			for (uint32_t i = task.First; i < task.First + task.Count; i++)
+			{
+				uint32_t object = tree.ObjectIndices[i];
+				uint32_t bin = std::min(BIN_COUNT - 1, static_cast<uint32_t>((centroids[object][axis] - centroidBounds.Min[axis]) * scale));
+				bins[bin].Count++;
+				bins[bin].Bounds.Expand(objectBounds[object]);
+			}
+
+			// Sweep from both sides so every split is evaluated in O(bins)
+			float leftArea[BIN_COUNT - 1], rightArea[BIN_COUNT - 1];
+			uint32_t leftCount[BIN_COUNT - 1], rightCount[BIN_COUNT - 1];
+			AABB leftBox, rightBox;
+			uint32_t leftSum = 0, rightSum = 0;
+			for (uint32_t i = 0; i < BIN_COUNT - 1; i++)
+			{
+				leftSum += bins[i].Count;
+				leftBox.Expand(bins[i].Bounds);
+				leftCount[i] = leftSum;
+				leftArea[i] = leftBox.GetSurfaceArea();
+
+				rightSum += bins[BIN_COUNT - 1 - i].Count;
+				rightBox.Expand(bins[BIN_COUNT - 1 - i].Bounds);
+				rightCount[BIN_COUNT - 2 - i] = rightSum;
+				rightArea[BIN_COUNT - 2 - i] = rightBox.GetSurfaceArea();
+			}
+
+			for (uint32_t i = 0; i < BIN_COUNT - 1; i++)
+			{
+				if (leftCount[i] == 0 || rightCount[i] == 0)
+					continue;
+
+				float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = i;
+				}
+			}
+		}
+
+		uint32_t leftCountFinal = 0;
+		const float nodeArea = std::max(bounds.GetSurfaceArea(), std::numeric_limits<float>::min());
+		const float leafCost = task.Count * INTERSECTION_COST;
+
+		if (bestAxis >= 0)
+		{
+			float splitCost = TRAVERSAL_COST + INTERSECTION_COST * bestCost / nodeArea;
+			if (splitCost >= leafCost && task.Count <= MAX_LEAF_SIZE)
+			{
+				makeLeaf();
+				continue;
+			}
+
+			const float scale = BIN_COUNT / centroidExtent[bestAxis];
+			auto middle = std::partition(tree.ObjectIndices.begin() + task.First, tree.ObjectIndices.begin() + task.First + task.Count,
+				[&](uint32_t object)
+				{
+					uint32_t bin = std::min(BIN_COUNT - 1, static_cast<uint32_t>((centroids[object][bestAxis] - centroidBounds.Min[bestAxis]) * scale));
+					return bin <= bestSplit;
+				});
+			leftCountFinal = static_cast<uint32_t>(middle - (tree.ObjectIndices.begin() + task.First));
+		}
+		else
+		{
+			// All centroids coincide, SAH can't separate them
+			if (task.Count <= MAX_LEAF_SIZE)
+			{
+				makeLeaf();
+				continue;
+			}
+			leftCountFinal = task.Count / 2;
+		}
+
+		uint32_t left = static_cast<uint32_t>(tree.Nodes.size());
+		tree.Nodes.emplace_back();
+		tree.Nodes.emplace_back();
+		tree.Parents.push_back(task.Node);
+		tree.Parents.push_back(task.Node);
+		tree.Nodes[task.Node].LeftFirst = left;
+		tree.Nodes[task.Node].Count = 0;
+
+		stack.push_back({ left, task.First, leftCountFinal });
+		stack.push_back({ left + 1, task.First + leftCountFinal, task.Count - leftCountFinal });
+	}
+
+	tree.ObjectLeaves.resize(objectCount);
+	for (uint32_t node = 0; node < tree.Nodes.size(); node++)
+	{
+		const BVHNode& leaf = tree.Nodes[node];
+		if (!leaf.IsLeaf())
+			continue;
+		for (uint32_t i = leaf.LeftFirst; i < leaf.LeftFirst + leaf.Count; i++)
+			tree.ObjectLeaves[tree.ObjectIndices[i]] = node;
+	}
+
+	return tree;
+}
+
+float BVH::GetNodeCostWeight(const BVHNode& node)
+{
+	using namespace BVHDefaults;
+	return node.IsLeaf() ? node.Count * INTERSECTION_COST : TRAVERSAL_COST;
+}
+
+float BVH::ComputeAreaCost(const std::vector<BVHNode>& nodes)
+{
+	float cost = 0.f;
+	for (const BVHNode& node : nodes)
+		cost += node.Bounds.GetSurfaceArea() * GetNodeCostWeight(node);
+	return cost;
+}
+
+float BVH::GetCurrentCost() const
+{
+	if (_tree.Nodes.empty())
+		return 0.f;
+
+	// SAH cost is relative to the root, the area sum itself is kept up to date incrementally
+	const float rootArea = std::max(_tree.Nodes[0].Bounds.GetSurfaceArea(), std::numeric_limits<float>::min());
+	return _areaCost / rootArea;
+}
+
+void BVH::SetNodeBounds(uint32_t node, const AABB& bounds)
+{
+	BVHNode& target = _tree.Nodes[node];
+	const float weight = GetNodeCostWeight(target);
+	_areaCost += (bounds.GetSurfaceArea() - target.Bounds.GetSurfaceArea()) * weight;
+	target.Bounds = bounds;
+}
+
+void BVH::Build(const std::vector<AABB>& objectBounds)
+{
+	// A rebuild still in flight was made for the old object set, its leaves no longer match
+	_pendingRebuild = std::future<Tree>();
+	_objectBounds = objectBounds;
+	AdoptTree(BuildTree(_objectBounds));
+	_buildCost = GetCurrentCost();
+}
+
+void BVH::AdoptTree(Tree&& tree)
+{
+	_tree = std::move(tree);
+	_dirtyLeaves.clear();
+	_isLeafDirty.assign(_tree.Nodes.size(), false);
+
+	_areaCost = ComputeAreaCost(_tree.Nodes);
+}
+
+AABB BVH::ComputeLeafBounds(const BVHNode& leaf) const
+{
+	AABB bounds;
+	for (uint32_t i = leaf.LeftFirst; i < leaf.LeftFirst + leaf.Count; i++)
+		bounds.Expand(_objectBounds[_tree.ObjectIndices[i]]);
+	return bounds;
+}
+
+void BVH::UpdateObject(uint32_t objectID, const AABB& bounds)
+{
+	_objectBounds[objectID] = bounds;
+
+	if (_tree.Nodes.empty())
+		return;
+
+	uint32_t leaf = _tree.ObjectLeaves[objectID];
+	if (!_isLeafDirty[leaf])
+	{
+		_isLeafDirty[leaf] = true;
+		_dirtyLeaves.push_back(leaf);
+	}
+}
+
+void BVH::Refit()
+{
+	if (_dirtyLeaves.empty())
+		return;
+
+	for (uint32_t leaf : _dirtyLeaves)
+	{
+		_isLeafDirty[leaf] = false;
+		SetNodeBounds(leaf, ComputeLeafBounds(_tree.Nodes[leaf]));
+
+		// Propagate until a parent doesn't change, shared ancestors stop early on the second pass
+		uint32_t node = _tree.Parents[leaf];
+		while (node != INVALID_NODE)
+		{
+			BVHNode& parent = _tree.Nodes[node];
+			AABB bounds = _tree.Nodes[parent.LeftFirst].Bounds;
+			bounds.Expand(_tree.Nodes[parent.LeftFirst + 1].Bounds);
+			if (bounds.Min == parent.Bounds.Min && bounds.Max == parent.Bounds.Max)
+				break;
+
+			SetNodeBounds(node, bounds);
+			node = _tree.Parents[node];
+		}
+	}
+	_dirtyLeaves.clear();
+}
+
+void BVH::RefitAll()
+{
+	// Children always come after their parent, so a reverse sweep is bottom-up
+	for (size_t i = _tree.Nodes.size(); i-- > 0;)
+	{
+		BVHNode& node = _tree.Nodes[i];
+		if (node.IsLeaf())
+		{
+			node.Bounds = ComputeLeafBounds(node);
+		}
+		else
+		{
+			node.Bounds = _tree.Nodes[node.LeftFirst].Bounds;
+			node.Bounds.Expand(_tree.Nodes[node.LeftFirst + 1].Bounds);
+		}
+	}
+}
+
+void BVH::Update(ThreadPool& pool)
+{
+	if (_pendingRebuild.valid() && _pendingRebuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		AdoptTree(_pendingRebuild.get());
+		// Objects kept moving while the build ran on a snapshot, bring every node up to date
+		RefitAll();
+		_areaCost = ComputeAreaCost(_tree.Nodes);
+		_buildCost = GetCurrentCost();
+		return;
+	}
+
+	Refit();
+
+	if (!_pendingRebuild.valid() && _buildCost > 0.f && GetCurrentCost() > _buildCost * BVHDefaults::REBUILD_THRESHOLD)
+	{
+		_pendingRebuild = pool.Submit([snapshot = _objectBounds]()
+			{
+				return BuildTree(snapshot);
+			});
+	}
+}
+
+bool BVH::IsRebuilding() const
+{
+	return _pendingRebuild.valid();
+}
+
+void BVH::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& outObjects) const
+{
+	if (_tree.Nodes.empty())
+		return;
+
+	// Nodes fully inside skip the plane tests for their whole subtree
+	struct Entry
+	{
+		uint32_t Node;
+		bool Inside;
+	};
+
+	std::vector<Entry> stack;
+	stack.reserve(64);
+	stack.push_back({ 0, false });
+
+	while (!stack.empty())
+	{
+		Entry entry = stack.back();
+		stack.pop_back();
+
+		const BVHNode& node = _tree.Nodes[entry.Node];
+		bool inside = entry.Inside;
+		if (!inside)
+		{
+			FrustumResult result = frustum.TestAABB(node.Bounds);
+			if (result == FrustumResult::Outside)
+				continue;
+			inside = result == FrustumResult::Inside;
+		}
+
+		if (node.IsLeaf())
+		{
+			for (uint32_t i = node.LeftFirst; i < node.LeftFirst + node.Count; i++)
+			{
+				uint32_t object = _tree.ObjectIndices[i];
+				if (inside || node.Count == 1 || frustum.IntersectsAABB(_objectBounds[object]))
+					outObjects.push_back(object);
+			}
+			continue;
+		}
+
+		stack.push_back({ node.LeftFirst + 1, inside });
+		stack.push_back({ node.LeftFirst, inside });
+	}
+}
+
+void BVH::QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& outObjects) const
+{
+	if (_tree.Nodes.empty())
+		return;
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const BVHNode& node = _tree.Nodes[stack.back()];
+		stack.pop_back();
+
+		if (!node.Bounds.OverlapsSphere(center, radius))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			for (uint32_t i = node.LeftFirst; i < node.LeftFirst + node.Count; i++)
+			{
+				uint32_t object = _tree.ObjectIndices[i];
+				if (_objectBounds[object].OverlapsSphere(center, radius))
+					outObjects.push_back(object);
+			}
+			continue;
+		}
+
+		stack.push_back(node.LeftFirst + 1);
+		stack.push_back(node.LeftFirst);
+	}
+}
+
+void BVH::QueryAABB(const AABB& box, std::vector<uint32_t>& outObjects) const
+{
+	if (_tree.Nodes.empty())
+		return;
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const BVHNode& node = _tree.Nodes[stack.back()];
+		stack.pop_back();
+
+		if (!node.Bounds.Overlaps(box))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			for (uint32_t i = node.LeftFirst; i < node.LeftFirst + node.Count; i++)
+			{
+				uint32_t object = _tree.ObjectIndices[i];
+				if (_objectBounds[object].Overlaps(box))
+					outObjects.push_back(object);
+			}
+			continue;
+		}
+
+		stack.push_back(node.LeftFirst + 1);
+		stack.push_back(node.LeftFirst);
+	}
+}
+
+bool BVH::Raycast(const Ray& ray, float maxDistance, RayHit& outHit, const RayIntersector& intersector /*= nullptr*/) const
+{
+	if (_tree.Nodes.empty())
+		return false;
+
+	float closest = maxDistance;
+	bool hit = false;
+
+	struct Entry
+	{
+		uint32_t Node;
+		float Distance;
+	};
+
+	std::vector<Entry> stack;
+	stack.reserve(64);
+
+	float rootDistance;
+	if (!_tree.Nodes[0].Bounds.IntersectRay(ray, closest, rootDistance))
+		return false;
+	stack.push_back({ 0, rootDistance });
+
+	while (!stack.empty())
+	{
+		Entry entry = stack.back();
+		stack.pop_back();
+
+		// Something closer was found since this node got pushed
+		if (entry.Distance > closest)
+			continue;
+
+		const BVHNode& node = _tree.Nodes[entry.Node];
+		if (node.IsLeaf())
+		{
+			for (uint32_t i = node.LeftFirst; i < node.LeftFirst + node.Count; i++)
+			{
+				uint32_t object = _tree.ObjectIndices[i];
+				float distance;
+				if (!_objectBounds[object].IntersectRay(ray, closest, distance))
+					continue;
+				if (intersector && !intersector(object, ray, closest, distance))
+					continue;
+
+				if (distance <= closest)
+				{
+					closest = distance;
+					outHit.ObjectID = object;
+					outHit.Distance = distance;
+					hit = true;
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so the far one is usually pruned
+		float leftDistance, rightDistance;
+		bool leftHit = _tree.Nodes[node.LeftFirst].Bounds.IntersectRay(ray, closest, leftDistance);
+		bool rightHit = _tree.Nodes[node.LeftFirst + 1].Bounds.IntersectRay(ray, closest, rightDistance);
+
+		if (leftHit && rightHit)
+		{
+			if (leftDistance <= rightDistance)
+			{
+				stack.push_back({ node.LeftFirst + 1, rightDistance });
+				stack.push_back({ node.LeftFirst, leftDistance });
+			}
+			else
+			{
+				stack.push_back({ node.LeftFirst, leftDistance });
+				stack.push_back({ node.LeftFirst + 1, rightDistance });
+			}
+		}
+		else if (leftHit)
+		{
+			stack.push_back({ node.LeftFirst, leftDistance });
+		}
+		else if (rightHit)
+		{
+			stack.push_back({ node.LeftFirst + 1, rightDistance });
+		}
+	}
+
+	return hit;
+}
+
+const AABB& BVH::GetObjectBounds(uint32_t objectID) const
+{
+	return _objectBounds[objectID];
+}
+
+uint32_t BVH::GetObjectCount() const
+{
+	return static_cast<uint32_t>(_objectBounds.size());
+}
+
+uint32_t BVH::GetNodeCount() const
+{
+	return static_cast<uint32_t>(_tree.Nodes.size());
+}
+
+float BVH::GetQuality() const
+{
+	return _buildCost > 0.f ? GetCurrentCost() / _buildCost : 1.f;
+}
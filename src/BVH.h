@@ -0,0 +1,105 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "AABB.h"
+#include "Frustum.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <vector>
+
+struct BVHNode
+{
+	AABB Bounds;
+	// Interior nodes: index of the left child, the right one follows it
+	// Leaves: first entry in the object index list
+	uint32_t LeftFirst = 0;
+	// Number of objects in a leaf, 0 for interior nodes
+	uint32_t Count = 0;
+
+	bool IsLeaf() const { return Count > 0; }
+};
+
+struct RayHit
+{
+	uint32_t ObjectID = 0;
+	float Distance = 0.f;
+};
+
+namespace BVHDefaults
+{
+	constexpr uint32_t BIN_COUNT = 16;
+	constexpr uint32_t MAX_LEAF_SIZE = 4;
+	constexpr float TRAVERSAL_COST = 1.f;
+	constexpr float INTERSECTION_COST = 1.f;
+	// Rebuild once refitting made the tree this much worse than when it was built
+	constexpr float REBUILD_THRESHOLD = 1.5f;
+}
+
+class BVH
+{
+public:
+	// Exact hit test for one object, returns true and the distance when it is closer than maxDistance
+	using RayIntersector = std::function<bool(uint32_t objectID, const Ray& ray, float maxDistance, float& distance)>;
+
+private:
+	struct Tree
+	{
+		std::vector<BVHNode> Nodes;
+		std::vector<uint32_t> ObjectIndices;
+		std::vector<uint32_t> Parents;
+		// Leaf holding each object, used to start refits
+		std::vector<uint32_t> ObjectLeaves;
+	};
+
+	Tree _tree;
+	std::vector<AABB> _objectBounds;
+
+	std::vector<uint32_t> _dirtyLeaves;
+	std::vector<bool> _isLeafDirty;
+
+	float _buildCost;
+	// Sum of surface area times cost weight over all nodes
+	float _areaCost;
+	std::future<Tree> _pendingRebuild;
+
+	static Tree BuildTree(const std::vector<AABB>& objectBounds);
+	static float GetNodeCostWeight(const BVHNode& node);
+	static float ComputeAreaCost(const std::vector<BVHNode>& nodes);
+	float GetCurrentCost() const;
+	void SetNodeBounds(uint32_t node, const AABB& bounds);
+
+	void AdoptTree(Tree&& tree);
+	void RefitAll();
+	AABB ComputeLeafBounds(const BVHNode& leaf) const;
+
+public:
+	BVH();
+
+	// Synchronous binned SAH build over the given object bounds, object IDs are indices into it
+	void Build(const std::vector<AABB>& objectBounds);
+
+	// Queue a bounds change, the tree picks it up on the next Refit()
+	void UpdateObject(uint32_t objectID, const AABB& bounds);
+	// Walks up from the changed leaves only, cost is proportional to the number of moved objects
+	void Refit();
+	// Refit, kick off a background rebuild when quality degraded and swap it in once done
+	void Update(ThreadPool& pool);
+	bool IsRebuilding() const;
+
+	void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& outObjects) const;
+	void QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& outObjects) const;
+	void QueryAABB(const AABB& box, std::vector<uint32_t>& outObjects) const;
+	// Closest hit, falls back to the object bounds when no intersector is given
+	bool Raycast(const Ray& ray, float maxDistance, RayHit& outHit, const RayIntersector& intersector = nullptr) const;
+
+	const AABB& GetObjectBounds(uint32_t objectID) const;
+	uint32_t GetObjectCount() const;
+	uint32_t GetNodeCount() const;
+	// SAH cost relative to the cost right after the last build
+	float GetQuality() const;
+};
+
+#endif // BVH_H
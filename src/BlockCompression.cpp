@@ -0,0 +1,273 @@
+#include "BlockCompression.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace BlockCompressionDefaults;
+
+namespace
+{
+	constexpr int BLOCK_TEXELS = BLOCK_DIMENSION * BLOCK_DIMENSION;
+
+	uint16_t To565(const float color[3])
+	{
+		auto quantize = [](float value, int maximum)
+			{
+				return static_cast<uint16_t>(std::clamp(static_cast<int>(value * maximum / 255.f + 0.5f), 0, maximum));
+			};
+		return static_cast<uint16_t>((quantize(color[0], 31) << 11) | (quantize(color[1], 63) << 5) | quantize(color[2], 31));
+	}
+
+	// What the GPU expands the endpoint to, the palette has to match it
+	void From565(uint16_t packed, int color[3])
+	{
+		const int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	void LoadBlock(const uint8_t* rgba, int width, int height, int blockX, int blockY, uint8_t block[BLOCK_TEXELS * 4])
+	{
+		for (int y = 0; y < BLOCK_DIMENSION; y++)
+		{
+			const int sourceY = std::min(blockY * BLOCK_DIMENSION + y, height - 1);
+			for (int x = 0; x < BLOCK_DIMENSION; x++)
+			{
+				const int sourceX = std::min(blockX * BLOCK_DIMENSION + x, width - 1);
+				std::memcpy(&block[(y * BLOCK_DIMENSION + x) * 4], &rgba[(static_cast<size_t>(sourceY) * width + sourceX) * 4], 4);
+			}
+		}
+	}
+
+	// Endpoints at the ends of the principal axis, pulled in by a sixteenth so the
+	// interpolated colors land on the bulk of the texels instead of the outliers
+	void CompressColorBlock(const uint8_t block[BLOCK_TEXELS * 4], uint8_t out[8])
+	{
+		float mean[3] = {};
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			for (int c = 0; c < 3; c++)
+				mean[c] += block[i * 4 + c];
+		}
+		for (int c = 0; c < 3; c++)
+			mean[c] /= BLOCK_TEXELS;
+
+		float covariance[3][3] = {};
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			const float d[3] = { block[i * 4] - mean[0], block[i * 4 + 1] - mean[1], block[i * 4 + 2] - mean[2] };
+			for (int a = 0; a < 3; a++)
+			{
+				for (int b = 0; b < 3; b++)
+					covariance[a][b] += d[a] * d[b];
+			}
+		}
+
+		float axis[3] = { 1.f, 1.f, 1.f };
+		for (int iteration = 0; iteration < AXIS_ITERATIONS; iteration++)
+		{
+			float next[3];
+			for (int a = 0; a < 3; a++)
+				next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+			const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+			if (length < 1e-6f)
+				break;
+			for (int a = 0; a < 3; a++)
+				axis[a] = next[a] / length;
+		}
+
+		float minimum = 0.f, maximum = 0.f;
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			const float t = (block[i * 4] - mean[0]) * axis[0] + (block[i * 4 + 1] - mean[1]) * axis[1] + (block[i * 4 + 2] - mean[2]) * axis[2];
+			minimum = std::min(minimum, t);
+			maximum = std::max(maximum, t);
+		}
+		const float inset = (maximum - minimum) / 16.f;
+		minimum += inset;
+		maximum -= inset;
+
+		float high[3], low[3];
+		for (int c = 0; c < 3; c++)
+		{
+			high[c] = mean[c] + axis[c] * maximum;
+			low[c] = mean[c] + axis[c] * minimum;
+		}
+		uint16_t color0 = To565(high), color1 = To565(low);
+		// color0 > color1 selects the four color mode, equal endpoints make every index 0 exact
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		std::memcpy(out, &color0, 2);
+		std::memcpy(out + 2, &color1, 2);
+		std::memset(out + 4, 0, 4);
+		if (color0 == color1)
+			return;
+
+		int palette[4][3];
+		From565(color0, palette[0]);
+		From565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			int best = 0, bestError = INT32_MAX;
+			for (int p = 0; p < 4; p++)
+			{
+				int error = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					const int d = block[i * 4 + c] - palette[p][c];
+					error += d * d;
+				}
+				if (error < bestError)
+				{
+					best = p;
+					bestError = error;
+				}
+			}
+			out[4 + i / BLOCK_DIMENSION] |= static_cast<uint8_t>(best << (2 * (i % BLOCK_DIMENSION)));
+		}
+	}
+
+	// Eight value mode between the block's alpha extremes, 3 bit indices packed little endian
+	void CompressAlphaBlock(const uint8_t block[BLOCK_TEXELS * 4], uint8_t out[8])
+	{
+		int alpha0 = 0, alpha1 = 255;
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			alpha0 = std::max(alpha0, static_cast<int>(block[i * 4 + 3]));
+			alpha1 = std::min(alpha1, static_cast<int>(block[i * 4 + 3]));
+		}
+		out[0] = static_cast<uint8_t>(alpha0);
+		out[1] = static_cast<uint8_t>(alpha1);
+		std::memset(out + 2, 0, 6);
+		if (alpha0 == alpha1)
+			return;
+
+		int palette[8] = { alpha0, alpha1 };
+		for (int p = 1; p < 7; p++)
+			palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+
+		uint64_t indices = 0;
+		for (int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			int best = 0, bestError = INT32_MAX;
+			for (int p = 0; p < 8; p++)
+			{
+				const int error = std::abs(block[i * 4 + 3] - palette[p]);
+				if (error < bestError)
+				{
+					best = p;
+					bestError = error;
+				}
+			}
+			indices |= static_cast<uint64_t>(best) << (3 * i);
+		}
+		for (int b = 0; b < 6; b++)
+			out[2 + b] = static_cast<uint8_t>(indices >> (8 * b));
+	}
+}
+
+size_t GetBlockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t GetCompressedSize(BlockFormat format, int width, int height)
+{
+	const size_t blocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	const size_t blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	return blocksX * blocksY * GetBlockBytes(format);
+}
+
+void CompressImage(BlockFormat format, const uint8_t* rgba, int width, int height, uint8_t* outBlocks, ThreadPool& pool)
+{
+	const int blocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	const int blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	const size_t blockBytes = GetBlockBytes(format);
+	pool.ParallelFor(static_cast<uint32_t>(blocksY), 4, [&](uint32_t begin, uint32_t end)
+		{
+			uint8_t block[BLOCK_TEXELS * 4];
+			for (uint32_t blockY = begin; blockY < end; blockY++)
+			{
+				for (int blockX = 0; blockX < blocksX; blockX++)
+				{
+					uint8_t* out = outBlocks + (static_cast<size_t>(blockY) * blocksX + blockX) * blockBytes;
+					LoadBlock(rgba, width, height, blockX, static_cast<int>(blockY), block);
+					if (format == BlockFormat::BC3)
+					{
+						CompressAlphaBlock(block, out);
+						out += 8;
+					}
+					CompressColorBlock(block, out);
+				}
+			}
+		});
+}
+
+std::vector<uint8_t> DownsampleImage(const uint8_t* rgba, int width, int height)
+{
+	const int halfWidth = std::max(width / 2, 1), halfHeight = std::max(height / 2, 1);
+	std::vector<uint8_t> half(static_cast<size_t>(halfWidth) * halfHeight * 4);
+	for (int y = 0; y < halfHeight; y++)
+	{
+		const size_t row0 = static_cast<size_t>(std::min(2 * y, height - 1)) * width;
+		const size_t row1 = static_cast<size_t>(std::min(2 * y + 1, height - 1)) * width;
+		for (int x = 0; x < halfWidth; x++)
+		{
+			const int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+			for (int c = 0; c < 4; c++)
+			{
+				const int sum = rgba[(row0 + x0) * 4 + c] + rgba[(row0 + x1) * 4 + c] + rgba[(row1 + x0) * 4 + c] + rgba[(row1 + x1) * 4 + c];
+				half[(static_cast<size_t>(y) * halfWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+			}
+		}
+	}
+	return half;
+}
+
+bool CanFlipCompressed(int height)
+{
+	return height % BLOCK_DIMENSION == 0 || height < BLOCK_DIMENSION;
+}
+
+void FlipCompressedVertically(BlockFormat format, uint8_t* blocks, int width, int height)
+{
+	const size_t blockBytes = GetBlockBytes(format);
+	const size_t rowBytes = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION * blockBytes;
+	const int blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	for (int y = 0; y < blocksY / 2; y++)
+		std::swap_ranges(blocks + y * rowBytes, blocks + (y + 1) * rowBytes, blocks + (blocksY - 1 - y) * rowBytes);
+
+	// Only the rows inside the image trade places in a level shorter than a block
+	const int rows = std::min(height, BLOCK_DIMENSION);
+	for (uint8_t* block = blocks; block < blocks + blocksY * rowBytes; block += blockBytes)
+	{
+		uint8_t* color = block;
+		if (format == BlockFormat::BC3)
+		{
+			uint64_t indices = 0;
+			for (int b = 0; b < 6; b++)
+				indices |= static_cast<uint64_t>(block[2 + b]) << (8 * b);
+			uint64_t flipped = indices;
+			for (int row = 0; row < rows; row++)
+			{
+				const uint64_t rowBits = (indices >> (12 * row)) & 0xfff;
+				flipped &= ~(0xfffull << (12 * (rows - 1 - row)));
+				flipped |= rowBits << (12 * (rows - 1 - row));
+			}
+			for (int b = 0; b < 6; b++)
+				block[2 + b] = static_cast<uint8_t>(flipped >> (8 * b));
+			color += 8;
+		}
+		std::reverse(color + 4, color + 4 + rows);
+	}
+}
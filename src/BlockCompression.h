@@ -0,0 +1,40 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+namespace BlockCompressionDefaults
+{
+	// Texels per block edge, every S3TC format
+	constexpr int BLOCK_DIMENSION = 4;
+	// Power iterations for a block's principal color axis
+	constexpr int AXIS_ITERATIONS = 4;
+}
+
+// Formats the cook writes. BC1 stores opaque color at 4 bits a texel, BC3 adds a separately
+// interpolated alpha block for 8 bits a texel.
+enum class BlockFormat : uint32_t
+{
+	BC1,
+	BC3
+};
+
+size_t GetBlockBytes(BlockFormat format);
+size_t GetCompressedSize(BlockFormat format, int width, int height);
+
+// RGBA8 rows, blocks left to right then top to bottom. Texels past the edge repeat the last
+// row or column so partial blocks don't pull their endpoints toward garbage.
+void CompressImage(BlockFormat format, const uint8_t* rgba, int width, int height, uint8_t* outBlocks, ThreadPool& pool);
+// Box filtered RGBA8 level of half the size, odd edges clamp
+std::vector<uint8_t> DownsampleImage(const uint8_t* rgba, int width, int height);
+
+// Whole blocks can only swap rows when no block straddles the flipped edge
+bool CanFlipCompressed(int height);
+// Reverses the rows of a compressed level in place: block rows and the texel rows inside each block
+void FlipCompressedVertically(BlockFormat format, uint8_t* blocks, int width, int height);
+
+#endif // BLOCK_COMPRESSION_H
@@ -0,0 +1,421 @@
+#include "CDLODTerrain.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace CDLODDefaults;
+
+namespace
+{
+	int PositiveModulo(int value, int divisor)
+	{
+		int remainder = value % divisor;
+		return remainder < 0 ? remainder + divisor : remainder;
+	}
+}
+
+void CDLODSelection::Clear()
+{
+	for (std::vector<CDLODInstance>& quadrant : Quadrants)
+		quadrant.clear();
+}
+
+uint32_t CDLODSelection::GetInstanceCount() const
+{
+	size_t count = 0;
+	for (const std::vector<CDLODInstance>& quadrant : Quadrants)
+		count += quadrant.size();
+	return static_cast<uint32_t>(count);
+}
+
+CDLODQuadtree::CDLODQuadtree()
+	: _origin(0.f), _spacing(1.f), _heightScale(0.f), _cells(0)
+{
+}
+
+void CDLODQuadtree::Build(const HeightField& field, const glm::vec3& origin, float spacing, float heightScale)
+{
+	_origin = origin;
+	_spacing = spacing;
+	_heightScale = heightScale;
+	_cells = field.Resolution - 1;
+
+	// Enough levels for a single root over the whole field
+	uint32_t lodCount = 1;
+	while (lodCount < MAX_LODS && (GRID_SIZE << (lodCount - 1)) < _cells)
+		lodCount++;
+
+	// Leaves straight from the samples, edges shared with the neighbours included
+	_levels.assign(lodCount, std::vector<HeightRange>());
+	uint32_t side = 1u << (lodCount - 1);
+	_levels[0].resize(static_cast<size_t>(side) * side);
+	for (uint32_t z = 0; z < side; z++)
+	{
+		for (uint32_t x = 0; x < side; x++)
+		{
+			// Empty stays inverted, selection skips it
+			HeightRange range = { FLT_MAX, -FLT_MAX };
+			const uint32_t x0 = x * GRID_SIZE;
+			const uint32_t z0 = z * GRID_SIZE;
+			if (x0 < _cells && z0 < _cells)
+			{
+				const uint32_t x1 = std::min(x0 + GRID_SIZE, _cells);
+				const uint32_t z1 = std::min(z0 + GRID_SIZE, _cells);
+				for (uint32_t sampleZ = z0; sampleZ <= z1; sampleZ++)
+				{
+					for (uint32_t sampleX = x0; sampleX <= x1; sampleX++)
+					{
+						float height = field.GetHeight(sampleX, sampleZ);
+						range.Min = std::min(range.Min, height);
+						range.Max = std::max(range.Max, height);
+					}
+				}
+			}
+			_levels[0][static_cast<size_t>(z) * side + x] = range;
+		}
+	}
+
+	for (uint32_t lod = 1; lod < lodCount; lod++)
+	{
+		const uint32_t childSide = side;
+		side /= 2;
+		const std::vector<HeightRange>& children = _levels[lod - 1];
+		_levels[lod].resize(static_cast<size_t>(side) * side);
+		for (uint32_t z = 0; z < side; z++)
+		{
+			for (uint32_t x = 0; x < side; x++)
+			{
+				HeightRange range = { FLT_MAX, -FLT_MAX };
+				for (uint32_t child = 0; child < 4; child++)
+				{
+					const HeightRange& childRange = children[static_cast<size_t>(z * 2 + (child >> 1)) * childSide + x * 2 + (child & 1)];
+					range.Min = std::min(range.Min, childRange.Min);
+					range.Max = std::max(range.Max, childRange.Max);
+				}
+				_levels[lod][static_cast<size_t>(z) * side + x] = range;
+			}
+		}
+	}
+
+	_ranges.resize(lodCount);
+	for (uint32_t lod = 0; lod < lodCount; lod++)
+		_ranges[lod] = FIRST_RANGE * GetNodeSize(0) * static_cast<float>(1u << lod);
+	_ranges[lodCount - 1] = FLT_MAX;
+}
+
+bool CDLODQuadtree::SelectNode(uint32_t lod, uint32_t x, uint32_t z, const glm::vec3& cameraPosition, const Frustum& frustum, CDLODSelection& outSelection) const
+{
+	const uint32_t side = 1u << (GetLODCount() - 1 - lod);
+	const HeightRange& heights = _levels[lod][static_cast<size_t>(z) * side + x];
+	// Past the end of the field, nothing to draw and nothing for the parent to fill in
+	if (heights.Min > heights.Max)
+		return true;
+
+	const AABB bounds = GetNodeBounds(lod, x, z);
+	if (!bounds.OverlapsSphere(cameraPosition, _ranges[lod]))
+		return false;
+	if (!frustum.IntersectsAABB(bounds))
+		return true;
+
+	const CDLODInstance instance = { bounds.Min.x, bounds.Min.z, GetNodeSize(lod), static_cast<float>(lod) };
+	if (lod == 0 || !bounds.OverlapsSphere(cameraPosition, _ranges[lod - 1]))
+	{
+		for (std::vector<CDLODInstance>& quadrant : outSelection.Quadrants)
+			quadrant.push_back(instance);
+		return true;
+	}
+
+	// Whatever the children leave out of range is covered at this node's LOD
+	for (uint32_t quadrant = 0; quadrant < 4; quadrant++)
+	{
+		if (!SelectNode(lod - 1, x * 2 + (quadrant & 1), z * 2 + (quadrant >> 1), cameraPosition, frustum, outSelection))
+			outSelection.Quadrants[quadrant].push_back(instance);
+	}
+	return true;
+}
+
+void CDLODQuadtree::Select(const glm::vec3& cameraPosition, const Frustum& frustum, CDLODSelection& outSelection) const
+{
+	outSelection.Clear();
+	if (_levels.empty())
+		return;
+	SelectNode(GetLODCount() - 1, 0, 0, cameraPosition, frustum, outSelection);
+}
+
+uint32_t CDLODQuadtree::GetLODCount() const
+{
+	return static_cast<uint32_t>(_levels.size());
+}
+
+float CDLODQuadtree::GetRange(uint32_t lod) const
+{
+	return _ranges[lod];
+}
+
+float CDLODQuadtree::GetMorphStart(uint32_t lod) const
+{
+	if (_ranges[lod] == FLT_MAX)
+		return FLT_MAX;
+	const float previous = lod > 0 ? _ranges[lod - 1] : 0.f;
+	return previous + (_ranges[lod] - previous) * MORPH_START;
+}
+
+float CDLODQuadtree::GetNodeSize(uint32_t lod) const
+{
+	return static_cast<float>(GRID_SIZE << lod) * _spacing;
+}
+
+AABB CDLODQuadtree::GetNodeBounds(uint32_t lod, uint32_t x, uint32_t z) const
+{
+	const uint32_t side = 1u << (GetLODCount() - 1 - lod);
+	const HeightRange& heights = _levels[lod][static_cast<size_t>(z) * side + x];
+	const float size = GetNodeSize(lod);
+	const glm::vec3 min(_origin.x + x * size, _origin.y + heights.Min * _heightScale, _origin.z + z * size);
+	return AABB(min, glm::vec3(min.x + size, _origin.y + heights.Max * _heightScale, min.z + size));
+}
+
+CDLODTerrain::CDLODTerrain()
+	: _shader("resources/shaders/cdlod.vert", "resources/shaders/terrain.frag"),
+	_field(nullptr), _origin(0.f), _spacing(1.f), _heightScale(0.f),
+	_vao(0), _gridVBO(0), _gridEBO(0), _instanceVBO(0), _instanceCapacity(0), _quadrantIndexCount(0),
+	_clipmap(0), _uploadedTexels(0)
+{
+	// Shared grid over [0, 1], indices grouped by quadrant so a partly covered node draws only what it needs
+	std::vector<glm::vec2> corners;
+	corners.reserve((GRID_SIZE + 1) * (GRID_SIZE + 1));
+	for (uint32_t z = 0; z <= GRID_SIZE; z++)
+	{
+		for (uint32_t x = 0; x <= GRID_SIZE; x++)
+			corners.emplace_back(static_cast<float>(x) / GRID_SIZE, static_cast<float>(z) / GRID_SIZE);
+	}
+
+	constexpr uint32_t HALF = GRID_SIZE / 2;
+	std::vector<uint32_t> indices;
+	indices.reserve(GRID_SIZE * GRID_SIZE * 6);
+	for (uint32_t quadrant = 0; quadrant < 4; quadrant++)
+	{
+		const uint32_t x0 = (quadrant & 1) * HALF;
+		const uint32_t z0 = (quadrant >> 1) * HALF;
+		for (uint32_t z = z0; z < z0 + HALF; z++)
+		{
+			for (uint32_t x = x0; x < x0 + HALF; x++)
+			{
+				uint32_t corner = z * (GRID_SIZE + 1) + x;
+				indices.insert(indices.end(), { corner, corner + GRID_SIZE + 1, corner + 1 });
+				indices.insert(indices.end(), { corner + 1, corner + GRID_SIZE + 1, corner + GRID_SIZE + 2 });
+			}
+		}
+	}
+	_quadrantIndexCount = HALF * HALF * 6;
+
+	GL_CHECK(glGenVertexArrays(1, &_vao));
+	GL_CHECK(glGenBuffers(1, &_gridVBO));
+	GL_CHECK(glGenBuffers(1, &_gridEBO));
+	GL_CHECK(glGenBuffers(1, &_instanceVBO));
+
+	GL_CHECK(glBindVertexArray(_vao));
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, _gridVBO));
+	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, corners.size() * sizeof(glm::vec2), corners.data(), GL_STATIC_DRAW));
+	GL_CHECK(glEnableVertexAttribArray(0));
+	GL_CHECK(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0));
+	GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _gridEBO));
+	GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW));
+
+	// Pointed at each quadrant's run of instances right before its draw
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, _instanceVBO));
+	GL_CHECK(glEnableVertexAttribArray(1));
+	GL_CHECK(glVertexAttribDivisor(1, 1));
+	GL_CHECK(glBindVertexArray(0));
+
+	GL_CHECK(glGenTextures(1, &_clipmap));
+}
+
+CDLODTerrain::~CDLODTerrain()
+{
+	glDeleteTextures(1, &_clipmap);
+	glDeleteBuffers(1, &_instanceVBO);
+	glDeleteBuffers(1, &_gridEBO);
+	glDeleteBuffers(1, &_gridVBO);
+	glDeleteVertexArrays(1, &_vao);
+}
+
+void CDLODTerrain::SetHeightField(const HeightField& field, const glm::vec3& origin, float spacing, float heightScale)
+{
+	_field = &field;
+	_origin = origin;
+	_spacing = spacing;
+	_heightScale = heightScale;
+	_quadtree.Build(field, origin, spacing, heightScale);
+
+	const uint32_t lodCount = _quadtree.GetLODCount();
+	_clipmapCenters.assign(lodCount, glm::ivec2(0));
+	_clipmapValid.assign(lodCount, false);
+
+	// Wrapped addressing is what makes the layers ring buffers, the shader never sees the window offset
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, _clipmap));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	GL_CHECK(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R16, CLIPMAP_SIZE, CLIPMAP_SIZE, lodCount, 0, GL_RED, GL_UNSIGNED_SHORT, nullptr));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+}
+
+void CDLODTerrain::UploadRegion(uint32_t lod, int x0, int z0, int x1, int z1)
+{
+	constexpr int SIZE = static_cast<int>(CLIPMAP_SIZE);
+	const int last = static_cast<int>(_field->Resolution) - 1;
+	const int step = 1 << lod;
+
+	// Split where the region wraps past the layer's edge
+	for (int z = z0; z < z1;)
+	{
+		const int layerZ = PositiveModulo(z, SIZE);
+		const int rows = std::min(z1 - z, SIZE - layerZ);
+		for (int x = x0; x < x1;)
+		{
+			const int layerX = PositiveModulo(x, SIZE);
+			const int columns = std::min(x1 - x, SIZE - layerX);
+
+			// Point samples, a texel of a coarser layer is the exact height its vertices morph onto
+			_uploadScratch.resize(static_cast<size_t>(rows) * columns);
+			for (int row = 0; row < rows; row++)
+			{
+				const uint32_t sampleZ = static_cast<uint32_t>(std::clamp((z + row) * step, 0, last));
+				for (int column = 0; column < columns; column++)
+				{
+					const uint32_t sampleX = static_cast<uint32_t>(std::clamp((x + column) * step, 0, last));
+					_uploadScratch[static_cast<size_t>(row) * columns + column] = static_cast<uint16_t>(_field->GetHeight(sampleX, sampleZ) * 65535.f + 0.5f);
+				}
+			}
+			GL_CHECK(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, layerX, layerZ, lod, columns, rows, 1, GL_RED, GL_UNSIGNED_SHORT, _uploadScratch.data()));
+			_uploadedTexels += static_cast<uint32_t>(rows * columns);
+			x += columns;
+		}
+		z += rows;
+	}
+}
+
+void CDLODTerrain::UpdateClipmap(const glm::vec3& cameraPosition)
+{
+	constexpr int SIZE = static_cast<int>(CLIPMAP_SIZE);
+	constexpr int HALF = SIZE / 2;
+	_uploadedTexels = 0;
+
+	// Past the field's edge there is nothing new to show, the windows stop following
+	const float last = static_cast<float>(_field->Resolution - 1);
+	const float cameraX = std::clamp((cameraPosition.x - _origin.x) / _spacing, 0.f, last);
+	const float cameraZ = std::clamp((cameraPosition.z - _origin.z) / _spacing, 0.f, last);
+
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, _clipmap));
+	GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 2));
+	for (uint32_t lod = 0; lod < _quadtree.GetLODCount(); lod++)
+	{
+		const float texelSamples = static_cast<float>(1u << lod);
+		const glm::ivec2 center(static_cast<int>(std::floor(cameraX / texelSamples + 0.5f)), static_cast<int>(std::floor(cameraZ / texelSamples + 0.5f)));
+		const glm::ivec2 previous = _clipmapCenters[lod];
+		if (_clipmapValid[lod] && center == previous)
+			continue;
+
+		if (!_clipmapValid[lod] || std::abs(center.x - previous.x) >= SIZE || std::abs(center.y - previous.y) >= SIZE)
+		{
+			UploadRegion(lod, center.x - HALF, center.y - HALF, center.x + HALF, center.y + HALF);
+		}
+		else
+		{
+			// Columns that entered the window, then rows, the corner they share goes up twice
+			if (center.x > previous.x)
+				UploadRegion(lod, previous.x + HALF, center.y - HALF, center.x + HALF, center.y + HALF);
+			else if (center.x < previous.x)
+				UploadRegion(lod, center.x - HALF, center.y - HALF, previous.x - HALF, center.y + HALF);
+			if (center.y > previous.y)
+				UploadRegion(lod, center.x - HALF, previous.y + HALF, center.x + HALF, center.y + HALF);
+			else if (center.y < previous.y)
+				UploadRegion(lod, center.x - HALF, center.y - HALF, center.x + HALF, previous.y - HALF);
+		}
+		_clipmapCenters[lod] = center;
+		_clipmapValid[lod] = true;
+	}
+	GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+}
+
+void CDLODTerrain::Draw(const glm::mat4& view, const glm::mat4& projection, const Frustum& frustum, const glm::vec3& cameraPosition)
+{
+	if (!_field)
+		return;
+
+	UpdateClipmap(cameraPosition);
+	_quadtree.Select(cameraPosition, frustum, _selection);
+
+	// Quadrant runs back to back, orphaned every frame so the driver never waits on the last one
+	const size_t instanceCount = _selection.GetInstanceCount();
+	if (instanceCount == 0)
+		return;
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, _instanceVBO));
+	_instanceCapacity = std::max(_instanceCapacity, instanceCount);
+	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, _instanceCapacity * sizeof(CDLODInstance), nullptr, GL_STREAM_DRAW));
+	size_t offset = 0;
+	for (const std::vector<CDLODInstance>& quadrant : _selection.Quadrants)
+	{
+		if (!quadrant.empty())
+			GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(CDLODInstance), quadrant.size() * sizeof(CDLODInstance), quadrant.data()));
+		offset += quadrant.size();
+	}
+
+	const uint32_t lodCount = _quadtree.GetLODCount();
+	glm::vec2 morphRanges[MAX_LODS];
+	for (uint32_t lod = 0; lod < lodCount; lod++)
+		morphRanges[lod] = glm::vec2(_quadtree.GetMorphStart(lod), _quadtree.GetRange(lod));
+
+	_shader.Use();
+	_shader.SetUniformMat4fv("view", view);
+	_shader.SetUniformMat4fv("projection", projection);
+	_shader.SetUniformVec3("cameraPosition", cameraPosition);
+	_shader.SetUniformVec3("terrainOrigin", _origin);
+	_shader.SetUniformF("sampleSpacing", _spacing);
+	_shader.SetUniformF("heightScale", _heightScale);
+	_shader.SetUniformF("gridSize", static_cast<float>(GRID_SIZE));
+	_shader.SetUniformF("clipmapSize", static_cast<float>(CLIPMAP_SIZE));
+	_shader.SetUniformI("clipmap", 0);
+	GL_CHECK(glUniform2fv(glGetUniformLocation(_shader.GetProgramID(), "morphRanges"), lodCount, &morphRanges[0][0]));
+
+	GL_CHECK(glActiveTexture(GL_TEXTURE0));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, _clipmap));
+	GL_CHECK(glBindVertexArray(_vao));
+	offset = 0;
+	for (uint32_t quadrant = 0; quadrant < 4; quadrant++)
+	{
+		const std::vector<CDLODInstance>& instances = _selection.Quadrants[quadrant];
+		if (instances.empty())
+			continue;
+		GL_CHECK(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(CDLODInstance), (void*)(offset * sizeof(CDLODInstance))));
+		GL_CHECK(glDrawElementsInstanced(GL_TRIANGLES, _quadrantIndexCount, GL_UNSIGNED_INT,
+			(void*)(quadrant * _quadrantIndexCount * sizeof(uint32_t)), static_cast<GLsizei>(instances.size())));
+		offset += instances.size();
+	}
+	GL_CHECK(glBindVertexArray(0));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+}
+
+uint32_t CDLODTerrain::GetInstanceCount() const
+{
+	return _selection.GetInstanceCount();
+}
+
+uint32_t CDLODTerrain::GetTriangleCount() const
+{
+	return _selection.GetInstanceCount() * (_quadrantIndexCount / 3);
+}
+
+uint32_t CDLODTerrain::GetUploadedTexels() const
+{
+	return _uploadedTexels;
+}
+
+size_t CDLODTerrain::GetClipmapBytes() const
+{
+	return static_cast<size_t>(_quadtree.GetLODCount()) * CLIPMAP_SIZE * CLIPMAP_SIZE * sizeof(uint16_t);
+}
@@ -0,0 +1,142 @@
+#ifndef CDLOD_TERRAIN_H
+#define CDLOD_TERRAIN_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "AABB.h"
+#include "Frustum.h"
+#include "HeightField.h"
+#include "Shader.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace CDLODDefaults
+{
+	// Quads per side of the shared grid, a leaf node spans as many samples
+	constexpr uint32_t GRID_SIZE = 32;
+	// LOD 0 reaches this many leaf sizes from the camera, every further LOD twice as far
+	constexpr float FIRST_RANGE = 3.f;
+	// Fraction of a LOD's distance band after which its vertices start morphing into the next LOD
+	constexpr float MORPH_START = 0.7f;
+	// Texels per side of every clipmap layer, one layer per LOD
+	constexpr uint32_t CLIPMAP_SIZE = 512;
+	// 2^15 leaves across is far beyond any height field that fits in memory
+	constexpr uint32_t MAX_LODS = 16;
+
+	// A layer has to hold everything its LOD can draw: the range, a node diagonal past it and a filter texel
+	static_assert(CLIPMAP_SIZE / 2 > GRID_SIZE * (FIRST_RANGE + 1.5f) + 2, "Clipmap layers too small for the LOD ranges");
+}
+
+// One draw of a grid quadrant, world units
+struct CDLODInstance
+{
+	float X;
+	float Z;
+	// Side of the whole node the quadrant belongs to
+	float Size;
+	float LOD;
+};
+
+struct CDLODSelection
+{
+	// Quadrants of the shared grid: (0, 0), (1, 0), (0, 1), (1, 1) in X then Z
+	std::vector<CDLODInstance> Quadrants[4];
+
+	void Clear();
+	uint32_t GetInstanceCount() const;
+};
+
+// Min/max quadtree over a height field and the distance based node selection of CDLOD.
+// A node is drawn at its own LOD while the next finer range misses it, otherwise its
+// children are tried and every quadrant they leave out is drawn at the node's LOD.
+class CDLODQuadtree
+{
+private:
+	struct HeightRange
+	{
+		float Min;
+		float Max;
+	};
+
+	// [0] holds the leaves, the last level is the root
+	std::vector<std::vector<HeightRange>> _levels;
+	std::vector<float> _ranges;
+	glm::vec3 _origin;
+	float _spacing;
+	float _heightScale;
+	// Samples the field spans minus one, nodes starting past it hold no terrain
+	uint32_t _cells;
+
+	bool SelectNode(uint32_t lod, uint32_t x, uint32_t z, const glm::vec3& cameraPosition, const Frustum& frustum, CDLODSelection& outSelection) const;
+
+public:
+	CDLODQuadtree();
+
+	// Sample (i, j) lands on origin + (i, height, j) * spacing with heights stretched by heightScale
+	void Build(const HeightField& field, const glm::vec3& origin, float spacing, float heightScale);
+	void Select(const glm::vec3& cameraPosition, const Frustum& frustum, CDLODSelection& outSelection) const;
+
+	uint32_t GetLODCount() const;
+	// Distance up to which a LOD is drawn, the coarsest has no limit
+	float GetRange(uint32_t lod) const;
+	float GetMorphStart(uint32_t lod) const;
+	float GetNodeSize(uint32_t lod) const;
+	AABB GetNodeBounds(uint32_t lod, uint32_t x, uint32_t z) const;
+};
+
+// Height field terrain with continuous distance dependent LOD. Every selected node is the same
+// instanced grid, vertices morph into the next LOD's grid before the switch so neighbours
+// never crack. Heights stream into a clipmap, one wrapped layer per LOD centered on the camera,
+// so GPU memory and the 4 draws per frame stay the same however large the field is.
+class CDLODTerrain
+{
+private:
+	Shader _shader;
+	CDLODQuadtree _quadtree;
+	// Source of the clipmap updates, owned by the caller
+	const HeightField* _field;
+	glm::vec3 _origin;
+	float _spacing;
+	float _heightScale;
+
+	unsigned int _vao;
+	unsigned int _gridVBO;
+	unsigned int _gridEBO;
+	unsigned int _instanceVBO;
+	size_t _instanceCapacity;
+	uint32_t _quadrantIndexCount;
+
+	unsigned int _clipmap;
+	// Level texel every layer is centered on, and whether it holds anything yet
+	std::vector<glm::ivec2> _clipmapCenters;
+	std::vector<bool> _clipmapValid;
+	std::vector<uint16_t> _uploadScratch;
+	uint32_t _uploadedTexels;
+
+	CDLODSelection _selection;
+
+	void UpdateClipmap(const glm::vec3& cameraPosition);
+	// Half open range of level texels, wrapped into the layer
+	void UploadRegion(uint32_t lod, int x0, int z0, int x1, int z1);
+
+public:
+	CDLODTerrain();
+	~CDLODTerrain();
+
+	CDLODTerrain(const CDLODTerrain&) = delete;
+	CDLODTerrain& operator=(const CDLODTerrain&) = delete;
+
+	// The field is read again whenever the camera moves, it has to outlive the terrain
+	void SetHeightField(const HeightField& field, const glm::vec3& origin, float spacing, float heightScale);
+
+	void Draw(const glm::mat4& view, const glm::mat4& projection, const Frustum& frustum, const glm::vec3& cameraPosition);
+
+	// Of the last Draw()
+	uint32_t GetInstanceCount() const;
+	uint32_t GetTriangleCount() const;
+	uint32_t GetUploadedTexels() const;
+	size_t GetClipmapBytes() const;
+};
+
+#endif // CDLOD_TERRAIN_H
@@ -0,0 +1,28 @@
+#include "Culling.h"
+
+const char* Culling::GetModeName(CullingMode mode)
+{
+	switch (mode)
+	{
+	case CullingMode::None:
+		return "None";
+	case CullingMode::Frustum:
+		return "Frustum";
+	case CullingMode::GpuOcclusion:
+		return "GPU occlusion";
+	case CullingMode::CpuOcclusion:
+		return "CPU occlusion";
+	case CullingMode::PotentiallyVisibleSet:
+		return "PVS";
+	case CullingMode::GpuCompute:
+		return "GPU compute";
+	default:
+		return "Unknown";
+	}
+}
+
+CullingMode Culling::NextMode(CullingMode mode)
+{
+	int next = (static_cast<int>(mode) + 1) % static_cast<int>(CullingMode::Count);
+	return static_cast<CullingMode>(next);
+}
@@ -0,0 +1,42 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <cstdint>
+
+enum class CullingMode
+{
+	None,
+	Frustum,
+	GpuOcclusion,
+	CpuOcclusion,
+	PotentiallyVisibleSet,
+	GpuCompute,
+	Count
+};
+
+struct CullingStats
+{
+	uint32_t Total = 0;
+	// Survivors of the frustum test
+	uint32_t InFrustum = 0;
+	uint32_t Occluded = 0;
+	uint32_t Drawn = 0;
+	// Part of Drawn, as camera facing quads
+	uint32_t Impostors = 0;
+	// HLOD clusters drawn as one proxy each, and the objects they stood in for
+	uint32_t Proxies = 0;
+	uint32_t Replaced = 0;
+	uint32_t CulledMeshlets = 0;
+	uint32_t Triangles = 0;
+	// Per-instance data sent to the GPU this frame
+	uint32_t UploadedBytes = 0;
+	bool Prepass = false;
+};
+
+namespace Culling
+{
+	const char* GetModeName(CullingMode mode);
+	CullingMode NextMode(CullingMode mode);
+}
+
+#endif // CULLING_H
@@ -0,0 +1,97 @@
+#include "DepthPrepass.h"
+#include "Logger.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+
+using namespace DepthPrepassDefaults;
+
+DepthPrepass::DepthPrepass()
+	: _shader("resources/shaders/transform.vert", "resources/shaders/depth.frag"),
+	_mode(DepthPrepassMode::Auto), _aspectRatio(1.f), _coverage(0.f), _autoEnabled(false)
+{
+}
+
+void DepthPrepass::BeginFrame(float aspectRatio)
+{
+	_aspectRatio = aspectRatio;
+	_coverage = 0.f;
+}
+
+void DepthPrepass::AddCoverage(float screenSize)
+{
+	// Bounding disc over the whole screen, both in NDC where the screen is 2 * aspect by 2
+	float radius = std::min(screenSize, 1.f);
+	_coverage += glm::pi<float>() * radius * radius / (4.f * _aspectRatio);
+}
+
+bool DepthPrepass::ShouldRun()
+{
+	switch (_mode)
+	{
+	case DepthPrepassMode::On:
+		return true;
+	case DepthPrepassMode::Auto:
+		if (_coverage > OVERDRAW_THRESHOLD)
+			_autoEnabled = true;
+		else if (_coverage < OVERDRAW_THRESHOLD - OVERDRAW_HYSTERESIS)
+			_autoEnabled = false;
+		return _autoEnabled;
+	default:
+		return false;
+	}
+}
+
+const Shader& DepthPrepass::BeginDepthPass(const glm::mat4& view, const glm::mat4& projection) const
+{
+	_shader.Use();
+	_shader.SetUniformMat4fv("view", view);
+	_shader.SetUniformMat4fv("projection", projection);
+	GL_CHECK(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+	return _shader;
+}
+
+void DepthPrepass::BeginColorPass() const
+{
+	GL_CHECK(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+	GL_CHECK(glDepthMask(GL_FALSE));
+	// transform.vert declares gl_Position invariant, so both passes land on the same depth bit for bit
+	GL_CHECK(glDepthFunc(GL_EQUAL));
+}
+
+void DepthPrepass::EndColorPass() const
+{
+	GL_CHECK(glDepthMask(GL_TRUE));
+	GL_CHECK(glDepthFunc(GL_LESS));
+}
+
+DepthPrepassMode DepthPrepass::GetMode() const
+{
+	return _mode;
+}
+
+void DepthPrepass::SetMode(DepthPrepassMode mode)
+{
+	_mode = mode;
+}
+
+float DepthPrepass::GetEstimatedOverdraw() const
+{
+	return _coverage;
+}
+
+const char* DepthPrepass::GetModeName(DepthPrepassMode mode)
+{
+	switch (mode)
+	{
+	case DepthPrepassMode::Off:
+		return "Off";
+	case DepthPrepassMode::On:
+		return "On";
+	case DepthPrepassMode::Auto:
+		return "Auto";
+	default:
+		return "Unknown";
+	}
+}
@@ -0,0 +1,57 @@
+#ifndef DEPTH_PREPASS_H
+#define DEPTH_PREPASS_H
+
+#include "Shader.h"
+
+enum class DepthPrepassMode
+{
+	Off,
+	On,
+	// Runs when the estimated overdraw is high enough to pay for drawing everything twice
+	Auto,
+	Count
+};
+
+namespace DepthPrepassDefaults
+{
+	// Summed screen coverage of the opaque draws, in screens, that turns the auto pre-pass on
+	constexpr float OVERDRAW_THRESHOLD = 2.5f;
+	// Below this it turns off again, keeps the choice from flipping every frame
+	constexpr float OVERDRAW_HYSTERESIS = 0.5f;
+}
+
+// Lays down depth with a trivial fragment shader so the textured color pass only shades the
+// visible fragment of every pixel, then tests the color pass against it with writes off.
+class DepthPrepass
+{
+private:
+	Shader _shader;
+	DepthPrepassMode _mode;
+	float _aspectRatio;
+	float _coverage;
+	bool _autoEnabled;
+
+public:
+	DepthPrepass();
+
+	// Starts the coverage estimate of a new frame
+	void BeginFrame(float aspectRatio);
+	// Screen size as in LODSelector::ComputeScreenSize
+	void AddCoverage(float screenSize);
+	// Decides for this frame, auto mode compares the estimate against the thresholds
+	bool ShouldRun();
+
+	// Binds the depth-only shader and masks color writes
+	const Shader& BeginDepthPass(const glm::mat4& view, const glm::mat4& projection) const;
+	// Depth stays as laid down, only fragments matching it get shaded
+	void BeginColorPass() const;
+	void EndColorPass() const;
+
+	DepthPrepassMode GetMode() const;
+	void SetMode(DepthPrepassMode mode);
+	// Summed coverage of the current frame in screens
+	float GetEstimatedOverdraw() const;
+	static const char* GetModeName(DepthPrepassMode mode);
+};
+
+#endif // DEPTH_PREPASS_H
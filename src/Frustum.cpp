@@ -0,0 +1,72 @@
+#include "Frustum.h"
+
+float Plane::GetSignedDistance(const glm::vec3& point) const
+{
+	return glm::dot(Normal, point) + Distance;
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	Update(viewProjection);
+}
+
+void Frustum::Update(const glm::mat4& viewProjection)
+{
+	// glm is column major so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+	const glm::vec4 equations[6] =
+	{
+		row3 + row0,
+		row3 - row0,
+		row3 + row1,
+		row3 - row1,
+		row3 + row2,
+		row3 - row2
+	};
+
+	for (int i = 0; i < 6; i++)
+	{
+		glm::vec3 normal = glm::vec3(equations[i]);
+		float length = glm::length(normal);
+		Planes[i].Normal = normal / length;
+		Planes[i].Distance = equations[i].w / length;
+	}
+}
+
+FrustumResult Frustum::TestAABB(const AABB& box) const
+{
+	glm::vec3 center = box.GetCenter();
+	glm::vec3 extents = box.GetExtents();
+
+	FrustumResult result = FrustumResult::Inside;
+	for (const Plane& plane : Planes)
+	{
+		float distance = plane.GetSignedDistance(center);
+		float radius = glm::dot(extents, glm::abs(plane.Normal));
+
+		if (distance < -radius)
+			return FrustumResult::Outside;
+		if (distance < radius)
+			result = FrustumResult::Intersect;
+	}
+	return result;
+}
+
+bool Frustum::IntersectsAABB(const AABB& box) const
+{
+	return TestAABB(box) != FrustumResult::Outside;
+}
+
+bool Frustum::IntersectsSphere(const glm::vec3& center, float radius) const
+{
+	for (const Plane& plane : Planes)
+	{
+		if (plane.GetSignedDistance(center) < -radius)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,39 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+#include "AABB.h"
+
+enum class FrustumResult
+{
+	Outside,
+	Intersect,
+	Inside
+};
+
+struct Plane
+{
+	glm::vec3 Normal = glm::vec3(0.f, 1.f, 0.f);
+	float Distance = 0.f;
+
+	float GetSignedDistance(const glm::vec3& point) const;
+};
+
+class Frustum
+{
+public:
+	Frustum() = default;
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	// Left, right, bottom, top, near, far, normals point inwards
+	Plane Planes[6];
+
+	// Gribb/Hartmann plane extraction
+	void Update(const glm::mat4& viewProjection);
+
+	FrustumResult TestAABB(const AABB& box) const;
+	bool IntersectsAABB(const AABB& box) const;
+	bool IntersectsSphere(const glm::vec3& center, float radius) const;
+};
+
+#endif // FRUSTUM_H
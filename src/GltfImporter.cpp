@@ -0,0 +1,654 @@
+#include "MeshImporter.h"
+#include "Json.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "VertexCache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+namespace
+{
+	constexpr uint32_t GLB_MAGIC = 0x46546c67; // "glTF"
+	constexpr uint32_t GLB_CHUNK_JSON = 0x4e4f534a; // "JSON"
+	constexpr uint32_t GLB_CHUNK_BIN = 0x004e4942; // "BIN\0"
+	constexpr int64_t MODE_TRIANGLES = 4;
+	// Bounds the recursion, cycles and shared nodes are caught by the visited flags
+	constexpr int MAX_NODE_DEPTH = 64;
+
+	// Accessor component types, the GL enums
+	constexpr int64_t COMPONENT_BYTE = 5120;
+	constexpr int64_t COMPONENT_UNSIGNED_BYTE = 5121;
+	constexpr int64_t COMPONENT_SHORT = 5122;
+	constexpr int64_t COMPONENT_UNSIGNED_SHORT = 5123;
+	constexpr int64_t COMPONENT_UNSIGNED_INT = 5125;
+	constexpr int64_t COMPONENT_FLOAT = 5126;
+
+	struct GltfBuffer
+	{
+		const uint8_t* Data = nullptr;
+		size_t Size = 0;
+	};
+
+	struct GltfDocument
+	{
+		std::string Directory;
+		JsonValue Json;
+		MappedFile Source;
+		// Storage behind Buffers
+		std::vector<std::unique_ptr<MappedFile>> ExternalFiles;
+		std::vector<std::vector<uint8_t>> DecodedUris;
+		std::vector<GltfBuffer> Buffers;
+	};
+
+	// Strided elements of one accessor, Data is null for accessors without a buffer view (all zeros)
+	struct AccessorView
+	{
+		const uint8_t* Data = nullptr;
+		size_t Count = 0;
+		size_t Stride = 0;
+		int64_t ComponentType = COMPONENT_FLOAT;
+		uint32_t ComponentCount = 1;
+		bool Normalized = false;
+	};
+
+	struct GltfDraw
+	{
+		int64_t MeshIndex;
+		int64_t PrimitiveIndex;
+		glm::mat4 Transform;
+	};
+
+	struct DecodedPrimitive
+	{
+		MeshData Data;
+		std::string Error;
+	};
+
+	size_t ComponentSize(int64_t componentType)
+	{
+		switch (componentType)
+		{
+		case COMPONENT_BYTE:
+		case COMPONENT_UNSIGNED_BYTE:
+			return 1;
+		case COMPONENT_SHORT:
+		case COMPONENT_UNSIGNED_SHORT:
+			return 2;
+		case COMPONENT_UNSIGNED_INT:
+		case COMPONENT_FLOAT:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	uint32_t ComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR")
+			return 1;
+		if (type == "VEC2")
+			return 2;
+		if (type == "VEC3")
+			return 3;
+		if (type == "VEC4")
+			return 4;
+		return 0;
+	}
+
+	int DecodeBase64Digit(char c)
+	{
+		if (c >= 'A' && c <= 'Z')
+			return c - 'A';
+		if (c >= 'a' && c <= 'z')
+			return c - 'a' + 26;
+		if (c >= '0' && c <= '9')
+			return c - '0' + 52;
+		if (c == '+')
+			return 62;
+		if (c == '/')
+			return 63;
+		return -1;
+	}
+
+	bool DecodeBase64(const char* text, size_t size, std::vector<uint8_t>& out)
+	{
+		out.reserve(size / 4 * 3);
+		uint32_t bits = 0;
+		int bitCount = 0;
+		for (size_t i = 0; i < size && text[i] != '='; i++)
+		{
+			int digit = DecodeBase64Digit(text[i]);
+			if (digit < 0)
+				return false;
+			bits = (bits << 6) | static_cast<uint32_t>(digit);
+			bitCount += 6;
+			if (bitCount >= 8)
+			{
+				bitCount -= 8;
+				out.push_back(static_cast<uint8_t>(bits >> bitCount));
+			}
+		}
+		return true;
+	}
+
+	// Uris are url encoded, file names with spaces come as %20
+	std::string DecodeUri(const std::string& uri)
+	{
+		std::string decoded;
+		for (size_t i = 0; i < uri.size(); i++)
+		{
+			if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) && std::isxdigit(static_cast<unsigned char>(uri[i + 2])))
+			{
+				decoded += static_cast<char>(std::strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+				i += 2;
+			}
+			else
+			{
+				decoded += uri[i];
+			}
+		}
+		return decoded;
+	}
+
+	uint32_t ReadU32(const uint8_t* data)
+	{
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	// Json and binary chunk of a .glb, or the whole file as json
+	bool ParseContainer(GltfDocument& document, GltfBuffer& outBinaryChunk, std::string& outError)
+	{
+		const uint8_t* data = document.Source.GetData();
+		const size_t size = document.Source.GetSize();
+		if (size < 12 || ReadU32(data) != GLB_MAGIC)
+			return ParseJson(reinterpret_cast<const char*>(data), size, document.Json, outError);
+
+		if (ReadU32(data + 4) != 2)
+		{
+			outError = "only glb version 2 is supported";
+			return false;
+		}
+
+		bool hasJson = false;
+		for (size_t offset = 12; offset + 8 <= size;)
+		{
+			const uint32_t chunkLength = ReadU32(data + offset);
+			const uint32_t chunkType = ReadU32(data + offset + 4);
+			const uint8_t* chunk = data + offset + 8;
+			if (chunkLength > size - offset - 8)
+			{
+				outError = "truncated glb chunk";
+				return false;
+			}
+
+			if (chunkType == GLB_CHUNK_JSON && !hasJson)
+			{
+				if (!ParseJson(reinterpret_cast<const char*>(chunk), chunkLength, document.Json, outError))
+					return false;
+				hasJson = true;
+			}
+			else if (chunkType == GLB_CHUNK_BIN && !outBinaryChunk.Data)
+			{
+				outBinaryChunk.Data = chunk;
+				outBinaryChunk.Size = chunkLength;
+			}
+			// Chunks are 4 byte aligned
+			offset += 8 + ((static_cast<size_t>(chunkLength) + 3) & ~size_t(3));
+		}
+
+		if (!hasJson)
+			outError = "glb without a json chunk";
+		return hasJson;
+	}
+
+	bool LoadBuffers(GltfDocument& document, const GltfBuffer& binaryChunk, std::vector<std::string>& outDependencies, std::string& outError)
+	{
+		const JsonValue& buffers = document.Json["buffers"];
+		document.Buffers.resize(buffers.GetSize());
+		for (size_t i = 0; i < buffers.GetSize(); i++)
+		{
+			const JsonValue& buffer = buffers[i];
+			const std::string& uri = buffer["uri"].AsString();
+			GltfBuffer& out = document.Buffers[i];
+
+			if (uri.empty())
+			{
+				// Only the first buffer of a glb may point at the binary chunk
+				if (i != 0 || !binaryChunk.Data)
+				{
+					outError = "buffer " + std::to_string(i) + " has no data";
+					return false;
+				}
+				out = binaryChunk;
+			}
+			else if (uri.compare(0, 5, "data:") == 0)
+			{
+				size_t comma = uri.find(',');
+				if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos)
+				{
+					outError = "buffer " + std::to_string(i) + " has an unsupported data uri";
+					return false;
+				}
+				document.DecodedUris.emplace_back();
+				if (!DecodeBase64(uri.data() + comma + 1, uri.size() - comma - 1, document.DecodedUris.back()))
+				{
+					outError = "buffer " + std::to_string(i) + " has invalid base64";
+					return false;
+				}
+				out.Data = document.DecodedUris.back().data();
+				out.Size = document.DecodedUris.back().size();
+			}
+			else
+			{
+				const std::string relativePath = DecodeUri(uri);
+				document.ExternalFiles.push_back(std::make_unique<MappedFile>());
+				MappedFile& file = *document.ExternalFiles.back();
+				if (!file.Open(document.Directory + relativePath))
+				{
+					outError = "missing buffer file " + relativePath;
+					return false;
+				}
+				out.Data = file.GetData();
+				out.Size = file.GetSize();
+				outDependencies.push_back(relativePath);
+			}
+
+			if (static_cast<size_t>(buffer["byteLength"].AsInt()) > out.Size)
+			{
+				outError = "buffer " + std::to_string(i) + " is shorter than its byteLength";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool GetAccessor(const GltfDocument& document, int64_t index, AccessorView& outView, std::string& outError)
+	{
+		const JsonValue& accessor = document.Json["accessors"][static_cast<size_t>(index)];
+		if (index < 0 || !accessor.IsObject())
+		{
+			outError = "invalid accessor " + std::to_string(index);
+			return false;
+		}
+		if (accessor.Has("sparse"))
+		{
+			outError = "sparse accessors are not supported";
+			return false;
+		}
+
+		const int64_t count = accessor["count"].AsInt();
+		if (count < 0)
+		{
+			outError = "accessor " + std::to_string(index) + " has a negative count";
+			return false;
+		}
+		outView.Count = static_cast<size_t>(count);
+		outView.ComponentType = accessor["componentType"].AsInt();
+		outView.ComponentCount = ComponentCount(accessor["type"].AsString());
+		outView.Normalized = accessor["normalized"].AsBool();
+		const size_t elementSize = ComponentSize(outView.ComponentType) * outView.ComponentCount;
+		if (elementSize == 0)
+		{
+			outError = "accessor " + std::to_string(index) + " has an unknown type";
+			return false;
+		}
+		if (!accessor.Has("bufferView"))
+			return true;
+
+		const JsonValue& bufferView = document.Json["bufferViews"][static_cast<size_t>(accessor["bufferView"].AsInt())];
+		const int64_t bufferIndex = bufferView["buffer"].AsInt(-1);
+		if (bufferIndex < 0 || static_cast<size_t>(bufferIndex) >= document.Buffers.size())
+		{
+			outError = "accessor " + std::to_string(index) + " has an invalid buffer view";
+			return false;
+		}
+
+		// Negative values would wrap to huge sizes and slip past the bounds check below
+		const int64_t viewOffset = bufferView["byteOffset"].AsInt();
+		const int64_t viewLength = bufferView["byteLength"].AsInt();
+		const int64_t accessorOffset = accessor["byteOffset"].AsInt();
+		const int64_t stride = bufferView["byteStride"].AsInt(static_cast<int64_t>(elementSize));
+		if (viewOffset < 0 || viewLength < 0 || accessorOffset < 0 || stride < 0)
+		{
+			outError = "accessor " + std::to_string(index) + " has a negative offset or length";
+			return false;
+		}
+
+		const GltfBuffer& buffer = document.Buffers[bufferIndex];
+		outView.Stride = static_cast<size_t>(stride);
+		// Every element takes at least a byte, which also keeps the stride product from overflowing
+		if (static_cast<uint64_t>(viewOffset) + static_cast<uint64_t>(viewLength) > buffer.Size || outView.Count > static_cast<uint64_t>(viewLength)
+			|| (outView.Count > 0 && static_cast<uint64_t>(accessorOffset) + outView.Stride * (outView.Count - 1) + elementSize > static_cast<uint64_t>(viewLength)))
+		{
+			outError = "accessor " + std::to_string(index) + " reads past its buffer";
+			return false;
+		}
+		outView.Data = buffer.Data + viewOffset + accessorOffset;
+		return true;
+	}
+
+	float ReadComponent(const uint8_t* data, int64_t componentType, bool normalized)
+	{
+		switch (componentType)
+		{
+		case COMPONENT_FLOAT:
+		{
+			float value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		case COMPONENT_UNSIGNED_BYTE:
+			return normalized ? *data / 255.f : static_cast<float>(*data);
+		case COMPONENT_BYTE:
+		{
+			float value = static_cast<float>(static_cast<int8_t>(*data));
+			return normalized ? std::max(value / 127.f, -1.f) : value;
+		}
+		case COMPONENT_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return normalized ? value / 65535.f : static_cast<float>(value);
+		}
+		case COMPONENT_SHORT:
+		{
+			int16_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return normalized ? std::max(value / 32767.f, -1.f) : static_cast<float>(value);
+		}
+		case COMPONENT_UNSIGNED_INT:
+			return static_cast<float>(ReadU32(data));
+		default:
+			return 0.f;
+		}
+	}
+
+	glm::vec4 ReadElement(const AccessorView& view, size_t element)
+	{
+		glm::vec4 value(0.f);
+		if (!view.Data)
+			return value;
+		const uint8_t* data = view.Data + element * view.Stride;
+		const size_t componentSize = ComponentSize(view.ComponentType);
+		for (uint32_t i = 0; i < view.ComponentCount; i++)
+			value[i] = ReadComponent(data + i * componentSize, view.ComponentType, view.Normalized);
+		return value;
+	}
+
+	uint32_t ReadIndex(const AccessorView& view, size_t element)
+	{
+		if (!view.Data)
+			return 0;
+		const uint8_t* data = view.Data + element * view.Stride;
+		switch (view.ComponentType)
+		{
+		case COMPONENT_UNSIGNED_BYTE:
+			return *data;
+		case COMPONENT_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		default:
+			return ReadU32(data);
+		}
+	}
+
+	glm::mat4 GetLocalTransform(const JsonValue& node)
+	{
+		glm::mat4 transform(1.f);
+		const JsonValue& matrix = node["matrix"];
+		if (matrix.GetSize() == 16)
+		{
+			// Column major like glm
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+					transform[column][row] = static_cast<float>(matrix[column * 4 + row].AsNumber());
+			}
+			return transform;
+		}
+
+		const JsonValue& translation = node["translation"];
+		const JsonValue& rotation = node["rotation"];
+		const JsonValue& scale = node["scale"];
+		glm::vec3 t(0.f), s(1.f);
+		for (int i = 0; i < 3; i++)
+		{
+			t[i] = static_cast<float>(translation[i].AsNumber(0.0));
+			s[i] = static_cast<float>(scale[i].AsNumber(1.0));
+		}
+		const float x = static_cast<float>(rotation[0].AsNumber(0.0));
+		const float y = static_cast<float>(rotation[1].AsNumber(0.0));
+		const float z = static_cast<float>(rotation[2].AsNumber(0.0));
+		const float w = static_cast<float>(rotation[3].AsNumber(1.0));
+
+		// T * R * S, the rotation from the unit quaternion (x, y, z, w)
+		transform[0] = glm::vec4(1.f - 2.f * (y * y + z * z), 2.f * (x * y + z * w), 2.f * (x * z - y * w), 0.f) * s.x;
+		transform[1] = glm::vec4(2.f * (x * y - z * w), 1.f - 2.f * (x * x + z * z), 2.f * (y * z + x * w), 0.f) * s.y;
+		transform[2] = glm::vec4(2.f * (x * z + y * w), 2.f * (y * z - x * w), 1.f - 2.f * (x * x + y * y), 0.f) * s.z;
+		transform[3] = glm::vec4(t, 1.f);
+		return transform;
+	}
+
+	// A node has one parent in a valid file, the visited flags keep a shared or cyclic child from
+	// being walked once per path, which grows exponentially on a crafted graph
+	void CollectDraws(const JsonValue& json, int64_t nodeIndex, const glm::mat4& parent, int depth, std::vector<bool>& visited,
+		std::vector<GltfDraw>& outDraws)
+	{
+		const JsonValue& node = json["nodes"][static_cast<size_t>(nodeIndex)];
+		if (nodeIndex < 0 || !node.IsObject() || depth > MAX_NODE_DEPTH || visited[static_cast<size_t>(nodeIndex)])
+			return;
+		visited[static_cast<size_t>(nodeIndex)] = true;
+
+		const glm::mat4 transform = parent * GetLocalTransform(node);
+		if (node.Has("mesh"))
+		{
+			const int64_t meshIndex = node["mesh"].AsInt();
+			const JsonValue& primitives = json["meshes"][static_cast<size_t>(meshIndex)]["primitives"];
+			for (size_t p = 0; p < primitives.GetSize(); p++)
+				outDraws.push_back({ meshIndex, static_cast<int64_t>(p), transform });
+		}
+
+		const JsonValue& children = node["children"];
+		for (size_t c = 0; c < children.GetSize(); c++)
+			CollectDraws(json, children[c].AsInt(-1), transform, depth + 1, visited, outDraws);
+	}
+
+	void DecodePrimitive(const GltfDocument& document, const GltfDraw& draw, DecodedPrimitive& out)
+	{
+		const JsonValue& primitive = document.Json["meshes"][static_cast<size_t>(draw.MeshIndex)]["primitives"][static_cast<size_t>(draw.PrimitiveIndex)];
+		if (primitive["mode"].AsInt(MODE_TRIANGLES) != MODE_TRIANGLES)
+			return;
+
+		const JsonValue& attributes = primitive["attributes"];
+		AccessorView positions, normals, texCoords, indices;
+		if (!attributes.Has("POSITION"))
+		{
+			out.Error = "primitive without positions";
+			return;
+		}
+		if (!GetAccessor(document, attributes["POSITION"].AsInt(), positions, out.Error))
+			return;
+		if (positions.ComponentType != COMPONENT_FLOAT || positions.ComponentCount != 3)
+		{
+			out.Error = "positions must be float vec3";
+			return;
+		}
+		const bool hasNormals = attributes.Has("NORMAL");
+		if (hasNormals && !GetAccessor(document, attributes["NORMAL"].AsInt(), normals, out.Error))
+			return;
+		if (attributes.Has("TEXCOORD_0") && !GetAccessor(document, attributes["TEXCOORD_0"].AsInt(), texCoords, out.Error))
+			return;
+		const bool indexed = primitive.Has("indices");
+		if (indexed && !GetAccessor(document, primitive["indices"].AsInt(), indices, out.Error))
+			return;
+
+		const size_t vertexCount = positions.Count;
+		if ((hasNormals && normals.Count < vertexCount) || (texCoords.Data && texCoords.Count < vertexCount))
+		{
+			out.Error = "attributes with fewer elements than positions";
+			return;
+		}
+
+		std::vector<uint32_t> primitiveIndices(indexed ? indices.Count : vertexCount);
+		for (size_t i = 0; i < primitiveIndices.size(); i++)
+		{
+			primitiveIndices[i] = indexed ? ReadIndex(indices, i) : static_cast<uint32_t>(i);
+			if (primitiveIndices[i] >= vertexCount)
+			{
+				out.Error = "index out of range";
+				return;
+			}
+		}
+		primitiveIndices.resize(primitiveIndices.size() / 3 * 3);
+
+		// Mirroring transforms flip the winding
+		const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(draw.Transform)));
+		const bool mirrored = glm::determinant(glm::mat3(draw.Transform)) < 0.f;
+		if (mirrored)
+		{
+			for (size_t i = 0; i < primitiveIndices.size(); i += 3)
+				std::swap(primitiveIndices[i + 1], primitiveIndices[i + 2]);
+		}
+
+		MeshData& data = out.Data;
+		data.Vertices.resize(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			Vertex& vertex = data.Vertices[v];
+			vertex.Position = glm::vec3(draw.Transform * glm::vec4(glm::vec3(ReadElement(positions, v)), 1.f));
+			vertex.TexCoord = glm::vec2(ReadElement(texCoords, v));
+			if (hasNormals)
+			{
+				glm::vec3 normal = normalMatrix * glm::vec3(ReadElement(normals, v));
+				float length = glm::length(normal);
+				vertex.Normal = length > 0.f ? normal / length : glm::vec3(0.f, 1.f, 0.f);
+			}
+		}
+
+		if (hasNormals)
+		{
+			data.Indices.swap(primitiveIndices);
+			return;
+		}
+
+		// The spec asks for flat normals when there are none, unweld and weld back what stays equal
+		std::vector<Vertex> flat(primitiveIndices.size());
+		data.Indices.resize(primitiveIndices.size());
+		for (size_t i = 0; i < primitiveIndices.size(); i += 3)
+		{
+			const Vertex* corners[3] = { &data.Vertices[primitiveIndices[i]], &data.Vertices[primitiveIndices[i + 1]], &data.Vertices[primitiveIndices[i + 2]] };
+			glm::vec3 normal = glm::cross(corners[1]->Position - corners[0]->Position, corners[2]->Position - corners[0]->Position);
+			float length = glm::length(normal);
+			normal = length > 0.f ? normal / length : glm::vec3(0.f, 1.f, 0.f);
+			for (int corner = 0; corner < 3; corner++)
+			{
+				flat[i + corner] = *corners[corner];
+				flat[i + corner].Normal = normal;
+				data.Indices[i + corner] = static_cast<uint32_t>(i + corner);
+			}
+		}
+		data.Vertices.swap(flat);
+		DeduplicateVertices(data);
+	}
+}
+
+bool ImportGltf(const std::string& path, ThreadPool& pool, ImportedMesh& outMesh)
+{
+	GltfDocument document;
+	document.Directory = path.substr(0, path.find_last_of("/\\") + 1);
+	if (!document.Source.Open(path))
+	{
+		std::cout << "ERROR::IMPORT::FILE_NOT_FOUND: " << path << "\n";
+		return false;
+	}
+
+	outMesh = ImportedMesh();
+	std::string error;
+	GltfBuffer binaryChunk;
+	if (!ParseContainer(document, binaryChunk, error) || !LoadBuffers(document, binaryChunk, outMesh.Dependencies, error))
+	{
+		std::cout << "ERROR::IMPORT::INVALID_GLTF: " << path << ": " << error << "\n";
+		return false;
+	}
+
+	// Default scene, or every node no other node lists as a child
+	const JsonValue& json = document.Json;
+	std::vector<int64_t> roots;
+	const JsonValue& scene = json["scenes"][static_cast<size_t>(json["scene"].AsInt(0))];
+	if (scene.IsObject())
+	{
+		for (size_t i = 0; i < scene["nodes"].GetSize(); i++)
+			roots.push_back(scene["nodes"][i].AsInt(-1));
+	}
+	else
+	{
+		const JsonValue& nodes = json["nodes"];
+		std::vector<bool> isChild(nodes.GetSize(), false);
+		for (size_t n = 0; n < nodes.GetSize(); n++)
+		{
+			for (size_t c = 0; c < nodes[n]["children"].GetSize(); c++)
+			{
+				size_t child = static_cast<size_t>(nodes[n]["children"][c].AsInt());
+				if (child < isChild.size())
+					isChild[child] = true;
+			}
+		}
+		for (size_t n = 0; n < nodes.GetSize(); n++)
+		{
+			if (!isChild[n])
+				roots.push_back(static_cast<int64_t>(n));
+		}
+	}
+
+	std::vector<GltfDraw> draws;
+	std::vector<bool> visited(json["nodes"].GetSize(), false);
+	for (int64_t root : roots)
+		CollectDraws(json, root, glm::mat4(1.f), 0, visited, draws);
+
+	// Accessor decoding is the bulk of the work, one task per primitive instance
+	std::vector<DecodedPrimitive> decoded(draws.size());
+	pool.ParallelFor(static_cast<uint32_t>(draws.size()), 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t d = begin; d < end; d++)
+				DecodePrimitive(document, draws[d], decoded[d]);
+		});
+
+	MeshData& data = outMesh.Data;
+	for (size_t d = 0; d < decoded.size(); d++)
+	{
+		const DecodedPrimitive& primitive = decoded[d];
+		if (!primitive.Error.empty())
+		{
+			std::cout << "ERROR::IMPORT::INVALID_GLTF: " << path << ": mesh " << draws[d].MeshIndex << " primitive " << draws[d].PrimitiveIndex << ": " << primitive.Error << "\n";
+			return false;
+		}
+		if (primitive.Data.Indices.empty())
+			continue;
+
+		const uint32_t baseVertex = static_cast<uint32_t>(data.Vertices.size());
+		const uint32_t firstIndex = static_cast<uint32_t>(data.Indices.size());
+		data.Vertices.insert(data.Vertices.end(), primitive.Data.Vertices.begin(), primitive.Data.Vertices.end());
+		for (uint32_t index : primitive.Data.Indices)
+			data.Indices.push_back(baseVertex + index);
+		outMesh.SubMeshes.push_back({ firstIndex, static_cast<uint32_t>(primitive.Data.Indices.size()), AABB() });
+	}
+
+	if (data.Indices.empty())
+	{
+		std::cout << "ERROR::IMPORT::EMPTY_MESH: " << path << "\n";
+		return false;
+	}
+
+	FinalizeImportedMesh(outMesh);
+	return true;
+}
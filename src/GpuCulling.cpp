@@ -0,0 +1,263 @@
+#include "GpuCulling.h"
+#include "LODSelector.h"
+#include "PackedTransform.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace GpuCullingDefaults;
+
+namespace
+{
+	struct GpuBounds
+	{
+		glm::vec4 Min;
+		glm::vec4 Max;
+	};
+
+	struct GpuMeshInfo
+	{
+		uint32_t FirstCommand;
+		uint32_t LODCount;
+	};
+
+	// The mesh id rides along in the unused w, exact as a float for any sane table size
+	GpuBounds ToGpuBounds(const AABB& bounds, uint32_t meshID)
+	{
+		return { glm::vec4(bounds.Min, 1.f), glm::vec4(bounds.Max, static_cast<float>(meshID)) };
+	}
+}
+
+GpuCulling::GpuCulling()
+	: _cullShader("resources/shaders/cull.comp"), _drawShader("resources/shaders/instanced.vert", "resources/shaders/shaderRect.frag"),
+	_transforms(sizeof(PackedTransform)), _bounds(sizeof(GpuBounds)),
+	_visibleBuffer(0), _commandBuffer(0), _lodBuffer(0), _meshBuffer(0), _objectCount(0),
+	_readbackIndex(0), _lastVisibleCount(0), _lastTriangleCount(0), _lastUploadedBytes(0)
+{
+	GL_CHECK(glGenBuffers(1, &_visibleBuffer));
+	GL_CHECK(glGenBuffers(1, &_commandBuffer));
+	GL_CHECK(glGenBuffers(1, &_lodBuffer));
+	GL_CHECK(glGenBuffers(1, &_meshBuffer));
+
+	GL_CHECK(glGenBuffers(READBACK_LATENCY, _readbackBuffers));
+	for (int i = 0; i < READBACK_LATENCY; i++)
+		_readbackFences[i] = nullptr;
+}
+
+GpuCulling::~GpuCulling()
+{
+	for (int i = 0; i < READBACK_LATENCY; i++)
+	{
+		if (_readbackFences[i])
+			glDeleteSync(_readbackFences[i]);
+	}
+	glDeleteBuffers(READBACK_LATENCY, _readbackBuffers);
+
+	glDeleteBuffers(1, &_visibleBuffer);
+	glDeleteBuffers(1, &_commandBuffer);
+	glDeleteBuffers(1, &_lodBuffer);
+	glDeleteBuffers(1, &_meshBuffer);
+}
+
+bool GpuCulling::IsSupported()
+{
+	return GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3);
+}
+
+void GpuCulling::Upload(const Scene& scene, const std::vector<const Mesh*>& meshes)
+{
+	_objectCount = scene.GetObjectCount();
+	_meshes = meshes;
+
+	std::vector<PackedTransform> transforms(_objectCount);
+	std::vector<GpuBounds> bounds(_objectCount);
+	std::vector<uint32_t> objectsPerMesh(meshes.size(), 0);
+	for (uint32_t objectID = 0; objectID < _objectCount; objectID++)
+	{
+		const SceneObject& object = scene.GetObject(objectID);
+		transforms[objectID] = PackTransform(object.Model);
+		bounds[objectID] = ToGpuBounds(scene.GetWorldBounds(objectID), object.MeshID);
+		objectsPerMesh[object.MeshID]++;
+	}
+
+	// Every LOD of a mesh gets room for all of its objects in the visible list
+	std::vector<GpuMeshInfo> meshInfos(meshes.size());
+	_meshFirstCommand.resize(meshes.size());
+	_commands.clear();
+	uint32_t visibleCapacity = 0;
+	for (size_t meshID = 0; meshID < meshes.size(); meshID++)
+	{
+		_meshFirstCommand[meshID] = static_cast<uint32_t>(_commands.size());
+		meshInfos[meshID] = { static_cast<uint32_t>(_commands.size()), meshes[meshID]->GetLODCount() };
+		for (uint32_t lod = 0; lod < meshes[meshID]->GetLODCount(); lod++)
+		{
+			const MeshLOD& range = meshes[meshID]->GetLOD(lod);
+			_commands.push_back({ range.IndexCount, 0, range.FirstIndex, 0, visibleCapacity });
+			visibleCapacity += objectsPerMesh[meshID];
+		}
+	}
+
+	_transforms.Assign(transforms.data(), _objectCount);
+	_bounds.Assign(bounds.data(), _objectCount);
+	GL_CHECK(glBindBuffer(GL_SHADER_STORAGE_BUFFER, _visibleBuffer));
+	GL_CHECK(glBufferData(GL_SHADER_STORAGE_BUFFER, visibleCapacity * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY));
+	std::vector<GLuint> lods(_objectCount, 0);
+	GL_CHECK(glBindBuffer(GL_SHADER_STORAGE_BUFFER, _lodBuffer));
+	GL_CHECK(glBufferData(GL_SHADER_STORAGE_BUFFER, lods.size() * sizeof(GLuint), lods.data(), GL_DYNAMIC_COPY));
+	GL_CHECK(glBindBuffer(GL_SHADER_STORAGE_BUFFER, _meshBuffer));
+	GL_CHECK(glBufferData(GL_SHADER_STORAGE_BUFFER, meshInfos.size() * sizeof(GpuMeshInfo), meshInfos.data(), GL_STATIC_DRAW));
+	GL_CHECK(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+
+	const GLsizeiptr commandBytes = _commands.size() * sizeof(DrawElementsIndirectCommand);
+	GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer));
+	GL_CHECK(glBufferData(GL_DRAW_INDIRECT_BUFFER, commandBytes, _commands.data(), GL_DYNAMIC_DRAW));
+	GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+
+	// Any copy still in flight was sized for the old command list
+	for (int i = 0; i < READBACK_LATENCY; i++)
+	{
+		if (_readbackFences[i])
+		{
+			glDeleteSync(_readbackFences[i]);
+			_readbackFences[i] = nullptr;
+		}
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, _readbackBuffers[i]));
+		GL_CHECK(glBufferData(GL_COPY_WRITE_BUFFER, commandBytes, nullptr, GL_STREAM_READ));
+	}
+	GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+void GpuCulling::UpdateObject(const Scene& scene, uint32_t objectID)
+{
+	const SceneObject& object = scene.GetObject(objectID);
+	GpuBounds bounds = ToGpuBounds(scene.GetWorldBounds(objectID), object.MeshID);
+	PackedTransform transform = PackTransform(object.Model);
+	_transforms.Set(objectID, &transform);
+	_bounds.Set(objectID, &bounds);
+}
+
+void GpuCulling::Cull(const Frustum& frustum, const glm::vec3& cameraPosition, float fovY)
+{
+	PollReadback();
+
+	if (_objectCount == 0)
+		return;
+
+	// Everything moved this frame, coalesced before the compute pass reads it
+	_lastUploadedBytes = _transforms.Flush() + _bounds.Flush();
+
+	// The only per-frame CPU write, 20 bytes per mesh LOD regardless of the object count
+	const GLsizeiptr commandBytes = _commands.size() * sizeof(DrawElementsIndirectCommand);
+	GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer));
+	GL_CHECK(glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandBytes, _commands.data()));
+	GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+
+	_cullShader.Use();
+	for (int i = 0; i < 6; i++)
+		_cullShader.SetUniformVec4("frustumPlanes[" + std::to_string(i) + "]", glm::vec4(frustum.Planes[i].Normal, frustum.Planes[i].Distance));
+	GL_CHECK(glUniform1ui(glGetUniformLocation(_cullShader.GetProgramID(), "objectCount"), _objectCount));
+	_cullShader.SetUniformVec3("cameraPosition", cameraPosition);
+	_cullShader.SetUniformF("tanHalfFov", std::tan(fovY * 0.5f));
+	for (uint32_t i = 0; i < LODDefaults::THRESHOLD_COUNT; i++)
+		_cullShader.SetUniformF("lodThresholds[" + std::to_string(i) + "]", LODDefaults::SCREEN_SIZE_THRESHOLDS[i]);
+	_cullShader.SetUniformF("lodHysteresis", LODDefaults::HYSTERESIS);
+
+	GL_CHECK(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BOUNDS_BINDING, _bounds.GetBufferID()));
+	GL_CHECK(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_BINDING, _visibleBuffer));
+	GL_CHECK(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, _commandBuffer));
+	GL_CHECK(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LOD_BINDING, _lodBuffer));
+	GL_CHECK(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_BINDING, _meshBuffer));
+
+	GL_CHECK(glDispatchCompute((_objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1));
+	// Indirect args, the visible list and the readback copy all consume what the compute pass wrote
+	GL_CHECK(glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT));
+
+	// Copy the commands aside for the stats, unless that slot is still in flight
+	if (!_readbackFences[_readbackIndex])
+	{
+		GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, _commandBuffer));
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, _readbackBuffers[_readbackIndex]));
+		GL_CHECK(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, commandBytes));
+		GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+		GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+		_readbackFences[_readbackIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		_readbackIndex = (_readbackIndex + 1) % READBACK_LATENCY;
+	}
+}
+
+void GpuCulling::PollReadback()
+{
+	for (int i = 0; i < READBACK_LATENCY; i++)
+	{
+		if (!_readbackFences[i])
+			continue;
+
+		// Zero timeout, only ever collects copies that already finished
+		GLenum status = glClientWaitSync(_readbackFences[i], 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			continue;
+
+		glDeleteSync(_readbackFences[i]);
+		_readbackFences[i] = nullptr;
+
+		std::vector<DrawElementsIndirectCommand> commands(_commands.size());
+		GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, _readbackBuffers[i]));
+		GL_CHECK(glGetBufferSubData(GL_COPY_READ_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data()));
+		GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+
+		_lastVisibleCount = 0;
+		_lastTriangleCount = 0;
+		for (const DrawElementsIndirectCommand& command : commands)
+		{
+			_lastVisibleCount += command.InstanceCount;
+			_lastTriangleCount += command.InstanceCount * (command.Count / 3);
+		}
+	}
+}
+
+void GpuCulling::Draw() const
+{
+	if (_objectCount == 0)
+		return;
+
+	GL_CHECK(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TRANSFORM_BINDING, _transforms.GetBufferID()));
+	GL_CHECK(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_BINDING, _visibleBuffer));
+	GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer));
+
+	// Empty LODs still cost a draw call, but no CPU side knowledge of what survived
+	for (size_t meshID = 0; meshID < _meshes.size(); meshID++)
+	{
+		_meshes[meshID]->Bind();
+		for (uint32_t lod = 0; lod < _meshes[meshID]->GetLODCount(); lod++)
+		{
+			uint32_t command = _meshFirstCommand[meshID] + lod;
+			_drawShader.SetUniformI("instanceOffset", static_cast<int>(_commands[command].BaseInstance));
+			GL_CHECK(glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(command * sizeof(DrawElementsIndirectCommand))));
+		}
+	}
+
+	GL_CHECK(glBindVertexArray(0));
+	GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+}
+
+const Shader& GpuCulling::GetDrawShader() const
+{
+	return _drawShader;
+}
+
+uint32_t GpuCulling::GetVisibleCount() const
+{
+	return _lastVisibleCount;
+}
+
+uint32_t GpuCulling::GetTriangleCount() const
+{
+	return _lastTriangleCount;
+}
+
+size_t GpuCulling::GetUploadedBytes() const
+{
+	return _lastUploadedBytes;
+}
@@ -0,0 +1,96 @@
+#ifndef GPU_CULLING_H
+#define GPU_CULLING_H
+
+#include <glad/glad.h>
+#include "Frustum.h"
+#include "InstanceBuffer.h"
+#include "Mesh.h"
+#include "Scene.h"
+#include "Shader.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace GpuCullingDefaults
+{
+	constexpr uint32_t WORKGROUP_SIZE = 64;
+	// Frames the visible count readback may lag behind
+	constexpr int READBACK_LATENCY = 2;
+
+	constexpr GLuint TRANSFORM_BINDING = 0;
+	constexpr GLuint BOUNDS_BINDING = 1;
+	constexpr GLuint VISIBLE_BINDING = 2;
+	constexpr GLuint COMMAND_BINDING = 3;
+	constexpr GLuint LOD_BINDING = 4;
+	constexpr GLuint MESH_BINDING = 5;
+}
+
+struct DrawElementsIndirectCommand
+{
+	GLuint Count;
+	GLuint InstanceCount;
+	GLuint FirstIndex;
+	GLint BaseVertex;
+	GLuint BaseInstance;
+};
+
+// GPU driven path for GL 4.3+. Packed transforms and world bounds stay resident in SSBOs,
+// a compute pass frustum culls them, picks a LOD and compacts the survivors into one
+// indirect draw per mesh LOD, so the CPU only uploads what actually moved.
+class GpuCulling
+{
+private:
+	Shader _cullShader;
+	Shader _drawShader;
+
+	// Only what moved since the last Cull goes up, see InstanceBuffer
+	InstanceBuffer _transforms;
+	InstanceBuffer _bounds;
+	unsigned int _visibleBuffer;
+	unsigned int _commandBuffer;
+	unsigned int _lodBuffer;
+	unsigned int _meshBuffer;
+	uint32_t _objectCount;
+
+	std::vector<const Mesh*> _meshes;
+	// Commands of mesh i start at _meshFirstCommand[i], one per LOD, all with zero instances
+	std::vector<uint32_t> _meshFirstCommand;
+	std::vector<DrawElementsIndirectCommand> _commands;
+
+	// Command buffer copies, read once their fence signalled
+	unsigned int _readbackBuffers[GpuCullingDefaults::READBACK_LATENCY];
+	GLsync _readbackFences[GpuCullingDefaults::READBACK_LATENCY];
+	int _readbackIndex;
+	uint32_t _lastVisibleCount;
+	uint32_t _lastTriangleCount;
+	size_t _lastUploadedBytes;
+
+	void PollReadback();
+
+public:
+	GpuCulling();
+	~GpuCulling();
+
+	GpuCulling(const GpuCulling&) = delete;
+	GpuCulling& operator=(const GpuCulling&) = delete;
+
+	static bool IsSupported();
+
+	// Full upload of every transform and world bounds, meshes indexed by the objects' MeshID
+	void Upload(const Scene& scene, const std::vector<const Mesh*>& meshes);
+	// Marks the object, the data goes up with the next Cull
+	void UpdateObject(const Scene& scene, uint32_t objectID);
+
+	void Cull(const Frustum& frustum, const glm::vec3& cameraPosition, float fovY);
+	// Caller sets view, projection and material uniforms on GetDrawShader() first
+	void Draw() const;
+
+	const Shader& GetDrawShader() const;
+	// Results of a previous frame, never stall for the current one
+	uint32_t GetVisibleCount() const;
+	uint32_t GetTriangleCount() const;
+	// Transform and bounds bytes sent by the last Cull
+	size_t GetUploadedBytes() const;
+};
+
+#endif // GPU_CULLING_H
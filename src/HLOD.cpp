@@ -0,0 +1,426 @@
+#include "HLOD.h"
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+using namespace HLODDefaults;
+
+namespace
+{
+	constexpr uint32_t HLOD_MAGIC = 0x31444c48; // "HLD1"
+	constexpr uint32_t HLOD_VERSION = 1;
+
+	struct HLODFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t SceneHash;
+		uint32_t ObjectCount;
+		uint32_t ClusterCount;
+		uint32_t ClusterObjectCount;
+		uint32_t VertexCount;
+		uint32_t IndexCount;
+	};
+
+	bool LessPosition(const glm::vec3& a, const glm::vec3& b)
+	{
+		if (a.x != b.x)
+			return a.x < b.x;
+		if (a.y != b.y)
+			return a.y < b.y;
+		return a.z < b.z;
+	}
+
+	// Triangle keyed by its sorted corners, so the same triangle matches whatever its winding
+	struct Face
+	{
+		glm::vec3 Corners[3];
+		uint32_t Triangle;
+
+		bool operator<(const Face& other) const
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				if (Corners[i] != other.Corners[i])
+					return LessPosition(Corners[i], other.Corners[i]);
+			}
+			return false;
+		}
+
+		bool SameCorners(const Face& other) const
+		{
+			return Corners[0] == other.Corners[0] && Corners[1] == other.Corners[1] && Corners[2] == other.Corners[2];
+		}
+	};
+
+	glm::vec3 TriangleNormal(const std::vector<Vertex>& vertices, const uint32_t* triangle)
+	{
+		const glm::vec3& a = vertices[triangle[0]].Position;
+		return glm::cross(vertices[triangle[1]].Position - a, vertices[triangle[2]].Position - a);
+	}
+
+	// Drops pairs of coincident, opposite facing triangles: the faces where stacked objects
+	// touch, nobody can see them and they would pin the simplifier to every member's outline
+	void RemoveInternalFaces(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		const size_t triangleCount = indices.size() / 3;
+		std::vector<Face> faces(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			Face& face = faces[t];
+			for (int corner = 0; corner < 3; corner++)
+				face.Corners[corner] = vertices[indices[t * 3 + corner]].Position;
+			std::sort(face.Corners, face.Corners + 3, LessPosition);
+			face.Triangle = static_cast<uint32_t>(t);
+		}
+		std::sort(faces.begin(), faces.end());
+
+		std::vector<bool> removed(triangleCount, false);
+		for (size_t begin = 0; begin < faces.size();)
+		{
+			size_t end = begin + 1;
+			while (end < faces.size() && faces[end].SameCorners(faces[begin]))
+				end++;
+
+			if (end - begin == 2)
+			{
+				uint32_t a = faces[begin].Triangle;
+				uint32_t b = faces[begin + 1].Triangle;
+				if (glm::dot(TriangleNormal(vertices, &indices[a * 3]), TriangleNormal(vertices, &indices[b * 3])) < 0.f)
+					removed[a] = removed[b] = true;
+			}
+			begin = end;
+		}
+
+		size_t write = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			if (removed[t])
+				continue;
+			for (int corner = 0; corner < 3; corner++)
+				indices[write++] = indices[t * 3 + corner];
+		}
+		indices.resize(write);
+	}
+
+	// Copies the triangles along with only the vertices they reference
+	void AppendTriangles(const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount, const glm::mat4& transform,
+		std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices)
+	{
+		constexpr uint32_t UNMAPPED = 0xffffffffu;
+		std::vector<uint32_t> remap(vertices.size(), UNMAPPED);
+		const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			uint32_t& mapped = remap[indices[i]];
+			if (mapped == UNMAPPED)
+			{
+				mapped = static_cast<uint32_t>(outVertices.size());
+				Vertex vertex = vertices[indices[i]];
+				vertex.Position = glm::vec3(transform * glm::vec4(vertex.Position, 1.f));
+				vertex.Normal = glm::normalize(normalMatrix * vertex.Normal);
+				outVertices.push_back(vertex);
+			}
+			outIndices.push_back(mapped);
+		}
+	}
+}
+
+HLOD::HLOD()
+	: _sceneHash(0), _drawnCount(0), _drawnTriangles(0)
+{
+}
+
+bool HLOD::HasValidRanges(uint32_t objectCount) const
+{
+	const uint64_t vertexCount = _proxyData.Vertices.size();
+	const uint64_t indexCount = _proxyData.Indices.size();
+	for (uint32_t index : _proxyData.Indices)
+	{
+		if (index >= vertexCount)
+			return false;
+	}
+	for (uint32_t objectID : _clusterObjects)
+	{
+		if (objectID >= objectCount)
+			return false;
+	}
+	for (const HLODCluster& cluster : _clusters)
+	{
+		if (static_cast<uint64_t>(cluster.FirstIndex) + cluster.IndexCount > indexCount
+			|| static_cast<uint64_t>(cluster.FirstObject) + cluster.ObjectCount > _clusterObjects.size())
+			return false;
+	}
+	return true;
+}
+
+void HLOD::BuildObjectClusters(uint32_t objectCount)
+{
+	_objectClusters.assign(objectCount, -1);
+	for (size_t c = 0; c < _clusters.size(); c++)
+	{
+		const HLODCluster& cluster = _clusters[c];
+		for (uint32_t i = 0; i < cluster.ObjectCount; i++)
+			_objectClusters[_clusterObjects[cluster.FirstObject + i]] = static_cast<int32_t>(c);
+	}
+	_useProxy.assign(_clusters.size(), 0);
+}
+
+void HLOD::Build(const Scene& scene, const std::vector<MeshData>& meshes, float clusterSize /*= HLODDefaults::CLUSTER_SIZE*/,
+	VertexCacheStats* outCacheStats /*= nullptr*/)
+{
+	_clusters.clear();
+	_clusterObjects.clear();
+	_proxyData = MeshData();
+	_sceneHash = scene.ComputeHash();
+
+	const uint32_t objectCount = scene.GetObjectCount();
+	AABB staticBounds;
+	for (uint32_t objectID = 0; objectID < objectCount; objectID++)
+	{
+		if (scene.GetObject(objectID).IsStatic)
+			staticBounds.Expand(scene.GetWorldBounds(objectID));
+	}
+
+	if (staticBounds.IsEmpty())
+	{
+		BuildObjectClusters(objectCount);
+		return;
+	}
+
+	// Columns on the ground plane, a cluster spans the scene's whole height
+	glm::vec3 size = staticBounds.Max - staticBounds.Min;
+	glm::ivec2 cellCounts = glm::max(glm::ivec2(glm::ceil(glm::vec2(size.x, size.z) / clusterSize)), glm::ivec2(1));
+	std::vector<std::vector<uint32_t>> cells(static_cast<size_t>(cellCounts.x) * cellCounts.y);
+	for (uint32_t objectID = 0; objectID < objectCount; objectID++)
+	{
+		if (!scene.GetObject(objectID).IsStatic)
+			continue;
+
+		glm::vec3 center = scene.GetWorldBounds(objectID).GetCenter() - staticBounds.Min;
+		glm::ivec2 coords = glm::clamp(glm::ivec2(glm::vec2(center.x, center.z) / clusterSize), glm::ivec2(0), cellCounts - glm::ivec2(1));
+		cells[coords.x + coords.y * cellCounts.x].push_back(objectID);
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	VertexCacheStats cacheStats;
+	for (const std::vector<uint32_t>& members : cells)
+	{
+		if (members.empty())
+			continue;
+
+		HLODCluster cluster;
+		cluster.FirstObject = static_cast<uint32_t>(_clusterObjects.size());
+		cluster.ObjectCount = static_cast<uint32_t>(members.size());
+
+		// Members' coarsest levels merged in world space
+		vertices.clear();
+		indices.clear();
+		for (uint32_t objectID : members)
+		{
+			const SceneObject& object = scene.GetObject(objectID);
+			const MeshData& mesh = meshes[object.MeshID];
+			MeshLOD lod = mesh.LODs.empty() ? MeshLOD{ 0, static_cast<uint32_t>(mesh.Indices.size()), 0.f } : mesh.LODs.back();
+			AppendTriangles(mesh.Vertices, mesh.Indices.data() + lod.FirstIndex, lod.IndexCount, object.Model, vertices, indices);
+
+			cluster.Bounds.Expand(scene.GetWorldBounds(objectID));
+			_clusterObjects.push_back(objectID);
+		}
+
+		// Proxies are only seen from afar, the uv seams between faces are free to collapse
+		RemoveInternalFaces(vertices, indices);
+		float error;
+		size_t targetIndexCount = static_cast<size_t>(indices.size() / 3 * REDUCTION) * 3;
+		std::vector<uint32_t> simplified = SimplifyMesh(vertices, indices, targetIndexCount, error, MAX_ERROR, false);
+
+		// Appending in the optimized order also lays the vertices out in first use order
+		float triangles = static_cast<float>(simplified.size() / 3);
+		cacheStats.ACMRBefore += ComputeACMR(simplified.data(), simplified.size(), vertices.size()) * triangles;
+		OptimizeVertexCache(simplified.data(), simplified.size(), vertices.size());
+		cacheStats.ACMRAfter += ComputeACMR(simplified.data(), simplified.size(), vertices.size()) * triangles;
+
+		cluster.FirstIndex = static_cast<uint32_t>(_proxyData.Indices.size());
+		AppendTriangles(vertices, simplified.data(), simplified.size(), glm::mat4(1.f), _proxyData.Vertices, _proxyData.Indices);
+		cluster.IndexCount = static_cast<uint32_t>(_proxyData.Indices.size()) - cluster.FirstIndex;
+		_clusters.push_back(cluster);
+	}
+
+	_proxyData.ComputeBounds();
+	_proxyData.LODs.push_back({ 0, static_cast<uint32_t>(_proxyData.Indices.size()), 0.f });
+	BuildObjectClusters(objectCount);
+
+	if (outCacheStats && !_proxyData.Indices.empty())
+	{
+		float triangles = static_cast<float>(_proxyData.Indices.size() / 3);
+		outCacheStats->ACMRBefore = cacheStats.ACMRBefore / triangles;
+		outCacheStats->ACMRAfter = cacheStats.ACMRAfter / triangles;
+	}
+}
+
+bool HLOD::Save(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "ERROR::HLOD::FILE_NOT_WRITABLE: " << path << "\n";
+		return false;
+	}
+
+	HLODFileHeader header = {};
+	header.Magic = HLOD_MAGIC;
+	header.Version = HLOD_VERSION;
+	header.SceneHash = _sceneHash;
+	header.ObjectCount = static_cast<uint32_t>(_objectClusters.size());
+	header.ClusterCount = static_cast<uint32_t>(_clusters.size());
+	header.ClusterObjectCount = static_cast<uint32_t>(_clusterObjects.size());
+	header.VertexCount = static_cast<uint32_t>(_proxyData.Vertices.size());
+	header.IndexCount = static_cast<uint32_t>(_proxyData.Indices.size());
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(_clusters.data()), _clusters.size() * sizeof(HLODCluster));
+	file.write(reinterpret_cast<const char*>(_clusterObjects.data()), _clusterObjects.size() * sizeof(uint32_t));
+	file.write(reinterpret_cast<const char*>(_proxyData.Vertices.data()), _proxyData.Vertices.size() * sizeof(Vertex));
+	file.write(reinterpret_cast<const char*>(_proxyData.Indices.data()), _proxyData.Indices.size() * sizeof(uint32_t));
+	return static_cast<bool>(file);
+}
+
+bool HLOD::Load(const std::string& path, const Scene& scene)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	HLODFileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.Magic != HLOD_MAGIC || header.Version != HLOD_VERSION)
+	{
+		std::cout << "ERROR::HLOD::INVALID_FILE: " << path << "\n";
+		return false;
+	}
+
+	if (header.SceneHash != scene.ComputeHash() || header.ObjectCount != scene.GetObjectCount())
+	{
+		std::cout << "ERROR::HLOD::STALE_FILE: " << path << " was cooked for a different scene\n";
+		return false;
+	}
+
+	// Counts come from the file, they have to add up to its size before anything is allocated
+	const uint64_t expectedSize = sizeof(header) + static_cast<uint64_t>(header.ClusterCount) * sizeof(HLODCluster)
+		+ static_cast<uint64_t>(header.ClusterObjectCount) * sizeof(uint32_t) + static_cast<uint64_t>(header.VertexCount) * sizeof(Vertex)
+		+ static_cast<uint64_t>(header.IndexCount) * sizeof(uint32_t);
+	file.seekg(0, std::ios::end);
+	const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+	file.seekg(sizeof(header), std::ios::beg);
+	if (fileSize != expectedSize)
+	{
+		std::cout << "ERROR::HLOD::TRUNCATED_FILE: " << path << "\n";
+		return false;
+	}
+
+	_sceneHash = header.SceneHash;
+	_clusters.resize(header.ClusterCount);
+	_clusterObjects.resize(header.ClusterObjectCount);
+	_proxyData = MeshData();
+	_proxyData.Vertices.resize(header.VertexCount);
+	_proxyData.Indices.resize(header.IndexCount);
+
+	file.read(reinterpret_cast<char*>(_clusters.data()), _clusters.size() * sizeof(HLODCluster));
+	file.read(reinterpret_cast<char*>(_clusterObjects.data()), _clusterObjects.size() * sizeof(uint32_t));
+	file.read(reinterpret_cast<char*>(_proxyData.Vertices.data()), _proxyData.Vertices.size() * sizeof(Vertex));
+	file.read(reinterpret_cast<char*>(_proxyData.Indices.data()), _proxyData.Indices.size() * sizeof(uint32_t));
+	if (!file || !HasValidRanges(header.ObjectCount))
+	{
+		std::cout << (file ? "ERROR::HLOD::INVALID_FILE: " : "ERROR::HLOD::TRUNCATED_FILE: ") << path << "\n";
+		_clusters.clear();
+		_clusterObjects.clear();
+		_proxyData = MeshData();
+		return false;
+	}
+
+	_proxyData.ComputeBounds();
+	_proxyData.LODs.push_back({ 0, header.IndexCount, 0.f });
+	BuildObjectClusters(header.ObjectCount);
+	return true;
+}
+
+bool HLOD::IsEmpty() const
+{
+	return _clusters.empty();
+}
+
+uint32_t HLOD::GetClusterCount() const
+{
+	return static_cast<uint32_t>(_clusters.size());
+}
+
+const MeshData& HLOD::GetProxyData() const
+{
+	return _proxyData;
+}
+
+void HLOD::Update(const Frustum& frustum, const glm::vec3& cameraPosition, float distance /*= HLODDefaults::DISTANCE*/)
+{
+	_drawCounts.clear();
+	_drawOffsets.clear();
+	_drawnCount = 0;
+	_drawnTriangles = 0;
+
+	for (size_t c = 0; c < _clusters.size(); c++)
+	{
+		const HLODCluster& cluster = _clusters[c];
+		glm::vec3 closest = glm::clamp(cameraPosition, cluster.Bounds.Min, cluster.Bounds.Max);
+		float clusterDistance = glm::length(closest - cameraPosition);
+		float threshold = distance * (_useProxy[c] ? 1.f - HYSTERESIS : 1.f + HYSTERESIS);
+		_useProxy[c] = clusterDistance > threshold;
+
+		if (!_useProxy[c] || !frustum.IntersectsAABB(cluster.Bounds))
+			continue;
+
+		// Neighbouring clusters are contiguous in the index buffer, runs of them go out as one range
+		const void* offset = reinterpret_cast<const void*>(static_cast<uintptr_t>(cluster.FirstIndex) * sizeof(uint32_t));
+		const GLsizei count = static_cast<GLsizei>(cluster.IndexCount);
+		if (!_drawCounts.empty() && reinterpret_cast<uintptr_t>(_drawOffsets.back()) + _drawCounts.back() * sizeof(uint32_t) == reinterpret_cast<uintptr_t>(offset))
+		{
+			_drawCounts.back() += count;
+		}
+		else
+		{
+			_drawCounts.push_back(count);
+			_drawOffsets.push_back(offset);
+		}
+		_drawnCount++;
+		_drawnTriangles += cluster.IndexCount / 3;
+	}
+}
+
+bool HLOD::IsReplaced(uint32_t objectID) const
+{
+	if (objectID >= _objectClusters.size())
+		return false;
+
+	int32_t cluster = _objectClusters[objectID];
+	return cluster >= 0 && _useProxy[cluster];
+}
+
+void HLOD::Draw(const Mesh& proxyMesh) const
+{
+	if (_drawCounts.empty())
+		return;
+
+	proxyMesh.Bind();
+	proxyMesh.DrawRanges(_drawCounts.data(), _drawOffsets.data(), static_cast<GLsizei>(_drawCounts.size()));
+}
+
+uint32_t HLOD::GetDrawnCount() const
+{
+	return _drawnCount;
+}
+
+uint32_t HLOD::GetDrawnTriangles() const
+{
+	return _drawnTriangles;
+}
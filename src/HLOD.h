@@ -0,0 +1,91 @@
+#ifndef HLOD_H
+#define HLOD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "AABB.h"
+#include "Frustum.h"
+#include "Mesh.h"
+#include "Scene.h"
+#include "VertexCache.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace HLODDefaults
+{
+	// Horizontal size of the grid cells static objects are grouped on
+	constexpr float CLUSTER_SIZE = 24.f;
+	// Clusters whose bounds are further than this are drawn as their proxy
+	constexpr float DISTANCE = 90.f;
+	constexpr float HYSTERESIS = 0.1f;
+	// Proxy triangle budget relative to the merged members once hidden faces are gone
+	constexpr float REDUCTION = 0.25f;
+	// World space error a proxy may introduce, coplanar faces merge for free
+	constexpr float MAX_ERROR = 0.1f;
+}
+
+struct HLODCluster
+{
+	// Union of the members' world bounds
+	AABB Bounds;
+	// Proxy index range in the shared proxy mesh
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	// Member range in the cluster object list
+	uint32_t FirstObject;
+	uint32_t ObjectCount;
+};
+
+// Hierarchical LOD: static objects are grouped on a grid and every group is baked into one
+// merged, simplified proxy in world space. All proxies live in a single mesh, so any number
+// of far clusters costs one draw call instead of one per member.
+class HLOD
+{
+private:
+	std::vector<HLODCluster> _clusters;
+	std::vector<uint32_t> _clusterObjects;
+	MeshData _proxyData;
+	uint64_t _sceneHash;
+	// Per object, -1 for dynamic objects
+	std::vector<int32_t> _objectClusters;
+	// Per cluster, kept between frames for the hysteresis
+	std::vector<uint8_t> _useProxy;
+	std::vector<GLsizei> _drawCounts;
+	std::vector<const void*> _drawOffsets;
+	uint32_t _drawnCount;
+	uint32_t _drawnTriangles;
+
+	// Every index, member and range read from a file lands inside its own array
+	bool HasValidRanges(uint32_t objectCount) const;
+	void BuildObjectClusters(uint32_t objectCount);
+
+public:
+	HLOD();
+
+	// Cook time, meshes are indexed by SceneObject::MeshID and their coarsest LOD gets merged.
+	// outCacheStats gets the proxies' ACMR around the vertex cache optimization, triangle weighted.
+	void Build(const Scene& scene, const std::vector<MeshData>& meshes, float clusterSize = HLODDefaults::CLUSTER_SIZE,
+		VertexCacheStats* outCacheStats = nullptr);
+	bool Save(const std::string& path) const;
+	// Fails when the file is missing or was cooked for a different scene
+	bool Load(const std::string& path, const Scene& scene);
+
+	bool IsEmpty() const;
+	uint32_t GetClusterCount() const;
+	// Source for the GPU mesh Draw() expects
+	const MeshData& GetProxyData() const;
+
+	// Per frame, switches clusters by distance and gathers the visible proxies
+	void Update(const Frustum& frustum, const glm::vec3& cameraPosition, float distance = HLODDefaults::DISTANCE);
+	// The object is covered by its cluster's proxy this frame
+	bool IsReplaced(uint32_t objectID) const;
+	// One multi draw over the gathered proxies
+	void Draw(const Mesh& proxyMesh) const;
+
+	uint32_t GetDrawnCount() const;
+	uint32_t GetDrawnTriangles() const;
+};
+
+#endif // HLOD_H
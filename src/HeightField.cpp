@@ -0,0 +1,92 @@
+#include "HeightField.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace HeightFieldDefaults;
+
+namespace
+{
+	// Lattice value in [0, 1]
+	float LatticeValue(int x, int z, uint32_t seed)
+	{
+		uint32_t hash = static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(z) * 19349663u ^ seed * 83492791u;
+		hash ^= hash >> 13;
+		hash *= 0x5bd1e995u;
+		hash ^= hash >> 15;
+		return static_cast<float>(hash & 0xffffff) / static_cast<float>(0xffffff);
+	}
+
+	float ValueNoise(float x, float z, uint32_t seed)
+	{
+		int cellX = static_cast<int>(std::floor(x));
+		int cellZ = static_cast<int>(std::floor(z));
+		float fx = x - cellX;
+		float fz = z - cellZ;
+		// Smoothstep weights, no creases along the lattice lines
+		fx = fx * fx * (3.f - 2.f * fx);
+		fz = fz * fz * (3.f - 2.f * fz);
+
+		float a = LatticeValue(cellX, cellZ, seed);
+		float b = LatticeValue(cellX + 1, cellZ, seed);
+		float c = LatticeValue(cellX, cellZ + 1, seed);
+		float d = LatticeValue(cellX + 1, cellZ + 1, seed);
+		float top = a + (b - a) * fx;
+		float bottom = c + (d - c) * fx;
+		return top + (bottom - top) * fz;
+	}
+}
+
+float HeightField::GetHeight(uint32_t x, uint32_t z) const
+{
+	return Heights[static_cast<size_t>(z) * Resolution + x];
+}
+
+float HeightField::Sample(float u, float v) const
+{
+	const float last = static_cast<float>(Resolution - 1);
+	float x = std::clamp(u, 0.f, 1.f) * last;
+	float z = std::clamp(v, 0.f, 1.f) * last;
+	uint32_t x0 = std::min(static_cast<uint32_t>(x), Resolution - 2);
+	uint32_t z0 = std::min(static_cast<uint32_t>(z), Resolution - 2);
+	float fx = x - x0;
+	float fz = z - z0;
+
+	float top = GetHeight(x0, z0) + (GetHeight(x0 + 1, z0) - GetHeight(x0, z0)) * fx;
+	float bottom = GetHeight(x0, z0 + 1) + (GetHeight(x0 + 1, z0 + 1) - GetHeight(x0, z0 + 1)) * fx;
+	return top + (bottom - top) * fz;
+}
+
+HeightField GenerateHeightField(uint32_t resolution /*= RESOLUTION*/, uint32_t seed /*= 1*/)
+{
+	HeightField field;
+	field.Resolution = std::max(resolution, 2u);
+	field.Heights.resize(static_cast<size_t>(field.Resolution) * field.Resolution);
+
+	float minHeight = 1e30f, maxHeight = -1e30f;
+	const float step = BASE_FREQUENCY / (field.Resolution - 1);
+	for (uint32_t z = 0; z < field.Resolution; z++)
+	{
+		for (uint32_t x = 0; x < field.Resolution; x++)
+		{
+			float height = 0.f;
+			float amplitude = 1.f;
+			float frequency = 1.f;
+			for (int octave = 0; octave < OCTAVES; octave++)
+			{
+				height += ValueNoise(x * step * frequency, z * step * frequency, seed + octave) * amplitude;
+				amplitude *= 0.5f;
+				frequency *= 2.f;
+			}
+			field.Heights[static_cast<size_t>(z) * field.Resolution + x] = height;
+			minHeight = std::min(minHeight, height);
+			maxHeight = std::max(maxHeight, height);
+		}
+	}
+
+	// Stretched to the full range, the caller's height scale is then the real relief
+	const float range = std::max(maxHeight - minHeight, 1e-6f);
+	for (float& height : field.Heights)
+		height = (height - minHeight) / range;
+	return field;
+}
@@ -0,0 +1,30 @@
+#ifndef HEIGHT_FIELD_H
+#define HEIGHT_FIELD_H
+
+#include <cstdint>
+#include <vector>
+
+namespace HeightFieldDefaults
+{
+	// Samples per side, a power of two plus one so patch corners land on samples
+	constexpr uint32_t RESOLUTION = 257;
+	constexpr int OCTAVES = 5;
+	// Lattice cells of the coarsest octave across the whole field
+	constexpr float BASE_FREQUENCY = 4.f;
+}
+
+// Square grid of heights in [0, 1], row major with rows along Z
+struct HeightField
+{
+	uint32_t Resolution = 0;
+	std::vector<float> Heights;
+
+	float GetHeight(uint32_t x, uint32_t z) const;
+	// Bilinear, u along X and v along Z, both clamped to [0, 1]
+	float Sample(float u, float v) const;
+};
+
+// Fractal value noise, the same seed always builds the same field
+HeightField GenerateHeightField(uint32_t resolution = HeightFieldDefaults::RESOLUTION, uint32_t seed = 1);
+
+#endif // HEIGHT_FIELD_H
@@ -0,0 +1,245 @@
+#include "Impostors.h"
+#include "Logger.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+using namespace ImpostorDefaults;
+
+ImpostorRenderer::ImpostorRenderer(float distance)
+	: _shader("resources/shaders/impostor.vert", "resources/shaders/impostor.frag"),
+	_atlas(0), _quadVAO(0), _quadVBO(0), _instanceVBO(0), _meshCount(0), _distance(distance)
+{
+	const float corners[] = {
+		-1.f, -1.f,
+		 1.f, -1.f,
+		-1.f,  1.f,
+		 1.f,  1.f
+	};
+
+	GL_CHECK(glGenVertexArrays(1, &_quadVAO));
+	GL_CHECK(glGenBuffers(1, &_quadVBO));
+	GL_CHECK(glGenBuffers(1, &_instanceVBO));
+
+	GL_CHECK(glBindVertexArray(_quadVAO));
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, _quadVBO));
+	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW));
+	GL_CHECK(glEnableVertexAttribArray(0));
+	GL_CHECK(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0));
+
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, _instanceVBO));
+	GL_CHECK(glEnableVertexAttribArray(1));
+	GL_CHECK(glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ImpostorInstance), (void*)offsetof(ImpostorInstance, Center)));
+	GL_CHECK(glVertexAttribDivisor(1, 1));
+	GL_CHECK(glEnableVertexAttribArray(2));
+	GL_CHECK(glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ImpostorInstance), (void*)offsetof(ImpostorInstance, Right)));
+	GL_CHECK(glVertexAttribDivisor(2, 1));
+	GL_CHECK(glEnableVertexAttribArray(3));
+	GL_CHECK(glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(ImpostorInstance), (void*)offsetof(ImpostorInstance, Up)));
+	GL_CHECK(glVertexAttribDivisor(3, 1));
+	GL_CHECK(glEnableVertexAttribArray(4));
+	GL_CHECK(glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(ImpostorInstance), (void*)offsetof(ImpostorInstance, CellOrigin)));
+	GL_CHECK(glVertexAttribDivisor(4, 1));
+
+	GL_CHECK(glBindVertexArray(0));
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+ImpostorRenderer::~ImpostorRenderer()
+{
+	if (_atlas)
+		glDeleteTextures(1, &_atlas);
+	glDeleteVertexArrays(1, &_quadVAO);
+	glDeleteBuffers(1, &_quadVBO);
+	glDeleteBuffers(1, &_instanceVBO);
+}
+
+glm::vec3 ImpostorRenderer::GetViewDirection(int yaw, int pitch)
+{
+	float yawAngle = yaw * glm::two_pi<float>() / YAW_VIEWS;
+	float pitchAngle = -glm::half_pi<float>() + glm::pi<float>() * (pitch + 0.5f) / PITCH_VIEWS;
+	return glm::vec3(std::cos(pitchAngle) * std::sin(yawAngle), std::sin(pitchAngle), std::cos(pitchAngle) * std::cos(yawAngle));
+}
+
+void ImpostorRenderer::GetCaptureAxes(const glm::vec3& direction, glm::vec3& outRight, glm::vec3& outUp)
+{
+	// Pitch rows are centered between the poles, the direction is never parallel to Y
+	const glm::vec3 forward = -direction;
+	outRight = glm::normalize(glm::cross(forward, glm::vec3(0.f, 1.f, 0.f)));
+	outUp = glm::cross(outRight, forward);
+}
+
+void ImpostorRenderer::Build(const std::vector<const Mesh*>& meshes, const Shader& captureShader)
+{
+	_meshCount = static_cast<int>(meshes.size());
+	_meshCenters.resize(meshes.size());
+	_meshRadii.resize(meshes.size());
+
+	const int atlasWidth = YAW_VIEWS * CELL_SIZE;
+	const int atlasHeight = PITCH_VIEWS * CELL_SIZE * _meshCount;
+
+	if (!_atlas)
+		GL_CHECK(glGenTextures(1, &_atlas));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, _atlas));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, MAX_MIP_LEVEL));
+	GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasWidth, atlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+
+	// Throwaway target, only the color texture outlives the capture
+	unsigned int framebuffer, depthBuffer;
+	GL_CHECK(glGenFramebuffers(1, &framebuffer));
+	GL_CHECK(glGenRenderbuffers(1, &depthBuffer));
+	GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer));
+	GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasWidth, atlasHeight));
+	GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+	GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _atlas, 0));
+	GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer));
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR::IMPOSTORS::FRAMEBUFFER_INCOMPLETE\n";
+		_meshCount = 0;
+	}
+	else
+	{
+		GLint viewport[4];
+		GL_CHECK(glGetIntegerv(GL_VIEWPORT, viewport));
+
+		GL_CHECK(glClearColor(0.f, 0.f, 0.f, 0.f));
+		GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+		captureShader.Use();
+
+		for (int meshID = 0; meshID < _meshCount; meshID++)
+		{
+			const Mesh& mesh = *meshes[meshID];
+			glm::vec3 center = mesh.GetBounds().GetCenter();
+			float radius = glm::length(mesh.GetBounds().GetExtents());
+			_meshCenters[meshID] = center;
+			_meshRadii[meshID] = radius;
+
+			// Orthographic, the bounding sphere fills the cell from any direction
+			glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, radius, 3.f * radius);
+			captureShader.SetUniformMat4fv("projection", projection);
+			captureShader.SetUniformMat4fv("model", glm::translate(glm::mat4(1.f), -center));
+
+			mesh.Bind();
+			for (int pitch = 0; pitch < PITCH_VIEWS; pitch++)
+			{
+				for (int yaw = 0; yaw < YAW_VIEWS; yaw++)
+				{
+					GL_CHECK(glViewport(yaw * CELL_SIZE + CELL_PADDING, (meshID * PITCH_VIEWS + pitch) * CELL_SIZE + CELL_PADDING,
+						CELL_SIZE - 2 * CELL_PADDING, CELL_SIZE - 2 * CELL_PADDING));
+
+					glm::vec3 direction = GetViewDirection(yaw, pitch);
+					glm::vec3 right, up;
+					GetCaptureAxes(direction, right, up);
+					glm::mat4 view = glm::lookAt(direction * 2.f * radius, glm::vec3(0.f), up);
+					captureShader.SetUniformMat4fv("view", view);
+					mesh.Draw();
+				}
+			}
+		}
+		GL_CHECK(glBindVertexArray(0));
+		GL_CHECK(glViewport(viewport[0], viewport[1], viewport[2], viewport[3]));
+	}
+
+	GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	GL_CHECK(glDeleteFramebuffers(1, &framebuffer));
+	GL_CHECK(glDeleteRenderbuffers(1, &depthBuffer));
+
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, _atlas));
+	GL_CHECK(glGenerateMipmap(GL_TEXTURE_2D));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+bool ImpostorRenderer::IsBuilt() const
+{
+	return _meshCount > 0;
+}
+
+bool ImpostorRenderer::ShouldUse(const AABB& worldBounds, const glm::vec3& cameraPosition) const
+{
+	glm::vec3 offset = worldBounds.GetCenter() - cameraPosition;
+	return IsBuilt() && glm::dot(offset, offset) > _distance * _distance;
+}
+
+void ImpostorRenderer::Add(const SceneObject& object, const glm::vec3& cameraPosition)
+{
+	const uint32_t meshID = object.MeshID;
+	glm::vec3 center = glm::vec3(object.Model * glm::vec4(_meshCenters[meshID], 1.f));
+	float scale = std::max({ glm::length(glm::vec3(object.Model[0])), glm::length(glm::vec3(object.Model[1])), glm::length(glm::vec3(object.Model[2])) });
+
+	// Viewing direction in mesh space, so rotated instances pick the matching capture
+	glm::vec3 toCamera = glm::inverse(glm::mat3(object.Model)) * (cameraPosition - center);
+	float length = glm::length(toCamera);
+	toCamera = length > 0.f ? toCamera / length : glm::vec3(0.f, 0.f, 1.f);
+
+	float yawAngle = std::atan2(toCamera.x, toCamera.z);
+	if (yawAngle < 0.f)
+		yawAngle += glm::two_pi<float>();
+	int yaw = static_cast<int>(std::round(yawAngle / glm::two_pi<float>() * YAW_VIEWS)) % YAW_VIEWS;
+
+	float pitchAngle = std::asin(std::clamp(toCamera.y, -1.f, 1.f));
+	int pitch = std::clamp(static_cast<int>((pitchAngle + glm::half_pi<float>()) / glm::pi<float>() * PITCH_VIEWS), 0, PITCH_VIEWS - 1);
+
+	// Quad on the captured view's axes turned into world space, wide enough that the padded cell
+	// shows the sphere at its real size
+	glm::vec3 right, up;
+	GetCaptureAxes(GetViewDirection(yaw, pitch), right, up);
+	const glm::mat3 rotation = glm::mat3(object.Model);
+	const float halfSize = _meshRadii[meshID] * scale * CELL_SIZE / (CELL_SIZE - 2 * CELL_PADDING);
+
+	ImpostorInstance instance;
+	instance.Center = center;
+	instance.Right = glm::normalize(rotation * right) * halfSize;
+	instance.Up = glm::normalize(rotation * up) * halfSize;
+	instance.CellOrigin = glm::vec2(static_cast<float>(yaw) / YAW_VIEWS, static_cast<float>(meshID * PITCH_VIEWS + pitch) / (PITCH_VIEWS * _meshCount));
+	_instances.push_back(instance);
+}
+
+void ImpostorRenderer::Draw(const glm::mat4& view, const glm::mat4& projection)
+{
+	if (_instances.empty())
+		return;
+
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, _instanceVBO));
+	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, _instances.size() * sizeof(ImpostorInstance), _instances.data(), GL_STREAM_DRAW));
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+	_shader.Use();
+	_shader.SetUniformMat4fv("view", view);
+	_shader.SetUniformMat4fv("projection", projection);
+	_shader.SetUniformVec2("cellSize", 1.f / YAW_VIEWS, 1.f / (PITCH_VIEWS * _meshCount));
+	_shader.SetUniformI("atlas", 0);
+
+	GL_CHECK(glActiveTexture(GL_TEXTURE0));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, _atlas));
+	GL_CHECK(glBindVertexArray(_quadVAO));
+	GL_CHECK(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(_instances.size())));
+	GL_CHECK(glBindVertexArray(0));
+
+	_instances.clear();
+}
+
+float ImpostorRenderer::GetDistance() const
+{
+	return _distance;
+}
+
+void ImpostorRenderer::SetDistance(float distance)
+{
+	_distance = distance;
+}
+
+uint32_t ImpostorRenderer::GetQueuedCount() const
+{
+	return static_cast<uint32_t>(_instances.size());
+}
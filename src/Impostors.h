@@ -0,0 +1,85 @@
+#ifndef IMPOSTORS_H
+#define IMPOSTORS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "AABB.h"
+#include "Mesh.h"
+#include "Scene.h"
+#include "Shader.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ImpostorDefaults
+{
+	// Captured views per mesh, yaw around local Y times pitch rows from pole to pole
+	constexpr int YAW_VIEWS = 8;
+	constexpr int PITCH_VIEWS = 5;
+	// Pixels per captured view
+	constexpr int CELL_SIZE = 64;
+	// Transparent border inside every cell, the atlas stops at the mip whose texels are this wide
+	// so no level blends a view with its neighbours
+	constexpr int CELL_PADDING = 4;
+	constexpr int MAX_MIP_LEVEL = 2;
+	static_assert((1 << MAX_MIP_LEVEL) <= CELL_PADDING, "Mip texels would reach into the next cell");
+	// Objects whose bounds center is farther than this are drawn as impostors
+	constexpr float DISTANCE = 60.f;
+}
+
+// Billboard stand-ins for far objects. Every mesh is rendered from a fixed set of directions
+// into one atlas at load time; far instances become camera facing quads showing the captured
+// view closest to the direction they are seen from, all of them in one instanced draw.
+// A quad is laid out on the same axes its view was captured with, so the image never rolls.
+class ImpostorRenderer
+{
+private:
+	struct ImpostorInstance
+	{
+		glm::vec3 Center;
+		// World space half axes of the quad
+		glm::vec3 Right;
+		glm::vec3 Up;
+		glm::vec2 CellOrigin;
+	};
+
+	Shader _shader;
+	unsigned int _atlas;
+	unsigned int _quadVAO;
+	unsigned int _quadVBO;
+	unsigned int _instanceVBO;
+	int _meshCount;
+	float _distance;
+
+	// Bounding sphere of every mesh in its own space
+	std::vector<glm::vec3> _meshCenters;
+	std::vector<float> _meshRadii;
+	std::vector<ImpostorInstance> _instances;
+
+	static glm::vec3 GetViewDirection(int yaw, int pitch);
+	// Image axes of the capture from a direction in mesh space, as glm::lookAt builds them
+	static void GetCaptureAxes(const glm::vec3& direction, glm::vec3& outRight, glm::vec3& outUp);
+
+public:
+	explicit ImpostorRenderer(float distance = ImpostorDefaults::DISTANCE);
+	~ImpostorRenderer();
+
+	ImpostorRenderer(const ImpostorRenderer&) = delete;
+	ImpostorRenderer& operator=(const ImpostorRenderer&) = delete;
+
+	// Load time capture. The shader needs model/view/projection uniforms, its textures bound already
+	void Build(const std::vector<const Mesh*>& meshes, const Shader& captureShader);
+	bool IsBuilt() const;
+
+	bool ShouldUse(const AABB& worldBounds, const glm::vec3& cameraPosition) const;
+	// Queues an impostor for the object, drawn with the rest on the next Draw()
+	void Add(const SceneObject& object, const glm::vec3& cameraPosition);
+	// Draws and clears the queue, binds the atlas on texture unit 0
+	void Draw(const glm::mat4& view, const glm::mat4& projection);
+
+	float GetDistance() const;
+	void SetDistance(float distance);
+	uint32_t GetQueuedCount() const;
+};
+
+#endif // IMPOSTORS_H
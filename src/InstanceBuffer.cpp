@@ -0,0 +1,109 @@
+#include "InstanceBuffer.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace InstanceBufferDefaults;
+
+InstanceBuffer::InstanceBuffer(uint32_t stride, GLenum usage /*= GL_DYNAMIC_DRAW*/)
+	: _buffer(0), _stride(stride), _usage(usage), _count(0), _uploadedBytes(0), _uploadedRanges(0)
+{
+	GL_CHECK(glGenBuffers(1, &_buffer));
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+	glDeleteBuffers(1, &_buffer);
+}
+
+void InstanceBuffer::Assign(const void* elements, uint32_t count)
+{
+	_count = count;
+	_data.resize(static_cast<size_t>(count) * _stride);
+	if (count > 0)
+		std::memcpy(_data.data(), elements, _data.size());
+	_dirtyFlags.assign(count, false);
+	_dirty.clear();
+
+	GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer));
+	GL_CHECK(glBufferData(GL_COPY_WRITE_BUFFER, _data.size(), _data.data(), _usage));
+	GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+void InstanceBuffer::Set(uint32_t index, const void* element)
+{
+	std::memcpy(&_data[static_cast<size_t>(index) * _stride], element, _stride);
+	if (_dirtyFlags[index])
+		return;
+	_dirtyFlags[index] = true;
+	_dirty.push_back(index);
+}
+
+void InstanceBuffer::UploadRange(uint32_t first, uint32_t count)
+{
+	const size_t offset = static_cast<size_t>(first) * _stride;
+	const size_t bytes = static_cast<size_t>(count) * _stride;
+	GL_CHECK(glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, &_data[offset]));
+	_uploadedBytes += bytes;
+	_uploadedRanges++;
+}
+
+size_t InstanceBuffer::Flush()
+{
+	_uploadedBytes = 0;
+	_uploadedRanges = 0;
+	if (_dirty.empty())
+		return 0;
+
+	GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer));
+	if (_dirty.size() >= _count * FULL_UPLOAD_FRACTION)
+	{
+		// Fresh storage, the driver never waits for frames still reading the old one
+		GL_CHECK(glBufferData(GL_COPY_WRITE_BUFFER, _data.size(), _data.data(), _usage));
+		_uploadedBytes = _data.size();
+		_uploadedRanges = 1;
+	}
+	else
+	{
+		std::sort(_dirty.begin(), _dirty.end());
+		uint32_t first = _dirty[0];
+		uint32_t end = first + 1;
+		for (size_t i = 1; i < _dirty.size(); i++)
+		{
+			if (_dirty[i] - end > MERGE_GAP)
+			{
+				UploadRange(first, end - first);
+				first = _dirty[i];
+			}
+			end = _dirty[i] + 1;
+		}
+		UploadRange(first, end - first);
+	}
+	GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+	for (uint32_t index : _dirty)
+		_dirtyFlags[index] = false;
+	_dirty.clear();
+	return _uploadedBytes;
+}
+
+unsigned int InstanceBuffer::GetBufferID() const
+{
+	return _buffer;
+}
+
+uint32_t InstanceBuffer::GetCount() const
+{
+	return _count;
+}
+
+size_t InstanceBuffer::GetUploadedBytes() const
+{
+	return _uploadedBytes;
+}
+
+uint32_t InstanceBuffer::GetUploadedRanges() const
+{
+	return _uploadedRanges;
+}
@@ -0,0 +1,57 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace InstanceBufferDefaults
+{
+	// Past this share of dirty instances one orphaning upload of everything beats the ranges
+	constexpr float FULL_UPLOAD_FRACTION = 0.5f;
+	// Clean instances between two dirty runs still sent along, cheaper than another call
+	constexpr uint32_t MERGE_GAP = 8;
+}
+
+// Per-instance GPU buffer with a CPU copy. Set() only writes the copy and marks the instance,
+// Flush() sends what was marked as coalesced glBufferSubData ranges, or the whole buffer when
+// most of it is dirty anyway. Uploads go through the copy target, so no binding is disturbed.
+class InstanceBuffer
+{
+private:
+	unsigned int _buffer;
+	uint32_t _stride;
+	GLenum _usage;
+	uint32_t _count;
+	std::vector<uint8_t> _data;
+	std::vector<bool> _dirtyFlags;
+	std::vector<uint32_t> _dirty;
+
+	size_t _uploadedBytes;
+	uint32_t _uploadedRanges;
+
+	void UploadRange(uint32_t first, uint32_t count);
+
+public:
+	InstanceBuffer(uint32_t stride, GLenum usage = GL_DYNAMIC_DRAW);
+	~InstanceBuffer();
+
+	InstanceBuffer(const InstanceBuffer&) = delete;
+	InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+	// Replaces everything, uploaded right away
+	void Assign(const void* elements, uint32_t count);
+	void Set(uint32_t index, const void* element);
+	// Sends everything set since the last flush, returns the bytes sent
+	size_t Flush();
+
+	unsigned int GetBufferID() const;
+	uint32_t GetCount() const;
+	// Of the last Flush
+	size_t GetUploadedBytes() const;
+	uint32_t GetUploadedRanges() const;
+};
+
+#endif // INSTANCE_BUFFER_H
@@ -0,0 +1,362 @@
+#include "Json.h"
+
+#include <charconv>
+#include <cstdlib>
+
+namespace
+{
+	// Deeper documents are rejected rather than overflowing the stack
+	constexpr int MAX_DEPTH = 256;
+
+	const JsonValue NULL_VALUE;
+	const std::string EMPTY_STRING;
+
+	void AppendUtf8(std::string& out, uint32_t codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			out += static_cast<char>(codePoint);
+		}
+		else if (codePoint < 0x800)
+		{
+			out += static_cast<char>(0xc0 | (codePoint >> 6));
+			out += static_cast<char>(0x80 | (codePoint & 0x3f));
+		}
+		else if (codePoint < 0x10000)
+		{
+			out += static_cast<char>(0xe0 | (codePoint >> 12));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+			out += static_cast<char>(0x80 | (codePoint & 0x3f));
+		}
+		else
+		{
+			out += static_cast<char>(0xf0 | (codePoint >> 18));
+			out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+			out += static_cast<char>(0x80 | (codePoint & 0x3f));
+		}
+	}
+}
+
+class JsonParser
+{
+private:
+	const char* _begin;
+	const char* _cursor;
+	const char* _end;
+	std::string _error;
+
+	bool Fail(const char* message)
+	{
+		if (_error.empty())
+			_error = message;
+		return false;
+	}
+
+	void SkipWhitespace()
+	{
+		while (_cursor < _end && (*_cursor == ' ' || *_cursor == '\t' || *_cursor == '\n' || *_cursor == '\r'))
+			_cursor++;
+	}
+
+	bool Expect(const char* literal)
+	{
+		for (const char* c = literal; *c; c++, _cursor++)
+		{
+			if (_cursor == _end || *_cursor != *c)
+				return Fail("unexpected literal");
+		}
+		return true;
+	}
+
+	bool ParseHex4(uint32_t& outValue)
+	{
+		if (_end - _cursor < 4)
+			return Fail("truncated unicode escape");
+		std::from_chars_result result = std::from_chars(_cursor, _cursor + 4, outValue, 16);
+		if (result.ptr != _cursor + 4)
+			return Fail("invalid unicode escape");
+		_cursor += 4;
+		return true;
+	}
+
+	bool ParseString(std::string& out)
+	{
+		// Opening quote already checked
+		_cursor++;
+		while (_cursor < _end && *_cursor != '"')
+		{
+			char c = *_cursor++;
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+			if (_cursor == _end)
+				break;
+
+			switch (*_cursor++)
+			{
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				uint32_t codePoint;
+				if (!ParseHex4(codePoint))
+					return false;
+				// Surrogate pair
+				if (codePoint >= 0xd800 && codePoint < 0xdc00 && _end - _cursor >= 6 && _cursor[0] == '\\' && _cursor[1] == 'u')
+				{
+					_cursor += 2;
+					uint32_t low;
+					if (!ParseHex4(low))
+						return false;
+					codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+				}
+				AppendUtf8(out, codePoint);
+				break;
+			}
+			default:
+				return Fail("invalid escape");
+			}
+		}
+		if (_cursor == _end)
+			return Fail("unterminated string");
+		_cursor++;
+		return true;
+	}
+
+	bool ParseNumber(double& out)
+	{
+		// from_chars takes no leading '+' and JSON allows none either
+		std::from_chars_result result = std::from_chars(_cursor, _end, out);
+		if (result.ec != std::errc())
+			return Fail("invalid number");
+		_cursor = result.ptr;
+		return true;
+	}
+
+	bool ParseValue(JsonValue& out, int depth)
+	{
+		if (depth > MAX_DEPTH)
+			return Fail("nesting too deep");
+
+		SkipWhitespace();
+		if (_cursor == _end)
+			return Fail("unexpected end");
+
+		switch (*_cursor)
+		{
+		case 'n':
+			out._type = JsonValue::Type::Null;
+			return Expect("null");
+		case 't':
+			out._type = JsonValue::Type::Bool;
+			out._bool = true;
+			return Expect("true");
+		case 'f':
+			out._type = JsonValue::Type::Bool;
+			out._bool = false;
+			return Expect("false");
+		case '"':
+			out._type = JsonValue::Type::String;
+			return ParseString(out._string);
+		case '[':
+		{
+			out._type = JsonValue::Type::Array;
+			_cursor++;
+			SkipWhitespace();
+			if (_cursor < _end && *_cursor == ']')
+			{
+				_cursor++;
+				return true;
+			}
+			while (true)
+			{
+				out._array.emplace_back();
+				if (!ParseValue(out._array.back(), depth + 1))
+					return false;
+				SkipWhitespace();
+				if (_cursor < _end && *_cursor == ',')
+				{
+					_cursor++;
+					continue;
+				}
+				if (_cursor < _end && *_cursor == ']')
+				{
+					_cursor++;
+					return true;
+				}
+				return Fail("expected ',' or ']'");
+			}
+		}
+		case '{':
+		{
+			out._type = JsonValue::Type::Object;
+			_cursor++;
+			SkipWhitespace();
+			if (_cursor < _end && *_cursor == '}')
+			{
+				_cursor++;
+				return true;
+			}
+			while (true)
+			{
+				SkipWhitespace();
+				if (_cursor == _end || *_cursor != '"')
+					return Fail("expected member name");
+				out._object.emplace_back();
+				if (!ParseString(out._object.back().first))
+					return false;
+				SkipWhitespace();
+				if (_cursor == _end || *_cursor != ':')
+					return Fail("expected ':'");
+				_cursor++;
+				if (!ParseValue(out._object.back().second, depth + 1))
+					return false;
+				SkipWhitespace();
+				if (_cursor < _end && *_cursor == ',')
+				{
+					_cursor++;
+					continue;
+				}
+				if (_cursor < _end && *_cursor == '}')
+				{
+					_cursor++;
+					return true;
+				}
+				return Fail("expected ',' or '}'");
+			}
+		}
+		default:
+			out._type = JsonValue::Type::Number;
+			return ParseNumber(out._number);
+		}
+	}
+
+public:
+	JsonParser(const char* text, size_t size)
+		: _begin(text), _cursor(text), _end(text + size)
+	{
+	}
+
+	bool Parse(JsonValue& out, std::string& outError)
+	{
+		out = JsonValue();
+		bool parsed = ParseValue(out, 0);
+		SkipWhitespace();
+		if (parsed && _cursor != _end)
+			parsed = Fail("trailing characters");
+		if (!parsed)
+			outError = _error + " at byte " + std::to_string(_cursor - _begin);
+		return parsed;
+	}
+};
+
+JsonValue::JsonValue()
+	: _type(Type::Null), _bool(false), _number(0.0)
+{
+}
+
+JsonValue::Type JsonValue::GetType() const
+{
+	return _type;
+}
+
+bool JsonValue::IsNull() const
+{
+	return _type == Type::Null;
+}
+
+bool JsonValue::IsNumber() const
+{
+	return _type == Type::Number;
+}
+
+bool JsonValue::IsString() const
+{
+	return _type == Type::String;
+}
+
+bool JsonValue::IsArray() const
+{
+	return _type == Type::Array;
+}
+
+bool JsonValue::IsObject() const
+{
+	return _type == Type::Object;
+}
+
+bool JsonValue::AsBool(bool fallback /*= false*/) const
+{
+	return _type == Type::Bool ? _bool : fallback;
+}
+
+double JsonValue::AsNumber(double fallback /*= 0.0*/) const
+{
+	return _type == Type::Number ? _number : fallback;
+}
+
+int64_t JsonValue::AsInt(int64_t fallback /*= 0*/) const
+{
+	return _type == Type::Number ? static_cast<int64_t>(_number) : fallback;
+}
+
+const std::string& JsonValue::AsString() const
+{
+	return _type == Type::String ? _string : EMPTY_STRING;
+}
+
+size_t JsonValue::GetSize() const
+{
+	if (_type == Type::Array)
+		return _array.size();
+	if (_type == Type::Object)
+		return _object.size();
+	return 0;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	if (_type == Type::Array && index < _array.size())
+		return _array[index];
+	if (_type == Type::Object && index < _object.size())
+		return _object[index].second;
+	return NULL_VALUE;
+}
+
+const JsonValue& JsonValue::operator[](int index) const
+{
+	return index < 0 ? NULL_VALUE : (*this)[static_cast<size_t>(index)];
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const
+{
+	if (_type == Type::Object)
+	{
+		for (const auto& member : _object)
+		{
+			if (member.first == key)
+				return member.second;
+		}
+	}
+	return NULL_VALUE;
+}
+
+bool JsonValue::Has(const char* key) const
+{
+	return !(*this)[key].IsNull();
+}
+
+bool ParseJson(const char* text, size_t size, JsonValue& outValue, std::string& outError)
+{
+	JsonParser parser(text, size);
+	return parser.Parse(outValue, outError);
+}
@@ -0,0 +1,64 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Read only JSON document, enough for asset manifests like glTF. Lookups of missing members
+// or elements return a shared null value so chains like json["a"][0]["b"] never fail.
+class JsonValue
+{
+public:
+	enum class Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+private:
+	Type _type;
+	bool _bool;
+	double _number;
+	std::string _string;
+	std::vector<JsonValue> _array;
+	// Members in file order, objects in asset files are small enough for a linear search
+	std::vector<std::pair<std::string, JsonValue>> _object;
+
+	friend class JsonParser;
+
+public:
+	JsonValue();
+
+	Type GetType() const;
+	bool IsNull() const;
+	bool IsNumber() const;
+	bool IsString() const;
+	bool IsArray() const;
+	bool IsObject() const;
+
+	bool AsBool(bool fallback = false) const;
+	double AsNumber(double fallback = 0.0) const;
+	// Integers come through AsNumber, exact up to 2^53
+	int64_t AsInt(int64_t fallback = 0) const;
+	const std::string& AsString() const;
+
+	// Array elements or object members
+	size_t GetSize() const;
+	const JsonValue& operator[](size_t index) const;
+	// Keeps json[0] from being ambiguous with the null pointer key
+	const JsonValue& operator[](int index) const;
+	const JsonValue& operator[](const char* key) const;
+	bool Has(const char* key) const;
+};
+
+// False with a message in outError on malformed input
+bool ParseJson(const char* text, size_t size, JsonValue& outValue, std::string& outError);
+
+#endif // JSON_H
@@ -0,0 +1,287 @@
+#include "KTX2File.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+using namespace KTX2Defaults;
+
+namespace
+{
+	constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	constexpr uint32_t VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+	constexpr uint32_t VK_FORMAT_BC3_UNORM_BLOCK = 137;
+	// Khronos data format descriptor values for the basic block
+	constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+	constexpr uint32_t KHR_DF_MODEL_BC3 = 130;
+	constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+	constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+	constexpr uint32_t KHR_DF_CHANNEL_COLOR = 0;
+	constexpr uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+
+	struct KTX2Header
+	{
+		uint8_t Identifier[12];
+		uint32_t VkFormat;
+		uint32_t TypeSize;
+		uint32_t PixelWidth;
+		uint32_t PixelHeight;
+		uint32_t PixelDepth;
+		uint32_t LayerCount;
+		uint32_t FaceCount;
+		uint32_t LevelCount;
+		uint32_t SupercompressionScheme;
+		uint32_t DfdByteOffset;
+		uint32_t DfdByteLength;
+		uint32_t KvdByteOffset;
+		uint32_t KvdByteLength;
+		uint64_t SgdByteOffset;
+		uint64_t SgdByteLength;
+	};
+	static_assert(sizeof(KTX2Header) == 80, "KTX2 header is 80 bytes on disk");
+
+	struct KTX2LevelIndex
+	{
+		uint64_t ByteOffset;
+		uint64_t ByteLength;
+		uint64_t UncompressedByteLength;
+	};
+
+	uint64_t Align(uint64_t offset, uint64_t alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	// Basic descriptor block with one 64 bit sample per S3TC sub block
+	std::vector<uint32_t> BuildDataFormatDescriptor(BlockFormat format)
+	{
+		const uint32_t sampleCount = format == BlockFormat::BC1 ? 1 : 2;
+		const uint32_t blockSize = 24 + 16 * sampleCount;
+		const uint32_t model = format == BlockFormat::BC1 ? KHR_DF_MODEL_BC1A : KHR_DF_MODEL_BC3;
+		std::vector<uint32_t> words = {
+			4 + blockSize,
+			0,
+			2 | (blockSize << 16),
+			model | (KHR_DF_PRIMARIES_BT709 << 8) | (KHR_DF_TRANSFER_LINEAR << 16),
+			3 | (3 << 8),
+			static_cast<uint32_t>(GetBlockBytes(format)),
+			0
+		};
+		auto addSample = [&](uint32_t bitOffset, uint32_t channel)
+			{
+				words.insert(words.end(), { bitOffset | (63u << 16) | (channel << 24), 0u, 0u, 0xFFFFFFFFu });
+			};
+		if (format == BlockFormat::BC3)
+			addSample(0, KHR_DF_CHANNEL_ALPHA);
+		addSample(format == BlockFormat::BC3 ? 64 : 0, KHR_DF_CHANNEL_COLOR);
+		return words;
+	}
+
+	// Sorted by key, every entry padded to 4 bytes
+	std::vector<uint8_t> BuildKeyValueData(uint64_t sourceHash)
+	{
+		char hex[17];
+		std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(sourceHash));
+		const std::pair<std::string, std::string> entries[] = {
+			{ "KTXorientation", "rd" },
+			{ "KTXwriter", "SMTH3D Cook" },
+			{ SOURCE_HASH_KEY, hex }
+		};
+
+		std::vector<uint8_t> data;
+		for (const auto& entry : entries)
+		{
+			const uint32_t length = static_cast<uint32_t>(entry.first.size() + 1 + entry.second.size() + 1);
+			const uint8_t* lengthBytes = reinterpret_cast<const uint8_t*>(&length);
+			data.insert(data.end(), lengthBytes, lengthBytes + sizeof(length));
+			data.insert(data.end(), entry.first.begin(), entry.first.end());
+			data.push_back(0);
+			data.insert(data.end(), entry.second.begin(), entry.second.end());
+			data.push_back(0);
+			data.resize(Align(data.size(), 4), 0);
+		}
+		return data;
+	}
+}
+
+uint64_t HashTextureSource(const uint8_t* data, size_t size)
+{
+	uint64_t hash = FNV_OFFSET_BASIS;
+	MixHash(hash, data, size);
+	return hash;
+}
+
+std::string GetCookedTexturePath(const std::string& source)
+{
+	std::error_code error;
+	const std::filesystem::path sourcePath(source);
+	std::filesystem::path absolutePath = std::filesystem::absolute(sourcePath, error);
+	const std::string key = error ? source : absolutePath.generic_string();
+
+	uint64_t hash = FNV_OFFSET_BASIS;
+	MixHash(hash, key.data(), key.size());
+	char hex[17];
+	std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+	return std::string(COOKED_DIR) + "/" + sourcePath.filename().string() + "." + hex + ".ktx2";
+}
+
+bool SaveKTX2(const std::string& path, BlockFormat format, int width, int height, const std::vector<std::vector<uint8_t>>& levels, uint64_t sourceHash)
+{
+	const std::vector<uint32_t> dataFormat = BuildDataFormatDescriptor(format);
+	const std::vector<uint8_t> keyValues = BuildKeyValueData(sourceHash);
+	const uint32_t levelCount = static_cast<uint32_t>(levels.size());
+
+	KTX2Header header = {};
+	std::memcpy(header.Identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+	header.VkFormat = format == BlockFormat::BC1 ? VK_FORMAT_BC1_RGB_UNORM_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+	header.TypeSize = 1;
+	header.PixelWidth = width;
+	header.PixelHeight = height;
+	header.FaceCount = 1;
+	header.LevelCount = levelCount;
+	header.DfdByteOffset = static_cast<uint32_t>(sizeof(header) + levelCount * sizeof(KTX2LevelIndex));
+	header.DfdByteLength = static_cast<uint32_t>(dataFormat.size() * sizeof(uint32_t));
+	header.KvdByteOffset = header.DfdByteOffset + header.DfdByteLength;
+	header.KvdByteLength = static_cast<uint32_t>(keyValues.size());
+
+	// Smallest level first, each on a block boundary
+	std::vector<KTX2LevelIndex> levelIndex(levelCount);
+	uint64_t offset = header.KvdByteOffset + header.KvdByteLength;
+	for (uint32_t level = levelCount; level-- > 0;)
+	{
+		offset = Align(offset, GetBlockBytes(format));
+		levelIndex[level] = { offset, levels[level].size(), levels[level].size() };
+		offset += levels[level].size();
+	}
+
+	// Written next to the target and renamed over it, a reader never maps half a file
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+	const std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary);
+		if (!file)
+		{
+			std::cout << "ERROR::KTX2::FILE_NOT_WRITABLE: " << temporaryPath << "\n";
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(levelIndex.data()), levelIndex.size() * sizeof(KTX2LevelIndex));
+		file.write(reinterpret_cast<const char*>(dataFormat.data()), dataFormat.size() * sizeof(uint32_t));
+		file.write(reinterpret_cast<const char*>(keyValues.data()), keyValues.size());
+		const char padding[16] = {};
+		for (uint32_t level = levelCount; level-- > 0;)
+		{
+			const uint64_t position = static_cast<uint64_t>(file.tellp());
+			file.write(padding, static_cast<std::streamsize>(levelIndex[level].ByteOffset - position));
+			file.write(reinterpret_cast<const char*>(levels[level].data()), static_cast<std::streamsize>(levels[level].size()));
+		}
+		if (!file)
+		{
+			std::cout << "ERROR::KTX2::WRITE_FAILED: " << temporaryPath << "\n";
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::cout << "ERROR::KTX2::WRITE_FAILED: " << path << " " << error.message() << "\n";
+		return false;
+	}
+	return true;
+}
+
+KTX2File::KTX2File()
+	: _format(BlockFormat::BC1), _sourceHash(0)
+{
+}
+
+bool KTX2File::Open(const std::string& path)
+{
+	_levels.clear();
+	if (!_file.Open(path))
+		return false;
+
+	const uint8_t* data = _file.GetData();
+	const size_t size = _file.GetSize();
+	KTX2Header header;
+	if (size < sizeof(header))
+		return false;
+	std::memcpy(&header, data, sizeof(header));
+
+	const bool known = header.VkFormat == VK_FORMAT_BC1_RGB_UNORM_BLOCK || header.VkFormat == VK_FORMAT_BC3_UNORM_BLOCK;
+	if (std::memcmp(header.Identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0 || !known
+		|| header.PixelWidth == 0 || header.PixelHeight == 0 || header.PixelDepth != 0 || header.LayerCount != 0 || header.FaceCount != 1
+		|| header.SupercompressionScheme != 0 || header.LevelCount != static_cast<uint32_t>(GetMipCount(header.PixelWidth, header.PixelHeight))
+		|| sizeof(header) + header.LevelCount * sizeof(KTX2LevelIndex) > size
+		|| header.KvdByteOffset > size || header.KvdByteLength > size - header.KvdByteOffset)
+	{
+		std::cout << "ERROR::KTX2::INVALID_FILE: " << path << "\n";
+		return false;
+	}
+	_format = header.VkFormat == VK_FORMAT_BC1_RGB_UNORM_BLOCK ? BlockFormat::BC1 : BlockFormat::BC3;
+
+	for (uint32_t level = 0; level < header.LevelCount; level++)
+	{
+		KTX2LevelIndex index;
+		std::memcpy(&index, data + sizeof(header) + level * sizeof(KTX2LevelIndex), sizeof(index));
+		const int width = std::max(static_cast<int>(header.PixelWidth) >> level, 1);
+		const int height = std::max(static_cast<int>(header.PixelHeight) >> level, 1);
+		if (index.ByteLength != GetCompressedSize(_format, width, height) || index.ByteOffset > size || index.ByteLength > size - index.ByteOffset)
+		{
+			std::cout << "ERROR::KTX2::INVALID_FILE: " << path << "\n";
+			_levels.clear();
+			return false;
+		}
+		_levels.push_back({ data + index.ByteOffset, static_cast<size_t>(index.ByteLength), width, height });
+	}
+
+	// Key value pairs: a length, then key and value null terminated, padded to 4 bytes
+	bool hasSourceHash = false;
+	const uint8_t* keyValues = data + header.KvdByteOffset;
+	for (size_t position = 0; position + sizeof(uint32_t) <= header.KvdByteLength;)
+	{
+		uint32_t length;
+		std::memcpy(&length, keyValues + position, sizeof(length));
+		position += sizeof(length);
+		if (length > header.KvdByteLength - position)
+			break;
+		const char* entry = reinterpret_cast<const char*>(keyValues + position);
+		const size_t keyLength = strnlen(entry, length);
+		if (keyLength < length && std::strcmp(entry, SOURCE_HASH_KEY) == 0)
+		{
+			const std::string value(entry + keyLength + 1, strnlen(entry + keyLength + 1, length - keyLength - 1));
+			_sourceHash = std::strtoull(value.c_str(), nullptr, 16);
+			hasSourceHash = true;
+		}
+		position = Align(position + length, 4);
+	}
+	if (!hasSourceHash)
+	{
+		_levels.clear();
+		return false;
+	}
+	return true;
+}
+
+BlockFormat KTX2File::GetFormat() const
+{
+	return _format;
+}
+
+const std::vector<KTX2Level>& KTX2File::GetLevels() const
+{
+	return _levels;
+}
+
+uint64_t KTX2File::GetSourceHash() const
+{
+	return _sourceHash;
+}
@@ -0,0 +1,61 @@
+#ifndef KTX2_FILE_H
+#define KTX2_FILE_H
+
+#include "BlockCompression.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace KTX2Defaults
+{
+	constexpr const char* COOKED_DIR = "resources/cooked";
+	// Key value entry with the hex FNV-1a of the source image, a changed source skips the file
+	constexpr const char* SOURCE_HASH_KEY = "SMTH3DsourceHash";
+}
+
+// FNV-1a over the source image bytes
+uint64_t HashTextureSource(const uint8_t* data, size_t size);
+// <COOKED_DIR>/<file name>.<hash of the full path>.ktx2, named like the mesh cache
+std::string GetCookedTexturePath(const std::string& source);
+// Levels largest first, top row first. Written as a plain KTX2: a UNORM vkFormat with its data
+// format descriptor, no supercompression, smallest level first in the file.
+bool SaveKTX2(const std::string& path, BlockFormat format, int width, int height, const std::vector<std::vector<uint8_t>>& levels, uint64_t sourceHash);
+
+struct KTX2Level
+{
+	// Points into the mapping
+	const uint8_t* Data;
+	size_t Size;
+	int Width;
+	int Height;
+};
+
+// Cooked block compressed 2D texture mapped read only, the levels go to glCompressedTex*
+// straight from the page cache. Only what SaveKTX2 writes opens, anything else is the cook's
+// to redo.
+class KTX2File
+{
+private:
+	MappedFile _file;
+	BlockFormat _format;
+	std::vector<KTX2Level> _levels;
+	uint64_t _sourceHash;
+
+public:
+	KTX2File();
+
+	KTX2File(const KTX2File&) = delete;
+	KTX2File& operator=(const KTX2File&) = delete;
+
+	// False if missing or not a 2D BC1 or BC3 KTX2 with every level and a source hash
+	bool Open(const std::string& path);
+
+	BlockFormat GetFormat() const;
+	const std::vector<KTX2Level>& GetLevels() const;
+	uint64_t GetSourceHash() const;
+};
+
+#endif // KTX2_FILE_H
@@ -0,0 +1,35 @@
+#include "LODSelector.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace LODDefaults;
+
+void LODSelector::Resize(uint32_t objectCount)
+{
+	_currentLODs.assign(objectCount, 0);
+}
+
+float LODSelector::ComputeScreenSize(const AABB& worldBounds, const glm::vec3& cameraPosition, float fovY)
+{
+	float radius = glm::length(worldBounds.GetExtents());
+	float distance = glm::length(worldBounds.GetCenter() - cameraPosition);
+	if (distance <= radius)
+		return 1.f;
+
+	return radius / (distance * std::tan(fovY * 0.5f));
+}
+
+uint32_t LODSelector::Select(uint32_t objectID, float screenSize, uint32_t lodCount)
+{
+	const uint32_t maxLOD = std::min(lodCount, THRESHOLD_COUNT + 1) - 1;
+	uint32_t lod = std::min<uint32_t>(_currentLODs[objectID], maxLOD);
+
+	while (lod < maxLOD && screenSize < SCREEN_SIZE_THRESHOLDS[lod] * (1.f - HYSTERESIS))
+		lod++;
+	while (lod > 0 && screenSize > SCREEN_SIZE_THRESHOLDS[lod - 1] * (1.f + HYSTERESIS))
+		lod--;
+
+	_currentLODs[objectID] = static_cast<uint8_t>(lod);
+	return lod;
+}
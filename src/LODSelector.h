@@ -0,0 +1,34 @@
+#ifndef LOD_SELECTOR_H
+#define LOD_SELECTOR_H
+
+#include <glm/glm.hpp>
+#include "AABB.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace LODDefaults
+{
+	constexpr uint32_t THRESHOLD_COUNT = 3;
+	// Screen height fraction an object needs to stay at LOD i, anything smaller drops to i + 1
+	constexpr float SCREEN_SIZE_THRESHOLDS[THRESHOLD_COUNT] = { 0.25f, 0.1f, 0.04f };
+	// Relative band around each threshold that keeps the current LOD, stops popping back and forth
+	constexpr float HYSTERESIS = 0.15f;
+}
+
+// Picks per object LODs from projected size. Remembers the last choice of every object,
+// a switch only happens once the size leaves the hysteresis band around a threshold.
+class LODSelector
+{
+private:
+	std::vector<uint8_t> _currentLODs;
+
+public:
+	void Resize(uint32_t objectCount);
+
+	// Bounding sphere diameter over the visible height at its distance, 1 fills the screen
+	static float ComputeScreenSize(const AABB& worldBounds, const glm::vec3& cameraPosition, float fovY);
+	uint32_t Select(uint32_t objectID, float screenSize, uint32_t lodCount);
+};
+
+#endif // LOD_SELECTOR_H
@@ -20,6 +20,15 @@ void GL::LOG::LogShaderCompilation(unsigned int shader, ShaderType type)
 			case ShaderType::Fragment:
 				return "FRAGMENT";
 				break;
+			case ShaderType::Compute:
+				return "COMPUTE";
+				break;
+			case ShaderType::TessControl:
+				return "TESS_CONTROL";
+				break;
+			case ShaderType::TessEvaluation:
+				return "TESS_EVALUATION";
+				break;
 			default:
 				return "UNKNOWN";
 			}
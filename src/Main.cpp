@@ -3,22 +3,52 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <stb_image.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 #include "Logger.h"
 #include "Shader.h"
 #include "Camera.h"
+#include "CDLODTerrain.h"
+#include "Culling.h"
+#include "DepthPrepass.h"
+#include "Frustum.h"
+#include "GpuCulling.h"
+#include "HeightField.h"
+#include "HLOD.h"
+#include "Impostors.h"
+#include "LODSelector.h"
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshFile.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "OcclusionQueries.h"
+#include "PotentiallyVisibleSet.h"
+#include "Primitives.h"
+#include "Scene.h"
+#include "SoftwareOcclusion.h"
+#include "SparseVoxelOctree.h"
+#include "TessellatedTerrain.h"
+#include "TextureManager.h"
+#include "ThreadPool.h"
+#include "UploadContext.h"
+#include "VertexCache.h"
+#include "VoxelWorld.h"
 
 using namespace GL::ERR;
 
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
 void MouseCallback(GLFWwindow* window, double xPos, double yPos);
 void ScrollCallback(GLFWwindow* window, double xOffset, double yOffset);
+void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void ProcessInput(GLFWwindow* window);
-void LoadTextureJPG(Shader& shader, const char* name, unsigned int& texture, const std::string texName);
-void LoadTexturePng(Shader& shader, const char* name, unsigned int& texture, const std::string texName);
-void FPS(GLFWwindow* window);
+void FPS(GLFWwindow* window, const CullingStats& stats);
 
 // Settings
 constexpr int SCREEN_WIDTH = 1000;
@@ -30,7 +60,9 @@ float LastFrame = 0.f;
 
 // Camera
 Camera camera(glm::vec3(0.f, 0.f, 3.f));
-constexpr float MAX_VIEW_DIST = 200.f;
+constexpr float NEAR_PLANE = 0.1f;
+// Far objects are impostors, so the view distance costs two triangles per object
+constexpr float MAX_VIEW_DIST = 2000.f;
 constexpr float FAR_PLANE = -20.f;
 
 float MaxVis = 0.1f;
@@ -38,8 +70,66 @@ float LastX = SCREEN_HEIGHT / 2.f;
 float LastY = SCREEN_WIDTH / 2.f;
 bool FirstMouse = true;
 
+// Scene
+constexpr unsigned int HERO_CUBE_COUNT = 10;
+bool AnimateCubes = false;
+const std::string DEMO_PVS_PATH = "resources/cooked/demo.pvs";
+const std::string DEMO_SPHERE_PATH = "resources/cooked/sphere.mesh";
+const std::string DEMO_HLOD_PATH = "resources/cooked/demo.hlod";
+CullingMode ActiveCulling = CullingMode::Frustum;
+bool GpuComputeSupported = false;
+bool UseImpostors = true;
+bool UseMeshletCulling = true;
+bool UseHLOD = true;
+DepthPrepassMode PrepassMode = DepthPrepassMode::Auto;
+
+enum class TerrainMode
+{
+	Off,
+	// GL 4.0 patches, the tessellator picks the detail
+	Tessellated,
+	// Instanced grid nodes picked on the CPU, works on any context
+	CDLOD,
+	Count
+};
+const char* const TERRAIN_MODE_NAMES[] = { "off", "tessellated", "CDLOD" };
+TerrainMode ActiveTerrain = TerrainMode::CDLOD;
+bool TessellationSupported = false;
+
+// Ground under the columns, its peaks just reach their bottom cubes
+constexpr uint32_t TERRAIN_RESOLUTION = 1025;
+constexpr float TERRAIN_SPACING = 2.f;
+constexpr float TERRAIN_SIZE = (TERRAIN_RESOLUTION - 1) * TERRAIN_SPACING;
+const glm::vec3 TERRAIN_ORIGIN = glm::vec3(-TERRAIN_SIZE * 0.5f, -18.5f, -TERRAIN_SIZE * 0.5f - 70.f);
+constexpr float TERRAIN_HEIGHT = 12.f;
+
+// Voxel world replacing the scene, 512 x 128 x 512 voxels with the camera start above the ground
+bool VoxelMode = false;
+// Ray-march the octree instead of rasterizing chunk meshes
+bool RayMarchVoxels = false;
+const glm::ivec3 VOXEL_WORLD_CHUNKS = glm::ivec3(16, 4, 16);
+const glm::vec3 VOXEL_WORLD_ORIGIN = glm::vec3(-256.f, -64.f, -256.f);
+constexpr int VOXEL_MIN_HEIGHT = 24;
+constexpr int VOXEL_MAX_HEIGHT = 56;
+// Reach of the dig and place clicks
+constexpr float VOXEL_EDIT_DISTANCE = 64.f;
+bool PendingDig = false;
+bool PendingPlace = false;
+float LastRemeshMilliseconds = 0.f;
+
+// One opaque draw of the CPU paths, recorded before drawing so the depth pre-pass can replay it
+struct DrawItem
+{
+	uint32_t ObjectID;
+	uint32_t LOD;
+	OcclusionState State;
+	// Meshlet ranges in the frame's MeshletDrawList, -1 draws the whole LOD
+	int FirstRange;
+	int RangeCount;
+};
+
 
-int main()
+int main(int argc, char** argv)
 {
 	// GLFW init and config
 	if (!glfwInit())
@@ -47,13 +137,20 @@ int main()
 		std::cout << "Failed to init\n";
 		return -1;
 	}
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	// 4.3 for compute culling, 3.3 is enough for everything else
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 	// Create window
 	GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "SMTH3D", nullptr, nullptr);
 	if (!window)
+	{
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "SMTH3D", nullptr, nullptr);
+	}
+	if (!window)
 	{
 		std::cout << "Failed to create GLFW window\n";
 		glfwTerminate();
@@ -66,6 +163,8 @@ int main()
 	glfwSetCursorPosCallback(window, MouseCallback);
 
 	glfwSetScrollCallback(window, ScrollCallback);
+	glfwSetKeyCallback(window, KeyCallback);
+	glfwSetMouseButtonCallback(window, MouseButtonCallback);
 
 	// VSync disabled
 	glfwSwapInterval(0);
@@ -81,84 +180,162 @@ int main()
 
 	Shader shaderRect("resources/shaders/transform.vert", "resources/shaders/shaderRect.frag");
 
-	float verticesCube[] = {
-		// position			 // texture
-		-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-
-		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-
-		-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-		-0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-		-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
-		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-		 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-
-		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f, 1.0f
-	};
+	// Workers for background BVH rebuilds and software occlusion
+	ThreadPool threadPool;
+
+	// Texture uploads run on a shared context of their own, the frame never waits on them
+	auto uploadContext = std::make_unique<UploadContext>(window);
+
+	// Decoded on the pool while the rest of startup runs. The framebuffer is not sRGB, so the
+	// material textures stay raw like before.
+	TextureManager textures(uploadContext->IsValid() ? uploadContext.get() : nullptr);
+	TextureOptions containerOptions;
+	containerOptions.Wrap = GL_CLAMP_TO_EDGE;
+	const TextureHandle texture1 = textures.LoadAsync("resources/textures/container.jpg", threadPool, containerOptions);
+	TextureOptions faceOptions;
+	faceOptions.FlipVertically = true;
+	const TextureHandle texture2 = textures.LoadAsync("resources/textures/awesomeface.png", threadPool, faceOptions);
+
+	Scene scene;
+	BuildDemoScene(scene);
+	scene.BuildIndex();
+
+	Frustum frustum;
+	std::vector<uint32_t> visibleObjects;
+	visibleObjects.reserve(scene.GetObjectCount());
+
+	OcclusionQueries occlusionQueries;
+	occlusionQueries.Resize(scene.GetObjectCount());
+	CullingStats cullingStats;
+
+	// Cooked offline by the Cook tool, PVS mode falls back to the BVH without it
+	PotentiallyVisibleSet pvs;
+	if (!pvs.Load(DEMO_PVS_PATH, scene))
+		std::cout << "No PVS cooked for this scene, run \"Cook pvs\" from the build directory to enable it\n";
+	// Moving objects aren't in the PVS, PVS mode frustum tests them every frame
+	std::vector<uint32_t> dynamicObjects;
+	for (uint32_t objectID = 0; objectID < scene.GetObjectCount(); objectID++)
+	{
+		if (!scene.GetObject(objectID).IsStatic)
+			dynamicObjects.push_back(objectID);
+	}
 
-	glm::vec3 cubePositions[] = {
-		glm::vec3(0.f, 0.f, 0.f),
-		glm::vec3(2.0f, 5.0f, -10.0f),
-		glm::vec3(-1.5f, -2.2f, -2.5f),
-		glm::vec3(-3.8f, -2.0f, -12.3f),
-		glm::vec3(2.4f, -0.4f, -3.5f),
-		glm::vec3(-1.7f, 3.0f, -7.5f),
-		glm::vec3(1.3f, -2.0f, -9.5f),
-		glm::vec3(3.5f, 4.0f, -2.5f),
-		glm::vec3(1.5f, 2.2f, -1.5f),
-		glm::vec3(-1.3f, 1.0f, -1.5f)
-	};
+	// Cluster proxies only exist cooked, far static objects are drawn one by one without them
+	HLOD hlod;
+	std::unique_ptr<Mesh> proxyMesh;
+	if (hlod.Load(DEMO_HLOD_PATH, scene))
+		proxyMesh = std::make_unique<Mesh>(hlod.GetProxyData());
+	else
+		std::cout << "No HLOD cooked for this scene, run \"Cook hlod\" from the build directory to enable it\n";
+
+	// LOD chain cooked offline by the Cook tool, simplified here at startup without it.
+	// The cube has no LODs or meshlets and uploads its compile time vertices as they are.
+	MeshData sphereData;
+	if (LoadMeshData(DEMO_SPHERE_PATH, sphereData))
+	{
+		// Cooked already reordered, the "Cook lod" output has the ACMR before
+		const MeshLOD& finest = sphereData.LODs[0];
+		std::cout << "Sphere: ACMR " << ComputeACMR(&sphereData.Indices[finest.FirstIndex], finest.IndexCount, sphereData.Vertices.size()) << " (cooked)\n";
+	}
+	else
+	{
+		std::cout << "No LODs cooked for the sphere, run \"Cook lod\" from the build directory to skip this step\n";
+		sphereData = CreateUVSphere<SceneDefaults::SPHERE_SEGMENTS, SceneDefaults::SPHERE_RINGS>();
+		BuildLODChain(sphereData);
+		BuildMeshlets(sphereData);
+		VertexCacheStats sphereCache = OptimizeVertexCache(sphereData);
+		std::cout << "Sphere: ACMR " << sphereCache.ACMRBefore << " -> " << sphereCache.ACMRAfter << "\n";
+	}
 
-	// Vertex buffer obj and vertex array obj
-	// Store vertex data in memory on GPU
-	unsigned int VBO, VAO;
+	// Indexed meshes shared by the per object and the indirect path, indexed by MeshID
+	Mesh cubeMesh(GetCubeView());
+	Mesh sphereMesh(sphereData);
+	const std::vector<const Mesh*> meshes = { &cubeMesh, &sphereMesh };
+	size_t packedBytes = 0, unpackedBytes = 0;
+	for (const Mesh* mesh : meshes)
+	{
+		packedBytes += mesh->GetVertexBufferSize();
+		unpackedBytes += mesh->GetUnpackedVertexBufferSize();
+	}
+	if (proxyMesh)
+	{
+		packedBytes += proxyMesh->GetVertexBufferSize();
+		unpackedBytes += proxyMesh->GetUnpackedVertexBufferSize();
+	}
+	std::cout << "Vertex buffers: " << packedBytes / 1024 << " KiB packed, " << unpackedBytes / 1024 << " KiB as float vertices with normals\n";
 
-	GL_CHECK(glGenVertexArrays(1, &VAO));
-	GL_CHECK(glGenBuffers(1, &VBO));
+	// Model from the command line, imported into a mapped cache on the first run and uploaded straight from it after
+	MeshCache modelCache;
+	std::unique_ptr<Mesh> modelMesh;
+	if (argc > 1)
+	{
+		auto start = std::chrono::steady_clock::now();
+		if (modelCache.Load(argv[1], threadPool))
+		{
+			modelMesh = std::make_unique<Mesh>(modelCache.GetView());
+			float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+			std::cout << "Model: " << modelMesh->GetIndexCount() / 3 << " triangles, " << modelCache.GetSubMeshCount() << " submeshes, loaded in " << seconds << "s\n";
+		}
+	}
+	LODSelector lodSelector;
+	lodSelector.Resize(scene.GetObjectCount());
+
+	// Coarsest LODs as occluders, they only ever collapsed vertices so they stay inside the full mesh
+	SoftwareOcclusion softwareOcclusion;
+	const std::vector<OccluderMesh> occluderMeshes = {
+		CreateOccluderMesh(Primitives::CUBE),
+		CreateOccluderMesh(sphereData, static_cast<uint32_t>(sphereData.LODs.size() - 1))
+	};
+
+	// Transforms and bounds resident on the GPU, only when compute shaders are available
+	std::unique_ptr<GpuCulling> gpuCulling;
+	GpuComputeSupported = GpuCulling::IsSupported();
+	if (GpuComputeSupported)
+	{
+		gpuCulling = std::make_unique<GpuCulling>();
+		gpuCulling->Upload(scene, meshes);
+	}
 
-	unsigned int texture1, texture2;
-	// Rectangle
-	GL_CHECK(glBindVertexArray(VAO));
-	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, VBO));
-	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(verticesCube), verticesCube, GL_STATIC_DRAW));
+	// Captured with the same shader and textures as the real draws, so those have to be up first
+	textures.Finish();
+	std::cout << "Textures: " << textures.GetTextureCount() << ", " << textures.GetMemoryUsage() / 1024 << " KiB\n";
+	ImpostorRenderer impostors;
+	textures.Bind(texture1, 0);
+	textures.Bind(texture2, 1);
+	shaderRect.Use();
+	shaderRect.SetUniformI("texture1", 0);
+	shaderRect.SetUniformI("texture2", 1);
+	shaderRect.SetUniformF("visible", MaxVis);
+	impostors.Build(meshes, shaderRect);
+
+	// Both terrain paths draw the same field, CDLOD streams it into a fixed size clipmap
+	const HeightField terrainField = GenerateHeightField(TERRAIN_RESOLUTION);
+	CDLODTerrain cdlodTerrain;
+	cdlodTerrain.SetHeightField(terrainField, TERRAIN_ORIGIN, TERRAIN_SPACING, TERRAIN_HEIGHT);
+	std::cout << "Terrain: " << TERRAIN_RESOLUTION << "x" << TERRAIN_RESOLUTION << " samples, " << cdlodTerrain.GetClipmapBytes() / 1024 << " KiB of clipmap\n";
+
+	std::unique_ptr<TessellatedTerrain> tessellatedTerrain;
+	TessellationSupported = TessellatedTerrain::IsSupported();
+	if (TessellationSupported)
+	{
+		tessellatedTerrain = std::make_unique<TessellatedTerrain>(TERRAIN_ORIGIN, TERRAIN_SIZE);
+		tessellatedTerrain->SetHeightField(terrainField, TERRAIN_HEIGHT);
+	}
+	else
+	{
+		std::cout << "Tessellation needs a GL 4.0 context, only the CDLOD terrain is available\n";
+	}
 
-	GL_CHECK(glEnableVertexAttribArray(0));
-	GL_CHECK(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0));
-	GL_CHECK(glEnableVertexAttribArray(1));
-	GL_CHECK(glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float))));
+	VoxelWorld voxelWorld(VOXEL_WORLD_CHUNKS, VOXEL_WORLD_ORIGIN);
+	voxelWorld.GenerateTerrain(GenerateHeightField(513, 7), VOXEL_MIN_HEIGHT, VOXEL_MAX_HEIGHT, threadPool);
+	std::cout << "Voxels: " << voxelWorld.GetSolidCount() << " solid in " << voxelWorld.GetChunkCount() << " chunks, "
+		<< voxelWorld.GetMemoryUsage() / 1024 << " KiB palette packed, " << voxelWorld.GetDenseMemoryUsage() / 1024 << " KiB dense\n";
+	// Built on first use and again after edits
+	SparseVoxelOctree voxelOctree;
 
-	LoadTextureJPG(shaderRect, "resources/textures/container.jpg", texture1, "texture1");
-	LoadTexturePng(shaderRect, "resources/textures/awesomeface.png", texture2, "texture2");
+	DepthPrepass depthPrepass;
+	std::vector<DrawItem> drawItems;
+	MeshletDrawList meshletDraws;
 
 	// View via wireframe mode
 	GL_CHECK(glPolygonMode(GL_FRONT_AND_BACK, GL_FILL));
@@ -171,21 +348,34 @@ int main()
 		LastFrame = currentFrame;
 
 		// FPS
-		FPS(window);
+		FPS(window, cullingStats);
 
 		// Input
 		ProcessInput(window);
 
+		// Spin the tutorial cubes, the BVH refits only the leaves they live in
+		if (AnimateCubes)
+		{
+			for (unsigned int i = 0; i < HERO_CUBE_COUNT; i++)
+			{
+				glm::mat4 model = scene.GetObject(i).Model;
+				model = glm::rotate(model, DeltaTime, glm::vec3(0.5f, 1.f, 0.f));
+				scene.SetTransform(i, model);
+				if (gpuCulling)
+					gpuCulling->UpdateObject(scene, i);
+			}
+		}
+		scene.Update(threadPool);
+
 		// Rendering
 		glClearColor(0.2f, 0.1f, 0.5f, 1.f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// Draw
+		textures.Update();
 		// bind textures on corresponding texture units
-		GL_CHECK(glActiveTexture(GL_TEXTURE0));
-		GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture1));
-		GL_CHECK(glActiveTexture(GL_TEXTURE1));
-		GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture2));
+		textures.Bind(texture1, 0);
+		textures.Bind(texture2, 1);
 
 		// Render cubes
 		shaderRect.Use();
@@ -194,24 +384,253 @@ int main()
 		// Camera
 		// Projection matrix
 		glm::mat4 projection = glm::mat4(1.f);
-		projection = glm::perspective(glm::radians(CameraDefaults::FOV), static_cast<float>(SCREEN_WIDTH / SCREEN_HEIGHT), 0.1f, MAX_VIEW_DIST);
+		projection = glm::perspective(glm::radians(camera.Zoom), static_cast<float>(SCREEN_WIDTH / SCREEN_HEIGHT), NEAR_PLANE, MAX_VIEW_DIST);
 		shaderRect.SetUniformMat4fv("projection", projection);
 
 		glm::mat4 view = camera.GetViewMatrix();
 		shaderRect.SetUniformMat4fv("view", view);
 
-		GL_CHECK(glBindVertexArray(VAO));
-		for (unsigned int i = 0; i < 10; i++)
+		glm::mat4 viewProjection = projection * view;
+		frustum.Update(viewProjection);
+		if (VoxelMode)
+		{
+			glm::ivec3 hit, before;
+			if ((PendingDig || PendingPlace) && voxelWorld.Raycast(camera.Position, camera.Front, VOXEL_EDIT_DISTANCE, hit, before))
+			{
+				if (PendingDig)
+					voxelWorld.SetVoxel(hit, VoxelBlocks::AIR);
+				else
+					voxelWorld.SetVoxel(before, VoxelBlocks::STONE);
+			}
+			PendingDig = false;
+			PendingPlace = false;
+
+			// Meshes land a few frames after the edit, the old one draws until then
+			voxelWorld.Update(threadPool, camera.Position);
+			cullingStats = CullingStats();
+			cullingStats.Total = voxelWorld.GetChunkCount();
+			if (RayMarchVoxels)
+			{
+				if (voxelOctree.GetRevision() != voxelWorld.GetRevision())
+				{
+					voxelOctree.Build(voxelWorld, threadPool);
+					std::cout << "Octree: " << voxelOctree.GetNodeCount() << " nodes, " << voxelOctree.GetMemoryUsage() / 1024
+						<< " KiB, " << voxelOctree.GetRebuiltChunkCount() << " chunks rebuilt in " << voxelOctree.GetBuildMilliseconds() << " ms\n";
+				}
+				voxelOctree.Draw(view, projection, camera.Position, glm::vec2(SCREEN_WIDTH, SCREEN_HEIGHT));
+			}
+			else
+			{
+				GL_CHECK(glActiveTexture(GL_TEXTURE0));
+				voxelWorld.Draw(view, projection, frustum);
+
+				const VoxelWorldStats& voxelStats = voxelWorld.GetStats();
+				cullingStats.Drawn = voxelStats.ChunksDrawn;
+				cullingStats.Triangles = voxelStats.QuadsDrawn * 2;
+				LastRemeshMilliseconds = voxelStats.LastMeshMilliseconds;
+			}
+		}
+		else if (ActiveCulling == CullingMode::GpuCompute && gpuCulling)
+		{
+			// Cull and compact on the GPU, the CPU never sees the visible list
+			gpuCulling->Cull(frustum, camera.Position, glm::radians(camera.Zoom));
+
+			const Shader& drawShader = gpuCulling->GetDrawShader();
+			drawShader.Use();
+			drawShader.SetUniformI("texture1", 0);
+			drawShader.SetUniformI("texture2", 1);
+			drawShader.SetUniformF("visible", MaxVis);
+			drawShader.SetUniformMat4fv("projection", projection);
+			drawShader.SetUniformMat4fv("view", view);
+			gpuCulling->Draw();
+
+			cullingStats = CullingStats();
+			cullingStats.Total = scene.GetObjectCount();
+			cullingStats.InFrustum = gpuCulling->GetVisibleCount();
+			cullingStats.Drawn = cullingStats.InFrustum;
+			cullingStats.Triangles = gpuCulling->GetTriangleCount();
+			cullingStats.UploadedBytes = static_cast<uint32_t>(gpuCulling->GetUploadedBytes());
+		}
+		else
+		{
+			// Frustum culling through the scene BVH
+			visibleObjects.clear();
+			const int pvsCell = ActiveCulling == CullingMode::PotentiallyVisibleSet ? pvs.FindCell(camera.Position) : -1;
+			if (ActiveCulling == CullingMode::None)
+			{
+				for (uint32_t objectID = 0; objectID < scene.GetObjectCount(); objectID++)
+					visibleObjects.push_back(objectID);
+			}
+			else if (pvsCell >= 0)
+			{
+				// Bitset lookup for the camera cell, then a per object frustum test on what is left
+				pvs.GatherVisible(pvsCell, visibleObjects);
+				visibleObjects.insert(visibleObjects.end(), dynamicObjects.begin(), dynamicObjects.end());
+				visibleObjects.erase(std::remove_if(visibleObjects.begin(), visibleObjects.end(),
+					[&](uint32_t objectID) { return !frustum.IntersectsAABB(scene.GetWorldBounds(objectID)); }), visibleObjects.end());
+			}
+			else
+			{
+				scene.QueryFrustum(frustum, visibleObjects);
+			}
+
+			cullingStats = CullingStats();
+			cullingStats.Total = scene.GetObjectCount();
+			cullingStats.InFrustum = static_cast<uint32_t>(visibleObjects.size());
+
+			// Far clusters collapse into their proxy, members never reach occlusion or the draw list
+			const bool useHLOD = UseHLOD && proxyMesh;
+			if (useHLOD)
+			{
+				hlod.Update(frustum, camera.Position);
+				size_t objectCount = visibleObjects.size();
+				visibleObjects.erase(std::remove_if(visibleObjects.begin(), visibleObjects.end(),
+					[&](uint32_t objectID) { return hlod.IsReplaced(objectID); }), visibleObjects.end());
+				cullingStats.Proxies = hlod.GetDrawnCount();
+				cullingStats.Replaced = static_cast<uint32_t>(objectCount - visibleObjects.size());
+				cullingStats.Triangles += hlod.GetDrawnTriangles();
+			}
+
+			if (ActiveCulling == CullingMode::CpuOcclusion)
+			{
+				softwareOcclusion.SelectOccluders(scene, visibleObjects, camera.Position);
+				softwareOcclusion.Render(scene, occluderMeshes, viewProjection, threadPool);
+				cullingStats.Occluded = softwareOcclusion.Filter(scene, visibleObjects);
+			}
+
+			const bool useOcclusionQueries = ActiveCulling == CullingMode::GpuOcclusion;
+			if (useOcclusionQueries)
+				occlusionQueries.CollectResults();
+
+			// Decide what to draw first, the pre-pass needs the same list twice
+			drawItems.clear();
+			meshletDraws.Clear();
+			depthPrepass.BeginFrame(static_cast<float>(SCREEN_WIDTH) / SCREEN_HEIGHT);
+			for (uint32_t objectID : visibleObjects)
+			{
+				OcclusionState state = OcclusionState::Visible;
+				if (useOcclusionQueries)
+					state = occlusionQueries.Classify(objectID, scene.GetWorldBounds(objectID), camera.Position);
+
+				if (state == OcclusionState::Occluded)
+				{
+					cullingStats.Occluded++;
+					continue;
+				}
+
+				const SceneObject& object = scene.GetObject(objectID);
+				if (UseImpostors && impostors.ShouldUse(scene.GetWorldBounds(objectID), camera.Position))
+				{
+					impostors.Add(object, camera.Position);
+					cullingStats.Drawn++;
+					cullingStats.Impostors++;
+					cullingStats.Triangles += 2;
+					continue;
+				}
+
+				const Mesh* mesh = meshes[object.MeshID];
+				float screenSize = LODSelector::ComputeScreenSize(scene.GetWorldBounds(objectID), camera.Position, glm::radians(camera.Zoom));
+				uint32_t lod = lodSelector.Select(objectID, screenSize, mesh->GetLODCount());
+				depthPrepass.AddCoverage(screenSize);
+
+				DrawItem item = { objectID, lod, state, -1, 0 };
+				// Close enough for full detail, so also worth dropping the clusters facing away or off screen
+				if (UseMeshletCulling && lod == 0 && !mesh->GetMeshlets().empty())
+				{
+					uint32_t culledBefore = meshletDraws.CulledCount;
+					uint32_t trianglesBefore = meshletDraws.TriangleCount;
+					item.FirstRange = static_cast<int>(meshletDraws.Counts.size());
+					CullMeshlets(mesh->GetMeshlets(), object.Model, frustum, camera.Position, meshletDraws);
+					item.RangeCount = static_cast<int>(meshletDraws.Counts.size()) - item.FirstRange;
+					cullingStats.CulledMeshlets += meshletDraws.CulledCount - culledBefore;
+					cullingStats.Triangles += meshletDraws.TriangleCount - trianglesBefore;
+				}
+				else
+				{
+					cullingStats.Triangles += mesh->GetLOD(lod).IndexCount / 3;
+				}
+
+				cullingStats.Drawn++;
+				drawItems.push_back(item);
+			}
+
+			auto drawItemList = [&](const Shader& shader)
+				{
+					const Mesh* boundMesh = nullptr;
+					for (const DrawItem& item : drawItems)
+					{
+						const SceneObject& object = scene.GetObject(item.ObjectID);
+						const Mesh* mesh = meshes[object.MeshID];
+						if (mesh != boundMesh)
+						{
+							mesh->Bind();
+							boundMesh = mesh;
+						}
+						shader.SetUniformMat4fv("model", object.Model);
+
+						if (item.State == OcclusionState::Pending)
+							occlusionQueries.BeginConditionalRender(item.ObjectID);
+						if (item.FirstRange >= 0)
+							mesh->DrawRanges(&meshletDraws.Counts[item.FirstRange], &meshletDraws.Offsets[item.FirstRange], item.RangeCount);
+						else
+							mesh->DrawLOD(item.LOD);
+						if (item.State == OcclusionState::Pending)
+							occlusionQueries.EndConditionalRender();
+					}
+
+					// Proxies are baked in world space, one draw for every far cluster
+					if (useHLOD)
+					{
+						shader.SetUniformMat4fv("model", glm::mat4(1.f));
+						hlod.Draw(*proxyMesh);
+					}
+					GL_CHECK(glBindVertexArray(0));
+				};
+
+			depthPrepass.SetMode(PrepassMode);
+			cullingStats.Prepass = depthPrepass.ShouldRun();
+			if (cullingStats.Prepass)
+			{
+				drawItemList(depthPrepass.BeginDepthPass(view, projection));
+				depthPrepass.BeginColorPass();
+				shaderRect.Use();
+				drawItemList(shaderRect);
+				depthPrepass.EndColorPass();
+			}
+			else
+			{
+				shaderRect.Use();
+				drawItemList(shaderRect);
+			}
+			impostors.Draw(view, projection);
+
+			// Test proxies against this frame's depth, the results are used next frame
+			if (useOcclusionQueries)
+				occlusionQueries.IssueQueries(scene, visibleObjects, viewProjection);
+		}
+
+		// Imported model at the origin, outside the scene and its culling
+		if (!VoxelMode && modelMesh && frustum.IntersectsAABB(modelMesh->GetBounds()))
 		{
-			glm::mat4 model = glm::mat4(1.f);
-			model = glm::translate(model, cubePositions[i]);
-			float angle = 25.f * i;
-			model = glm::rotate(model, glm::radians(angle), glm::vec3(1.f, 1.f, 0.5f));
-			shaderRect.SetUniformMat4fv("model", model);
+			shaderRect.Use();
+			shaderRect.SetUniformMat4fv("model", glm::mat4(1.f));
+			modelMesh->Bind();
+			modelMesh->Draw();
+			GL_CHECK(glBindVertexArray(0));
+			cullingStats.Triangles += modelMesh->GetIndexCount() / 3;
+		}
 
-			GL_CHECK(glDrawArrays(GL_TRIANGLES, 0, 36));
+		// Last, both bind their height maps over the material textures
+		if (!VoxelMode && ActiveTerrain == TerrainMode::Tessellated && tessellatedTerrain)
+		{
+			tessellatedTerrain->Draw(view, projection, frustum, camera.Position, SCREEN_HEIGHT);
+			cullingStats.Triangles += tessellatedTerrain->GetTriangleCount();
+		}
+		else if (!VoxelMode && ActiveTerrain == TerrainMode::CDLOD)
+		{
+			cdlodTerrain.Draw(view, projection, frustum, camera.Position);
+			cullingStats.Triangles += cdlodTerrain.GetTriangleCount();
 		}
-		GL_CHECK(glBindVertexArray(0));
 
 		// Check events and swap buffers
 		glfwSwapBuffers(window);
@@ -219,9 +638,11 @@ int main()
 	}
 
 	// De-allocate all resources once its over
-	GL_CHECK(glDeleteVertexArrays(1, &VAO));
-	GL_CHECK(glDeleteBuffers(1, &VBO));
 	GL_CHECK(glBindVertexArray(0));
+	gpuCulling.reset();
+	tessellatedTerrain.reset();
+	// Its hidden window has to go before GLFW does
+	uploadContext.reset();
 
 	glfwTerminate();
 	return 0;
@@ -260,6 +681,51 @@ void ProcessInput(GLFWwindow* window)
 		camera.ProcessKeyboard(RIGHT, DeltaTime);
 }
 
+void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (action != GLFW_PRESS)
+		return;
+
+	if (key == GLFW_KEY_M)
+		AnimateCubes = !AnimateCubes;
+	if (key == GLFW_KEY_I)
+		UseImpostors = !UseImpostors;
+	if (key == GLFW_KEY_K)
+		UseMeshletCulling = !UseMeshletCulling;
+	if (key == GLFW_KEY_H)
+		UseHLOD = !UseHLOD;
+	if (key == GLFW_KEY_T)
+	{
+		ActiveTerrain = static_cast<TerrainMode>((static_cast<int>(ActiveTerrain) + 1) % static_cast<int>(TerrainMode::Count));
+		if (ActiveTerrain == TerrainMode::Tessellated && !TessellationSupported)
+			ActiveTerrain = TerrainMode::CDLOD;
+	}
+	if (key == GLFW_KEY_V)
+		VoxelMode = !VoxelMode;
+	if (key == GLFW_KEY_O)
+		RayMarchVoxels = !RayMarchVoxels;
+	if (key == GLFW_KEY_P)
+		PrepassMode = static_cast<DepthPrepassMode>((static_cast<int>(PrepassMode) + 1) % static_cast<int>(DepthPrepassMode::Count));
+	if (key == GLFW_KEY_C)
+	{
+		ActiveCulling = Culling::NextMode(ActiveCulling);
+		if (ActiveCulling == CullingMode::GpuCompute && !GpuComputeSupported)
+			ActiveCulling = Culling::NextMode(ActiveCulling);
+	}
+}
+
+void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+	if (action != GLFW_PRESS || !VoxelMode)
+		return;
+
+	// Applied in the render loop, next to the world they edit
+	if (button == GLFW_MOUSE_BUTTON_LEFT)
+		PendingDig = true;
+	if (button == GLFW_MOUSE_BUTTON_RIGHT)
+		PendingPlace = true;
+}
+
 void ScrollCallback(GLFWwindow* window, double xOffset, double yOffset)
 {
 	camera.ScrollCallback(static_cast<float>(yOffset));
@@ -286,62 +752,7 @@ void MouseCallback(GLFWwindow* window, double xPosition, double yPosition)
 	camera.MouseCallback(xOffset, yOffset);
 }
 
-void LoadTextureJPG(Shader& shader, const char* fName, unsigned int& texture, const std::string texName)
-{
-	GL_CHECK(glGenTextures(1, &texture));
-	GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
-
-	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
-	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-
-	int width, height, noChannels;
-	unsigned char* data = stbi_load(fName, &width, &height, &noChannels, 0);
-	if (!data)
-	{
-		std::cout << "Texture load failed\n";
-		return;
-	}
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	stbi_image_free(data);
-
-	shader.Use();
-	shader.SetUniformI(texName, 0);
-}
-
-void LoadTexturePng(Shader& shader, const char* fName, unsigned int& texture, const std::string texName)
-{
-	GL_CHECK(glGenTextures(1, &texture));
-	GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
-
-	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
-	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
-	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
-	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-
-	int width, height, noChannels;
-	stbi_set_flip_vertically_on_load(true);
-	unsigned char* data = stbi_load(fName, &width, &height, &noChannels, 0);
-	if (!data)
-	{
-		std::cout << "Texture load failed\n";
-		return;
-	}
-
-	GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data));
-	GL_CHECK(glGenerateMipmap(GL_TEXTURE_2D));
-
-	stbi_image_free(data);
-
-	shader.Use();
-	shader.SetUniformI(texName, 1);
-}
-
-void FPS(GLFWwindow* window)
+void FPS(GLFWwindow* window, const CullingStats& stats)
 {
 	static float timerSec = 0.f;
 	static int fpsCount = 0;
@@ -352,7 +763,18 @@ void FPS(GLFWwindow* window)
 	if (timerSec >= 0.1f)
 	{
 		int avgFPS = (int)(fpsCount / timerSec);
-		std::string title = "SMTH3D - FPS: " + std::to_string(avgFPS);
+		std::string title = "SMTH3D - FPS: " + std::to_string(avgFPS)
+			+ " | Culling: " + Culling::GetModeName(ActiveCulling)
+			+ " | Drawn: " + std::to_string(stats.Drawn) + "/" + std::to_string(stats.Total)
+			+ " | Occluded: " + std::to_string(stats.Occluded)
+			+ " | Impostors: " + std::to_string(stats.Impostors)
+			+ " | HLOD: " + std::to_string(stats.Proxies) + " for " + std::to_string(stats.Replaced) + (UseHLOD ? "" : " (off)")
+			+ " | Meshlets culled: " + std::to_string(stats.CulledMeshlets)
+			+ " | Triangles: " + std::to_string(stats.Triangles)
+			+ (ActiveCulling == CullingMode::GpuCompute ? " | Uploaded: " + std::to_string(stats.UploadedBytes) + " B" : "")
+			+ " | Terrain: " + TERRAIN_MODE_NAMES[static_cast<int>(ActiveTerrain)]
+			+ (VoxelMode ? (RayMarchVoxels ? std::string(" | Voxels: ray-marched octree") : " | Voxels, last remesh: " + std::to_string(LastRemeshMilliseconds) + " ms") : "")
+			+ " | Pre-pass: " + DepthPrepass::GetModeName(PrepassMode) + (stats.Prepass ? " (on)" : " (off)");
 		glfwSetWindowTitle(window, title.c_str());
 
 		timerSec = 0.f;
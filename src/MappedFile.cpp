@@ -0,0 +1,134 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile()
+	: _data(nullptr), _size(0), _open(false), _file(INVALID_HANDLE_VALUE), _mapping(nullptr)
+{
+}
+#else
+MappedFile::MappedFile()
+	: _data(nullptr), _size(0), _open(false)
+{
+}
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_file, &size))
+	{
+		Close();
+		return false;
+	}
+	_size = static_cast<size_t>(size.QuadPart);
+	_open = true;
+	if (_size == 0)
+		return true;
+
+	_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping)
+		_data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!_data)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data)
+		UnmapViewOfFile(_data);
+	if (_mapping)
+		CloseHandle(_mapping);
+	if (_file != INVALID_HANDLE_VALUE)
+		CloseHandle(_file);
+	_data = nullptr;
+	_mapping = nullptr;
+	_file = INVALID_HANDLE_VALUE;
+	_size = 0;
+	_open = false;
+}
+#else
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		return false;
+	}
+	_size = static_cast<size_t>(status.st_size);
+	if (_size > 0)
+	{
+		void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED)
+		{
+			close(file);
+			_size = 0;
+			return false;
+		}
+		_data = static_cast<const uint8_t*>(data);
+		madvise(data, _size, MADV_SEQUENTIAL);
+	}
+
+	// The mapping keeps the file alive on its own
+	close(file);
+	_open = true;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data)
+		munmap(const_cast<uint8_t*>(_data), _size);
+	_data = nullptr;
+	_size = 0;
+	_open = false;
+}
+#endif
+
+bool MappedFile::IsOpen() const
+{
+	return _open;
+}
+
+const uint8_t* MappedFile::GetData() const
+{
+	return _data;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return _size;
+}
@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read only view of a whole file through the OS page cache, nothing is copied until touched
+class MappedFile
+{
+private:
+	const uint8_t* _data;
+	size_t _size;
+	bool _open;
+#ifdef _WIN32
+	void* _file;
+	void* _mapping;
+#endif
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// False if the file can't be opened, empty files open with no data
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const;
+	const uint8_t* GetData() const;
+	size_t GetSize() const;
+};
+
+#endif // MAPPED_FILE_H
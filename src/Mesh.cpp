@@ -0,0 +1,127 @@
+#include "Mesh.h"
+#include "Logger.h"
+#include "VertexFormat.h"
+
+void MeshData::ComputeBounds()
+{
+	Bounds = AABB();
+	for (const Vertex& vertex : Vertices)
+		Bounds.Expand(vertex.Position);
+}
+
+Mesh::Mesh(const MeshData& data)
+	: _VAO(0), _VBO(0), _EBO(0), _quantizationUBO(0), _vertexCount(static_cast<uint32_t>(data.Vertices.size())),
+	_indexCount(static_cast<uint32_t>(data.Indices.size())), _bounds(data.Bounds), _lods(data.LODs), _meshlets(data.Meshlets)
+{
+	if (_lods.empty())
+		_lods.push_back({ 0, _indexCount, 0.f });
+
+	// Quantize against the vertices themselves, stored bounds may be padded or stale
+	AABB vertexBounds;
+	for (const Vertex& vertex : data.Vertices)
+		vertexBounds.Expand(vertex.Position);
+	const std::vector<PackedVertex> packed = PackVertices(data.Vertices, vertexBounds);
+	Upload(packed.data(), data.Indices.data(), ComputeQuantization(vertexBounds));
+}
+
+Mesh::Mesh(const PackedMeshView& view)
+	: _VAO(0), _VBO(0), _EBO(0), _quantizationUBO(0), _vertexCount(view.VertexCount), _indexCount(view.IndexCount), _bounds(view.Bounds)
+{
+	_lods.push_back({ 0, _indexCount, 0.f });
+	Upload(view.Vertices, view.Indices, view.Quantization);
+}
+
+void Mesh::Upload(const PackedVertex* vertices, const uint32_t* indices, const MeshQuantization& quantization)
+{
+	GL_CHECK(glGenVertexArrays(1, &_VAO));
+	GL_CHECK(glGenBuffers(1, &_VBO));
+	GL_CHECK(glGenBuffers(1, &_EBO));
+	GL_CHECK(glGenBuffers(1, &_quantizationUBO));
+
+	GL_CHECK(glBindVertexArray(_VAO));
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, _VBO));
+	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, _vertexCount * sizeof(PackedVertex), vertices, GL_STATIC_DRAW));
+	GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO));
+	GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indexCount * sizeof(uint32_t), indices, GL_STATIC_DRAW));
+	SetupPackedVertexAttributes();
+	GL_CHECK(glBindVertexArray(0));
+
+	GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, _quantizationUBO));
+	GL_CHECK(glBufferData(GL_UNIFORM_BUFFER, sizeof(MeshQuantization), &quantization, GL_STATIC_DRAW));
+	GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+}
+
+Mesh::~Mesh()
+{
+	glDeleteVertexArrays(1, &_VAO);
+	glDeleteBuffers(1, &_VBO);
+	glDeleteBuffers(1, &_EBO);
+	glDeleteBuffers(1, &_quantizationUBO);
+}
+
+void Mesh::Bind() const
+{
+	GL_CHECK(glBindVertexArray(_VAO));
+	GL_CHECK(glBindBufferBase(GL_UNIFORM_BUFFER, VertexFormatDefaults::QUANTIZATION_BINDING, _quantizationUBO));
+}
+
+void Mesh::Draw() const
+{
+	DrawLOD(0);
+}
+
+void Mesh::DrawLOD(uint32_t lod) const
+{
+	const MeshLOD& range = _lods[lod];
+	GL_CHECK(glDrawElements(GL_TRIANGLES, range.IndexCount, GL_UNSIGNED_INT, (void*)(range.FirstIndex * sizeof(uint32_t))));
+}
+
+void Mesh::DrawRanges(const GLsizei* counts, const void* const* offsets, GLsizei rangeCount) const
+{
+	GL_CHECK(glMultiDrawElements(GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, rangeCount));
+}
+
+unsigned int Mesh::GetVAO() const
+{
+	return _VAO;
+}
+
+size_t Mesh::GetVertexBufferSize() const
+{
+	return static_cast<size_t>(_vertexCount) * sizeof(PackedVertex);
+}
+
+size_t Mesh::GetUnpackedVertexBufferSize() const
+{
+	return static_cast<size_t>(_vertexCount) * sizeof(Vertex);
+}
+
+unsigned int Mesh::GetElementBuffer() const
+{
+	return _EBO;
+}
+
+uint32_t Mesh::GetIndexCount() const
+{
+	return _indexCount;
+}
+
+const AABB& Mesh::GetBounds() const
+{
+	return _bounds;
+}
+
+uint32_t Mesh::GetLODCount() const
+{
+	return static_cast<uint32_t>(_lods.size());
+}
+
+const MeshLOD& Mesh::GetLOD(uint32_t lod) const
+{
+	return _lods[lod];
+}
+
+const std::vector<Meshlet>& Mesh::GetMeshlets() const
+{
+	return _meshlets;
+}
@@ -0,0 +1,102 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "AABB.h"
+
+#include <cstdint>
+#include <vector>
+
+// Full precision vertex the tools work on, the GPU gets a PackedVertex (see VertexFormat.h)
+struct Vertex
+{
+	glm::vec3 Position;
+	glm::vec2 TexCoord;
+	glm::vec3 Normal;
+};
+
+// Index range of one detail level, every level shares the vertex buffer
+struct MeshLOD
+{
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	// Object space simplification error, 0 for the source mesh
+	float Error;
+};
+
+// Cluster of LOD 0 triangles, a contiguous index range with its own culling bounds
+struct Meshlet
+{
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	glm::vec3 Center;
+	float Radius;
+	// Average normal, the cluster faces away from every viewer inside the cone around -ConeAxis
+	glm::vec3 ConeAxis;
+	// Sine of the normals' spread around the axis, 1 disables backface culling
+	float ConeCutoff;
+};
+
+// CPU side geometry, what importers and generators produce and the GPU mesh is built from
+struct MeshData
+{
+	std::vector<Vertex> Vertices;
+	std::vector<uint32_t> Indices;
+	AABB Bounds;
+	// Finest first, LOD 0 is the whole index buffer until a chain is built
+	std::vector<MeshLOD> LODs;
+	// Partition of LOD 0, empty for meshes too small to be worth splitting
+	std::vector<Meshlet> Meshlets;
+
+	void ComputeBounds();
+};
+
+struct PackedVertex;
+struct MeshQuantization;
+struct PackedMeshView;
+
+class Mesh
+{
+private:
+	unsigned int _VAO;
+	unsigned int _VBO;
+	unsigned int _EBO;
+	// Position dequantization for the packed vertices, bound with the VAO
+	unsigned int _quantizationUBO;
+	uint32_t _vertexCount;
+	uint32_t _indexCount;
+	AABB _bounds;
+	std::vector<MeshLOD> _lods;
+	std::vector<Meshlet> _meshlets;
+
+	void Upload(const PackedVertex* vertices, const uint32_t* indices, const MeshQuantization& quantization);
+
+public:
+	explicit Mesh(const MeshData& data);
+	// Straight copy to the GPU, one LOD and no meshlets
+	explicit Mesh(const PackedMeshView& view);
+	~Mesh();
+
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	void Bind() const;
+	void Draw() const;
+	void DrawLOD(uint32_t lod) const;
+	// One glMultiDrawElements over index ranges, offsets in bytes
+	void DrawRanges(const GLsizei* counts, const void* const* offsets, GLsizei rangeCount) const;
+
+	unsigned int GetVAO() const;
+	// Bytes on the GPU, and what the same vertices would take unpacked
+	size_t GetVertexBufferSize() const;
+	size_t GetUnpackedVertexBufferSize() const;
+	unsigned int GetElementBuffer() const;
+	uint32_t GetIndexCount() const;
+	const AABB& GetBounds() const;
+	uint32_t GetLODCount() const;
+	const MeshLOD& GetLOD(uint32_t lod) const;
+	const std::vector<Meshlet>& GetMeshlets() const;
+};
+
+#endif // MESH_H
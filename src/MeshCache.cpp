@@ -0,0 +1,293 @@
+#include "MeshCache.h"
+#include "Utilities.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+using namespace MeshCacheDefaults;
+
+namespace
+{
+	constexpr uint32_t MESH_CACHE_MAGIC = 0x3148434d; // "MCH1"
+	constexpr uint32_t MESH_CACHE_VERSION = 1;
+
+	static_assert(std::is_trivially_copyable<SubMesh>::value, "SubMesh is mapped as is");
+
+	// Offsets are from the start of the file
+	struct MeshCacheHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t SourceHash;
+		uint32_t VertexCount;
+		uint32_t IndexCount;
+		uint32_t SubMeshCount;
+		uint32_t DependencyCount;
+		uint64_t VertexOffset;
+		uint64_t IndexOffset;
+		uint64_t SubMeshOffset;
+		// Null terminated paths one after the other
+		uint64_t DependencyOffset;
+		uint64_t DependencySize;
+		MeshQuantization Quantization;
+		float BoundsMin[3];
+		float BoundsMax[3];
+	};
+
+	uint64_t AlignBlob(uint64_t offset)
+	{
+		return (offset + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT * BLOB_ALIGNMENT;
+	}
+
+	bool MixFileHash(uint64_t& hash, const std::string& path)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+			return false;
+		// The size goes in first so moving bytes between files changes the hash
+		uint64_t size = file.GetSize();
+		MixHash(hash, &size, sizeof(size));
+		MixHash(hash, file.GetData(), file.GetSize());
+		return true;
+	}
+
+	// The indices go to the GPU as they are, so they get the same checks as an imported file
+	bool HasValidRanges(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, const SubMesh* subMeshes, uint32_t subMeshCount)
+	{
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			if (indices[i] >= vertexCount)
+				return false;
+		}
+		for (uint32_t i = 0; i < subMeshCount; i++)
+		{
+			if (static_cast<uint64_t>(subMeshes[i].FirstIndex) + subMeshes[i].IndexCount > indexCount)
+				return false;
+		}
+		return true;
+	}
+
+	bool BlobFits(uint64_t offset, uint64_t size, size_t fileSize)
+	{
+		return offset % BLOB_ALIGNMENT == 0 && offset <= fileSize && size <= fileSize - offset;
+	}
+}
+
+bool HashMeshSource(const std::string& source, const std::vector<std::string>& dependencies, uint64_t& outHash)
+{
+	const std::string directory = source.substr(0, source.find_last_of("/\\") + 1);
+	outHash = FNV_OFFSET_BASIS;
+	if (!MixFileHash(outHash, source))
+		return false;
+	for (const std::string& dependency : dependencies)
+	{
+		if (!MixFileHash(outHash, directory + dependency))
+			return false;
+	}
+	return true;
+}
+
+std::string GetMeshCachePath(const std::string& source)
+{
+	std::error_code error;
+	const std::filesystem::path sourcePath(source);
+	std::filesystem::path absolutePath = std::filesystem::absolute(sourcePath, error);
+	const std::string key = error ? source : absolutePath.generic_string();
+
+	uint64_t hash = FNV_OFFSET_BASIS;
+	MixHash(hash, key.data(), key.size());
+	char hex[17];
+	std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+	return std::string(CACHE_DIR) + "/" + sourcePath.filename().string() + "." + hex + ".mcache";
+}
+
+bool SaveMeshCache(const std::string& path, const ImportedMesh& mesh, uint64_t sourceHash)
+{
+	const MeshData& data = mesh.Data;
+	const std::vector<PackedVertex> vertices = PackVertices(data.Vertices, data.Bounds);
+
+	std::string dependencies;
+	for (const std::string& dependency : mesh.Dependencies)
+	{
+		dependencies += dependency;
+		dependencies += '\0';
+	}
+
+	MeshCacheHeader header = {};
+	header.Magic = MESH_CACHE_MAGIC;
+	header.Version = MESH_CACHE_VERSION;
+	header.SourceHash = sourceHash;
+	header.VertexCount = static_cast<uint32_t>(vertices.size());
+	header.IndexCount = static_cast<uint32_t>(data.Indices.size());
+	header.SubMeshCount = static_cast<uint32_t>(mesh.SubMeshes.size());
+	header.DependencyCount = static_cast<uint32_t>(mesh.Dependencies.size());
+	header.VertexOffset = AlignBlob(sizeof(header));
+	header.IndexOffset = AlignBlob(header.VertexOffset + vertices.size() * sizeof(PackedVertex));
+	header.SubMeshOffset = AlignBlob(header.IndexOffset + data.Indices.size() * sizeof(uint32_t));
+	header.DependencyOffset = AlignBlob(header.SubMeshOffset + mesh.SubMeshes.size() * sizeof(SubMesh));
+	header.DependencySize = dependencies.size();
+	header.Quantization = ComputeQuantization(data.Bounds);
+	for (int i = 0; i < 3; i++)
+	{
+		header.BoundsMin[i] = data.Bounds.Min[i];
+		header.BoundsMax[i] = data.Bounds.Max[i];
+	}
+
+	// Written next to the target and renamed over it, a reader never maps half a file
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+	const std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary);
+		if (!file)
+		{
+			std::cout << "ERROR::MESH_CACHE::FILE_NOT_WRITABLE: " << temporaryPath << "\n";
+			return false;
+		}
+
+		const char padding[BLOB_ALIGNMENT] = {};
+		auto writeBlob = [&](uint64_t offset, const void* blob, size_t size)
+			{
+				const uint64_t position = static_cast<uint64_t>(file.tellp());
+				file.write(padding, static_cast<std::streamsize>(offset - position));
+				file.write(static_cast<const char*>(blob), static_cast<std::streamsize>(size));
+			};
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		writeBlob(header.VertexOffset, vertices.data(), vertices.size() * sizeof(PackedVertex));
+		writeBlob(header.IndexOffset, data.Indices.data(), data.Indices.size() * sizeof(uint32_t));
+		writeBlob(header.SubMeshOffset, mesh.SubMeshes.data(), mesh.SubMeshes.size() * sizeof(SubMesh));
+		writeBlob(header.DependencyOffset, dependencies.data(), dependencies.size());
+		if (!file)
+		{
+			std::cout << "ERROR::MESH_CACHE::WRITE_FAILED: " << temporaryPath << "\n";
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::cout << "ERROR::MESH_CACHE::WRITE_FAILED: " << path << " " << error.message() << "\n";
+		return false;
+	}
+	return true;
+}
+
+MeshCache::MeshCache()
+	: _view(), _subMeshes(nullptr), _subMeshCount(0)
+{
+}
+
+bool MeshCache::Open(const std::string& cachePath, const std::string& source)
+{
+	Close();
+	if (!_file.Open(cachePath))
+		return false;
+
+	const uint8_t* data = _file.GetData();
+	const size_t size = _file.GetSize();
+	MeshCacheHeader header;
+	if (size < sizeof(header))
+	{
+		Close();
+		return false;
+	}
+	std::memcpy(&header, data, sizeof(header));
+	if (header.Magic != MESH_CACHE_MAGIC || header.Version != MESH_CACHE_VERSION
+		|| !BlobFits(header.VertexOffset, static_cast<uint64_t>(header.VertexCount) * sizeof(PackedVertex), size)
+		|| !BlobFits(header.IndexOffset, static_cast<uint64_t>(header.IndexCount) * sizeof(uint32_t), size)
+		|| !BlobFits(header.SubMeshOffset, static_cast<uint64_t>(header.SubMeshCount) * sizeof(SubMesh), size)
+		|| !BlobFits(header.DependencyOffset, header.DependencySize, size))
+	{
+		std::cout << "ERROR::MESH_CACHE::INVALID_FILE: " << cachePath << "\n";
+		Close();
+		return false;
+	}
+
+	std::vector<std::string> dependencies;
+	const char* names = reinterpret_cast<const char*>(data + header.DependencyOffset);
+	for (size_t begin = 0; begin < header.DependencySize;)
+	{
+		const void* terminator = std::memchr(names + begin, '\0', header.DependencySize - begin);
+		if (!terminator)
+			break;
+		size_t end = static_cast<const char*>(terminator) - names;
+		dependencies.emplace_back(names + begin, end - begin);
+		begin = end + 1;
+	}
+
+	uint64_t sourceHash;
+	if (dependencies.size() != header.DependencyCount || !HashMeshSource(source, dependencies, sourceHash) || sourceHash != header.SourceHash)
+	{
+		Close();
+		return false;
+	}
+
+	const uint32_t* indices = reinterpret_cast<const uint32_t*>(data + header.IndexOffset);
+	const SubMesh* subMeshes = reinterpret_cast<const SubMesh*>(data + header.SubMeshOffset);
+	if (!HasValidRanges(indices, header.IndexCount, header.VertexCount, subMeshes, header.SubMeshCount))
+	{
+		std::cout << "ERROR::MESH_CACHE::INVALID_FILE: " << cachePath << "\n";
+		Close();
+		return false;
+	}
+
+	_view.Vertices = reinterpret_cast<const PackedVertex*>(data + header.VertexOffset);
+	_view.VertexCount = header.VertexCount;
+	_view.Indices = indices;
+	_view.IndexCount = header.IndexCount;
+	_view.Quantization = header.Quantization;
+	_view.Bounds = AABB(glm::vec3(header.BoundsMin[0], header.BoundsMin[1], header.BoundsMin[2]),
+		glm::vec3(header.BoundsMax[0], header.BoundsMax[1], header.BoundsMax[2]));
+	_subMeshes = subMeshes;
+	_subMeshCount = header.SubMeshCount;
+	return true;
+}
+
+bool MeshCache::Load(const std::string& source, ThreadPool& pool)
+{
+	const std::string cachePath = GetMeshCachePath(source);
+	if (Open(cachePath, source))
+		return true;
+
+	ImportedMesh mesh;
+	if (!ImportMesh(source, pool, mesh))
+		return false;
+
+	uint64_t sourceHash;
+	if (!HashMeshSource(source, mesh.Dependencies, sourceHash) || !SaveMeshCache(cachePath, mesh, sourceHash))
+		return false;
+	return Open(cachePath, source);
+}
+
+void MeshCache::Close()
+{
+	_file.Close();
+	_view = PackedMeshView();
+	_subMeshes = nullptr;
+	_subMeshCount = 0;
+}
+
+const PackedMeshView& MeshCache::GetView() const
+{
+	return _view;
+}
+
+const SubMesh* MeshCache::GetSubMeshes() const
+{
+	return _subMeshes;
+}
+
+uint32_t MeshCache::GetSubMeshCount() const
+{
+	return _subMeshCount;
+}
+
+size_t MeshCache::GetFileSize() const
+{
+	return _file.GetSize();
+}
@@ -0,0 +1,57 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "MappedFile.h"
+#include "MeshImporter.h"
+#include "VertexFormat.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+namespace MeshCacheDefaults
+{
+	// Every blob starts on a cache line, the mapped pointers go to the GPU as they are
+	constexpr size_t BLOB_ALIGNMENT = 64;
+	constexpr const char* CACHE_DIR = "resources/cooked";
+}
+
+// FNV-1a over the source file and every file it pulled in, what a cache is checked against
+bool HashMeshSource(const std::string& source, const std::vector<std::string>& dependencies, uint64_t& outHash);
+// <CACHE_DIR>/<file name>.<hash of the full path>.mcache, so equal names in different folders don't collide
+std::string GetMeshCachePath(const std::string& source);
+// Packed vertices, indices, the submesh table and the dependency list, each blob aligned for mapping
+bool SaveMeshCache(const std::string& path, const ImportedMesh& mesh, uint64_t sourceHash);
+
+// Cooked import mapped read only, drawing it takes one upload and no parsing
+class MeshCache
+{
+private:
+	MappedFile _file;
+	PackedMeshView _view;
+	const SubMesh* _subMeshes;
+	uint32_t _subMeshCount;
+
+public:
+	MeshCache();
+
+	MeshCache(const MeshCache&) = delete;
+	MeshCache& operator=(const MeshCache&) = delete;
+
+	// False if the cache is missing, corrupt or the source hashes differently than when it was cooked
+	bool Open(const std::string& cachePath, const std::string& source);
+	// Open(), importing the source and rewriting its cache first when that fails
+	bool Load(const std::string& source, ThreadPool& pool);
+	void Close();
+
+	// Points into the mapping, valid until Close()
+	const PackedMeshView& GetView() const;
+	const SubMesh* GetSubMeshes() const;
+	uint32_t GetSubMeshCount() const;
+	size_t GetFileSize() const;
+};
+
+#endif // MESH_CACHE_H
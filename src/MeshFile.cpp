@@ -0,0 +1,127 @@
+#include "MeshFile.h"
+
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	constexpr uint32_t MESH_MAGIC = 0x3148534d; // "MSH1"
+	constexpr uint32_t MESH_VERSION = 3;
+
+	struct MeshFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t VertexCount;
+		uint32_t IndexCount;
+		uint32_t LODCount;
+		uint32_t MeshletCount;
+		float BoundsMin[3];
+		float BoundsMax[3];
+	};
+
+	bool FitsIndices(uint32_t first, uint32_t count, size_t indexCount)
+	{
+		return static_cast<uint64_t>(first) + count <= indexCount;
+	}
+
+	// At least one LOD, and every index and range lands inside its array
+	bool HasValidRanges(const MeshData& data)
+	{
+		if (data.LODs.empty())
+			return false;
+		for (uint32_t index : data.Indices)
+		{
+			if (index >= data.Vertices.size())
+				return false;
+		}
+		for (const MeshLOD& lod : data.LODs)
+		{
+			if (!FitsIndices(lod.FirstIndex, lod.IndexCount, data.Indices.size()))
+				return false;
+		}
+		for (const Meshlet& meshlet : data.Meshlets)
+		{
+			if (!FitsIndices(meshlet.FirstIndex, meshlet.IndexCount, data.Indices.size()))
+				return false;
+		}
+		return true;
+	}
+}
+
+bool SaveMeshData(const std::string& path, const MeshData& data)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "ERROR::MESH::FILE_NOT_WRITABLE: " << path << "\n";
+		return false;
+	}
+
+	MeshFileHeader header = {};
+	header.Magic = MESH_MAGIC;
+	header.Version = MESH_VERSION;
+	header.VertexCount = static_cast<uint32_t>(data.Vertices.size());
+	header.IndexCount = static_cast<uint32_t>(data.Indices.size());
+	header.LODCount = static_cast<uint32_t>(data.LODs.size());
+	header.MeshletCount = static_cast<uint32_t>(data.Meshlets.size());
+	for (int i = 0; i < 3; i++)
+	{
+		header.BoundsMin[i] = data.Bounds.Min[i];
+		header.BoundsMax[i] = data.Bounds.Max[i];
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(data.Vertices.data()), data.Vertices.size() * sizeof(Vertex));
+	file.write(reinterpret_cast<const char*>(data.Indices.data()), data.Indices.size() * sizeof(uint32_t));
+	file.write(reinterpret_cast<const char*>(data.LODs.data()), data.LODs.size() * sizeof(MeshLOD));
+	file.write(reinterpret_cast<const char*>(data.Meshlets.data()), data.Meshlets.size() * sizeof(Meshlet));
+	return static_cast<bool>(file);
+}
+
+bool LoadMeshData(const std::string& path, MeshData& outData)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	MeshFileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.Magic != MESH_MAGIC || header.Version != MESH_VERSION)
+	{
+		std::cout << "ERROR::MESH::INVALID_FILE: " << path << "\n";
+		return false;
+	}
+
+	// Counts come from the file, they have to add up to its size before anything is allocated
+	const uint64_t expectedSize = sizeof(header) + static_cast<uint64_t>(header.VertexCount) * sizeof(Vertex)
+		+ static_cast<uint64_t>(header.IndexCount) * sizeof(uint32_t) + static_cast<uint64_t>(header.LODCount) * sizeof(MeshLOD)
+		+ static_cast<uint64_t>(header.MeshletCount) * sizeof(Meshlet);
+	file.seekg(0, std::ios::end);
+	const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+	file.seekg(sizeof(header), std::ios::beg);
+	if (fileSize != expectedSize)
+	{
+		std::cout << "ERROR::MESH::TRUNCATED_FILE: " << path << "\n";
+		return false;
+	}
+
+	outData.Vertices.resize(header.VertexCount);
+	outData.Indices.resize(header.IndexCount);
+	outData.LODs.resize(header.LODCount);
+	outData.Meshlets.resize(header.MeshletCount);
+	outData.Bounds = AABB(glm::vec3(header.BoundsMin[0], header.BoundsMin[1], header.BoundsMin[2]),
+		glm::vec3(header.BoundsMax[0], header.BoundsMax[1], header.BoundsMax[2]));
+
+	file.read(reinterpret_cast<char*>(outData.Vertices.data()), outData.Vertices.size() * sizeof(Vertex));
+	file.read(reinterpret_cast<char*>(outData.Indices.data()), outData.Indices.size() * sizeof(uint32_t));
+	file.read(reinterpret_cast<char*>(outData.LODs.data()), outData.LODs.size() * sizeof(MeshLOD));
+	file.read(reinterpret_cast<char*>(outData.Meshlets.data()), outData.Meshlets.size() * sizeof(Meshlet));
+	if (!file || !HasValidRanges(outData))
+	{
+		std::cout << (file ? "ERROR::MESH::INVALID_FILE: " : "ERROR::MESH::TRUNCATED_FILE: ") << path << "\n";
+		outData = MeshData();
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,12 @@
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include "Mesh.h"
+
+#include <string>
+
+// Cooked mesh: vertices, indices, the LOD table and meshlets in one binary blob, loaded without any processing
+bool SaveMeshData(const std::string& path, const MeshData& data);
+bool LoadMeshData(const std::string& path, MeshData& outData);
+
+#endif // MESH_FILE_H
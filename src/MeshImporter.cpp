@@ -0,0 +1,39 @@
+#include "MeshImporter.h"
+#include "VertexCache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+bool ImportMesh(const std::string& path, ThreadPool& pool, ImportedMesh& outMesh)
+{
+	size_t dot = path.find_last_of('.');
+	std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	if (extension == "obj")
+		return ImportObj(path, pool, outMesh);
+	if (extension == "gltf" || extension == "glb")
+		return ImportGltf(path, pool, outMesh);
+
+	std::cout << "ERROR::IMPORT::UNKNOWN_FORMAT: " << path << "\n";
+	return false;
+}
+
+void FinalizeImportedMesh(ImportedMesh& mesh)
+{
+	MeshData& data = mesh.Data;
+	const size_t vertexCount = data.Vertices.size();
+	for (SubMesh& subMesh : mesh.SubMeshes)
+	{
+		subMesh.Bounds = AABB();
+		for (uint32_t i = subMesh.FirstIndex; i < subMesh.FirstIndex + subMesh.IndexCount; i++)
+			subMesh.Bounds.Expand(data.Vertices[data.Indices[i]].Position);
+		// Per range so the submesh table stays valid
+		OptimizeVertexCache(&data.Indices[subMesh.FirstIndex], subMesh.IndexCount, vertexCount);
+	}
+
+	data.ComputeBounds();
+	data.LODs.assign(1, { 0, static_cast<uint32_t>(data.Indices.size()), 0.f });
+	data.Meshlets.clear();
+}
@@ -0,0 +1,49 @@
+#ifndef MESH_IMPORTER_H
+#define MESH_IMPORTER_H
+
+#include "AABB.h"
+#include "Mesh.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+namespace MeshImporterDefaults
+{
+	// OBJ text is split into about this many bytes per parse task
+	constexpr size_t OBJ_CHUNK_SIZE = 1 << 20;
+}
+
+// Index range drawn with one material: an OBJ usemtl/o/g block or one glTF primitive instance
+struct SubMesh
+{
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	AABB Bounds;
+};
+
+struct ImportedMesh
+{
+	MeshData Data;
+	// In file order, they cover the whole index buffer
+	std::vector<SubMesh> SubMeshes;
+	// Other files the mesh was read from (glTF buffers), relative to the source's directory
+	std::vector<std::string> Dependencies;
+};
+
+// Picks the importer from the extension: .obj, .gltf or .glb
+bool ImportMesh(const std::string& path, ThreadPool& pool, ImportedMesh& outMesh);
+
+// Wavefront OBJ, polygons are fanned into triangles and faces without normals get smooth ones.
+// Chunks of the file are parsed in parallel, only the vertex welding runs on one thread.
+bool ImportObj(const std::string& path, ThreadPool& pool, ImportedMesh& outMesh);
+// glTF 2.0 triangle primitives of the default scene baked into world space, one submesh per node
+// and primitive. Buffers may be external files, base64 data uris or the binary chunk of a .glb.
+bool ImportGltf(const std::string& path, ThreadPool& pool, ImportedMesh& outMesh);
+
+// Importers share this: bounds, per submesh vertex cache order and a single LOD
+void FinalizeImportedMesh(ImportedMesh& mesh);
+
+#endif // MESH_IMPORTER_H
@@ -0,0 +1,343 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace MeshSimplifierDefaults;
+
+namespace
+{
+	// Symmetric 4x4 matrix, only the upper triangle is stored
+	struct Quadric
+	{
+		double A00 = 0, A01 = 0, A02 = 0, A03 = 0;
+		double A11 = 0, A12 = 0, A13 = 0;
+		double A22 = 0, A23 = 0;
+		double A33 = 0;
+
+		void AddPlane(const glm::dvec3& normal, double distance)
+		{
+			A00 += normal.x * normal.x; A01 += normal.x * normal.y; A02 += normal.x * normal.z; A03 += normal.x * distance;
+			A11 += normal.y * normal.y; A12 += normal.y * normal.z; A13 += normal.y * distance;
+			A22 += normal.z * normal.z; A23 += normal.z * distance;
+			A33 += distance * distance;
+		}
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			A00 += other.A00; A01 += other.A01; A02 += other.A02; A03 += other.A03;
+			A11 += other.A11; A12 += other.A12; A13 += other.A13;
+			A22 += other.A22; A23 += other.A23;
+			A33 += other.A33;
+			return *this;
+		}
+
+		// Sum of squared distances from the point to every accumulated plane
+		double Evaluate(const glm::vec3& point) const
+		{
+			double x = point.x, y = point.y, z = point.z;
+			return A00 * x * x + 2.0 * A01 * x * y + 2.0 * A02 * x * z + 2.0 * A03 * x
+				+ A11 * y * y + 2.0 * A12 * y * z + 2.0 * A13 * y
+				+ A22 * z * z + 2.0 * A23 * z
+				+ A33;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t Source;
+		uint32_t Target;
+		double Cost;
+	};
+
+	bool SamePosition(const Vertex& a, const Vertex& b)
+	{
+		return a.Position.x == b.Position.x && a.Position.y == b.Position.y && a.Position.z == b.Position.z;
+	}
+
+	bool LessPosition(const Vertex& a, const Vertex& b)
+	{
+		if (a.Position.x != b.Position.x)
+			return a.Position.x < b.Position.x;
+		if (a.Position.y != b.Position.y)
+			return a.Position.y < b.Position.y;
+		return a.Position.z < b.Position.z;
+	}
+
+	float AttributeDistance(const Vertex& a, const Vertex& b)
+	{
+		return glm::length(a.TexCoord - b.TexCoord) + glm::length(a.Normal - b.Normal);
+	}
+
+	// Wedge of the target position whose attributes are closest to the source's
+	uint32_t ClosestWedge(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& targetWedges, uint32_t source)
+	{
+		uint32_t target = targetWedges[0];
+		float bestDistance = AttributeDistance(vertices[target], vertices[source]);
+		for (uint32_t candidate : targetWedges)
+		{
+			float distance = AttributeDistance(vertices[candidate], vertices[source]);
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				target = candidate;
+			}
+		}
+		return target;
+	}
+
+	uint64_t EdgeKey(uint32_t a, uint32_t b)
+	{
+		return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+	}
+
+	glm::vec3 TriangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		return glm::cross(b - a, c - a);
+	}
+}
+
+std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float& outError, float maxError, bool lockSeams)
+{
+	outError = 0.f;
+	const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+
+	// Weld by position: every vertex points at the first one sharing its position (its position id),
+	// and vertices that also share the uv and normal collapse into one wedge
+	std::vector<uint32_t> order(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return LessPosition(vertices[a], vertices[b]); });
+
+	std::vector<uint32_t> positionID(vertexCount);
+	std::vector<uint32_t> wedge(vertexCount);
+	std::vector<std::vector<uint32_t>> wedges(vertexCount);
+	for (size_t begin = 0; begin < order.size();)
+	{
+		size_t end = begin + 1;
+		while (end < order.size() && SamePosition(vertices[order[begin]], vertices[order[end]]))
+			end++;
+
+		uint32_t id = order[begin];
+		for (size_t i = begin; i < end; i++)
+		{
+			uint32_t vertex = order[i];
+			positionID[vertex] = id;
+
+			wedge[vertex] = vertex;
+			for (uint32_t existing : wedges[id])
+			{
+				if (vertices[existing].TexCoord == vertices[vertex].TexCoord && vertices[existing].Normal == vertices[vertex].Normal)
+				{
+					wedge[vertex] = existing;
+					break;
+				}
+			}
+			if (wedge[vertex] == vertex)
+				wedges[id].push_back(vertex);
+		}
+		begin = end;
+	}
+
+	std::vector<uint32_t> result(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+		result[i] = wedge[indices[i]];
+
+	// Seams (several uvs or normals on one position) if asked, and open or non-manifold edges never move
+	std::vector<bool> locked(vertexCount, false);
+	for (uint32_t id = 0; id < vertexCount && lockSeams; id++)
+		locked[id] = wedges[id].size() > 1;
+
+	std::vector<uint64_t> edges;
+	edges.reserve(result.size());
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		for (int e = 0; e < 3; e++)
+			edges.push_back(EdgeKey(positionID[result[i + e]], positionID[result[i + (e + 1) % 3]]));
+	}
+	std::sort(edges.begin(), edges.end());
+	for (size_t begin = 0; begin < edges.size();)
+	{
+		size_t end = begin + 1;
+		while (end < edges.size() && edges[end] == edges[begin])
+			end++;
+		if (end - begin != 2)
+		{
+			locked[static_cast<uint32_t>(edges[begin] >> 32)] = true;
+			locked[static_cast<uint32_t>(edges[begin] & 0xffffffffu)] = true;
+		}
+		begin = end;
+	}
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		glm::dvec3 a(vertices[result[i]].Position), b(vertices[result[i + 1]].Position), c(vertices[result[i + 2]].Position);
+		glm::dvec3 normal = glm::cross(b - a, c - a);
+		double length = glm::length(normal);
+		if (length <= 0.0)
+			continue;
+
+		normal /= length;
+		Quadric plane;
+		plane.AddPlane(normal, -glm::dot(normal, a));
+		for (int corner = 0; corner < 3; corner++)
+			quadrics[positionID[result[i + corner]]] += plane;
+	}
+
+	std::vector<uint32_t> collapseTarget(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<Collapse> collapses;
+
+	const double costLimit = static_cast<double>(maxError) * maxError;
+	double maxCost = 0.0;
+	while (result.size() > targetIndexCount)
+	{
+		const size_t triangleCount = result.size() / 3;
+
+		// Triangles around every position id, CSR style
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (uint32_t index : result)
+			triangleOffsets[positionID[index] + 1]++;
+		for (uint32_t id = 0; id < vertexCount; id++)
+			triangleOffsets[id + 1] += triangleOffsets[id];
+		vertexTriangles.resize(result.size());
+		std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			vertexTriangles[cursor[positionID[result[i]]]++] = static_cast<uint32_t>(i / 3);
+
+		// Both directions of every edge, onto the target wedge with the closest uv
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				uint32_t source = result[i + e];
+				uint32_t other = result[i + (e + 1) % 3];
+				uint32_t sourceID = positionID[source];
+				uint32_t targetID = positionID[other];
+				if (locked[sourceID] || sourceID == targetID)
+					continue;
+
+				uint32_t target = ClosestWedge(vertices, wedges[targetID], source);
+				Quadric merged = quadrics[sourceID];
+				merged += quadrics[targetID];
+				collapses.push_back({ source, target, std::max(merged.Evaluate(vertices[target].Position), 0.0) });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+			{
+				return a.Cost != b.Cost ? a.Cost < b.Cost : (a.Source != b.Source ? a.Source < b.Source : a.Target < b.Target);
+			});
+
+		for (uint32_t i = 0; i < vertexCount; i++)
+			collapseTarget[i] = i;
+		std::fill(touched.begin(), touched.end(), false);
+
+		// Each interior collapse removes two triangles; one pass only collapses disjoint
+		// neighbourhoods so every flip test below sees up to date geometry
+		size_t removed = 0;
+		const size_t toRemove = triangleCount - targetIndexCount / 3;
+		for (const Collapse& collapse : collapses)
+		{
+			if (removed >= toRemove || collapse.Cost > costLimit)
+				break;
+
+			uint32_t sourceID = positionID[collapse.Source];
+			uint32_t targetID = positionID[collapse.Target];
+			if (touched[sourceID] || touched[targetID])
+				continue;
+
+			bool flips = false;
+			for (uint32_t t = triangleOffsets[sourceID]; t < triangleOffsets[sourceID + 1] && !flips; t++)
+			{
+				const uint32_t* triangle = &result[vertexTriangles[t] * 3];
+				glm::vec3 before[3], after[3];
+				bool collapsesAway = false;
+				for (int corner = 0; corner < 3; corner++)
+				{
+					uint32_t id = positionID[triangle[corner]];
+					collapsesAway |= id == targetID;
+					before[corner] = vertices[triangle[corner]].Position;
+					after[corner] = id == sourceID ? vertices[collapse.Target].Position : before[corner];
+				}
+				if (collapsesAway)
+					continue;
+
+				glm::vec3 normalBefore = TriangleNormal(before[0], before[1], before[2]);
+				glm::vec3 normalAfter = TriangleNormal(after[0], after[1], after[2]);
+				float lengths = glm::length(normalBefore) * glm::length(normalAfter);
+				flips = lengths <= 0.f || glm::dot(normalBefore, normalAfter) < MAX_NORMAL_FLIP * lengths;
+			}
+			if (flips)
+				continue;
+
+			for (uint32_t source : wedges[sourceID])
+				collapseTarget[source] = source == collapse.Source ? collapse.Target : ClosestWedge(vertices, wedges[targetID], source);
+			quadrics[targetID] += quadrics[sourceID];
+			maxCost = std::max(maxCost, collapse.Cost);
+			removed += 2;
+
+			for (uint32_t t = triangleOffsets[sourceID]; t < triangleOffsets[sourceID + 1]; t++)
+			{
+				const uint32_t* triangle = &result[vertexTriangles[t] * 3];
+				for (int corner = 0; corner < 3; corner++)
+					touched[positionID[triangle[corner]]] = true;
+			}
+		}
+
+		if (removed == 0)
+			break;
+
+		// Apply the collapses and drop the triangles that became degenerate
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			uint32_t a = collapseTarget[result[i]];
+			uint32_t b = collapseTarget[result[i + 1]];
+			uint32_t c = collapseTarget[result[i + 2]];
+			if (positionID[a] == positionID[b] || positionID[b] == positionID[c] || positionID[a] == positionID[c])
+				continue;
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	outError = static_cast<float>(std::sqrt(maxCost));
+	return result;
+}
+
+void BuildLODChain(MeshData& data, uint32_t maxLODCount, float reduction)
+{
+	if (data.LODs.empty())
+		data.LODs.push_back({ 0, static_cast<uint32_t>(data.Indices.size()), 0.f });
+
+	const MeshLOD& last = data.LODs.back();
+	std::vector<uint32_t> current(data.Indices.begin() + last.FirstIndex, data.Indices.begin() + last.FirstIndex + last.IndexCount);
+	float error = last.Error;
+
+	while (data.LODs.size() < maxLODCount)
+	{
+		size_t targetTriangles = static_cast<size_t>(current.size() / 3 * reduction);
+		if (targetTriangles < MIN_LOD_TRIANGLES)
+			break;
+
+		float levelError;
+		std::vector<uint32_t> simplified = SimplifyMesh(data.Vertices, current, targetTriangles * 3, levelError);
+		// Locked seams and borders can stall the reduction, a level that barely shrank isn't worth drawing
+		if (simplified.size() > current.size() * (1.f + reduction) * 0.5f)
+			break;
+
+		// Each level is simplified from the previous one, so the errors stack up
+		error += levelError;
+		data.LODs.push_back({ static_cast<uint32_t>(data.Indices.size()), static_cast<uint32_t>(simplified.size()), error });
+		data.Indices.insert(data.Indices.end(), simplified.begin(), simplified.end());
+		current.swap(simplified);
+	}
+}
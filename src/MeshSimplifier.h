@@ -0,0 +1,34 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include "Mesh.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace MeshSimplifierDefaults
+{
+	constexpr uint32_t MAX_LOD_COUNT = 4;
+	// Triangle ratio between neighbouring levels
+	constexpr float LOD_REDUCTION = 0.5f;
+	// Stop the chain once a level gets this small
+	constexpr size_t MIN_LOD_TRIANGLES = 64;
+	// Collapses flipping a neighbour's normal further than this (cosine) are rejected
+	constexpr float MAX_NORMAL_FLIP = 0.2f;
+}
+
+// Quadric error edge collapse (Garland-Heckbert). Vertices only ever collapse onto one of
+// their neighbours, never to a new position, so the output indexes the same vertex buffer.
+// Open borders are locked to keep the silhouette, attribute seams too unless lockSeams is off, then
+// every wedge of a collapsed position follows onto the target wedge with the closest uv and normal.
+// Stops early rather than introduce an error above maxError.
+// Returns the simplified index list, outError the largest object space error introduced.
+std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float& outError, float maxError = std::numeric_limits<float>::max(), bool lockSeams = true);
+
+// Appends coarser levels to data.Indices and data.LODs, each simplified from the previous one
+void BuildLODChain(MeshData& data, uint32_t maxLODCount = MeshSimplifierDefaults::MAX_LOD_COUNT,
+	float reduction = MeshSimplifierDefaults::LOD_REDUCTION);
+
+#endif // MESH_SIMPLIFIER_H
@@ -0,0 +1,228 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace MeshletDefaults;
+
+namespace
+{
+	void ComputeMeshletBounds(const MeshData& data, Meshlet& meshlet)
+	{
+		const uint32_t* indices = &data.Indices[meshlet.FirstIndex];
+
+		AABB bounds;
+		for (uint32_t i = 0; i < meshlet.IndexCount; i++)
+			bounds.Expand(data.Vertices[indices[i]].Position);
+		meshlet.Center = bounds.GetCenter();
+		meshlet.Radius = 0.f;
+		for (uint32_t i = 0; i < meshlet.IndexCount; i++)
+			meshlet.Radius = std::max(meshlet.Radius, glm::length(data.Vertices[indices[i]].Position - meshlet.Center));
+
+		std::vector<glm::vec3> normals;
+		glm::vec3 axis(0.f);
+		for (uint32_t i = 0; i < meshlet.IndexCount; i += 3)
+		{
+			const glm::vec3& a = data.Vertices[indices[i]].Position;
+			glm::vec3 normal = glm::cross(data.Vertices[indices[i + 1]].Position - a, data.Vertices[indices[i + 2]].Position - a);
+			float length = glm::length(normal);
+			if (length <= 0.f)
+				continue;
+
+			normals.push_back(normal / length);
+			axis += normals.back();
+		}
+
+		meshlet.ConeAxis = glm::vec3(0.f, 0.f, 1.f);
+		meshlet.ConeCutoff = 1.f;
+		float axisLength = glm::length(axis);
+		if (axisLength <= 0.f)
+			return;
+
+		meshlet.ConeAxis = axis / axisLength;
+		float minDot = 1.f;
+		for (const glm::vec3& normal : normals)
+			minDot = std::min(minDot, glm::dot(normal, meshlet.ConeAxis));
+
+		// Normals spread past 90 degrees, some triangle faces every possible viewer
+		if (minDot > 0.f)
+			meshlet.ConeCutoff = std::sqrt(1.f - minDot * minDot);
+	}
+}
+
+void MeshletDrawList::Clear()
+{
+	Counts.clear();
+	Offsets.clear();
+	TriangleCount = 0;
+	CulledCount = 0;
+}
+
+void BuildMeshlets(MeshData& data, uint32_t maxTriangles, uint32_t maxVertices)
+{
+	data.Meshlets.clear();
+	if (data.LODs.empty())
+		data.LODs.push_back({ 0, static_cast<uint32_t>(data.Indices.size()), 0.f });
+
+	const MeshLOD& lod = data.LODs[0];
+	const uint32_t triangleCount = lod.IndexCount / 3;
+	if (triangleCount < MIN_MESH_TRIANGLES)
+		return;
+
+	const uint32_t* triangles = &data.Indices[lod.FirstIndex];
+	const uint32_t vertexCount = static_cast<uint32_t>(data.Vertices.size());
+
+	std::vector<glm::vec3> normals(triangleCount);
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		const glm::vec3& a = data.Vertices[triangles[t * 3]].Position;
+		glm::vec3 normal = glm::cross(data.Vertices[triangles[t * 3 + 1]].Position - a, data.Vertices[triangles[t * 3 + 2]].Position - a);
+		float length = glm::length(normal);
+		normals[t] = length > 0.f ? normal / length : glm::vec3(0.f);
+	}
+
+	// Triangles around every vertex, CSR style
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (uint32_t i = 0; i < lod.IndexCount; i++)
+		offsets[triangles[i] + 1]++;
+	for (uint32_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] += offsets[v];
+	std::vector<uint32_t> vertexTriangles(lod.IndexCount);
+	std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+	for (uint32_t i = 0; i < lod.IndexCount; i++)
+		vertexTriangles[cursor[triangles[i]]++] = i / 3;
+
+	std::vector<bool> assigned(triangleCount, false);
+	// Meshlet that last used each vertex, saves clearing a set per meshlet
+	std::vector<uint32_t> vertexStamp(vertexCount, UINT32_MAX);
+	std::vector<uint32_t> reordered;
+	reordered.reserve(lod.IndexCount);
+	std::vector<uint32_t> candidates;
+
+	uint32_t seed = 0;
+	while (true)
+	{
+		while (seed < triangleCount && assigned[seed])
+			seed++;
+		if (seed == triangleCount)
+			break;
+
+		const uint32_t meshletIndex = static_cast<uint32_t>(data.Meshlets.size());
+		Meshlet meshlet = {};
+		meshlet.FirstIndex = lod.FirstIndex + static_cast<uint32_t>(reordered.size());
+
+		uint32_t meshletVertices = 0;
+		uint32_t meshletTriangles = 0;
+		glm::vec3 normalSum(0.f);
+		candidates.clear();
+		candidates.push_back(seed);
+
+		while (meshletTriangles < maxTriangles)
+		{
+			// Fewest new vertices first, then the closest facing direction
+			int best = -1;
+			int bestNewVertices = 4;
+			float bestFacing = -2.f;
+			for (size_t c = 0; c < candidates.size(); c++)
+			{
+				uint32_t t = candidates[c];
+				if (assigned[t])
+					continue;
+
+				int newVertices = 0;
+				for (int corner = 0; corner < 3; corner++)
+					newVertices += vertexStamp[triangles[t * 3 + corner]] != meshletIndex;
+				if (meshletVertices + newVertices > maxVertices)
+					continue;
+
+				float facing = glm::dot(normals[t], normalSum);
+				if (newVertices < bestNewVertices || (newVertices == bestNewVertices && facing > bestFacing))
+				{
+					best = static_cast<int>(c);
+					bestNewVertices = newVertices;
+					bestFacing = facing;
+				}
+			}
+			if (best < 0)
+				break;
+
+			uint32_t t = candidates[best];
+			candidates[best] = candidates.back();
+			candidates.pop_back();
+
+			assigned[t] = true;
+			meshletTriangles++;
+			normalSum += normals[t];
+			for (int corner = 0; corner < 3; corner++)
+			{
+				uint32_t vertex = triangles[t * 3 + corner];
+				reordered.push_back(vertex);
+				if (vertexStamp[vertex] != meshletIndex)
+				{
+					vertexStamp[vertex] = meshletIndex;
+					meshletVertices++;
+				}
+				for (uint32_t i = offsets[vertex]; i < offsets[vertex + 1]; i++)
+				{
+					if (!assigned[vertexTriangles[i]])
+						candidates.push_back(vertexTriangles[i]);
+				}
+			}
+
+			// Drop stale and duplicate entries before they pile up
+			std::sort(candidates.begin(), candidates.end());
+			candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+			candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t c) { return assigned[c]; }), candidates.end());
+		}
+
+		meshlet.IndexCount = meshletTriangles * 3;
+		data.Meshlets.push_back(meshlet);
+	}
+
+	std::copy(reordered.begin(), reordered.end(), data.Indices.begin() + lod.FirstIndex);
+	for (Meshlet& meshlet : data.Meshlets)
+		ComputeMeshletBounds(data, meshlet);
+}
+
+void CullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& model, const Frustum& frustum,
+	const glm::vec3& cameraPosition, MeshletDrawList& outDraws)
+{
+	const glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.f));
+	const float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+	const size_t firstRange = outDraws.Counts.size();
+
+	for (const Meshlet& meshlet : meshlets)
+	{
+		// Backfacing from everywhere the camera could be looking at it from
+		glm::vec3 toMeshlet = meshlet.Center - localCamera;
+		if (glm::dot(toMeshlet, meshlet.ConeAxis) >= meshlet.ConeCutoff * glm::length(toMeshlet) + meshlet.Radius)
+		{
+			outDraws.CulledCount++;
+			continue;
+		}
+
+		glm::vec3 worldCenter = glm::vec3(model * glm::vec4(meshlet.Center, 1.f));
+		if (!frustum.IntersectsSphere(worldCenter, meshlet.Radius * scale))
+		{
+			outDraws.CulledCount++;
+			continue;
+		}
+
+		const void* offset = reinterpret_cast<const void*>(static_cast<uintptr_t>(meshlet.FirstIndex) * sizeof(uint32_t));
+		const GLsizei count = static_cast<GLsizei>(meshlet.IndexCount);
+		if (outDraws.Counts.size() > firstRange)
+		{
+			uintptr_t previousEnd = reinterpret_cast<uintptr_t>(outDraws.Offsets.back()) + outDraws.Counts.back() * sizeof(uint32_t);
+			if (previousEnd == reinterpret_cast<uintptr_t>(offset))
+			{
+				outDraws.Counts.back() += count;
+				outDraws.TriangleCount += meshlet.IndexCount / 3;
+				continue;
+			}
+		}
+
+		outDraws.Counts.push_back(count);
+		outDraws.Offsets.push_back(offset);
+		outDraws.TriangleCount += meshlet.IndexCount / 3;
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+#include "Mesh.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace MeshletDefaults
+{
+	constexpr uint32_t MAX_TRIANGLES = 124;
+	constexpr uint32_t MAX_VERTICES = 64;
+	// Smaller meshes are drawn whole, a handful of clusters wouldn't pay for the tests
+	constexpr uint32_t MIN_MESH_TRIANGLES = 256;
+}
+
+// Index ranges for Mesh::DrawRanges, may collect several instances one after another
+struct MeshletDrawList
+{
+	std::vector<GLsizei> Counts;
+	std::vector<const void*> Offsets;
+	uint32_t TriangleCount = 0;
+	uint32_t CulledCount = 0;
+
+	void Clear();
+};
+
+// Splits LOD 0 into clusters grown over shared vertices, preferring triangles that face the
+// same way so the normal cones stay tight. Reorders the LOD 0 indices so every meshlet is one
+// contiguous range; the other LODs are untouched.
+void BuildMeshlets(MeshData& data, uint32_t maxTriangles = MeshletDefaults::MAX_TRIANGLES,
+	uint32_t maxVertices = MeshletDefaults::MAX_VERTICES);
+
+// Frustum and normal cone test of every meshlet of one instance. Survivors are appended to the
+// draw list, neighbours in the index buffer merged into one range, never into an earlier call's. The cone test assumes the
+// model matrix has no shear or non-uniform scale.
+void CullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& model, const Frustum& frustum,
+	const glm::vec3& cameraPosition, MeshletDrawList& outDraws);
+
+#endif // MESHLETS_H
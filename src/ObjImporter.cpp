@@ -0,0 +1,375 @@
+#include "MeshImporter.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+
+namespace
+{
+	constexpr int32_t NO_INDEX = std::numeric_limits<int32_t>::min();
+
+	// Zero based as far as one chunk can tell. Negative OBJ indices count back from the
+	// elements defined so far, which is only known once every earlier chunk has been parsed.
+	struct ObjIndex
+	{
+		int32_t Value = NO_INDEX;
+		bool Relative = false;
+	};
+
+	struct ObjCorner
+	{
+		ObjIndex Position;
+		ObjIndex TexCoord;
+		ObjIndex Normal;
+	};
+
+	struct ObjChunk
+	{
+		std::vector<glm::vec3> Positions;
+		std::vector<glm::vec2> TexCoords;
+		std::vector<glm::vec3> Normals;
+		std::vector<ObjCorner> Corners;
+		// Corner count of every face, the corners follow each other
+		std::vector<uint32_t> FaceSizes;
+		// Local face index where a usemtl, o or g block starts
+		std::vector<uint32_t> GroupStarts;
+		uint32_t SkippedLines = 0;
+	};
+
+	struct CornerKey
+	{
+		int32_t Position;
+		int32_t TexCoord;
+		int32_t Normal;
+
+		bool operator==(const CornerKey& other) const
+		{
+			return Position == other.Position && TexCoord == other.TexCoord && Normal == other.Normal;
+		}
+	};
+
+	struct CornerKeyHash
+	{
+		size_t operator()(const CornerKey& key) const
+		{
+			uint64_t hash = static_cast<uint32_t>(key.Position);
+			hash = hash * 0x9e3779b97f4a7c15ull ^ static_cast<uint32_t>(key.TexCoord);
+			hash = hash * 0x9e3779b97f4a7c15ull ^ static_cast<uint32_t>(key.Normal);
+			return static_cast<size_t>(hash ^ (hash >> 29));
+		}
+	};
+
+	bool IsBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	void SkipBlanks(const char*& cursor, const char* end)
+	{
+		while (cursor < end && IsBlank(*cursor))
+			cursor++;
+	}
+
+	bool ParseFloat(const char*& cursor, const char* end, float& outValue)
+	{
+		SkipBlanks(cursor, end);
+		if (cursor < end && *cursor == '+')
+			cursor++;
+		std::from_chars_result result = std::from_chars(cursor, end, outValue);
+		if (result.ec != std::errc())
+			return false;
+		cursor = result.ptr;
+		return true;
+	}
+
+	bool ParseIndex(const char*& cursor, const char* end, int32_t elementCount, ObjIndex& outIndex)
+	{
+		int32_t value = 0;
+		std::from_chars_result result = std::from_chars(cursor, end, value);
+		if (result.ec != std::errc() || value == 0)
+			return false;
+		cursor = result.ptr;
+		outIndex.Relative = value < 0;
+		outIndex.Value = value < 0 ? elementCount + value : value - 1;
+		return true;
+	}
+
+	// "v", "v/t", "v//n" or "v/t/n"
+	bool ParseCorner(const char*& cursor, const char* end, const ObjChunk& chunk, ObjCorner& outCorner)
+	{
+		if (!ParseIndex(cursor, end, static_cast<int32_t>(chunk.Positions.size()), outCorner.Position))
+			return false;
+		if (cursor == end || *cursor != '/')
+			return true;
+		cursor++;
+		if (cursor < end && *cursor != '/' && !ParseIndex(cursor, end, static_cast<int32_t>(chunk.TexCoords.size()), outCorner.TexCoord))
+			return false;
+		if (cursor == end || *cursor != '/')
+			return true;
+		cursor++;
+		return ParseIndex(cursor, end, static_cast<int32_t>(chunk.Normals.size()), outCorner.Normal);
+	}
+
+	bool StartsWithKeyword(const char* cursor, const char* end, const char* keyword)
+	{
+		size_t length = std::strlen(keyword);
+		return static_cast<size_t>(end - cursor) > length && std::memcmp(cursor, keyword, length) == 0 && IsBlank(cursor[length]);
+	}
+
+	bool ParseLine(const char* cursor, const char* end, ObjChunk& chunk)
+	{
+		SkipBlanks(cursor, end);
+		if (cursor == end || *cursor == '#')
+			return true;
+
+		if (StartsWithKeyword(cursor, end, "v"))
+		{
+			cursor += 1;
+			glm::vec3 position;
+			if (!ParseFloat(cursor, end, position.x) || !ParseFloat(cursor, end, position.y) || !ParseFloat(cursor, end, position.z))
+				return false;
+			chunk.Positions.push_back(position);
+		}
+		else if (StartsWithKeyword(cursor, end, "vt"))
+		{
+			cursor += 2;
+			// v is optional
+			glm::vec2 texCoord(0.f);
+			if (!ParseFloat(cursor, end, texCoord.x))
+				return false;
+			ParseFloat(cursor, end, texCoord.y);
+			chunk.TexCoords.push_back(texCoord);
+		}
+		else if (StartsWithKeyword(cursor, end, "vn"))
+		{
+			cursor += 2;
+			glm::vec3 normal;
+			if (!ParseFloat(cursor, end, normal.x) || !ParseFloat(cursor, end, normal.y) || !ParseFloat(cursor, end, normal.z))
+				return false;
+			chunk.Normals.push_back(normal);
+		}
+		else if (StartsWithKeyword(cursor, end, "f"))
+		{
+			cursor += 1;
+			const size_t firstCorner = chunk.Corners.size();
+			SkipBlanks(cursor, end);
+			while (cursor < end)
+			{
+				ObjCorner corner;
+				if (!ParseCorner(cursor, end, chunk, corner))
+				{
+					chunk.Corners.resize(firstCorner);
+					return false;
+				}
+				chunk.Corners.push_back(corner);
+				SkipBlanks(cursor, end);
+			}
+
+			const uint32_t cornerCount = static_cast<uint32_t>(chunk.Corners.size() - firstCorner);
+			if (cornerCount < 3)
+			{
+				chunk.Corners.resize(firstCorner);
+				return false;
+			}
+			chunk.FaceSizes.push_back(cornerCount);
+		}
+		else if (StartsWithKeyword(cursor, end, "usemtl") || StartsWithKeyword(cursor, end, "o") || StartsWithKeyword(cursor, end, "g"))
+		{
+			chunk.GroupStarts.push_back(static_cast<uint32_t>(chunk.FaceSizes.size()));
+		}
+		// Smoothing groups, materials libraries, lines and points don't matter here
+		return true;
+	}
+
+	void ParseChunk(const char* begin, const char* end, ObjChunk& chunk)
+	{
+		const char* line = begin;
+		while (line < end)
+		{
+			const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+			if (!lineEnd)
+				lineEnd = end;
+			if (!ParseLine(line, lineEnd, chunk))
+				chunk.SkippedLines++;
+			line = lineEnd + 1;
+		}
+	}
+
+	// Global zero based index, or NO_INDEX when missing or out of range
+	int32_t ResolveIndex(const ObjIndex& index, size_t chunkBase, size_t elementCount)
+	{
+		if (index.Value == NO_INDEX)
+			return NO_INDEX;
+		int64_t resolved = index.Relative ? static_cast<int64_t>(chunkBase) + index.Value : index.Value;
+		if (resolved < 0 || resolved >= static_cast<int64_t>(elementCount))
+			return NO_INDEX;
+		return static_cast<int32_t>(resolved);
+	}
+}
+
+bool ImportObj(const std::string& path, ThreadPool& pool, ImportedMesh& outMesh)
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		std::cout << "ERROR::IMPORT::FILE_NOT_FOUND: " << path << "\n";
+		return false;
+	}
+
+	// Cut at line ends near evenly spaced offsets, every chunk then parses on its own
+	const char* text = reinterpret_cast<const char*>(file.GetData());
+	const size_t size = file.GetSize();
+	const size_t chunkCount = std::max<size_t>(1, size / MeshImporterDefaults::OBJ_CHUNK_SIZE);
+	std::vector<size_t> chunkStarts(chunkCount + 1, size);
+	chunkStarts[0] = 0;
+	for (size_t c = 1; c < chunkCount; c++)
+	{
+		size_t start = std::max(chunkStarts[c - 1], size * c / chunkCount);
+		const void* newline = start < size ? std::memchr(text + start, '\n', size - start) : nullptr;
+		chunkStarts[c] = newline ? static_cast<const char*>(newline) - text + 1 : size;
+	}
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	pool.ParallelFor(static_cast<uint32_t>(chunkCount), 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t c = begin; c < end; c++)
+				ParseChunk(text + chunkStarts[c], text + chunkStarts[c + 1], chunks[c]);
+		});
+
+	// Every chunk's elements go after the previous chunks'
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> texCoords;
+	std::vector<glm::vec3> normals;
+	std::vector<size_t> positionBase(chunkCount), texCoordBase(chunkCount), normalBase(chunkCount), faceBase(chunkCount);
+	size_t faceCount = 0;
+	uint32_t skippedLines = 0;
+	for (size_t c = 0; c < chunkCount; c++)
+	{
+		positionBase[c] = positions.size();
+		texCoordBase[c] = texCoords.size();
+		normalBase[c] = normals.size();
+		faceBase[c] = faceCount;
+		positions.insert(positions.end(), chunks[c].Positions.begin(), chunks[c].Positions.end());
+		texCoords.insert(texCoords.end(), chunks[c].TexCoords.begin(), chunks[c].TexCoords.end());
+		normals.insert(normals.end(), chunks[c].Normals.begin(), chunks[c].Normals.end());
+		faceCount += chunks[c].FaceSizes.size();
+		skippedLines += chunks[c].SkippedLines;
+	}
+	if (faceCount == 0)
+	{
+		std::cout << "ERROR::IMPORT::EMPTY_MESH: " << path << "\n";
+		return false;
+	}
+
+	std::vector<size_t> groupStarts = { 0 };
+	for (size_t c = 0; c < chunkCount; c++)
+	{
+		for (uint32_t start : chunks[c].GroupStarts)
+			groupStarts.push_back(faceBase[c] + start);
+	}
+	groupStarts.push_back(faceCount);
+
+	// Weld corners sharing all three indices, fan every polygon from its first corner
+	outMesh = ImportedMesh();
+	MeshData& data = outMesh.Data;
+	std::unordered_map<CornerKey, uint32_t, CornerKeyHash> welded;
+	welded.reserve(positions.size());
+	std::vector<bool> smoothNormal;
+	uint32_t invalidFaces = 0;
+	size_t group = 0;
+	size_t face = 0;
+	uint32_t subMeshStart = 0;
+	std::vector<uint32_t> polygon;
+	for (size_t c = 0; c < chunkCount; c++)
+	{
+		const ObjChunk& chunk = chunks[c];
+		size_t corner = 0;
+		for (uint32_t faceSize : chunk.FaceSizes)
+		{
+			// Close the submesh of every group ending here, empty ones are dropped
+			while (groupStarts[group + 1] <= face)
+			{
+				uint32_t indexCount = static_cast<uint32_t>(data.Indices.size()) - subMeshStart;
+				if (indexCount > 0)
+					outMesh.SubMeshes.push_back({ subMeshStart, indexCount, AABB() });
+				subMeshStart = static_cast<uint32_t>(data.Indices.size());
+				group++;
+			}
+
+			polygon.clear();
+			for (uint32_t i = 0; i < faceSize; i++)
+			{
+				const ObjCorner& source = chunk.Corners[corner + i];
+				CornerKey key;
+				key.Position = ResolveIndex(source.Position, positionBase[c], positions.size());
+				key.TexCoord = ResolveIndex(source.TexCoord, texCoordBase[c], texCoords.size());
+				key.Normal = ResolveIndex(source.Normal, normalBase[c], normals.size());
+				if (key.Position == NO_INDEX)
+					break;
+
+				auto inserted = welded.emplace(key, static_cast<uint32_t>(data.Vertices.size()));
+				if (inserted.second)
+				{
+					Vertex vertex;
+					vertex.Position = positions[key.Position];
+					vertex.TexCoord = key.TexCoord != NO_INDEX ? texCoords[key.TexCoord] : glm::vec2(0.f);
+					vertex.Normal = key.Normal != NO_INDEX ? normals[key.Normal] : glm::vec3(0.f);
+					data.Vertices.push_back(vertex);
+					smoothNormal.push_back(key.Normal == NO_INDEX);
+				}
+				polygon.push_back(inserted.first->second);
+			}
+			corner += faceSize;
+			face++;
+
+			if (polygon.size() != faceSize)
+			{
+				invalidFaces++;
+				continue;
+			}
+			for (uint32_t i = 1; i + 1 < faceSize; i++)
+			{
+				data.Indices.push_back(polygon[0]);
+				data.Indices.push_back(polygon[i]);
+				data.Indices.push_back(polygon[i + 1]);
+			}
+		}
+	}
+	uint32_t indexCount = static_cast<uint32_t>(data.Indices.size()) - subMeshStart;
+	if (indexCount > 0)
+		outMesh.SubMeshes.push_back({ subMeshStart, indexCount, AABB() });
+
+	// Area weighted normals for vertices the file gave none
+	for (size_t i = 0; i < data.Indices.size(); i += 3)
+	{
+		const uint32_t* triangle = &data.Indices[i];
+		glm::vec3 faceNormal = glm::cross(data.Vertices[triangle[1]].Position - data.Vertices[triangle[0]].Position,
+			data.Vertices[triangle[2]].Position - data.Vertices[triangle[0]].Position);
+		for (int corner = 0; corner < 3; corner++)
+		{
+			if (smoothNormal[triangle[corner]])
+				data.Vertices[triangle[corner]].Normal += faceNormal;
+		}
+	}
+	for (Vertex& vertex : data.Vertices)
+	{
+		float length = glm::length(vertex.Normal);
+		vertex.Normal = length > 0.f ? vertex.Normal / length : glm::vec3(0.f, 1.f, 0.f);
+	}
+
+	if (skippedLines > 0 || invalidFaces > 0)
+		std::cout << "Skipped " << skippedLines << " malformed lines and " << invalidFaces << " faces with invalid indices in " << path << "\n";
+	if (data.Indices.empty())
+	{
+		std::cout << "ERROR::IMPORT::EMPTY_MESH: " << path << "\n";
+		return false;
+	}
+
+	FinalizeImportedMesh(outMesh);
+	return true;
+}
@@ -0,0 +1,166 @@
+#include "OcclusionQueries.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+
+OcclusionQueries::OcclusionQueries()
+	: _frame(0), _proxyShader("resources/shaders/proxy.vert", "resources/shaders/proxy.frag"),
+	_proxyVAO(0), _proxyVBO(0), _proxyEBO(0)
+{
+	// Unit cube centred on the origin, scaled to the object bounds per query
+	const float corners[] = {
+		-0.5f, -0.5f, -0.5f,
+		 0.5f, -0.5f, -0.5f,
+		 0.5f,  0.5f, -0.5f,
+		-0.5f,  0.5f, -0.5f,
+		-0.5f, -0.5f,  0.5f,
+		 0.5f, -0.5f,  0.5f,
+		 0.5f,  0.5f,  0.5f,
+		-0.5f,  0.5f,  0.5f
+	};
+
+	const unsigned char indices[] = {
+		0, 1, 2, 2, 3, 0,
+		4, 5, 6, 6, 7, 4,
+		0, 4, 7, 7, 3, 0,
+		1, 5, 6, 6, 2, 1,
+		0, 1, 5, 5, 4, 0,
+		3, 2, 6, 6, 7, 3
+	};
+
+	GL_CHECK(glGenVertexArrays(1, &_proxyVAO));
+	GL_CHECK(glGenBuffers(1, &_proxyVBO));
+	GL_CHECK(glGenBuffers(1, &_proxyEBO));
+
+	GL_CHECK(glBindVertexArray(_proxyVAO));
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, _proxyVBO));
+	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW));
+	GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _proxyEBO));
+	GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW));
+
+	GL_CHECK(glEnableVertexAttribArray(0));
+	GL_CHECK(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0));
+	GL_CHECK(glBindVertexArray(0));
+}
+
+OcclusionQueries::~OcclusionQueries()
+{
+	for (ObjectQuery& query : _queries)
+		glDeleteQueries(1, &query.Query);
+
+	glDeleteVertexArrays(1, &_proxyVAO);
+	glDeleteBuffers(1, &_proxyVBO);
+	glDeleteBuffers(1, &_proxyEBO);
+}
+
+void OcclusionQueries::Resize(uint32_t objectCount)
+{
+	size_t oldCount = _queries.size();
+	if (objectCount < oldCount)
+	{
+		for (size_t i = objectCount; i < oldCount; i++)
+			GL_CHECK(glDeleteQueries(1, &_queries[i].Query));
+		_queries.resize(objectCount);
+
+		_pending.erase(std::remove_if(_pending.begin(), _pending.end(),
+			[objectCount](uint32_t objectID) { return objectID >= objectCount; }), _pending.end());
+		return;
+	}
+
+	_queries.resize(objectCount);
+	for (size_t i = oldCount; i < objectCount; i++)
+		GL_CHECK(glGenQueries(1, &_queries[i].Query));
+}
+
+void OcclusionQueries::CollectResults()
+{
+	_frame++;
+
+	// Never ask for GL_QUERY_RESULT before GL_QUERY_RESULT_AVAILABLE, that would block on the GPU
+	size_t kept = 0;
+	for (size_t i = 0; i < _pending.size(); i++)
+	{
+		uint32_t objectID = _pending[i];
+		ObjectQuery& query = _queries[objectID];
+
+		GLuint available = GL_FALSE;
+		GL_CHECK(glGetQueryObjectuiv(query.Query, GL_QUERY_RESULT_AVAILABLE, &available));
+		if (!available)
+		{
+			_pending[kept++] = objectID;
+			continue;
+		}
+
+		GLuint anySamplesPassed = GL_FALSE;
+		GL_CHECK(glGetQueryObjectuiv(query.Query, GL_QUERY_RESULT, &anySamplesPassed));
+		query.Visible = anySamplesPassed != GL_FALSE;
+		query.Pending = false;
+		query.ResultFrame = query.IssuedFrame;
+	}
+	_pending.resize(kept);
+}
+
+OcclusionState OcclusionQueries::Classify(uint32_t objectID, const AABB& worldBounds, const glm::vec3& cameraPosition) const
+{
+	// The proxy would be clipped by the near plane, so the query says nothing useful
+	const glm::vec3 margin = glm::vec3(OcclusionDefaults::PROXY_INFLATE + OcclusionDefaults::NEAR_PLANE);
+	AABB inflated(worldBounds.Min - margin, worldBounds.Max + margin);
+	if (inflated.Contains(cameraPosition))
+		return OcclusionState::Visible;
+
+	const ObjectQuery& query = _queries[objectID];
+	if (query.Pending)
+		return OcclusionState::Pending;
+
+	if (query.ResultFrame + OcclusionDefaults::MAX_RESULT_AGE < _frame)
+		return OcclusionState::Visible;
+
+	return query.Visible ? OcclusionState::Visible : OcclusionState::Occluded;
+}
+
+void OcclusionQueries::BeginConditionalRender(uint32_t objectID) const
+{
+	// NO_WAIT draws anyway if the result still hasn't landed
+	GL_CHECK(glBeginConditionalRender(_queries[objectID].Query, GL_QUERY_NO_WAIT));
+}
+
+void OcclusionQueries::EndConditionalRender() const
+{
+	GL_CHECK(glEndConditionalRender());
+}
+
+void OcclusionQueries::IssueQueries(const Scene& scene, const std::vector<uint32_t>& objects, const glm::mat4& viewProjection)
+{
+	GL_CHECK(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+	GL_CHECK(glDepthMask(GL_FALSE));
+
+	_proxyShader.Use();
+	GL_CHECK(glBindVertexArray(_proxyVAO));
+
+	for (uint32_t objectID : objects)
+	{
+		ObjectQuery& query = _queries[objectID];
+		// Still waiting on the previous one, reusing the object now would discard it
+		if (query.Pending)
+			continue;
+
+		const AABB& bounds = scene.GetWorldBounds(objectID);
+		glm::vec3 size = bounds.Max - bounds.Min + glm::vec3(2.f * OcclusionDefaults::PROXY_INFLATE);
+		glm::mat4 model = glm::translate(glm::mat4(1.f), bounds.GetCenter());
+		model = glm::scale(model, size);
+		_proxyShader.SetUniformMat4fv("mvp", viewProjection * model);
+
+		GL_CHECK(glBeginQuery(GL_ANY_SAMPLES_PASSED, query.Query));
+		GL_CHECK(glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, (void*)0));
+		GL_CHECK(glEndQuery(GL_ANY_SAMPLES_PASSED));
+
+		query.Pending = true;
+		query.IssuedFrame = _frame;
+		_pending.push_back(objectID);
+	}
+
+	GL_CHECK(glBindVertexArray(0));
+	GL_CHECK(glDepthMask(GL_TRUE));
+	GL_CHECK(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+}
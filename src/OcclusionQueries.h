@@ -0,0 +1,73 @@
+#ifndef OCCLUSION_QUERIES_H
+#define OCCLUSION_QUERIES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "AABB.h"
+#include "Scene.h"
+#include "Shader.h"
+
+#include <cstdint>
+#include <vector>
+
+enum class OcclusionState
+{
+	Visible,
+	Occluded,
+	// A query is in flight, draw under conditional rendering and let the GPU decide
+	Pending
+};
+
+namespace OcclusionDefaults
+{
+	// Proxies are inflated so they don't z-fight with the object they stand for
+	constexpr float PROXY_INFLATE = 0.01f;
+	constexpr float NEAR_PLANE = 0.1f;
+	// Results older than this are stale, e.g. the object left the frustum meanwhile
+	constexpr uint32_t MAX_RESULT_AGE = 2;
+}
+
+// Hardware occlusion queries against AABB proxies. Results are only read back once
+// GL reports them available, so decisions lag one or more frames behind.
+class OcclusionQueries
+{
+private:
+	struct ObjectQuery
+	{
+		unsigned int Query = 0;
+		bool Pending = false;
+		bool Visible = true;
+		uint64_t IssuedFrame = 0;
+		uint64_t ResultFrame = 0;
+	};
+
+	std::vector<ObjectQuery> _queries;
+	std::vector<uint32_t> _pending;
+	uint64_t _frame;
+
+	Shader _proxyShader;
+	unsigned int _proxyVAO;
+	unsigned int _proxyVBO;
+	unsigned int _proxyEBO;
+
+public:
+	OcclusionQueries();
+	~OcclusionQueries();
+
+	OcclusionQueries(const OcclusionQueries&) = delete;
+	OcclusionQueries& operator=(const OcclusionQueries&) = delete;
+
+	void Resize(uint32_t objectCount);
+
+	// Start of frame, picks up every result that is ready without stalling
+	void CollectResults();
+	OcclusionState Classify(uint32_t objectID, const AABB& worldBounds, const glm::vec3& cameraPosition) const;
+
+	void BeginConditionalRender(uint32_t objectID) const;
+	void EndConditionalRender() const;
+
+	// After the scene is drawn, test the proxies of the given objects against its depth
+	void IssueQueries(const Scene& scene, const std::vector<uint32_t>& objects, const glm::mat4& viewProjection);
+};
+
+#endif // OCCLUSION_QUERIES_H
@@ -0,0 +1,70 @@
+#include "PackedTransform.h"
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	uint32_t PackSnorm2x16(float x, float y)
+	{
+		auto toSnorm = [](float value) { return static_cast<uint16_t>(static_cast<int16_t>(std::round(std::clamp(value, -1.f, 1.f) * 32767.f))); };
+		return static_cast<uint32_t>(toSnorm(x)) | (static_cast<uint32_t>(toSnorm(y)) << 16);
+	}
+
+	uint32_t PackHalf2x16(float x, float y)
+	{
+		return static_cast<uint32_t>(FloatToHalf(x)) | (static_cast<uint32_t>(FloatToHalf(y)) << 16);
+	}
+
+	// Unit quaternion (x, y, z, w) of a pure rotation, from the largest of its four components
+	glm::vec4 RotationToQuaternion(const glm::vec3& c0, const glm::vec3& c1, const glm::vec3& c2)
+	{
+		const float trace = c0.x + c1.y + c2.z;
+		glm::vec4 q;
+		if (trace > 0.f)
+		{
+			const float s = std::sqrt(trace + 1.f) * 2.f;
+			q = glm::vec4((c1.z - c2.y) / s, (c2.x - c0.z) / s, (c0.y - c1.x) / s, 0.25f * s);
+		}
+		else if (c0.x > c1.y && c0.x > c2.z)
+		{
+			const float s = std::sqrt(1.f + c0.x - c1.y - c2.z) * 2.f;
+			q = glm::vec4(0.25f * s, (c1.x + c0.y) / s, (c2.x + c0.z) / s, (c1.z - c2.y) / s);
+		}
+		else if (c1.y > c2.z)
+		{
+			const float s = std::sqrt(1.f + c1.y - c0.x - c2.z) * 2.f;
+			q = glm::vec4((c1.x + c0.y) / s, 0.25f * s, (c2.y + c1.z) / s, (c2.x - c0.z) / s);
+		}
+		else
+		{
+			const float s = std::sqrt(1.f + c2.z - c0.x - c1.y) * 2.f;
+			q = glm::vec4((c2.x + c0.z) / s, (c2.y + c1.z) / s, 0.25f * s, (c0.y - c1.x) / s);
+		}
+		return glm::normalize(q);
+	}
+}
+
+PackedTransform PackTransform(const glm::mat4& model)
+{
+	glm::vec3 columns[3] = { glm::vec3(model[0]), glm::vec3(model[1]), glm::vec3(model[2]) };
+	glm::vec3 scale(glm::length(columns[0]), glm::length(columns[1]), glm::length(columns[2]));
+	// A mirroring matrix keeps a proper rotation, the flip moves into the x scale
+	if (glm::dot(glm::cross(columns[0], columns[1]), columns[2]) < 0.f)
+		scale.x = -scale.x;
+	for (int i = 0; i < 3; i++)
+		columns[i] = scale[i] != 0.f ? columns[i] / scale[i] : glm::vec3(i == 0, i == 1, i == 2);
+
+	const glm::vec4 rotation = RotationToQuaternion(columns[0], columns[1], columns[2]);
+
+	PackedTransform packed;
+	packed.Position[0] = model[3].x;
+	packed.Position[1] = model[3].y;
+	packed.Position[2] = model[3].z;
+	packed.RotationXY = PackSnorm2x16(rotation.x, rotation.y);
+	packed.RotationZW = PackSnorm2x16(rotation.z, rotation.w);
+	packed.ScaleXY = PackHalf2x16(scale.x, scale.y);
+	packed.ScaleZ = PackHalf2x16(scale.z, 0.f);
+	return packed;
+}
@@ -0,0 +1,26 @@
+#ifndef PACKED_TRANSFORM_H
+#define PACKED_TRANSFORM_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// GPU side instance transform, 28 bytes against 64 for a glm::mat4. Position stays full
+// float, the rotation is a unit quaternion in four snorm16 and the scale three half floats.
+// Only translate * rotate * scale matrices survive the trip, shear is dropped.
+// Read back by UnpackTransform in resources/shaders/instanced.vert.
+struct PackedTransform
+{
+	float Position[3];
+	// Quaternion x and y, then z and w, as snorm16 pairs
+	uint32_t RotationXY;
+	uint32_t RotationZW;
+	// Half floats, the upper half of ScaleZ is spare
+	uint32_t ScaleXY;
+	uint32_t ScaleZ;
+};
+static_assert(sizeof(PackedTransform) == 28, "PackedTransform is uploaded as is");
+
+PackedTransform PackTransform(const glm::mat4& model);
+
+#endif // PACKED_TRANSFORM_H
@@ -0,0 +1,131 @@
+#include "PixelStagingBuffer.h"
+#include "Logger.h"
+
+#include <algorithm>
+
+using namespace PixelStagingDefaults;
+
+PixelStagingBuffer::PixelStagingBuffer(size_t size /*= PixelStagingDefaults::BUFFER_BYTES*/)
+	: _buffer(0), _mapped(nullptr), _size(size)
+{
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	GL_CHECK(glGenBuffers(1, &_buffer));
+	GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer));
+	GL_CHECK(glBufferStorage(GL_PIXEL_UNPACK_BUFFER, _size, nullptr, flags));
+	_mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, _size, flags));
+	GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
+	// Without the mapping every Allocate fails and decodes go to the heap
+	if (_mapped)
+		_free.push_back({ 0, _size });
+}
+
+PixelStagingBuffer::~PixelStagingBuffer()
+{
+	for (const RetiredBlock& block : _retired)
+		glDeleteSync(block.Fence);
+
+	if (_mapped)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	glDeleteBuffers(1, &_buffer);
+}
+
+bool PixelStagingBuffer::IsSupported()
+{
+	return GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 4);
+}
+
+unsigned char* PixelStagingBuffer::Allocate(size_t size)
+{
+	size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (size_t i = 0; i < _free.size(); i++)
+	{
+		Block& block = _free[i];
+		if (block.Size < size)
+			continue;
+
+		const size_t offset = block.Offset;
+		block.Offset += size;
+		block.Size -= size;
+		if (block.Size == 0)
+			_free.erase(_free.begin() + i);
+		_allocated[offset] = size;
+		return _mapped + offset;
+	}
+	return nullptr;
+}
+
+void PixelStagingBuffer::FreeOffset(size_t offset)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto allocation = _allocated.find(offset);
+	if (allocation == _allocated.end())
+		return;
+	const Block freed = { offset, allocation->second };
+	_allocated.erase(allocation);
+
+	auto next = std::lower_bound(_free.begin(), _free.end(), freed.Offset, [](const Block& block, size_t value) { return block.Offset < value; });
+	next = _free.insert(next, freed);
+	if (next + 1 != _free.end() && next->Offset + next->Size == (next + 1)->Offset)
+	{
+		next->Size += (next + 1)->Size;
+		_free.erase(next + 1);
+	}
+	if (next != _free.begin() && (next - 1)->Offset + (next - 1)->Size == next->Offset)
+	{
+		(next - 1)->Size += next->Size;
+		_free.erase(next);
+	}
+}
+
+void PixelStagingBuffer::Free(const unsigned char* memory)
+{
+	if (Contains(memory))
+		FreeOffset(GetOffset(memory));
+}
+
+void PixelStagingBuffer::Retire(const unsigned char* memory)
+{
+	if (Contains(memory))
+		_retired.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), GetOffset(memory) });
+}
+
+void PixelStagingBuffer::Poll()
+{
+	for (size_t i = 0; i < _retired.size();)
+	{
+		// Zero timeout, the GPU usually finished the copy frames ago
+		GLenum status = glClientWaitSync(_retired[i].Fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		{
+			i++;
+			continue;
+		}
+		glDeleteSync(_retired[i].Fence);
+		FreeOffset(_retired[i].Offset);
+		_retired[i] = _retired.back();
+		_retired.pop_back();
+	}
+}
+
+bool PixelStagingBuffer::Contains(const void* memory) const
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(memory);
+	return _mapped && bytes >= _mapped && bytes < _mapped + _size;
+}
+
+size_t PixelStagingBuffer::GetOffset(const void* memory) const
+{
+	return static_cast<size_t>(static_cast<const unsigned char*>(memory) - _mapped);
+}
+
+unsigned int PixelStagingBuffer::GetBufferID() const
+{
+	return _buffer;
+}
@@ -0,0 +1,74 @@
+#ifndef PIXEL_STAGING_BUFFER_H
+#define PIXEL_STAGING_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace PixelStagingDefaults
+{
+	// A few large textures in flight at once, anything that doesn't fit decodes to the heap
+	constexpr size_t BUFFER_BYTES = 64 * 1024 * 1024;
+	constexpr size_t ALIGNMENT = 256;
+}
+
+// Pixel unpack buffer mapped once for its whole life (GL 4.4+), so decoders on any thread write
+// straight into memory the texture upload reads from. Blocks are handed out first fit and come
+// back either unused through Free or, once an upload read them, through Retire and a fence.
+class PixelStagingBuffer
+{
+private:
+	struct Block
+	{
+		size_t Offset;
+		size_t Size;
+	};
+
+	struct RetiredBlock
+	{
+		GLsync Fence;
+		size_t Offset;
+	};
+
+	unsigned int _buffer;
+	unsigned char* _mapped;
+	size_t _size;
+
+	// Allocate and Free run on workers
+	std::mutex _mutex;
+	// Sorted by offset, neighbours merged
+	std::vector<Block> _free;
+	std::unordered_map<size_t, size_t> _allocated;
+	// GL thread only
+	std::vector<RetiredBlock> _retired;
+
+	void FreeOffset(size_t offset);
+
+public:
+	explicit PixelStagingBuffer(size_t size = PixelStagingDefaults::BUFFER_BYTES);
+	~PixelStagingBuffer();
+
+	PixelStagingBuffer(const PixelStagingBuffer&) = delete;
+	PixelStagingBuffer& operator=(const PixelStagingBuffer&) = delete;
+
+	static bool IsSupported();
+
+	// Any thread, nullptr when no free block is large enough
+	unsigned char* Allocate(size_t size);
+	// Any thread, for a block no upload read from
+	void Free(const unsigned char* memory);
+	// GL thread, right after issuing the upload that reads the block
+	void Retire(const unsigned char* memory);
+	// GL thread, frees retired blocks the GPU is done with
+	void Poll();
+
+	bool Contains(const void* memory) const;
+	// Offset to pass as the pixel pointer while the buffer is bound to GL_PIXEL_UNPACK_BUFFER
+	size_t GetOffset(const void* memory) const;
+	unsigned int GetBufferID() const;
+};
+
+#endif // PIXEL_STAGING_BUFFER_H
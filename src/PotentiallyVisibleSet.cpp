@@ -0,0 +1,345 @@
+#include "PotentiallyVisibleSet.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace PVSDefaults;
+
+namespace
+{
+	constexpr uint32_t PVS_MAGIC = 0x31535650; // "PVS1"
+	constexpr uint32_t PVS_VERSION = 2;
+
+	struct PVSFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t SceneHash;
+		uint32_t ObjectCount;
+		uint32_t WordsPerCell;
+		int32_t CellCounts[3];
+		float CellSize;
+		float GridMin[3];
+		float GridMax[3];
+	};
+
+	// Ray parameter of the first hit, the direction doesn't need to be unit length
+	bool IntersectSphere(const Ray& ray, const glm::vec3& center, float radius, float maxDistance, float& distance)
+	{
+		glm::vec3 offset = ray.Origin - center;
+		float a = glm::dot(ray.Direction, ray.Direction);
+		float b = glm::dot(offset, ray.Direction);
+		float c = glm::dot(offset, offset) - radius * radius;
+		float discriminant = b * b - a * c;
+		if (discriminant < 0.f)
+			return false;
+
+		float root = std::sqrt(discriminant);
+		float t = (-b - root) / a;
+		if (t < 0.f)
+			t = (-b + root) / a;
+		if (t < 0.f || t > maxDistance)
+			return false;
+
+		distance = t;
+		return true;
+	}
+
+	int CountTrailingZeros(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+	int PopCount(uint64_t value)
+	{
+		int count = 0;
+		for (; value; value &= value - 1)
+			count++;
+		return count;
+	}
+
+	// mt19937 output is specified by the standard, distributions are not, so map to floats by hand
+	float NextFloat(std::mt19937& rng)
+	{
+		return (rng() >> 8) * (1.f / 16777216.f);
+	}
+}
+
+PotentiallyVisibleSet::PotentiallyVisibleSet()
+	: _cellCounts(0), _cellSize(CELL_SIZE), _objectCount(0), _wordsPerCell(0), _sceneHash(0)
+{
+}
+
+void PotentiallyVisibleSet::Build(const Scene& scene, ThreadPool& pool, float cellSize /*= PVSDefaults::CELL_SIZE*/)
+{
+	_objectCount = scene.GetObjectCount();
+	_wordsPerCell = (_objectCount + 63) / 64;
+	_sceneHash = scene.ComputeHash();
+	_cellSize = cellSize;
+
+	_gridBounds = AABB();
+	for (uint32_t objectID = 0; objectID < _objectCount; objectID++)
+		_gridBounds.Expand(scene.GetWorldBounds(objectID));
+	_gridBounds.Min -= glm::vec3(GRID_MARGIN);
+	_gridBounds.Max += glm::vec3(GRID_MARGIN);
+
+	glm::vec3 size = _gridBounds.Max - _gridBounds.Min;
+	_cellCounts = glm::ivec3(glm::ceil(size / _cellSize));
+	_gridBounds.Max = _gridBounds.Min + glm::vec3(_cellCounts) * _cellSize;
+
+	_bits.assign(static_cast<size_t>(GetCellCount()) * _wordsPerCell, 0);
+
+	std::vector<glm::mat4> inverseModels(_objectCount);
+	for (uint32_t objectID = 0; objectID < _objectCount; objectID++)
+		inverseModels[objectID] = glm::inverse(scene.GetObject(objectID).Model);
+
+	// Only static objects are baked, moving ones neither get bits nor block the rays
+	std::vector<uint32_t> staticObjects;
+	for (uint32_t objectID = 0; objectID < _objectCount; objectID++)
+	{
+		if (scene.GetObject(objectID).IsStatic)
+			staticObjects.push_back(objectID);
+	}
+
+	// Every cell owns its own words, so jobs never touch the same memory
+	pool.ParallelFor(GetCellCount(), 4, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t cell = begin; cell < end; cell++)
+				BuildCell(scene, inverseModels, staticObjects, cell);
+		});
+}
+
+void PotentiallyVisibleSet::BuildCell(const Scene& scene, const std::vector<glm::mat4>& inverseModels, const std::vector<uint32_t>& staticObjects, uint32_t cell)
+{
+	const BVH& bvh = scene.GetBVH();
+
+	glm::ivec3 coords(cell % _cellCounts.x, (cell / _cellCounts.x) % _cellCounts.y, cell / (_cellCounts.x * _cellCounts.y));
+	glm::vec3 cellMin = _gridBounds.Min + glm::vec3(coords) * _cellSize;
+	AABB cellBounds(cellMin, cellMin + glm::vec3(_cellSize));
+
+	// The camera can stand right next to, or inside, anything overlapping the cell
+	std::vector<uint32_t> overlapping;
+	bvh.QueryAABB(cellBounds, overlapping);
+	for (uint32_t objectID : overlapping)
+	{
+		if (scene.GetObject(objectID).IsStatic)
+			SetVisible(cell, objectID);
+	}
+
+	auto intersector = [&](uint32_t objectID, const Ray& ray, float maxDistance, float& distance)
+		{
+			const SceneObject& object = scene.GetObject(objectID);
+			if (!object.IsStatic)
+				return false;
+
+			// Same parameter t in both spaces, the direction just isn't unit length locally
+			const glm::mat4& inverseModel = inverseModels[objectID];
+			Ray localRay(glm::vec3(inverseModel * glm::vec4(ray.Origin, 1.f)), glm::vec3(inverseModel * glm::vec4(ray.Direction, 0.f)));
+			if (object.MeshID == SceneDefaults::SPHERE_MESH)
+				return IntersectSphere(localRay, object.LocalBounds.GetCenter(), object.LocalBounds.GetExtents().x, maxDistance, distance);
+			return object.LocalBounds.IntersectRay(localRay, maxDistance, distance);
+		};
+
+	std::mt19937 rng(cell * 2654435761u + 1u);
+	const float goldenAngle = glm::pi<float>() * (3.f - std::sqrt(5.f));
+
+	auto castRay = [&](const glm::vec3& origin, const glm::vec3& direction, float maxDistance)
+		{
+			RayHit hit;
+			if (bvh.Raycast(Ray(origin, direction), maxDistance, hit, intersector))
+				SetVisible(cell, hit.ObjectID);
+		};
+
+	for (uint32_t sample = 0; sample < SAMPLES_PER_CELL; sample++)
+	{
+		glm::vec3 origin = cellMin + glm::vec3(NextFloat(rng), NextFloat(rng), NextFloat(rng)) * _cellSize;
+
+		// One ray at a random point of every object not seen yet, so small distant objects
+		// aren't left to chance; whatever the ray hits first is visible either way
+		for (uint32_t objectID : staticObjects)
+		{
+			glm::vec3 jitter(NextFloat(rng), NextFloat(rng), NextFloat(rng));
+			if (IsVisible(static_cast<int>(cell), objectID))
+				continue;
+
+			const AABB& bounds = scene.GetWorldBounds(objectID);
+			glm::vec3 target = bounds.Min + (bounds.Max - bounds.Min) * jitter;
+			glm::vec3 toTarget = target - origin;
+			float distance = glm::length(toTarget);
+			if (distance <= 0.f || distance > MAX_RAY_DISTANCE)
+				continue;
+
+			castRay(origin, toTarget / distance, distance + _cellSize);
+		}
+
+		// Spherical Fibonacci directions, jittered per sample so cells don't share blind spots
+		float jitterZ = NextFloat(rng);
+		float jitterPhi = NextFloat(rng) * glm::two_pi<float>();
+		for (uint32_t i = 0; i < RAYS_PER_SAMPLE; i++)
+		{
+			float z = 1.f - 2.f * (i + jitterZ) / RAYS_PER_SAMPLE;
+			float radius = std::sqrt(std::max(0.f, 1.f - z * z));
+			float phi = i * goldenAngle + jitterPhi;
+			castRay(origin, glm::vec3(radius * std::cos(phi), radius * std::sin(phi), z), MAX_RAY_DISTANCE);
+		}
+	}
+}
+
+void PotentiallyVisibleSet::SetVisible(uint32_t cell, uint32_t objectID)
+{
+	_bits[static_cast<size_t>(cell) * _wordsPerCell + objectID / 64] |= 1ull << (objectID % 64);
+}
+
+bool PotentiallyVisibleSet::Save(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "ERROR::PVS::FILE_NOT_WRITABLE: " << path << "\n";
+		return false;
+	}
+
+	PVSFileHeader header = {};
+	header.Magic = PVS_MAGIC;
+	header.Version = PVS_VERSION;
+	header.SceneHash = _sceneHash;
+	header.ObjectCount = _objectCount;
+	header.WordsPerCell = _wordsPerCell;
+	for (int i = 0; i < 3; i++)
+	{
+		header.CellCounts[i] = _cellCounts[i];
+		header.GridMin[i] = _gridBounds.Min[i];
+		header.GridMax[i] = _gridBounds.Max[i];
+	}
+	header.CellSize = _cellSize;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(_bits.data()), _bits.size() * sizeof(uint64_t));
+	return static_cast<bool>(file);
+}
+
+bool PotentiallyVisibleSet::Load(const std::string& path, const Scene& scene)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	PVSFileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.Magic != PVS_MAGIC || header.Version != PVS_VERSION)
+	{
+		std::cout << "ERROR::PVS::INVALID_FILE: " << path << "\n";
+		return false;
+	}
+
+	if (header.SceneHash != scene.ComputeHash() || header.ObjectCount != scene.GetObjectCount())
+	{
+		std::cout << "ERROR::PVS::STALE_FILE: " << path << " was cooked for a different scene\n";
+		return false;
+	}
+
+	// A wider bitset would hand out object IDs the scene doesn't have, and FindCell divides by the
+	// cell size and clamps to the counts, so both have to describe a real grid
+	const bool validGrid = header.CellCounts[0] > 0 && header.CellCounts[1] > 0 && header.CellCounts[2] > 0
+		&& std::isfinite(header.CellSize) && header.CellSize > 0.f
+		&& header.GridMin[0] <= header.GridMax[0] && header.GridMin[1] <= header.GridMax[1] && header.GridMin[2] <= header.GridMax[2];
+	if (header.WordsPerCell != (header.ObjectCount + 63) / 64 || !validGrid)
+	{
+		std::cout << "ERROR::PVS::INVALID_FILE: " << path << "\n";
+		return false;
+	}
+
+	// Every cell needs its full row of bits, checked before anything is allocated
+	const uint64_t cellCount = static_cast<uint64_t>(header.CellCounts[0]) * header.CellCounts[1] * header.CellCounts[2];
+	file.seekg(0, std::ios::end);
+	const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+	file.seekg(sizeof(header), std::ios::beg);
+	if (cellCount > INT32_MAX || fileSize != sizeof(header) + cellCount * header.WordsPerCell * sizeof(uint64_t))
+	{
+		std::cout << "ERROR::PVS::TRUNCATED_FILE: " << path << "\n";
+		return false;
+	}
+
+	_sceneHash = header.SceneHash;
+	_objectCount = header.ObjectCount;
+	_wordsPerCell = header.WordsPerCell;
+	_cellCounts = glm::ivec3(header.CellCounts[0], header.CellCounts[1], header.CellCounts[2]);
+	_cellSize = header.CellSize;
+	_gridBounds = AABB(glm::vec3(header.GridMin[0], header.GridMin[1], header.GridMin[2]),
+		glm::vec3(header.GridMax[0], header.GridMax[1], header.GridMax[2]));
+
+	_bits.resize(static_cast<size_t>(GetCellCount()) * _wordsPerCell);
+	file.read(reinterpret_cast<char*>(_bits.data()), _bits.size() * sizeof(uint64_t));
+	if (!file)
+	{
+		std::cout << "ERROR::PVS::TRUNCATED_FILE: " << path << "\n";
+		_bits.clear();
+		return false;
+	}
+	return true;
+}
+
+bool PotentiallyVisibleSet::IsEmpty() const
+{
+	return _bits.empty();
+}
+
+int PotentiallyVisibleSet::FindCell(const glm::vec3& position) const
+{
+	if (_bits.empty() || !_gridBounds.Contains(position))
+		return -1;
+
+	glm::ivec3 coords = glm::ivec3((position - _gridBounds.Min) / _cellSize);
+	coords = glm::clamp(coords, glm::ivec3(0), _cellCounts - glm::ivec3(1));
+	return coords.x + coords.y * _cellCounts.x + coords.z * _cellCounts.x * _cellCounts.y;
+}
+
+bool PotentiallyVisibleSet::IsVisible(int cell, uint32_t objectID) const
+{
+	return (_bits[static_cast<size_t>(cell) * _wordsPerCell + objectID / 64] >> (objectID % 64)) & 1ull;
+}
+
+void PotentiallyVisibleSet::GatherVisible(int cell, std::vector<uint32_t>& outObjects) const
+{
+	const uint64_t* words = &_bits[static_cast<size_t>(cell) * _wordsPerCell];
+	for (uint32_t word = 0; word < _wordsPerCell; word++)
+	{
+		for (uint64_t bits = words[word]; bits; bits &= bits - 1)
+			outObjects.push_back(word * 64 + CountTrailingZeros(bits));
+	}
+}
+
+uint32_t PotentiallyVisibleSet::GetCellCount() const
+{
+	return static_cast<uint32_t>(_cellCounts.x * _cellCounts.y * _cellCounts.z);
+}
+
+uint32_t PotentiallyVisibleSet::GetVisibleCount(int cell) const
+{
+	uint32_t count = 0;
+	const uint64_t* words = &_bits[static_cast<size_t>(cell) * _wordsPerCell];
+	for (uint32_t word = 0; word < _wordsPerCell; word++)
+		count += PopCount(words[word]);
+	return count;
+}
+
+size_t PotentiallyVisibleSet::GetMemoryUsage() const
+{
+	return _bits.size() * sizeof(uint64_t);
+}
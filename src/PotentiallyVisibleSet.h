@@ -0,0 +1,62 @@
+#ifndef POTENTIALLY_VISIBLE_SET_H
+#define POTENTIALLY_VISIBLE_SET_H
+
+#include <glm/glm.hpp>
+#include "AABB.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PVSDefaults
+{
+	constexpr float CELL_SIZE = 8.f;
+	constexpr uint32_t SAMPLES_PER_CELL = 8;
+	// Random directions on top of the one targeted ray per object
+	constexpr uint32_t RAYS_PER_SAMPLE = 64;
+	constexpr float MAX_RAY_DISTANCE = 200.f;
+	// Grid padding around the scene so the camera can stand a bit outside it
+	constexpr float GRID_MARGIN = 8.f;
+}
+
+// Per cell bitsets of the static objects visible from somewhere inside the cell.
+// Visibility is sampled with rays against the objects' local boxes, or spheres for the
+// sphere mesh, which is exact for the demo scene; anything no ray reached is treated as hidden.
+// Dynamic objects have no bits, the caller frustum culls them on its own.
+class PotentiallyVisibleSet
+{
+private:
+	AABB _gridBounds;
+	glm::ivec3 _cellCounts;
+	float _cellSize;
+	uint32_t _objectCount;
+	uint32_t _wordsPerCell;
+	uint64_t _sceneHash;
+	std::vector<uint64_t> _bits;
+
+	void BuildCell(const Scene& scene, const std::vector<glm::mat4>& inverseModels, const std::vector<uint32_t>& staticObjects, uint32_t cell);
+	void SetVisible(uint32_t cell, uint32_t objectID);
+
+public:
+	PotentiallyVisibleSet();
+
+	// Cook time, samples every cell on the thread pool
+	void Build(const Scene& scene, ThreadPool& pool, float cellSize = PVSDefaults::CELL_SIZE);
+	bool Save(const std::string& path) const;
+	// Fails when the file is missing or was cooked for a different scene
+	bool Load(const std::string& path, const Scene& scene);
+
+	bool IsEmpty() const;
+	// -1 outside the grid
+	int FindCell(const glm::vec3& position) const;
+	bool IsVisible(int cell, uint32_t objectID) const;
+	void GatherVisible(int cell, std::vector<uint32_t>& outObjects) const;
+
+	uint32_t GetCellCount() const;
+	uint32_t GetVisibleCount(int cell) const;
+	size_t GetMemoryUsage() const;
+};
+
+#endif // POTENTIALLY_VISIBLE_SET_H
@@ -0,0 +1,509 @@
+#ifndef PRIMITIVES_H
+#define PRIMITIVES_H
+
+#include "Mesh.h"
+#include "VertexFormat.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Built-in meshes are generated by the compiler, tessellation is a template argument and the
+// vertices, indices and bounds end up as read only data. Everything has unit size around the origin.
+// The packed GPU vertices are computed at compile time too, a Mesh uploads them from there.
+
+namespace PrimitiveMath
+{
+	constexpr double PI = 3.14159265358979323846;
+
+	// std::sin isn't constexpr before C++26: reduction to [-pi/2, pi/2] then a Taylor series that is exact
+	// in float. The reflection also makes sin(pi) exactly 0, so pole and seam vertices coincide.
+	constexpr double Sin(double x)
+	{
+		while (x > PI)
+			x -= 2.0 * PI;
+		while (x < -PI)
+			x += 2.0 * PI;
+		if (x > 0.5 * PI)
+			x = PI - x;
+		else if (x < -0.5 * PI)
+			x = -PI - x;
+
+		double term = x;
+		double sum = x;
+		for (int n = 1; n < 10; n++)
+		{
+			term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+			sum += term;
+		}
+		return sum;
+	}
+
+	constexpr double Cos(double x)
+	{
+		return Sin(x + 0.5 * PI);
+	}
+}
+
+// Vertex without the glm types, those can't be written in constant expressions
+struct PrimitiveVertex
+{
+	float Position[3];
+	float TexCoord[2];
+	float Normal[3];
+};
+
+template<size_t VertexCount, size_t IndexCount>
+struct PrimitiveMesh
+{
+	std::array<PrimitiveVertex, VertexCount> Vertices;
+	std::array<uint32_t, IndexCount> Indices;
+	float BoundsMin[3];
+	float BoundsMax[3];
+};
+
+template<size_t VertexCount, size_t IndexCount>
+struct PackedPrimitive
+{
+	std::array<PackedVertex, VertexCount> Vertices;
+	std::array<uint32_t, IndexCount> Indices;
+	float BoundsMin[3];
+	float BoundsMax[3];
+};
+
+namespace PrimitiveDetail
+{
+	constexpr PrimitiveVertex MakeVertex(double x, double y, double z, double u, double v, double nx, double ny, double nz)
+	{
+		return {
+			{ static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) },
+			{ static_cast<float>(u), static_cast<float>(v) },
+			{ static_cast<float>(nx), static_cast<float>(ny), static_cast<float>(nz) }
+		};
+	}
+
+	constexpr float Abs(float value)
+	{
+		return value < 0.f ? -value : value;
+	}
+
+	// std::lround, the float is exact in double so adding the half can't round up on its own
+	constexpr long RoundHalfAway(float value)
+	{
+		const double magnitude = value < 0.f ? -static_cast<double>(value) : static_cast<double>(value);
+		const long rounded = static_cast<long>(magnitude + 0.5);
+		return value < 0.f ? -rounded : rounded;
+	}
+
+	constexpr uint32_t RoundHalfEven(double value)
+	{
+		uint32_t rounded = static_cast<uint32_t>(value);
+		const double remainder = value - rounded;
+		if (remainder > 0.5 || (remainder == 0.5 && (rounded & 1u)))
+			rounded++;
+		return rounded;
+	}
+
+	// FloatToHalf without reading the bits, for the finite values a generator produces
+	constexpr uint16_t ToHalf(float value)
+	{
+		const uint32_t sign = value < 0.f ? 0x8000u : 0u;
+		const double magnitude = value < 0.f ? -static_cast<double>(value) : static_cast<double>(value);
+		if (magnitude == 0.0)
+			return static_cast<uint16_t>(sign);
+
+		int exponent = 0;
+		double scaled = magnitude;
+		while (scaled >= 2.0)
+		{
+			scaled *= 0.5;
+			exponent++;
+		}
+		while (scaled < 1.0)
+		{
+			scaled *= 2.0;
+			exponent--;
+		}
+
+		// Below the smallest normal the value is a multiple of 2^-24, a round up to 0x400 is the right normal
+		if (exponent < -14)
+			return static_cast<uint16_t>(sign | RoundHalfEven(magnitude * 16777216.0));
+
+		// A carry out of the mantissa bumps the exponent, past the largest half that is infinity
+		const uint32_t half = (static_cast<uint32_t>(exponent + 15) << 10) + RoundHalfEven((scaled - 1.0) * 1024.0);
+		return static_cast<uint16_t>(sign | (half < 0x7c00u ? half : 0x7c00u));
+	}
+
+	// Same float operations as PackVertices, so the result is bit identical
+	constexpr PackedVertex PackVertex(const PrimitiveVertex& vertex, const float boundsMin[3], const float boundsMax[3])
+	{
+		PackedVertex packed = {};
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float extent = boundsMax[axis] - boundsMin[axis];
+			float value = extent > 0.f ? (vertex.Position[axis] - boundsMin[axis]) / extent : 0.f;
+			value = value < 0.f ? 0.f : (value > 1.f ? 1.f : value);
+			packed.Position[axis] = extent > 0.f ? static_cast<uint16_t>(RoundHalfAway(value * 65535.f)) : 0;
+		}
+		packed.TexCoord[0] = ToHalf(vertex.TexCoord[0]);
+		packed.TexCoord[1] = ToHalf(vertex.TexCoord[1]);
+
+		// Octahedral normal, see EncodeOctahedral
+		const float* n = vertex.Normal;
+		const float length = Abs(n[0]) + Abs(n[1]) + Abs(n[2]);
+		float encoded[2] = { 0.f, 0.f };
+		if (length > 0.f)
+		{
+			const float x = n[0] / length, y = n[1] / length, z = n[2] / length;
+			encoded[0] = z < 0.f ? (1.f - Abs(y)) * (x >= 0.f ? 1.f : -1.f) : x;
+			encoded[1] = z < 0.f ? (1.f - Abs(x)) * (y >= 0.f ? 1.f : -1.f) : y;
+		}
+		for (int i = 0; i < 2; i++)
+		{
+			const float value = encoded[i] < -1.f ? -1.f : (encoded[i] > 1.f ? 1.f : encoded[i]);
+			packed.Normal |= (static_cast<uint32_t>(RoundHalfAway(value * 511.f)) & 0x3ffu) << (10 * i);
+		}
+		return packed;
+	}
+
+	template<size_t VertexCount, size_t IndexCount>
+	constexpr void ComputeBounds(PrimitiveMesh<VertexCount, IndexCount>& mesh)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			mesh.BoundsMin[axis] = mesh.Vertices[0].Position[axis];
+			mesh.BoundsMax[axis] = mesh.Vertices[0].Position[axis];
+		}
+		for (const PrimitiveVertex& vertex : mesh.Vertices)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (vertex.Position[axis] < mesh.BoundsMin[axis])
+					mesh.BoundsMin[axis] = vertex.Position[axis];
+				if (vertex.Position[axis] > mesh.BoundsMax[axis])
+					mesh.BoundsMax[axis] = vertex.Position[axis];
+			}
+		}
+	}
+}
+
+// Four vertices per face so the normals stay flat, every face maps the whole texture
+constexpr PrimitiveMesh<24, 36> GenerateCube()
+{
+	// Normal, then the face's u and v axes with u x v = normal, which makes the corners counter-clockwise from outside
+	constexpr double FACES[6][9] = {
+		{ 1, 0, 0,   0, 0, -1,   0, 1, 0 },
+		{ -1, 0, 0,  0, 0, 1,    0, 1, 0 },
+		{ 0, 1, 0,   1, 0, 0,    0, 0, -1 },
+		{ 0, -1, 0,  1, 0, 0,    0, 0, 1 },
+		{ 0, 0, 1,   1, 0, 0,    0, 1, 0 },
+		{ 0, 0, -1,  -1, 0, 0,   0, 1, 0 }
+	};
+	constexpr double CORNERS[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+
+	PrimitiveMesh<24, 36> mesh = {};
+	for (uint32_t face = 0; face < 6; face++)
+	{
+		const double* n = FACES[face];
+		const double* u = FACES[face] + 3;
+		const double* v = FACES[face] + 6;
+		for (uint32_t corner = 0; corner < 4; corner++)
+		{
+			const double s = CORNERS[corner][0];
+			const double t = CORNERS[corner][1];
+			mesh.Vertices[face * 4 + corner] = PrimitiveDetail::MakeVertex(
+				0.5 * n[0] + (s - 0.5) * u[0] + (t - 0.5) * v[0],
+				0.5 * n[1] + (s - 0.5) * u[1] + (t - 0.5) * v[1],
+				0.5 * n[2] + (s - 0.5) * u[2] + (t - 0.5) * v[2],
+				s, t, n[0], n[1], n[2]);
+		}
+
+		const uint32_t first = face * 4;
+		const uint32_t quad[6] = { first, first + 1, first + 2, first, first + 2, first + 3 };
+		for (uint32_t i = 0; i < 6; i++)
+			mesh.Indices[face * 6 + i] = quad[i];
+	}
+	PrimitiveDetail::ComputeBounds(mesh);
+	return mesh;
+}
+
+// Latitude/longitude sphere of diameter 1, the seam and poles get their own vertices for the uvs
+template<uint32_t Segments, uint32_t Rings>
+constexpr PrimitiveMesh<(Segments + 1) * (Rings + 1), 6 * Segments * (Rings - 1)> GenerateUVSphere()
+{
+	static_assert(Segments >= 3 && Rings >= 2, "A sphere needs at least 3 segments and 2 rings");
+
+	PrimitiveMesh<(Segments + 1) * (Rings + 1), 6 * Segments * (Rings - 1)> mesh = {};
+
+	// One sine and cosine per column and per row, the vertices only multiply them
+	double segmentSin[Segments + 1] = {};
+	double segmentCos[Segments + 1] = {};
+	for (uint32_t segment = 0; segment <= Segments; segment++)
+	{
+		const double phi = 2.0 * PrimitiveMath::PI * segment / Segments;
+		segmentSin[segment] = PrimitiveMath::Sin(phi);
+		segmentCos[segment] = PrimitiveMath::Cos(phi);
+	}
+
+	size_t vertex = 0;
+	for (uint32_t ring = 0; ring <= Rings; ring++)
+	{
+		const double v = static_cast<double>(ring) / Rings;
+		const double sinTheta = PrimitiveMath::Sin(v * PrimitiveMath::PI);
+		const double cosTheta = PrimitiveMath::Cos(v * PrimitiveMath::PI);
+		for (uint32_t segment = 0; segment <= Segments; segment++)
+		{
+			const double nx = sinTheta * segmentCos[segment];
+			const double nz = -sinTheta * segmentSin[segment];
+			mesh.Vertices[vertex++] = PrimitiveDetail::MakeVertex(0.5 * nx, 0.5 * cosTheta, 0.5 * nz,
+				static_cast<double>(segment) / Segments, 1.0 - v, nx, cosTheta, nz);
+		}
+	}
+
+	const uint32_t stride = Segments + 1;
+	size_t index = 0;
+	for (uint32_t ring = 0; ring < Rings; ring++)
+	{
+		for (uint32_t segment = 0; segment < Segments; segment++)
+		{
+			const uint32_t a = ring * stride + segment;
+			const uint32_t b = a + stride;
+
+			// The pole rows would only produce degenerate halves
+			if (ring != 0)
+			{
+				mesh.Indices[index++] = a;
+				mesh.Indices[index++] = b;
+				mesh.Indices[index++] = a + 1;
+			}
+			if (ring != Rings - 1)
+			{
+				mesh.Indices[index++] = a + 1;
+				mesh.Indices[index++] = b;
+				mesh.Indices[index++] = b + 1;
+			}
+		}
+	}
+	PrimitiveDetail::ComputeBounds(mesh);
+	return mesh;
+}
+
+// Unit square grid in the xz plane facing +y
+template<uint32_t CellsX, uint32_t CellsZ>
+constexpr PrimitiveMesh<(CellsX + 1) * (CellsZ + 1), 6 * CellsX * CellsZ> GeneratePlane()
+{
+	static_assert(CellsX >= 1 && CellsZ >= 1, "A plane needs at least one cell");
+
+	PrimitiveMesh<(CellsX + 1) * (CellsZ + 1), 6 * CellsX * CellsZ> mesh = {};
+	for (uint32_t z = 0; z <= CellsZ; z++)
+	{
+		for (uint32_t x = 0; x <= CellsX; x++)
+		{
+			const double u = static_cast<double>(x) / CellsX;
+			const double v = static_cast<double>(z) / CellsZ;
+			mesh.Vertices[z * (CellsX + 1) + x] = PrimitiveDetail::MakeVertex(u - 0.5, 0.0, v - 0.5, u, 1.0 - v, 0.0, 1.0, 0.0);
+		}
+	}
+
+	size_t index = 0;
+	for (uint32_t z = 0; z < CellsZ; z++)
+	{
+		for (uint32_t x = 0; x < CellsX; x++)
+		{
+			const uint32_t a = z * (CellsX + 1) + x;
+			const uint32_t c = a + CellsX + 1;
+			const uint32_t quad[6] = { a, c, a + 1, a + 1, c, c + 1 };
+			for (uint32_t i = 0; i < 6; i++)
+				mesh.Indices[index++] = quad[i];
+		}
+	}
+	PrimitiveDetail::ComputeBounds(mesh);
+	return mesh;
+}
+
+// Capped cylinder of diameter and height 1 along y. The side has a seam column, the caps a center vertex each.
+template<uint32_t Segments>
+constexpr PrimitiveMesh<4 * Segments + 4, 12 * Segments> GenerateCylinder()
+{
+	static_assert(Segments >= 3, "A cylinder needs at least 3 segments");
+
+	PrimitiveMesh<4 * Segments + 4, 12 * Segments> mesh = {};
+	double segmentSin[Segments + 1] = {};
+	double segmentCos[Segments + 1] = {};
+	for (uint32_t segment = 0; segment <= Segments; segment++)
+	{
+		const double phi = 2.0 * PrimitiveMath::PI * segment / Segments;
+		segmentSin[segment] = PrimitiveMath::Sin(phi);
+		segmentCos[segment] = PrimitiveMath::Cos(phi);
+	}
+
+	// Side: bottom row then top row
+	const uint32_t sideStride = Segments + 1;
+	for (uint32_t row = 0; row < 2; row++)
+	{
+		for (uint32_t segment = 0; segment <= Segments; segment++)
+		{
+			const double x = segmentCos[segment];
+			const double z = -segmentSin[segment];
+			mesh.Vertices[row * sideStride + segment] = PrimitiveDetail::MakeVertex(0.5 * x, row - 0.5, 0.5 * z,
+				static_cast<double>(segment) / Segments, row, x, 0.0, z);
+		}
+	}
+
+	// Caps: center then the rim, bottom first
+	const uint32_t capBase[2] = { 2 * sideStride, 2 * sideStride + Segments + 1 };
+	for (uint32_t cap = 0; cap < 2; cap++)
+	{
+		const double y = cap - 0.5;
+		const double ny = cap == 0 ? -1.0 : 1.0;
+		mesh.Vertices[capBase[cap]] = PrimitiveDetail::MakeVertex(0.0, y, 0.0, 0.5, 0.5, 0.0, ny, 0.0);
+		for (uint32_t segment = 0; segment < Segments; segment++)
+		{
+			const double x = segmentCos[segment];
+			const double z = -segmentSin[segment];
+			mesh.Vertices[capBase[cap] + 1 + segment] = PrimitiveDetail::MakeVertex(0.5 * x, y, 0.5 * z,
+				0.5 + 0.5 * x, 0.5 - 0.5 * z, 0.0, ny, 0.0);
+		}
+	}
+
+	size_t index = 0;
+	for (uint32_t segment = 0; segment < Segments; segment++)
+	{
+		const uint32_t bottom = segment;
+		const uint32_t top = sideStride + segment;
+		const uint32_t side[6] = { bottom, bottom + 1, top, top, bottom + 1, top + 1 };
+		for (uint32_t i = 0; i < 6; i++)
+			mesh.Indices[index++] = side[i];
+	}
+	for (uint32_t cap = 0; cap < 2; cap++)
+	{
+		const uint32_t center = capBase[cap];
+		for (uint32_t segment = 0; segment < Segments; segment++)
+		{
+			const uint32_t current = center + 1 + segment;
+			const uint32_t next = center + 1 + (segment + 1) % Segments;
+			// The bottom cap faces down, so its fan turns the other way
+			mesh.Indices[index++] = center;
+			mesh.Indices[index++] = cap == 0 ? next : current;
+			mesh.Indices[index++] = cap == 0 ? current : next;
+		}
+	}
+	PrimitiveDetail::ComputeBounds(mesh);
+	return mesh;
+}
+
+template<size_t VertexCount, size_t IndexCount>
+constexpr PackedPrimitive<VertexCount, IndexCount> PackPrimitive(const PrimitiveMesh<VertexCount, IndexCount>& primitive)
+{
+	PackedPrimitive<VertexCount, IndexCount> packed = {};
+	for (size_t i = 0; i < VertexCount; i++)
+		packed.Vertices[i] = PrimitiveDetail::PackVertex(primitive.Vertices[i], primitive.BoundsMin, primitive.BoundsMax);
+	packed.Indices = primitive.Indices;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		packed.BoundsMin[axis] = primitive.BoundsMin[axis];
+		packed.BoundsMax[axis] = primitive.BoundsMax[axis];
+	}
+	return packed;
+}
+
+namespace Primitives
+{
+	inline constexpr PrimitiveMesh<24, 36> CUBE = GenerateCube();
+	static_assert(CUBE.BoundsMin[0] == -0.5f && CUBE.BoundsMax[1] == 0.5f, "The cube has unit size");
+	inline constexpr auto PACKED_CUBE = PackPrimitive(CUBE);
+
+	template<uint32_t Segments, uint32_t Rings>
+	inline constexpr auto UV_SPHERE = GenerateUVSphere<Segments, Rings>();
+	template<uint32_t Segments, uint32_t Rings>
+	inline constexpr auto PACKED_UV_SPHERE = PackPrimitive(UV_SPHERE<Segments, Rings>);
+
+	template<uint32_t CellsX, uint32_t CellsZ>
+	inline constexpr auto PLANE = GeneratePlane<CellsX, CellsZ>();
+	template<uint32_t CellsX, uint32_t CellsZ>
+	inline constexpr auto PACKED_PLANE = PackPrimitive(PLANE<CellsX, CellsZ>);
+
+	template<uint32_t Segments>
+	inline constexpr auto CYLINDER = GenerateCylinder<Segments>();
+	template<uint32_t Segments>
+	inline constexpr auto PACKED_CYLINDER = PackPrimitive(CYLINDER<Segments>);
+}
+
+// What Mesh uploads as is, no copy and nothing on the heap
+template<size_t VertexCount, size_t IndexCount>
+PackedMeshView GetPackedView(const PackedPrimitive<VertexCount, IndexCount>& primitive)
+{
+	const AABB bounds(glm::vec3(primitive.BoundsMin[0], primitive.BoundsMin[1], primitive.BoundsMin[2]),
+		glm::vec3(primitive.BoundsMax[0], primitive.BoundsMax[1], primitive.BoundsMax[2]));
+	return { primitive.Vertices.data(), static_cast<uint32_t>(VertexCount), primitive.Indices.data(), static_cast<uint32_t>(IndexCount),
+		ComputeQuantization(bounds), bounds };
+}
+
+inline PackedMeshView GetCubeView()
+{
+	return GetPackedView(Primitives::PACKED_CUBE);
+}
+
+template<uint32_t Segments, uint32_t Rings>
+PackedMeshView GetUVSphereView()
+{
+	return GetPackedView(Primitives::PACKED_UV_SPHERE<Segments, Rings>);
+}
+
+template<uint32_t CellsX, uint32_t CellsZ>
+PackedMeshView GetPlaneView()
+{
+	return GetPackedView(Primitives::PACKED_PLANE<CellsX, CellsZ>);
+}
+
+template<uint32_t Segments>
+PackedMeshView GetCylinderView()
+{
+	return GetPackedView(Primitives::PACKED_CYLINDER<Segments>);
+}
+
+// Copies into the heap backed form the LOD, meshlet and vertex cache tools work on, only for
+// meshes that go through them
+template<size_t VertexCount, size_t IndexCount>
+MeshData ToMeshData(const PrimitiveMesh<VertexCount, IndexCount>& primitive)
+{
+	MeshData data;
+	data.Vertices.resize(VertexCount);
+	for (size_t i = 0; i < VertexCount; i++)
+	{
+		const PrimitiveVertex& source = primitive.Vertices[i];
+		data.Vertices[i].Position = glm::vec3(source.Position[0], source.Position[1], source.Position[2]);
+		data.Vertices[i].TexCoord = glm::vec2(source.TexCoord[0], source.TexCoord[1]);
+		data.Vertices[i].Normal = glm::vec3(source.Normal[0], source.Normal[1], source.Normal[2]);
+	}
+	data.Indices.assign(primitive.Indices.begin(), primitive.Indices.end());
+	data.Bounds = AABB(glm::vec3(primitive.BoundsMin[0], primitive.BoundsMin[1], primitive.BoundsMin[2]),
+		glm::vec3(primitive.BoundsMax[0], primitive.BoundsMax[1], primitive.BoundsMax[2]));
+	data.LODs.push_back({ 0, static_cast<uint32_t>(IndexCount), 0.f });
+	return data;
+}
+
+inline MeshData CreateCube()
+{
+	return ToMeshData(Primitives::CUBE);
+}
+
+template<uint32_t Segments, uint32_t Rings>
+MeshData CreateUVSphere()
+{
+	return ToMeshData(Primitives::UV_SPHERE<Segments, Rings>);
+}
+
+template<uint32_t CellsX, uint32_t CellsZ>
+MeshData CreatePlane()
+{
+	return ToMeshData(Primitives::PLANE<CellsX, CellsZ>);
+}
+
+template<uint32_t Segments>
+MeshData CreateCylinder()
+{
+	return ToMeshData(Primitives::CYLINDER<Segments>);
+}
+
+#endif // PRIMITIVES_H
@@ -0,0 +1,145 @@
+#include "Scene.h"
+#include "Utilities.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+Scene::Scene()
+	: _isIndexBuilt(false)
+{
+}
+
+uint32_t Scene::AddObject(const glm::mat4& model, const AABB& localBounds, uint32_t meshID, bool isStatic)
+{
+	SceneObject object;
+	object.Model = model;
+	object.LocalBounds = localBounds;
+	object.MeshID = meshID;
+	object.IsStatic = isStatic;
+	_objects.push_back(object);
+
+	// Adding objects invalidates the tree topology
+	_isIndexBuilt = false;
+	return static_cast<uint32_t>(_objects.size() - 1);
+}
+
+void Scene::SetTransform(uint32_t objectID, const glm::mat4& model)
+{
+	SceneObject& object = _objects[objectID];
+	object.Model = model;
+
+	if (_isIndexBuilt)
+		_bvh.UpdateObject(objectID, object.LocalBounds.Transformed(model));
+}
+
+void Scene::BuildIndex()
+{
+	std::vector<AABB> worldBounds;
+	worldBounds.reserve(_objects.size());
+	for (const SceneObject& object : _objects)
+		worldBounds.push_back(object.LocalBounds.Transformed(object.Model));
+
+	_bvh.Build(worldBounds);
+	_isIndexBuilt = true;
+}
+
+void Scene::Update(ThreadPool& pool)
+{
+	if (!_isIndexBuilt)
+		BuildIndex();
+
+	_bvh.Update(pool);
+}
+
+void Scene::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& outObjects) const
+{
+	_bvh.QueryFrustum(frustum, outObjects);
+}
+
+const SceneObject& Scene::GetObject(uint32_t objectID) const
+{
+	return _objects[objectID];
+}
+
+const AABB& Scene::GetWorldBounds(uint32_t objectID) const
+{
+	return _bvh.GetObjectBounds(objectID);
+}
+
+uint32_t Scene::GetObjectCount() const
+{
+	return static_cast<uint32_t>(_objects.size());
+}
+
+const BVH& Scene::GetBVH() const
+{
+	return _bvh;
+}
+
+uint64_t Scene::ComputeHash() const
+{
+	// FNV-1a over the world bounds of every object
+	uint64_t hash = FNV_OFFSET_BASIS;
+	uint32_t count = GetObjectCount();
+	MixHash(hash, &count, sizeof(count));
+	for (uint32_t objectID = 0; objectID < count; objectID++)
+	{
+		const AABB& bounds = GetWorldBounds(objectID);
+		MixHash(hash, &bounds.Min, sizeof(bounds.Min));
+		MixHash(hash, &bounds.Max, sizeof(bounds.Max));
+	}
+	return hash;
+}
+
+void BuildDemoScene(Scene& scene)
+{
+	const glm::vec3 cubePositions[] = {
+		glm::vec3(0.f, 0.f, 0.f),
+		glm::vec3(2.0f, 5.0f, -10.0f),
+		glm::vec3(-1.5f, -2.2f, -2.5f),
+		glm::vec3(-3.8f, -2.0f, -12.3f),
+		glm::vec3(2.4f, -0.4f, -3.5f),
+		glm::vec3(-1.7f, 3.0f, -7.5f),
+		glm::vec3(1.3f, -2.0f, -9.5f),
+		glm::vec3(3.5f, 4.0f, -2.5f),
+		glm::vec3(1.5f, 2.2f, -1.5f),
+		glm::vec3(-1.3f, 1.0f, -1.5f)
+	};
+
+	for (unsigned int i = 0; i < 10; i++)
+	{
+		glm::mat4 model = glm::mat4(1.f);
+		model = glm::translate(model, cubePositions[i]);
+		float angle = 25.f * i;
+		model = glm::rotate(model, glm::radians(angle), glm::vec3(1.f, 1.f, 0.5f));
+		scene.AddObject(model, SceneDefaults::CUBE_BOUNDS, SceneDefaults::CUBE_MESH, false);
+	}
+
+	// Columns of stacked cubes, heights come from a hash so every run builds the same layout
+	constexpr int COLUMNS_X = 33;
+	constexpr int COLUMNS_Z = 40;
+	constexpr float SPACING = 3.f;
+	constexpr float SPHERE_SCALE = 2.f;
+	for (int x = 0; x < COLUMNS_X; x++)
+	{
+		for (int z = 0; z < COLUMNS_Z; z++)
+		{
+			unsigned int hash = (static_cast<unsigned int>(x) * 73856093u) ^ (static_cast<unsigned int>(z) * 19349663u);
+			int height = 1 + static_cast<int>(hash % 6);
+
+			glm::vec3 base((x - COLUMNS_X / 2) * SPACING, -6.f, -20.f - z * SPACING);
+			for (int y = 0; y < height; y++)
+			{
+				glm::mat4 model = glm::translate(glm::mat4(1.f), base + glm::vec3(0.f, static_cast<float>(y), 0.f));
+				scene.AddObject(model, SceneDefaults::CUBE_BOUNDS);
+			}
+
+			// Dense meshes to exercise LOD selection
+			if ((hash >> 8) % 5 == 0)
+			{
+				glm::vec3 center = base + glm::vec3(0.f, height - 0.5f + SPHERE_SCALE * 0.5f, 0.f);
+				glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.f), center), glm::vec3(SPHERE_SCALE));
+				scene.AddObject(model, SceneDefaults::CUBE_BOUNDS, SceneDefaults::SPHERE_MESH);
+			}
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+#include "AABB.h"
+#include "BVH.h"
+#include "Frustum.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <vector>
+
+struct SceneObject
+{
+	glm::mat4 Model = glm::mat4(1.f);
+	// Mesh space bounds, the world ones live in the BVH
+	AABB LocalBounds;
+	// Index into the renderer's mesh table
+	uint32_t MeshID = 0;
+	// Static objects never move and may be baked into cooked data (PVS, HLOD proxies)
+	bool IsStatic = true;
+};
+
+class Scene
+{
+private:
+	std::vector<SceneObject> _objects;
+	BVH _bvh;
+	bool _isIndexBuilt;
+
+public:
+	Scene();
+
+	uint32_t AddObject(const glm::mat4& model, const AABB& localBounds, uint32_t meshID = 0, bool isStatic = true);
+	// Moves an object, the BVH refits on the next Update()
+	void SetTransform(uint32_t objectID, const glm::mat4& model);
+
+	// Full build, call once after populating the scene
+	void BuildIndex();
+	// Per-frame refit and background rebuild bookkeeping
+	void Update(ThreadPool& pool);
+
+	void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& outObjects) const;
+
+	const SceneObject& GetObject(uint32_t objectID) const;
+	const AABB& GetWorldBounds(uint32_t objectID) const;
+	uint32_t GetObjectCount() const;
+	const BVH& GetBVH() const;
+
+	// Changes whenever an object is added or moved, cooked files use it to detect a stale scene
+	uint64_t ComputeHash() const;
+};
+
+namespace SceneDefaults
+{
+	// Unit cube the demo meshes are built around
+	const AABB CUBE_BOUNDS = AABB(glm::vec3(-0.5f), glm::vec3(0.5f));
+
+	// Demo mesh table, the sphere has unit diameter so it shares the cube's bounds
+	constexpr uint32_t CUBE_MESH = 0;
+	constexpr uint32_t SPHERE_MESH = 1;
+	constexpr uint32_t DEMO_MESH_COUNT = 2;
+	constexpr uint32_t SPHERE_SEGMENTS = 64;
+	constexpr uint32_t SPHERE_RINGS = 32;
+}
+
+// The ten tutorial cubes (dynamic, they can be animated) plus a block of stacked columns behind them, some topped with a sphere
+void BuildDemoScene(Scene& scene);
+
+#endif // SCENE_H
@@ -2,57 +2,100 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "VertexFormat.h"
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+namespace
 {
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::fstream vShaderFile;
-	std::fstream fShaderFile;
+	// Guards against include cycles
+	constexpr int MAX_INCLUDE_DEPTH = 8;
+
+	// Uniform blocks shared by many programs get fixed binding points, GL 3.3 can't set them in GLSL
+	void BindUniformBlocks(unsigned int program)
+	{
+		unsigned int block = glGetUniformBlockIndex(program, VertexFormatDefaults::QUANTIZATION_BLOCK);
+		if (block != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, block, VertexFormatDefaults::QUANTIZATION_BINDING);
+	}
+}
 
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+std::string Shader::ReadShaderFile(const std::string& path, int depth /*= 0*/)
+{
+	std::fstream shaderFile;
+	shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
+	std::string source;
 	try
 	{
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
-		std::stringstream vShaderStream, fShaderStream;
-		
-		// Read file's buffer contents into streams
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
+		shaderFile.open(path);
+		std::stringstream shaderStream;
 
-		vShaderFile.close();
-		fShaderFile.close();
+		// Read file's buffer contents into streams
+		shaderStream << shaderFile.rdbuf();
+		shaderFile.close();
 
 		// Convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
+		source = shaderStream.str();
 	}
 	catch (std::ifstream::failure& err)
 	{
-		std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << err.what() << "\n";
+		std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << " " << err.what() << "\n";
+		return std::string();
 	}
 
-	const char* vShaderCode = vertexCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
+	// Splice included files in place, GLSL has no include of its own
+	const std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+	std::istringstream lines(source);
+	std::string line;
+	std::string expanded;
+	while (std::getline(lines, line))
+	{
+		size_t directive = line.find("#include");
+		if (directive == std::string::npos || line.find_first_not_of(" \t") != directive)
+		{
+			expanded += line;
+			expanded += '\n';
+			continue;
+		}
+
+		size_t open = line.find('"', directive);
+		size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+		if (close == std::string::npos)
+		{
+			std::cerr << "ERROR::SHADER::INVALID_INCLUDE: " << path << ": " << line << "\n";
+			continue;
+		}
+		if (depth >= MAX_INCLUDE_DEPTH)
+		{
+			std::cerr << "ERROR::SHADER::INCLUDE_TOO_DEEP: " << path << ": " << line << "\n";
+			continue;
+		}
+		expanded += ReadShaderFile(directory + line.substr(open + 1, close - open - 1), depth + 1);
+	}
+	return expanded;
+}
 
-	// Vertex and fragment shader source code
-	// This shader processes vertex data for rendering
-	unsigned int vertex;
-	vertex = glCreateShader(GL_VERTEX_SHADER);
+unsigned int Shader::CompileShader(const std::string& source, ShaderType type)
+{
+	const char* shaderCode = source.c_str();
+
+	unsigned int shader = glCreateShader(static_cast<GLenum>(type));
 	// Attach shader source code to the actual shader object and compile
-	glShaderSource(vertex, 1, &vShaderCode, nullptr);
-	glCompileShader(vertex);
+	glShaderSource(shader, 1, &shaderCode, nullptr);
+	glCompileShader(shader);
 	// Check if shader compilation was successful
-	GL::LOG::LogShaderCompilation(vertex, ShaderType::Vertex);
+	GL::LOG::LogShaderCompilation(shader, type);
+	return shader;
+}
 
-	unsigned int fragment;
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &fShaderCode, nullptr);
-	glCompileShader(fragment);
-	GL::LOG::LogShaderCompilation(fragment, ShaderType::Fragment);
+Shader::Shader(const char* vertexPath, const char* fragmentPath)
+{
+	std::string vertexCode = ReadShaderFile(vertexPath);
+	std::string fragmentCode = ReadShaderFile(fragmentPath);
+
+	// Vertex and fragment shader source code
+	// This shader processes vertex data for rendering
+	unsigned int vertex = CompileShader(vertexCode, ShaderType::Vertex);
+	unsigned int fragment = CompileShader(fragmentCode, ShaderType::Fragment);
 
 	// Link shaders
 	_ID = glCreateProgram();
@@ -60,12 +103,48 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 	glAttachShader(_ID, fragment);
 	glLinkProgram(_ID);
 	GL::LOG::LogShaderProgramLinking(_ID);
+	BindUniformBlocks(_ID);
 
 	// After linking the shaders we no longer need them
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
 }
 
+Shader::Shader(const char* vertexPath, const char* tessControlPath, const char* tessEvaluationPath, const char* fragmentPath)
+{
+	unsigned int vertex = CompileShader(ReadShaderFile(vertexPath), ShaderType::Vertex);
+	unsigned int tessControl = CompileShader(ReadShaderFile(tessControlPath), ShaderType::TessControl);
+	unsigned int tessEvaluation = CompileShader(ReadShaderFile(tessEvaluationPath), ShaderType::TessEvaluation);
+	unsigned int fragment = CompileShader(ReadShaderFile(fragmentPath), ShaderType::Fragment);
+
+	_ID = glCreateProgram();
+	glAttachShader(_ID, vertex);
+	glAttachShader(_ID, tessControl);
+	glAttachShader(_ID, tessEvaluation);
+	glAttachShader(_ID, fragment);
+	glLinkProgram(_ID);
+	GL::LOG::LogShaderProgramLinking(_ID);
+	BindUniformBlocks(_ID);
+
+	glDeleteShader(vertex);
+	glDeleteShader(tessControl);
+	glDeleteShader(tessEvaluation);
+	glDeleteShader(fragment);
+}
+
+Shader::Shader(const char* computePath)
+{
+	std::string computeCode = ReadShaderFile(computePath);
+	unsigned int compute = CompileShader(computeCode, ShaderType::Compute);
+
+	_ID = glCreateProgram();
+	glAttachShader(_ID, compute);
+	glLinkProgram(_ID);
+	GL::LOG::LogShaderProgramLinking(_ID);
+
+	glDeleteShader(compute);
+}
+
 Shader::~Shader()
 {
 	glUseProgram(0);
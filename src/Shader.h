@@ -16,10 +16,21 @@ private:
 	// Program id
 	unsigned int _ID;
 
+	// Expands #include "file" lines, relative to the including file
+	static std::string ReadShaderFile(const std::string& path, int depth = 0);
+	static unsigned int CompileShader(const std::string& source, ShaderType type);
+
 public:
 	Shader(const char* vertexPath, const char* fragmentPath);
+	// Tessellated program, needs a 4.0 context
+	Shader(const char* vertexPath, const char* tessControlPath, const char* tessEvaluationPath, const char* fragmentPath);
+	// Compute only program, needs a 4.3 context
+	explicit Shader(const char* computePath);
 	~Shader();
 
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
+
 	// Use/activate the shader
 	void Use() const;
 
@@ -0,0 +1,346 @@
+#include "SoftwareOcclusion.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace SoftwareOcclusionDefaults;
+
+namespace
+{
+	constexpr uint64_t FULL_MASK = ~0ull;
+	constexpr int TILE_PIXELS = TILE_SIZE * TILE_SIZE;
+
+	float EdgeFunction(const glm::vec2& a, const glm::vec2& b, float x, float y)
+	{
+		return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+	}
+
+	// Signed distance to the near plane in clip space, z >= -w is in front of it
+	float NearDistance(const glm::vec4& v)
+	{
+		return v.z + v.w;
+	}
+}
+
+OccluderMesh CreateOccluderMesh(const MeshData& data, uint32_t lod)
+{
+	OccluderMesh mesh;
+	mesh.Positions.reserve(data.Vertices.size());
+	for (const Vertex& vertex : data.Vertices)
+		mesh.Positions.push_back(vertex.Position);
+
+	const MeshLOD& range = data.LODs[lod];
+	mesh.Indices.assign(data.Indices.begin() + range.FirstIndex, data.Indices.begin() + range.FirstIndex + range.IndexCount);
+	return mesh;
+}
+
+SoftwareOcclusion::SoftwareOcclusion()
+	: _depth(WIDTH * HEIGHT, 1.f), _coverage(TILES_X * TILES_Y, 0), _tileMaxDepth(TILES_X * TILES_Y, 1.f),
+	_viewProjection(1.f)
+{
+}
+
+void SoftwareOcclusion::SelectOccluders(const Scene& scene, const std::vector<uint32_t>& candidates, const glm::vec3& cameraPosition)
+{
+	struct Candidate
+	{
+		uint32_t ObjectID;
+		float Size;
+	};
+
+	std::vector<Candidate> ranked;
+	ranked.reserve(candidates.size());
+	for (uint32_t objectID : candidates)
+	{
+		const AABB& bounds = scene.GetWorldBounds(objectID);
+		float distance = std::max(glm::length(bounds.GetCenter() - cameraPosition), NEAR_CLIP);
+		float size = glm::length(bounds.GetExtents()) / distance;
+		if (size >= MIN_OCCLUDER_SIZE)
+			ranked.push_back({ objectID, size });
+	}
+
+	size_t count = std::min<size_t>(ranked.size(), MAX_OCCLUDERS);
+	// Ties broken by ID so the selection never depends on candidate order
+	std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(),
+		[](const Candidate& a, const Candidate& b)
+		{
+			return a.Size != b.Size ? a.Size > b.Size : a.ObjectID < b.ObjectID;
+		});
+
+	_occluders.clear();
+	for (size_t i = 0; i < count; i++)
+		_occluders.push_back(ranked[i].ObjectID);
+}
+
+void SoftwareOcclusion::AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+	const glm::vec4* clip[3] = { &a, &b, &c };
+
+	ScreenTriangle triangle;
+	float z[3];
+	for (int i = 0; i < 3; i++)
+	{
+		float invW = 1.f / clip[i]->w;
+		triangle.Vertices[i] = glm::vec2((clip[i]->x * invW * 0.5f + 0.5f) * WIDTH, (clip[i]->y * invW * 0.5f + 0.5f) * HEIGHT);
+		z[i] = clip[i]->z * invW * 0.5f + 0.5f;
+	}
+
+	glm::vec2 e1 = triangle.Vertices[1] - triangle.Vertices[0];
+	glm::vec2 e2 = triangle.Vertices[2] - triangle.Vertices[0];
+	float area = e1.x * e2.y - e2.x * e1.y;
+	if (std::fabs(area) < 1e-8f)
+		return;
+
+	// Both windings are rasterized, keep them counter-clockwise so inside means all edges >= 0
+	if (area < 0.f)
+	{
+		std::swap(triangle.Vertices[1], triangle.Vertices[2]);
+		std::swap(z[1], z[2]);
+		std::swap(e1, e2);
+		area = -area;
+	}
+
+	float dz1 = z[1] - z[0];
+	float dz2 = z[2] - z[0];
+	triangle.DZDX = (dz1 * e2.y - dz2 * e1.y) / area;
+	triangle.DZDY = (dz2 * e1.x - dz1 * e2.x) / area;
+	triangle.Z0 = z[0] - triangle.DZDX * triangle.Vertices[0].x - triangle.DZDY * triangle.Vertices[0].y;
+
+	glm::vec2 minimum = glm::min(triangle.Vertices[0], glm::min(triangle.Vertices[1], triangle.Vertices[2]));
+	glm::vec2 maximum = glm::max(triangle.Vertices[0], glm::max(triangle.Vertices[1], triangle.Vertices[2]));
+	triangle.MinX = std::max(0, static_cast<int>(std::floor(minimum.x)));
+	triangle.MinY = std::max(0, static_cast<int>(std::floor(minimum.y)));
+	triangle.MaxX = std::min(WIDTH - 1, static_cast<int>(std::ceil(maximum.x)));
+	triangle.MaxY = std::min(HEIGHT - 1, static_cast<int>(std::ceil(maximum.y)));
+	if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+		return;
+
+	_triangles.push_back(triangle);
+}
+
+void SoftwareOcclusion::Render(const Scene& scene, const std::vector<OccluderMesh>& meshes, const glm::mat4& viewProjection, ThreadPool& pool)
+{
+	_viewProjection = viewProjection;
+	_triangles.clear();
+
+	std::vector<glm::vec4> clipPositions;
+	for (uint32_t objectID : _occluders)
+	{
+		const SceneObject& object = scene.GetObject(objectID);
+		const OccluderMesh& mesh = meshes[object.MeshID];
+		clipPositions.resize(mesh.Positions.size());
+
+		glm::mat4 mvp = viewProjection * object.Model;
+		for (size_t i = 0; i < mesh.Positions.size(); i++)
+			clipPositions[i] = mvp * glm::vec4(mesh.Positions[i], 1.f);
+
+		for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+		{
+			const glm::vec4 input[3] = { clipPositions[mesh.Indices[i]], clipPositions[mesh.Indices[i + 1]], clipPositions[mesh.Indices[i + 2]] };
+
+			// Sutherland-Hodgman against the near plane only, x/y are handled by the bounding box
+			glm::vec4 clipped[4];
+			int count = 0;
+			for (int v = 0; v < 3; v++)
+			{
+				const glm::vec4& current = input[v];
+				const glm::vec4& next = input[(v + 1) % 3];
+				float currentDistance = NearDistance(current);
+				float nextDistance = NearDistance(next);
+
+				if (currentDistance >= 0.f)
+					clipped[count++] = current;
+				if ((currentDistance >= 0.f) != (nextDistance >= 0.f))
+				{
+					float t = currentDistance / (currentDistance - nextDistance);
+					clipped[count++] = current + (next - current) * t;
+				}
+			}
+
+			for (int v = 1; v + 1 < count; v++)
+				AddTriangle(clipped[0], clipped[v], clipped[v + 1]);
+		}
+	}
+
+	const uint32_t bandCount = (TILES_Y + BAND_TILE_ROWS - 1) / BAND_TILE_ROWS;
+	pool.ParallelFor(bandCount, 1, [this](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t band = begin; band < end; band++)
+			{
+				int firstRow = static_cast<int>(band) * BAND_TILE_ROWS;
+				RasterizeBand(firstRow, std::min(firstRow + BAND_TILE_ROWS, TILES_Y) - 1);
+			}
+		});
+}
+
+void SoftwareOcclusion::RasterizeBand(int firstTileRow, int lastTileRow)
+{
+	std::fill(_depth.begin() + firstTileRow * TILES_X * TILE_PIXELS, _depth.begin() + (lastTileRow + 1) * TILES_X * TILE_PIXELS, 1.f);
+	std::fill(_coverage.begin() + firstTileRow * TILES_X, _coverage.begin() + (lastTileRow + 1) * TILES_X, 0ull);
+
+	const int bandMinY = firstTileRow * TILE_SIZE;
+	const int bandMaxY = (lastTileRow + 1) * TILE_SIZE - 1;
+
+	for (const ScreenTriangle& triangle : _triangles)
+	{
+		if (triangle.MaxY < bandMinY || triangle.MinY > bandMaxY)
+			continue;
+
+		const glm::vec2& v0 = triangle.Vertices[0];
+		const glm::vec2& v1 = triangle.Vertices[1];
+		const glm::vec2& v2 = triangle.Vertices[2];
+
+		int tileMinY = std::max(triangle.MinY, bandMinY) / TILE_SIZE;
+		int tileMaxY = std::min(triangle.MaxY, bandMaxY) / TILE_SIZE;
+		int tileMinX = triangle.MinX / TILE_SIZE;
+		int tileMaxX = triangle.MaxX / TILE_SIZE;
+
+		for (int tileY = tileMinY; tileY <= tileMaxY; tileY++)
+		{
+			for (int tileX = tileMinX; tileX <= tileMaxX; tileX++)
+			{
+				// Reject the tile if all four corner samples are outside one edge
+				float x0 = tileX * TILE_SIZE + 0.5f, x1 = x0 + TILE_SIZE - 1;
+				float y0 = tileY * TILE_SIZE + 0.5f, y1 = y0 + TILE_SIZE - 1;
+				bool rejected = false;
+				const glm::vec2* edges[3][2] = { { &v0, &v1 }, { &v1, &v2 }, { &v2, &v0 } };
+				for (auto& edge : edges)
+				{
+					if (EdgeFunction(*edge[0], *edge[1], x0, y0) < 0.f && EdgeFunction(*edge[0], *edge[1], x1, y0) < 0.f
+						&& EdgeFunction(*edge[0], *edge[1], x0, y1) < 0.f && EdgeFunction(*edge[0], *edge[1], x1, y1) < 0.f)
+					{
+						rejected = true;
+						break;
+					}
+				}
+				if (rejected)
+					continue;
+
+				const int tile = tileY * TILES_X + tileX;
+				float* depth = &_depth[tile * TILE_PIXELS];
+				uint64_t mask = 0;
+
+				for (int py = 0; py < TILE_SIZE; py++)
+				{
+					float y = y0 + py;
+					// Straight line loop over a tile row, the compiler turns this into SIMD
+					for (int px = 0; px < TILE_SIZE; px++)
+					{
+						float x = x0 + px;
+						float w0 = EdgeFunction(v0, v1, x, y);
+						float w1 = EdgeFunction(v1, v2, x, y);
+						float w2 = EdgeFunction(v2, v0, x, y);
+						bool inside = w0 >= 0.f && w1 >= 0.f && w2 >= 0.f;
+
+						float z = std::clamp(triangle.Z0 + triangle.DZDX * x + triangle.DZDY * y, 0.f, 1.f);
+						int index = py * TILE_SIZE + px;
+						depth[index] = inside ? std::min(depth[index], z) : depth[index];
+						mask |= static_cast<uint64_t>(inside) << index;
+					}
+				}
+				_coverage[tile] |= mask;
+			}
+		}
+	}
+
+	// Hierarchical level, only tiles with every pixel covered get a finite max depth
+	for (int tile = firstTileRow * TILES_X; tile < (lastTileRow + 1) * TILES_X; tile++)
+	{
+		if (_coverage[tile] != FULL_MASK)
+		{
+			_tileMaxDepth[tile] = 1.f;
+			continue;
+		}
+
+		const float* depth = &_depth[tile * TILE_PIXELS];
+		_tileMaxDepth[tile] = *std::max_element(depth, depth + TILE_PIXELS);
+	}
+}
+
+bool SoftwareOcclusion::IsTileRectVisible(int minX, int minY, int maxX, int maxY, float nearestDepth) const
+{
+	const float threshold = nearestDepth - DEPTH_BIAS;
+
+	for (int tileY = minY / TILE_SIZE; tileY <= maxY / TILE_SIZE; tileY++)
+	{
+		for (int tileX = minX / TILE_SIZE; tileX <= maxX / TILE_SIZE; tileX++)
+		{
+			const int tile = tileY * TILES_X + tileX;
+			// Whole tile is covered by something closer
+			if (_tileMaxDepth[tile] < threshold)
+				continue;
+
+			const float* depth = &_depth[tile * TILE_PIXELS];
+			int startX = std::max(minX, tileX * TILE_SIZE), endX = std::min(maxX, tileX * TILE_SIZE + TILE_SIZE - 1);
+			int startY = std::max(minY, tileY * TILE_SIZE), endY = std::min(maxY, tileY * TILE_SIZE + TILE_SIZE - 1);
+			for (int y = startY; y <= endY; y++)
+			{
+				for (int x = startX; x <= endX; x++)
+				{
+					if (depth[(y % TILE_SIZE) * TILE_SIZE + (x % TILE_SIZE)] >= threshold)
+						return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+bool SoftwareOcclusion::IsVisible(const AABB& worldBounds) const
+{
+	glm::vec2 minimum(std::numeric_limits<float>::max());
+	glm::vec2 maximum(-std::numeric_limits<float>::max());
+	float nearestDepth = 1.f;
+
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner((i & 1) ? worldBounds.Max.x : worldBounds.Min.x,
+			(i & 2) ? worldBounds.Max.y : worldBounds.Min.y,
+			(i & 4) ? worldBounds.Max.z : worldBounds.Min.z);
+		glm::vec4 clip = _viewProjection * glm::vec4(corner, 1.f);
+
+		// Crosses the near plane, the screen rect would be meaningless
+		if (clip.w <= NEAR_CLIP || NearDistance(clip) < 0.f)
+			return true;
+
+		float invW = 1.f / clip.w;
+		glm::vec2 screen((clip.x * invW * 0.5f + 0.5f) * WIDTH, (clip.y * invW * 0.5f + 0.5f) * HEIGHT);
+		minimum = glm::min(minimum, screen);
+		maximum = glm::max(maximum, screen);
+		nearestDepth = std::min(nearestDepth, clip.z * invW * 0.5f + 0.5f);
+	}
+
+	// Grow by a pixel, occluders are sampled at pixel centres
+	int minX = std::max(0, static_cast<int>(std::floor(minimum.x)) - 1);
+	int minY = std::max(0, static_cast<int>(std::floor(minimum.y)) - 1);
+	int maxX = std::min(WIDTH - 1, static_cast<int>(std::ceil(maximum.x)) + 1);
+	int maxY = std::min(HEIGHT - 1, static_cast<int>(std::ceil(maximum.y)) + 1);
+	if (minX > maxX || minY > maxY)
+		return true;
+
+	return IsTileRectVisible(minX, minY, maxX, maxY, nearestDepth);
+}
+
+uint32_t SoftwareOcclusion::Filter(const Scene& scene, std::vector<uint32_t>& objects) const
+{
+	size_t before = objects.size();
+	objects.erase(std::remove_if(objects.begin(), objects.end(),
+		[&](uint32_t objectID) { return !IsVisible(scene.GetWorldBounds(objectID)); }), objects.end());
+	return static_cast<uint32_t>(before - objects.size());
+}
+
+uint32_t SoftwareOcclusion::GetOccluderCount() const
+{
+	return static_cast<uint32_t>(_occluders.size());
+}
+
+uint32_t SoftwareOcclusion::GetTriangleCount() const
+{
+	return static_cast<uint32_t>(_triangles.size());
+}
+
+float SoftwareOcclusion::GetDepth(int x, int y) const
+{
+	int tile = (y / TILE_SIZE) * TILES_X + (x / TILE_SIZE);
+	return _depth[tile * TILE_PIXELS + (y % TILE_SIZE) * TILE_SIZE + (x % TILE_SIZE)];
+}
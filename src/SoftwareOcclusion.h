@@ -0,0 +1,99 @@
+#ifndef SOFTWARE_OCCLUSION_H
+#define SOFTWARE_OCCLUSION_H
+
+#include <glm/glm.hpp>
+#include "AABB.h"
+#include "Mesh.h"
+#include "Primitives.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace SoftwareOcclusionDefaults
+{
+	constexpr int WIDTH = 256;
+	constexpr int HEIGHT = 160;
+	// 8x8 pixels per tile, one coverage bit each
+	constexpr int TILE_SIZE = 8;
+	constexpr int TILES_X = WIDTH / TILE_SIZE;
+	constexpr int TILES_Y = HEIGHT / TILE_SIZE;
+	// Tile rows rasterized by one job
+	constexpr int BAND_TILE_ROWS = 2;
+
+	constexpr uint32_t MAX_OCCLUDERS = 64;
+	// Bounds radius over distance an object needs to be picked as an occluder
+	constexpr float MIN_OCCLUDER_SIZE = 0.05f;
+	constexpr float NEAR_CLIP = 0.1f;
+	constexpr float DEPTH_BIAS = 1e-5f;
+}
+
+// Must lie inside the mesh it stands for, a coarse LOD that only collapsed vertices works
+struct OccluderMesh
+{
+	std::vector<glm::vec3> Positions;
+	std::vector<uint32_t> Indices;
+};
+
+// Positions of the mesh and the indices of one of its LODs
+OccluderMesh CreateOccluderMesh(const MeshData& data, uint32_t lod);
+
+// Every triangle of a built-in primitive, which has no coarser LOD
+template<size_t VertexCount, size_t IndexCount>
+OccluderMesh CreateOccluderMesh(const PrimitiveMesh<VertexCount, IndexCount>& primitive)
+{
+	OccluderMesh mesh;
+	mesh.Positions.reserve(VertexCount);
+	for (const PrimitiveVertex& vertex : primitive.Vertices)
+		mesh.Positions.emplace_back(vertex.Position[0], vertex.Position[1], vertex.Position[2]);
+	mesh.Indices.assign(primitive.Indices.begin(), primitive.Indices.end());
+	return mesh;
+}
+
+// Rasterizes a few large occluders into a small CPU depth buffer and tests object bounds
+// against it. Needs no GL context, and the result doesn't depend on the thread count since
+// every screen band is owned by exactly one job and depth merging is a plain min.
+class SoftwareOcclusion
+{
+private:
+	struct ScreenTriangle
+	{
+		glm::vec2 Vertices[3];
+		// Depth plane, z = Z0 + dZdX * x + dZdY * y
+		float Z0, DZDX, DZDY;
+		int MinX, MinY, MaxX, MaxY;
+	};
+
+	// Tile-major so each 8x8 tile is 64 contiguous floats
+	std::vector<float> _depth;
+	std::vector<uint64_t> _coverage;
+	// Farthest depth of fully covered tiles, 1 otherwise
+	std::vector<float> _tileMaxDepth;
+
+	std::vector<ScreenTriangle> _triangles;
+	std::vector<uint32_t> _occluders;
+	glm::mat4 _viewProjection;
+
+	void AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+	void RasterizeBand(int firstTileRow, int lastTileRow);
+	bool IsTileRectVisible(int minX, int minY, int maxX, int maxY, float nearestDepth) const;
+
+public:
+	SoftwareOcclusion();
+
+	// Picks the biggest on-screen objects among the candidates
+	void SelectOccluders(const Scene& scene, const std::vector<uint32_t>& candidates, const glm::vec3& cameraPosition);
+	// Occluder meshes indexed by the objects' MeshID
+	void Render(const Scene& scene, const std::vector<OccluderMesh>& meshes, const glm::mat4& viewProjection, ThreadPool& pool);
+
+	bool IsVisible(const AABB& worldBounds) const;
+	// Keeps only the objects that aren't hidden, returns how many were removed
+	uint32_t Filter(const Scene& scene, std::vector<uint32_t>& objects) const;
+
+	uint32_t GetOccluderCount() const;
+	uint32_t GetTriangleCount() const;
+	float GetDepth(int x, int y) const;
+};
+
+#endif // SOFTWARE_OCCLUSION_H
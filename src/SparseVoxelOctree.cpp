@@ -0,0 +1,297 @@
+#include "SparseVoxelOctree.h"
+#include "Logger.h"
+#include "ThreadPool.h"
+#include "VoxelWorld.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+using namespace SparseVoxelOctreeDefaults;
+using namespace VoxelDefaults;
+
+namespace
+{
+	// Node word of the cube at (x, y, z), children appended to nodes first and pointed at
+	// as pointerBase + their index. Eight equal children that are empty or leaves collapse.
+	template<typename LeafFunc>
+	uint32_t BuildNode(int x, int y, int z, int size, const LeafFunc& leaf, std::vector<uint32_t>& nodes, uint32_t pointerBase)
+	{
+		if (size == 1)
+			return leaf(x, y, z);
+
+		const int half = size / 2;
+		uint32_t children[8];
+		bool uniform = true;
+		for (int child = 0; child < 8; child++)
+		{
+			children[child] = BuildNode(x + (child & 1) * half, y + ((child >> 1) & 1) * half, z + (child >> 2) * half, half, leaf, nodes, pointerBase);
+			uniform &= children[child] == children[0];
+		}
+		if (uniform && (children[0] == 0 || (children[0] & LEAF)))
+			return children[0];
+
+		const uint32_t index = static_cast<uint32_t>(nodes.size());
+		nodes.insert(nodes.end(), children, children + 8);
+		return pointerBase + index;
+	}
+
+	bool IsPointer(uint32_t node)
+	{
+		return node != 0 && (node & LEAF) == 0;
+	}
+
+	uint32_t ToLeaf(BlockID block)
+	{
+		return block == VoxelBlocks::AIR ? 0 : LEAF | block;
+	}
+}
+
+SparseVoxelOctree::SparseVoxelOctree()
+	: _shader("resources/shaders/fullscreen.vert", "resources/shaders/svo.frag"),
+	_VAO(0), _nodeBuffer(0), _nodeTexture(0), _origin(0.f), _rootSize(0), _revision(0), _buildMilliseconds(0.f),
+	_sizeInChunks(0), _upperCapacity(0), _wastedNodes(0), _usedNodes(0), _rebuiltChunks(0), _bufferCapacity(0)
+{
+	// Core profile draws need a VAO even when the vertex shader makes up its own positions
+	GL_CHECK(glGenVertexArrays(1, &_VAO));
+	GL_CHECK(glGenBuffers(1, &_nodeBuffer));
+	GL_CHECK(glGenTextures(1, &_nodeTexture));
+}
+
+SparseVoxelOctree::~SparseVoxelOctree()
+{
+	glDeleteTextures(1, &_nodeTexture);
+	glDeleteBuffers(1, &_nodeBuffer);
+	glDeleteVertexArrays(1, &_VAO);
+}
+
+void SparseVoxelOctree::Build(const VoxelWorld& world, ThreadPool& pool)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	const glm::ivec3 size = world.GetSizeInChunks();
+	const uint32_t chunkCount = world.GetChunkCount();
+	int rootChunks = 1;
+	while (rootChunks < size.x || rootChunks < size.y || rootChunks < size.z)
+		rootChunks *= 2;
+
+	const bool full = size != _sizeInChunks || _chunkRoots.size() != chunkCount;
+	if (full)
+	{
+		_sizeInChunks = size;
+		_chunkNodes.assign(chunkCount, {});
+		_chunkRoots.assign(chunkCount, 0);
+		_chunkRevisions.assign(chunkCount, 0);
+		_chunkOffsets.assign(chunkCount, 0);
+		_chunkCapacities.assign(chunkCount, 0);
+
+		// Every cube of two or more chunks may need its 8 children
+		_upperCapacity = 0;
+		for (int cubeSize = 2; cubeSize <= rootChunks; cubeSize *= 2)
+		{
+			const uint32_t cubes = static_cast<uint32_t>(rootChunks / cubeSize);
+			_upperCapacity += cubes * cubes * cubes * 8;
+		}
+	}
+
+	std::vector<uint32_t> dirty;
+	for (uint32_t index = 0; index < chunkCount; index++)
+	{
+		const glm::ivec3 chunk(index % size.x, (index / size.x) % size.y, index / (size.x * size.y));
+		if (full || world.GetChunkRevision(chunk) != _chunkRevisions[index])
+			dirty.push_back(index);
+	}
+
+	// Every chunk on its own, pointers relative to the chunk's nodes and one past them so
+	// 0 still reads as empty
+	pool.ParallelFor(static_cast<uint32_t>(dirty.size()), 1, [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<BlockID> blocks(CHUNK_VOLUME);
+			for (uint32_t i = begin; i < end; i++)
+			{
+				const uint32_t index = dirty[i];
+				const glm::ivec3 chunk(index % size.x, (index / size.x) % size.y, index / (size.x * size.y));
+				const VoxelChunk& source = world.GetChunk(chunk);
+				std::vector<uint32_t>& nodes = _chunkNodes[index];
+				nodes.clear();
+				_chunkRevisions[index] = world.GetChunkRevision(chunk);
+				if (source.GetPaletteSize() == 1)
+				{
+					_chunkRoots[index] = ToLeaf(source.Get(0, 0, 0));
+					continue;
+				}
+				source.Decode(blocks.data());
+				_chunkRoots[index] = BuildNode(0, 0, 0, CHUNK_SIZE,
+					[&](int x, int y, int z) { return ToLeaf(blocks[VoxelChunk::ToVoxelIndex(x, y, z)]); }, nodes, 1);
+			}
+		});
+	_rebuiltChunks = static_cast<uint32_t>(dirty.size());
+
+	// Changed chunks go back into their slot when they fit, a full layout also compacts the moved ones
+	std::vector<std::pair<size_t, size_t>> ranges;
+	const bool uploadAll = full || _wastedNodes > _nodes.size() / 2;
+	if (uploadAll)
+	{
+		Relayout(pool);
+	}
+	else
+	{
+		for (uint32_t index : dirty)
+		{
+			const uint32_t nodeCount = static_cast<uint32_t>(_chunkNodes[index].size());
+			if (nodeCount > _chunkCapacities[index])
+			{
+				_wastedNodes += _chunkCapacities[index];
+				_chunkOffsets[index] = static_cast<uint32_t>(_nodes.size());
+				_chunkCapacities[index] = nodeCount + nodeCount / 8 + CHUNK_SLACK;
+				_nodes.resize(_nodes.size() + _chunkCapacities[index], 0);
+			}
+			WriteChunk(index);
+			if (nodeCount > 0)
+				ranges.emplace_back(_chunkOffsets[index], nodeCount);
+		}
+	}
+
+	// Levels above the chunks, outside the world is air. Rebuilt every time, they are a few
+	// thousand words at most and sit in front of the chunks.
+	std::vector<uint32_t> upper;
+	const uint32_t root = BuildNode(0, 0, 0, rootChunks, [&](int x, int y, int z)
+		{
+			if (x >= size.x || y >= size.y || z >= size.z)
+				return 0u;
+			const uint32_t index = (z * size.y + y) * size.x + x;
+			const uint32_t chunkRoot = _chunkRoots[index];
+			return IsPointer(chunkRoot) ? chunkRoot + _chunkOffsets[index] - 1 : chunkRoot;
+		}, upper, 1);
+	_nodes[0] = root;
+	std::copy(upper.begin(), upper.end(), _nodes.begin() + 1);
+	ranges.emplace_back(0, 1 + upper.size());
+
+	_usedNodes = static_cast<uint32_t>(1 + upper.size());
+	for (const std::vector<uint32_t>& nodes : _chunkNodes)
+		_usedNodes += static_cast<uint32_t>(nodes.size());
+
+	_origin = world.GetOrigin();
+	_rootSize = rootChunks * CHUNK_SIZE;
+	_revision = world.GetRevision();
+	_buildMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	Upload(ranges, uploadAll);
+}
+
+void SparseVoxelOctree::Relayout(ThreadPool& pool)
+{
+	const uint32_t chunkCount = static_cast<uint32_t>(_chunkNodes.size());
+	size_t nodeCount = 1 + _upperCapacity;
+	for (uint32_t index = 0; index < chunkCount; index++)
+	{
+		const uint32_t chunkNodes = static_cast<uint32_t>(_chunkNodes[index].size());
+		_chunkOffsets[index] = static_cast<uint32_t>(nodeCount);
+		// Uniform chunks have no nodes and stay that way until edited, they get no slot
+		_chunkCapacities[index] = chunkNodes ? chunkNodes + chunkNodes / 8 + CHUNK_SLACK : 0;
+		nodeCount += _chunkCapacities[index];
+	}
+	_nodes.assign(nodeCount, 0);
+	_wastedNodes = 0;
+
+	pool.ParallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t index = begin; index < end; index++)
+				WriteChunk(index);
+		});
+}
+
+void SparseVoxelOctree::WriteChunk(uint32_t index)
+{
+	if (_chunkNodes[index].empty())
+		return;
+
+	const uint32_t relocation = _chunkOffsets[index] - 1;
+	uint32_t* target = &_nodes[_chunkOffsets[index]];
+	for (uint32_t node : _chunkNodes[index])
+		*target++ = IsPointer(node) ? node + relocation : node;
+}
+
+void SparseVoxelOctree::Upload(const std::vector<std::pair<size_t, size_t>>& ranges, bool uploadAll)
+{
+	GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, _nodeBuffer));
+	if (uploadAll || _nodes.size() > _bufferCapacity)
+	{
+		GLint maxTexels = 0;
+		GL_CHECK(glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels));
+		if (_nodes.size() > static_cast<size_t>(maxTexels))
+		{
+			std::cout << "ERROR::SVO::TOO_LARGE: " << _nodes.size() << " nodes, the buffer texture holds " << maxTexels << "\n";
+			GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, 0));
+			_nodes.clear();
+			_chunkRoots.clear();
+			_bufferCapacity = 0;
+			return;
+		}
+
+		// Headroom for chunks moving out of their slot, the words past the tree are never read
+		_bufferCapacity = std::min(_nodes.size() + _nodes.size() / 4, static_cast<size_t>(maxTexels));
+		GL_CHECK(glBufferData(GL_TEXTURE_BUFFER, _bufferCapacity * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW));
+		GL_CHECK(glBufferSubData(GL_TEXTURE_BUFFER, 0, _nodes.size() * sizeof(uint32_t), _nodes.data()));
+		GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, 0));
+		GL_CHECK(glBindTexture(GL_TEXTURE_BUFFER, _nodeTexture));
+		GL_CHECK(glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, _nodeBuffer));
+		GL_CHECK(glBindTexture(GL_TEXTURE_BUFFER, 0));
+		return;
+	}
+
+	for (const std::pair<size_t, size_t>& range : ranges)
+	{
+		GL_CHECK(glBufferSubData(GL_TEXTURE_BUFFER, range.first * sizeof(uint32_t), range.second * sizeof(uint32_t), &_nodes[range.first]));
+	}
+	GL_CHECK(glBindBuffer(GL_TEXTURE_BUFFER, 0));
+}
+
+void SparseVoxelOctree::Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, const glm::vec2& viewportSize)
+{
+	if (_nodes.empty())
+		return;
+
+	_shader.Use();
+	_shader.SetUniformMat4fv("inverseViewProjection", glm::inverse(projection * view));
+	_shader.SetUniformVec3("cameraPosition", cameraPosition);
+	_shader.SetUniformVec3("octreeOrigin", _origin);
+	_shader.SetUniformF("octreeSize", static_cast<float>(_rootSize));
+	_shader.SetUniformVec2("viewportSize", viewportSize);
+	_shader.SetUniformI("maxSteps", MAX_STEPS);
+	_shader.SetUniformI("nodes", 0);
+	GL_CHECK(glUniform3fv(glGetUniformLocation(_shader.GetProgramID(), "blockColors"), VoxelBlocks::COUNT, &BLOCK_COLORS[0][0]));
+
+	GL_CHECK(glActiveTexture(GL_TEXTURE0));
+	GL_CHECK(glBindTexture(GL_TEXTURE_BUFFER, _nodeTexture));
+	GL_CHECK(glDisable(GL_DEPTH_TEST));
+	GL_CHECK(glBindVertexArray(_VAO));
+	GL_CHECK(glDrawArrays(GL_TRIANGLES, 0, 3));
+	GL_CHECK(glBindVertexArray(0));
+	GL_CHECK(glEnable(GL_DEPTH_TEST));
+	GL_CHECK(glBindTexture(GL_TEXTURE_BUFFER, 0));
+}
+
+uint32_t SparseVoxelOctree::GetRevision() const
+{
+	return _revision;
+}
+
+uint32_t SparseVoxelOctree::GetNodeCount() const
+{
+	return _usedNodes;
+}
+
+uint32_t SparseVoxelOctree::GetRebuiltChunkCount() const
+{
+	return _rebuiltChunks;
+}
+
+size_t SparseVoxelOctree::GetMemoryUsage() const
+{
+	return _nodes.size() * sizeof(uint32_t);
+}
+
+float SparseVoxelOctree::GetBuildMilliseconds() const
+{
+	return _buildMilliseconds;
+}
@@ -0,0 +1,89 @@
+#ifndef SPARSE_VOXEL_OCTREE_H
+#define SPARSE_VOXEL_OCTREE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Shader.h"
+#include "VoxelChunk.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class ThreadPool;
+class VoxelWorld;
+
+namespace SparseVoxelOctreeDefaults
+{
+	// Node word flag, the low bits are the block of a solid cube
+	constexpr uint32_t LEAF = 0x80000000u;
+	// Cells visited per pixel before the ray gives up, a few times the depth is plenty
+	constexpr int MAX_STEPS = 256;
+	// Spare words after a chunk's nodes, on top of an eighth of them, so edits rebuild in place
+	constexpr uint32_t CHUNK_SLACK = 64;
+}
+
+// Octree over a VoxelWorld, ray-marched per pixel so the cost follows the resolution and not
+// the voxel count. Every node is one 32 bit word: 0 for an empty cube, LEAF | block for a cube
+// of one block type, else the index of its 8 children (x in bit 0, y in bit 1, z in bit 2).
+// Uniform cubes collapse at any size, solid ground under the surface costs a single word.
+// Node 0 is the root, the levels above the chunks follow in a region sized for the worst case,
+// then every chunk's subtree in its own slot. An edit rebuilds the changed chunks and the levels
+// above them and uploads just those ranges; a chunk that outgrew its slot moves to the end.
+class SparseVoxelOctree
+{
+private:
+	Shader _shader;
+	unsigned int _VAO;
+	unsigned int _nodeBuffer;
+	unsigned int _nodeTexture;
+
+	std::vector<uint32_t> _nodes;
+	glm::vec3 _origin;
+	// Edge of the root cube in voxels, the world padded to a power of two
+	int _rootSize;
+	uint32_t _revision;
+	float _buildMilliseconds;
+
+	// Per chunk subtree with pointers relative to it and one past it, kept for incremental builds
+	glm::ivec3 _sizeInChunks;
+	std::vector<std::vector<uint32_t>> _chunkNodes;
+	std::vector<uint32_t> _chunkRoots;
+	std::vector<uint32_t> _chunkRevisions;
+	std::vector<uint32_t> _chunkOffsets;
+	std::vector<uint32_t> _chunkCapacities;
+	uint32_t _upperCapacity;
+	// Words in slots chunks moved out of, compacted once they're half the tree
+	size_t _wastedNodes;
+	uint32_t _usedNodes;
+	uint32_t _rebuiltChunks;
+	// Words the GPU buffer has room for
+	size_t _bufferCapacity;
+
+	void Relayout(ThreadPool& pool);
+	void WriteChunk(uint32_t index);
+	void Upload(const std::vector<std::pair<size_t, size_t>>& ranges, bool uploadAll);
+
+public:
+	SparseVoxelOctree();
+	~SparseVoxelOctree();
+
+	SparseVoxelOctree(const SparseVoxelOctree&) = delete;
+	SparseVoxelOctree& operator=(const SparseVoxelOctree&) = delete;
+
+	// Subtrees of the chunks changed since the last build in parallel, all of them the first time,
+	// then the levels above them on the calling thread
+	void Build(const VoxelWorld& world, ThreadPool& pool);
+	// Full screen pass, caller clears, depth is not written
+	void Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, const glm::vec2& viewportSize);
+
+	// World revision the tree was built from
+	uint32_t GetRevision() const;
+	// Words in use, slot slack not included
+	uint32_t GetNodeCount() const;
+	uint32_t GetRebuiltChunkCount() const;
+	size_t GetMemoryUsage() const;
+	float GetBuildMilliseconds() const;
+};
+
+#endif // SPARSE_VOXEL_OCTREE_H
@@ -0,0 +1,175 @@
+#include "TessellatedTerrain.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace TessellationDefaults;
+
+TessellatedTerrain::TessellatedTerrain(const glm::vec3& origin, float size, int patchesPerSide /*= PATCHES_PER_SIDE*/)
+	: _shader("resources/shaders/terrain.vert", "resources/shaders/terrain.tesc", "resources/shaders/terrain.tese", "resources/shaders/terrain.frag"),
+	_vao(0), _vbo(0), _ebo(0), _heightMap(0), _patchCount(0),
+	_origin(origin), _size(size), _heightScale(0.f), _edgePixels(EDGE_PIXELS), _maxLevel(64.f),
+	_queryIndex(0), _lastTriangleCount(0)
+{
+	// Corners are shared between patches, the index buffer lists four per patch
+	const int corners = patchesPerSide + 1;
+	const float step = size / patchesPerSide;
+	std::vector<glm::vec2> positions;
+	positions.reserve(static_cast<size_t>(corners) * corners);
+	for (int z = 0; z < corners; z++)
+	{
+		for (int x = 0; x < corners; x++)
+			positions.emplace_back(origin.x + x * step, origin.z + z * step);
+	}
+
+	// Quad domain order: (u, v) = (0, 0), (1, 0), (1, 1), (0, 1) with u along X and v along Z
+	std::vector<uint32_t> indices;
+	indices.reserve(static_cast<size_t>(patchesPerSide) * patchesPerSide * 4);
+	for (int z = 0; z < patchesPerSide; z++)
+	{
+		for (int x = 0; x < patchesPerSide; x++)
+		{
+			uint32_t corner = static_cast<uint32_t>(z * corners + x);
+			indices.push_back(corner);
+			indices.push_back(corner + 1);
+			indices.push_back(corner + corners + 1);
+			indices.push_back(corner + corners);
+		}
+	}
+	_patchCount = static_cast<uint32_t>(patchesPerSide * patchesPerSide);
+
+	GL_CHECK(glGenVertexArrays(1, &_vao));
+	GL_CHECK(glGenBuffers(1, &_vbo));
+	GL_CHECK(glGenBuffers(1, &_ebo));
+
+	GL_CHECK(glBindVertexArray(_vao));
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, _vbo));
+	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec2), positions.data(), GL_STATIC_DRAW));
+	GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo));
+	GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW));
+	GL_CHECK(glEnableVertexAttribArray(0));
+	GL_CHECK(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0));
+	GL_CHECK(glBindVertexArray(0));
+
+	// Flat until a height field is set, the shaders always sample something
+	const float zero = 0.f;
+	GL_CHECK(glGenTextures(1, &_heightMap));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, _heightMap));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, 1, 1, 0, GL_RED, GL_FLOAT, &zero));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+	// 64 is the guaranteed minimum, some drivers go further
+	GLint maxLevel = 64;
+	GL_CHECK(glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxLevel));
+	_maxLevel = static_cast<float>(maxLevel);
+
+	GL_CHECK(glGenQueries(QUERY_LATENCY, _queries));
+	for (int i = 0; i < QUERY_LATENCY; i++)
+		_queryIssued[i] = false;
+}
+
+TessellatedTerrain::~TessellatedTerrain()
+{
+	glDeleteQueries(QUERY_LATENCY, _queries);
+	glDeleteTextures(1, &_heightMap);
+	glDeleteBuffers(1, &_ebo);
+	glDeleteBuffers(1, &_vbo);
+	glDeleteVertexArrays(1, &_vao);
+}
+
+bool TessellatedTerrain::IsSupported()
+{
+	return GLVersion.major >= 4;
+}
+
+void TessellatedTerrain::SetHeightField(const HeightField& field, float heightScale)
+{
+	_heightScale = heightScale;
+
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, _heightMap));
+	GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+	GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, field.Resolution, field.Resolution, 0, GL_RED, GL_FLOAT, field.Heights.data()));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+void TessellatedTerrain::SetEdgePixels(float edgePixels)
+{
+	_edgePixels = std::max(edgePixels, 1.f);
+}
+
+void TessellatedTerrain::PollQueries()
+{
+	for (int i = 0; i < QUERY_LATENCY; i++)
+	{
+		if (!_queryIssued[i])
+			continue;
+
+		GLuint available = GL_FALSE;
+		GL_CHECK(glGetQueryObjectuiv(_queries[i], GL_QUERY_RESULT_AVAILABLE, &available));
+		if (!available)
+			continue;
+
+		GLuint primitives = 0;
+		GL_CHECK(glGetQueryObjectuiv(_queries[i], GL_QUERY_RESULT, &primitives));
+		_lastTriangleCount = primitives;
+		_queryIssued[i] = false;
+	}
+}
+
+void TessellatedTerrain::Draw(const glm::mat4& view, const glm::mat4& projection, const Frustum& frustum, const glm::vec3& cameraPosition, int viewportHeight)
+{
+	PollQueries();
+
+	glm::vec4 planes[6];
+	for (int i = 0; i < 6; i++)
+		planes[i] = glm::vec4(frustum.Planes[i].Normal, frustum.Planes[i].Distance);
+
+	_shader.Use();
+	_shader.SetUniformMat4fv("view", view);
+	_shader.SetUniformMat4fv("projection", projection);
+	_shader.SetUniformVec3("cameraPosition", cameraPosition);
+	_shader.SetUniformVec3("terrainOrigin", _origin);
+	_shader.SetUniformF("terrainSize", _size);
+	_shader.SetUniformF("heightScale", _heightScale);
+	// Pixels covered by one world unit at distance one
+	_shader.SetUniformF("projectionScale", projection[1][1] * viewportHeight * 0.5f);
+	_shader.SetUniformF("edgePixels", _edgePixels);
+	_shader.SetUniformF("maxLevel", _maxLevel);
+	_shader.SetUniformI("heightMap", 0);
+	GL_CHECK(glUniform4fv(glGetUniformLocation(_shader.GetProgramID(), "frustumPlanes"), 6, &planes[0][0]));
+
+	GL_CHECK(glActiveTexture(GL_TEXTURE0));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, _heightMap));
+
+	// A slot still waiting on the GPU is skipped this frame rather than waited on
+	const bool query = !_queryIssued[_queryIndex];
+	if (query)
+		GL_CHECK(glBeginQuery(GL_PRIMITIVES_GENERATED, _queries[_queryIndex]));
+
+	GL_CHECK(glPatchParameteri(GL_PATCH_VERTICES, 4));
+	GL_CHECK(glBindVertexArray(_vao));
+	GL_CHECK(glDrawElements(GL_PATCHES, static_cast<GLsizei>(_patchCount * 4), GL_UNSIGNED_INT, (void*)0));
+	GL_CHECK(glBindVertexArray(0));
+
+	if (query)
+	{
+		GL_CHECK(glEndQuery(GL_PRIMITIVES_GENERATED));
+		_queryIssued[_queryIndex] = true;
+		_queryIndex = (_queryIndex + 1) % QUERY_LATENCY;
+	}
+}
+
+uint32_t TessellatedTerrain::GetPatchCount() const
+{
+	return _patchCount;
+}
+
+uint32_t TessellatedTerrain::GetTriangleCount() const
+{
+	return _lastTriangleCount;
+}
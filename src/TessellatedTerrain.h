@@ -0,0 +1,71 @@
+#ifndef TESSELLATED_TERRAIN_H
+#define TESSELLATED_TERRAIN_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+#include "HeightField.h"
+#include "Shader.h"
+
+#include <cstdint>
+
+namespace TessellationDefaults
+{
+	// Coarse grid the CPU submits, everything finer comes out of the tessellator
+	constexpr int PATCHES_PER_SIDE = 16;
+	// Target on screen length of a generated edge, in pixels
+	constexpr float EDGE_PIXELS = 12.f;
+	// Frames the generated triangle count may lag behind
+	constexpr int QUERY_LATENCY = 2;
+}
+
+// Ground drawn as a grid of quad patches for GL 4.0+. The control shader gives every patch
+// edge a level from its projected length and drops patches outside the frustum, the evaluation
+// shader displaces the generated vertices by the height map. LOD costs the CPU nothing and
+// the vertex buffer holds only the patch corners.
+class TessellatedTerrain
+{
+private:
+	Shader _shader;
+	unsigned int _vao;
+	unsigned int _vbo;
+	unsigned int _ebo;
+	unsigned int _heightMap;
+	uint32_t _patchCount;
+
+	glm::vec3 _origin;
+	float _size;
+	float _heightScale;
+	float _edgePixels;
+	float _maxLevel;
+
+	// GL_PRIMITIVES_GENERATED of the last frames, read once available
+	unsigned int _queries[TessellationDefaults::QUERY_LATENCY];
+	bool _queryIssued[TessellationDefaults::QUERY_LATENCY];
+	int _queryIndex;
+	uint32_t _lastTriangleCount;
+
+	void PollQueries();
+
+public:
+	// Flat square of size x size on the XZ plane, origin is its minimum corner
+	TessellatedTerrain(const glm::vec3& origin, float size, int patchesPerSide = TessellationDefaults::PATCHES_PER_SIDE);
+	~TessellatedTerrain();
+
+	TessellatedTerrain(const TessellatedTerrain&) = delete;
+	TessellatedTerrain& operator=(const TessellatedTerrain&) = delete;
+
+	static bool IsSupported();
+
+	// Heights are stretched over [origin.y, origin.y + heightScale], a zero scale keeps it flat
+	void SetHeightField(const HeightField& field, float heightScale);
+	void SetEdgePixels(float edgePixels);
+
+	void Draw(const glm::mat4& view, const glm::mat4& projection, const Frustum& frustum, const glm::vec3& cameraPosition, int viewportHeight);
+
+	uint32_t GetPatchCount() const;
+	// Result of a previous frame, never stalls for the current one
+	uint32_t GetTriangleCount() const;
+};
+
+#endif // TESSELLATED_TERRAIN_H
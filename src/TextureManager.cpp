@@ -0,0 +1,708 @@
+#include "TextureManager.h"
+#include "KTX2File.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "UploadContext.h"
+#include "Utilities.h"
+#include "stb_image_loader.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+	// EXT_texture_compression_s3tc and EXT_texture_sRGB, glad only carries the core enums
+	constexpr GLenum COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
+	constexpr GLenum COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+	constexpr GLenum COMPRESSED_SRGB_S3TC_DXT1 = 0x8C4C;
+	constexpr GLenum COMPRESSED_SRGB_ALPHA_S3TC_DXT5 = 0x8C4F;
+
+	// Everything that changes the texture built from the same bytes
+	uint32_t GetOptionBits(const TextureOptions& options)
+	{
+		return (options.SRGB ? 1u : 0u) | (options.FlipVertically ? 2u : 0u) | (options.Mipmaps ? 4u : 0u) | (static_cast<uint32_t>(options.Wrap) << 3);
+	}
+
+	GLenum GetInternalFormat(int channels, bool sRGB)
+	{
+		switch (channels)
+		{
+		case 1: return GL_R8;
+		case 2: return GL_RG8;
+		case 3: return sRGB ? GL_SRGB8 : GL_RGB8;
+		default: return sRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+		}
+	}
+
+	GLenum GetPixelFormat(int channels)
+	{
+		switch (channels)
+		{
+		case 1: return GL_RED;
+		case 2: return GL_RG;
+		case 3: return GL_RGB;
+		default: return GL_RGBA;
+		}
+	}
+
+	bool HasExtension(const char* name)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (extension && std::strcmp(extension, name) == 0)
+				return true;
+		}
+		return false;
+	}
+}
+
+TextureManager::DecodedImage::DecodedImage(DecodedImage&& other) noexcept
+	: Pixels(other.Pixels), Staging(other.Staging), Compressed(std::move(other.Compressed)), FlippedBlocks(std::move(other.FlippedBlocks)),
+	Width(other.Width), Height(other.Height), Channels(other.Channels), ContentKey(other.ContentKey), DuplicateOf(other.DuplicateOf)
+{
+	other.Pixels = nullptr;
+}
+
+TextureManager::DecodedImage& TextureManager::DecodedImage::operator=(DecodedImage&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (Staging)
+			Staging->Free(Pixels);
+		else if (Pixels)
+			stbi_image_free(Pixels);
+		Pixels = other.Pixels;
+		Staging = other.Staging;
+		Compressed = std::move(other.Compressed);
+		FlippedBlocks = std::move(other.FlippedBlocks);
+		Width = other.Width;
+		Height = other.Height;
+		Channels = other.Channels;
+		ContentKey = other.ContentKey;
+		DuplicateOf = other.DuplicateOf;
+		other.Pixels = nullptr;
+	}
+	return *this;
+}
+
+TextureManager::DecodedImage::~DecodedImage()
+{
+	if (Staging)
+		Staging->Free(Pixels);
+	else if (Pixels)
+		stbi_image_free(Pixels);
+}
+
+TextureManager::TextureManager(UploadContext* uploadContext /*= nullptr*/)
+	: _entries(1), _uploadContext(uploadContext), _uploadBuffer(0), _placeholder(0),
+	_blockCompression(false), _blockCompressionSRGB(false), _decodeCount(0)
+{
+	// Every desktop driver has S3TC, it just never made it into core
+	_blockCompression = HasExtension("GL_EXT_texture_compression_s3tc");
+	_blockCompressionSRGB = _blockCompression && (HasExtension("GL_EXT_texture_sRGB") || HasExtension("GL_EXT_texture_compression_s3tc_srgb"));
+
+	const unsigned char grey[4] = { 128, 128, 128, 255 };
+	GL_CHECK(glGenTextures(1, &_placeholder));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, _placeholder));
+	GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+	GL_CHECK(glGenBuffers(1, &_uploadBuffer));
+	if (PixelStagingBuffer::IsSupported())
+		_staging = std::make_unique<PixelStagingBuffer>();
+}
+
+TextureManager::~TextureManager()
+{
+	// Workers still reference this object
+	for (DecodeJob& job : _jobs)
+		job.Result.wait();
+	for (BackgroundUpload& upload : _backgroundUploads)
+	{
+		if (!upload.Sync)
+			upload.Sync = upload.Fence.get();
+		glDeleteSync(upload.Sync);
+		glDeleteTextures(1, &upload.Texture);
+	}
+
+	for (const Entry& entry : _entries)
+	{
+		if (entry.Texture)
+			glDeleteTextures(1, &entry.Texture);
+	}
+	glDeleteTextures(1, &_placeholder);
+	glDeleteBuffers(1, &_uploadBuffer);
+}
+
+bool TextureManager::HasImmutableStorage()
+{
+	return GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 2);
+}
+
+TextureHandle TextureManager::AddEntry(Entry&& entry)
+{
+	TextureHandle handle;
+	if (_freeSlots.empty())
+	{
+		handle = static_cast<TextureHandle>(_entries.size());
+		_entries.push_back(std::move(entry));
+	}
+	else
+	{
+		handle = _freeSlots.back();
+		_freeSlots.pop_back();
+		_entries[handle] = std::move(entry);
+	}
+	return handle;
+}
+
+void TextureManager::FreeEntry(TextureHandle handle)
+{
+	Entry& entry = _entries[handle];
+	if (entry.Texture)
+		glDeleteTextures(1, &entry.Texture);
+	const TextureHandle source = entry.Source;
+
+	// Every path that resolved to it, not just the one it was loaded from
+	for (auto it = _byPath.begin(); it != _byPath.end();)
+		it = it->second == handle ? _byPath.erase(it) : std::next(it);
+	{
+		// A claim made by a decode that finished after the last Release has no content key on the entry
+		std::lock_guard<std::mutex> lock(_contentMutex);
+		for (auto it = _byContent.begin(); it != _byContent.end();)
+			it = it->second == handle ? _byContent.erase(it) : std::next(it);
+	}
+
+	entry = Entry();
+	_freeSlots.push_back(handle);
+	Release(source);
+}
+
+TextureHandle TextureManager::AddPending(const std::string& path, const std::string& key, const TextureOptions& options)
+{
+	Entry entry;
+	entry.Path = path;
+	entry.Key = key;
+	entry.RefCount = 1;
+	entry.Options = options;
+	const TextureHandle handle = AddEntry(std::move(entry));
+	_byPath[key] = handle;
+	return handle;
+}
+
+TextureManager::DecodedImage TextureManager::Decode(TextureHandle handle, const std::string& path, const TextureOptions& options)
+{
+	DecodedImage image;
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		std::cout << "ERROR::TEXTURE::FILE_NOT_FOUND: " << path << "\n";
+		return image;
+	}
+
+	// Same bytes under another name, whoever hashes them first decodes them
+	const uint32_t optionBits = GetOptionBits(options);
+	const uint64_t sourceHash = HashTextureSource(file.GetData(), file.GetSize());
+	image.ContentKey = FNV_OFFSET_BASIS;
+	MixHash(image.ContentKey, &optionBits, sizeof(optionBits));
+	MixHash(image.ContentKey, &sourceHash, sizeof(sourceHash));
+	{
+		std::lock_guard<std::mutex> lock(_contentMutex);
+		auto claim = _byContent.emplace(image.ContentKey, handle);
+		if (claim.first->second != handle)
+		{
+			image.DuplicateOf = claim.first->second;
+			return image;
+		}
+	}
+
+	if (_blockCompression && (!options.SRGB || _blockCompressionSRGB) && LoadCooked(path, sourceHash, options, image))
+	{
+		_decodeCount++;
+		return image;
+	}
+
+	// The header gives the output size, a staging block of it becomes stb's output buffer
+	unsigned char* target = nullptr;
+	int width, height, channels;
+	if (_staging && stbi_info_from_memory(file.GetData(), static_cast<int>(file.GetSize()), &width, &height, &channels))
+	{
+		const size_t size = static_cast<size_t>(width) * height * channels;
+		target = _staging->Allocate(size + 1);
+		if (target)
+			SetStbImageTarget(target, size);
+	}
+
+	// The thread local flip leaves decodes on other workers alone
+	stbi_set_flip_vertically_on_load_thread(options.FlipVertically);
+	image.Pixels = stbi_load_from_memory(file.GetData(), static_cast<int>(file.GetSize()), &image.Width, &image.Height, &image.Channels, 0);
+	stbi_set_flip_vertically_on_load_thread(false);
+	if (target)
+	{
+		ClearStbImageTarget();
+		// A format that converts after decoding ends up on the heap anyway
+		if (image.Pixels == target)
+			image.Staging = _staging.get();
+		else
+			_staging->Free(target);
+	}
+	if (!image.Pixels)
+	{
+		std::cout << "ERROR::TEXTURE::DECODE_FAILED: " << path << " " << stbi_failure_reason() << "\n";
+		std::lock_guard<std::mutex> lock(_contentMutex);
+		_byContent.erase(image.ContentKey);
+		return image;
+	}
+	_decodeCount++;
+	return image;
+}
+
+bool TextureManager::LoadCooked(const std::string& path, uint64_t sourceHash, const TextureOptions& options, DecodedImage& image)
+{
+	auto cooked = std::make_unique<KTX2File>();
+	if (!cooked->Open(GetCookedTexturePath(path)) || cooked->GetSourceHash() != sourceHash)
+		return false;
+
+	// Cooked top row first like the source, flipping shuffles whole blocks into a copy
+	const std::vector<KTX2Level>& levels = cooked->GetLevels();
+	if (options.FlipVertically)
+	{
+		for (const KTX2Level& level : levels)
+		{
+			if (!CanFlipCompressed(level.Height))
+				return false;
+		}
+		for (const KTX2Level& level : levels)
+		{
+			const size_t offset = image.FlippedBlocks.size();
+			image.FlippedBlocks.insert(image.FlippedBlocks.end(), level.Data, level.Data + level.Size);
+			FlipCompressedVertically(cooked->GetFormat(), &image.FlippedBlocks[offset], level.Width, level.Height);
+		}
+	}
+
+	image.Width = levels[0].Width;
+	image.Height = levels[0].Height;
+	image.Channels = cooked->GetFormat() == BlockFormat::BC1 ? 3 : 4;
+	image.Compressed = std::move(cooked);
+	return true;
+}
+
+size_t TextureManager::GetImageMemory(const DecodedImage& image, const TextureOptions& options)
+{
+	size_t bytes = 0;
+	const int mipCount = options.Mipmaps ? GetMipCount(image.Width, image.Height) : 1;
+	for (int level = 0, w = image.Width, h = image.Height; level < mipCount; level++, w = std::max(w / 2, 1), h = std::max(h / 2, 1))
+		bytes += image.Compressed ? GetCompressedSize(image.Compressed->GetFormat(), w, h) : static_cast<size_t>(w) * h * image.Channels;
+	return bytes;
+}
+
+bool TextureManager::Complete(TextureHandle handle, DecodedImage& image)
+{
+	Entry& entry = _entries[handle];
+	// Released while the worker was busy
+	if (entry.RefCount == 0)
+	{
+		FreeEntry(handle);
+		return false;
+	}
+
+	if (image.DuplicateOf)
+	{
+		const TextureHandle source = image.DuplicateOf;
+		std::unique_lock<std::mutex> lock(_contentMutex);
+		// The claim goes away once the handle that made it is freed, which may be pending
+		auto claim = _byContent.find(image.ContentKey);
+		if (claim != _byContent.end() && claim->second == source && _entries[source].RefCount > 0)
+		{
+			lock.unlock();
+			entry.Source = source;
+			entry.State = EntryState::Ready;
+			Acquire(source);
+			return false;
+		}
+		// Decode it here after all, under our own claim
+		_byContent[image.ContentKey] = handle;
+		lock.unlock();
+		image = Decode(handle, entry.Path, entry.Options);
+		return Complete(handle, image);
+	}
+
+	if (!image.Pixels && !image.Compressed)
+	{
+		entry.State = EntryState::Failed;
+		return false;
+	}
+	entry.ContentKey = image.ContentKey;
+	entry.Width = image.Width;
+	entry.Height = image.Height;
+	entry.Channels = image.Channels;
+	entry.MemoryBytes = GetImageMemory(image, entry.Options);
+	return true;
+}
+
+void TextureManager::FillCompressedLevels(const DecodedImage& image, const TextureOptions& options, int mipCount)
+{
+	const bool bc1 = image.Compressed->GetFormat() == BlockFormat::BC1;
+	const GLenum internalFormat = bc1 ? (options.SRGB ? COMPRESSED_SRGB_S3TC_DXT1 : COMPRESSED_RGB_S3TC_DXT1)
+		: (options.SRGB ? COMPRESSED_SRGB_ALPHA_S3TC_DXT5 : COMPRESSED_RGBA_S3TC_DXT5);
+	const bool immutable = HasImmutableStorage();
+	if (immutable)
+		GL_CHECK(glTexStorage2D(GL_TEXTURE_2D, mipCount, internalFormat, image.Width, image.Height));
+
+	// Straight from the mapping, the blocks are already what the GPU stores
+	const std::vector<KTX2Level>& levels = image.Compressed->GetLevels();
+	const uint8_t* flipped = image.FlippedBlocks.data();
+	for (int level = 0; level < mipCount; level++)
+	{
+		const KTX2Level& source = levels[level];
+		const uint8_t* blocks = image.FlippedBlocks.empty() ? source.Data : flipped;
+		flipped += source.Size;
+		const GLsizei size = static_cast<GLsizei>(source.Size);
+		if (immutable)
+			GL_CHECK(glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, source.Width, source.Height, internalFormat, size, blocks));
+		else
+			GL_CHECK(glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, source.Width, source.Height, 0, size, blocks));
+	}
+	if (!immutable)
+		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipCount - 1));
+}
+
+void TextureManager::FillTexture(unsigned int texture, const DecodedImage& image, const TextureOptions& options, unsigned int uploadBuffer)
+{
+	const int mipCount = options.Mipmaps ? GetMipCount(image.Width, image.Height) : 1;
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+	if (image.Compressed)
+		FillCompressedLevels(image, options, mipCount);
+	else
+		FillUncompressedLevels(image, options, mipCount, uploadBuffer);
+
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.Wrap));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.Wrap));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+void TextureManager::FillUncompressedLevels(const DecodedImage& image, const TextureOptions& options, int mipCount, unsigned int uploadBuffer)
+{
+	const GLenum internalFormat = GetInternalFormat(image.Channels, options.SRGB);
+	const GLenum pixelFormat = GetPixelFormat(image.Channels);
+	if (HasImmutableStorage())
+	{
+		GL_CHECK(glTexStorage2D(GL_TEXTURE_2D, mipCount, internalFormat, image.Width, image.Height));
+	}
+	else
+	{
+		// Same levels by hand, the max level keeps the texture complete
+		for (int level = 0, w = image.Width, h = image.Height; level < mipCount; level++, w = std::max(w / 2, 1), h = std::max(h / 2, 1))
+			GL_CHECK(glTexImage2D(GL_TEXTURE_2D, level, internalFormat, w, h, 0, pixelFormat, GL_UNSIGNED_BYTE, nullptr));
+		GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipCount - 1));
+	}
+
+	// The pixel pointer is an offset into whatever buffer is bound to GL_PIXEL_UNPACK_BUFFER
+	const void* pixels = image.Pixels;
+	if (image.Staging)
+	{
+		GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, image.Staging->GetBufferID()));
+		pixels = reinterpret_cast<const void*>(image.Staging->GetOffset(image.Pixels));
+	}
+	else if (uploadBuffer)
+	{
+		// Orphaning gives a fresh block each time, the driver copies out of it when the GPU gets
+		// to the upload instead of the CPU waiting for the previous one
+		const size_t size = static_cast<size_t>(image.Width) * image.Height * image.Channels;
+		GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffer));
+		GL_CHECK(glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW));
+		void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		// Unmap is false when the contents got lost, send the pixels straight from memory instead
+		if (mapped)
+			std::memcpy(mapped, image.Pixels, size);
+		if (mapped && glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE)
+			pixels = nullptr;
+		else
+			GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+	}
+
+	// Rows of 1 and 3 channel images are not 4 byte aligned in general
+	GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+	GL_CHECK(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.Width, image.Height, pixelFormat, GL_UNSIGNED_BYTE, pixels));
+	GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+	GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+	if (mipCount > 1)
+		GL_CHECK(glGenerateMipmap(GL_TEXTURE_2D));
+
+	// Grey images read as grey, not red
+	if (image.Channels <= 2)
+	{
+		const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, image.Channels == 2 ? GL_GREEN : GL_ONE };
+		GL_CHECK(glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle));
+	}
+}
+
+void TextureManager::Upload(TextureHandle handle, DecodedImage& image)
+{
+	Entry& entry = _entries[handle];
+	GL_CHECK(glGenTextures(1, &entry.Texture));
+	FillTexture(entry.Texture, image, entry.Options, _uploadBuffer);
+	if (image.Staging)
+	{
+		// The block is reused once the GPU has read it
+		image.Staging->Retire(image.Pixels);
+		image.Staging = nullptr;
+		image.Pixels = nullptr;
+	}
+	entry.State = EntryState::Ready;
+}
+
+void TextureManager::UploadInBackground(TextureHandle handle, DecodedImage&& image)
+{
+	// The name is shared with the upload context, the texture itself only exists once it ran
+	BackgroundUpload upload;
+	upload.Handle = handle;
+	GL_CHECK(glGenTextures(1, &upload.Texture));
+	auto shared = std::make_shared<DecodedImage>(std::move(image));
+	const unsigned int texture = upload.Texture;
+	const TextureOptions options = _entries[handle].Options;
+	// A staging block goes back to its buffer with the last reference, the fence has signalled by then
+	upload.Image = shared;
+	upload.Fence = _uploadContext->Submit([texture, shared, options]() { FillTexture(texture, *shared, options, 0); });
+	_entries[handle].State = EntryState::Uploading;
+	_backgroundUploads.push_back(std::move(upload));
+}
+
+void TextureManager::AdoptBackgroundUploads(bool wait)
+{
+	for (size_t i = 0; i < _backgroundUploads.size();)
+	{
+		BackgroundUpload& upload = _backgroundUploads[i];
+		if (!upload.Sync)
+		{
+			if (!wait && upload.Fence.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				i++;
+				continue;
+			}
+			upload.Sync = upload.Fence.get();
+		}
+		if (wait)
+			glClientWaitSync(upload.Sync, 0, std::numeric_limits<GLuint64>::max());
+		else if (!UploadContext::IsSignalled(upload.Sync))
+		{
+			i++;
+			continue;
+		}
+		glDeleteSync(upload.Sync);
+
+		Entry& entry = _entries[upload.Handle];
+		if (entry.RefCount == 0)
+		{
+			glDeleteTextures(1, &upload.Texture);
+			FreeEntry(upload.Handle);
+		}
+		else
+		{
+			entry.Texture = upload.Texture;
+			entry.State = EntryState::Ready;
+		}
+		_backgroundUploads[i] = std::move(_backgroundUploads.back());
+		_backgroundUploads.pop_back();
+	}
+}
+
+void TextureManager::CollectFinishedJobs(bool wait)
+{
+	for (size_t i = 0; i < _jobs.size();)
+	{
+		if (!wait && _jobs[i].Result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			i++;
+			continue;
+		}
+		const TextureHandle handle = _jobs[i].Handle;
+		DecodedImage image = _jobs[i].Result.get();
+		_jobs[i] = std::move(_jobs.back());
+		_jobs.pop_back();
+		if (Complete(handle, image))
+			_uploads.emplace_back(handle, std::move(image));
+	}
+}
+
+TextureHandle TextureManager::Load(const std::string& path, const TextureOptions& options /*= TextureOptions()*/)
+{
+	const std::string key = path + "|" + std::to_string(GetOptionBits(options));
+	auto byPath = _byPath.find(key);
+	if (byPath != _byPath.end())
+	{
+		Acquire(byPath->second);
+		return byPath->second;
+	}
+
+	const TextureHandle handle = AddPending(path, key, options);
+	DecodedImage image = Decode(handle, path, options);
+	if (Complete(handle, image))
+		Upload(handle, image);
+	if (_entries[handle].State == EntryState::Failed)
+	{
+		Release(handle);
+		return 0;
+	}
+	return handle;
+}
+
+TextureHandle TextureManager::LoadAsync(const std::string& path, ThreadPool& pool, const TextureOptions& options /*= TextureOptions()*/)
+{
+	const std::string key = path + "|" + std::to_string(GetOptionBits(options));
+	auto byPath = _byPath.find(key);
+	if (byPath != _byPath.end())
+	{
+		Acquire(byPath->second);
+		return byPath->second;
+	}
+
+	const TextureHandle handle = AddPending(path, key, options);
+	_jobs.push_back({ handle, pool.Submit([this, handle, path, options]() { return Decode(handle, path, options); }) });
+	return handle;
+}
+
+void TextureManager::Acquire(TextureHandle handle)
+{
+	if (handle != 0 && handle < _entries.size() && _entries[handle].RefCount > 0)
+		_entries[handle].RefCount++;
+}
+
+void TextureManager::Release(TextureHandle handle)
+{
+	if (handle == 0 || handle >= _entries.size() || _entries[handle].RefCount == 0)
+		return;
+
+	Entry& entry = _entries[handle];
+	if (--entry.RefCount > 0)
+		return;
+
+	// Nothing resolves to it anymore, the slot itself waits for its decode or upload to finish
+	for (auto it = _byPath.begin(); it != _byPath.end();)
+		it = it->second == handle ? _byPath.erase(it) : std::next(it);
+	if (entry.State == EntryState::Ready || entry.State == EntryState::Failed)
+		FreeEntry(handle);
+}
+
+void TextureManager::Update(float budgetMilliseconds /*= TextureDefaults::UPLOAD_BUDGET_MILLISECONDS*/)
+{
+	CollectFinishedJobs(false);
+	if (_staging)
+		_staging->Poll();
+
+	// Nothing to budget, the render thread only hands images over and picks up fenced textures
+	if (_uploadContext)
+	{
+		while (!_uploads.empty())
+		{
+			const TextureHandle handle = _uploads.front().first;
+			DecodedImage image = std::move(_uploads.front().second);
+			_uploads.pop_front();
+			if (_entries[handle].RefCount == 0)
+				FreeEntry(handle);
+			else
+				UploadInBackground(handle, std::move(image));
+		}
+		AdoptBackgroundUploads(false);
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	bool uploaded = false;
+	while (!_uploads.empty())
+	{
+		if (uploaded && std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMilliseconds)
+			break;
+
+		const TextureHandle handle = _uploads.front().first;
+		DecodedImage image = std::move(_uploads.front().second);
+		_uploads.pop_front();
+		if (_entries[handle].RefCount == 0)
+		{
+			FreeEntry(handle);
+			continue;
+		}
+		Upload(handle, image);
+		uploaded = true;
+	}
+}
+
+void TextureManager::Finish()
+{
+	CollectFinishedJobs(true);
+	Update(std::numeric_limits<float>::infinity());
+	AdoptBackgroundUploads(true);
+}
+
+void TextureManager::Bind(TextureHandle handle, unsigned int unit) const
+{
+	GL_CHECK(glActiveTexture(GL_TEXTURE0 + unit));
+	GL_CHECK(glBindTexture(GL_TEXTURE_2D, GetTexture(handle)));
+}
+
+unsigned int TextureManager::GetTexture(TextureHandle handle) const
+{
+	if (handle == 0 || handle >= _entries.size() || _entries[handle].RefCount == 0)
+		return 0;
+
+	const Entry& entry = _entries[handle];
+	if (entry.Source)
+		return GetTexture(entry.Source);
+	return entry.State == EntryState::Ready ? entry.Texture : _placeholder;
+}
+
+bool TextureManager::IsReady(TextureHandle handle) const
+{
+	if (handle == 0 || handle >= _entries.size() || _entries[handle].RefCount == 0)
+		return false;
+
+	const Entry& entry = _entries[handle];
+	if (entry.Source)
+		return IsReady(entry.Source);
+	return entry.State == EntryState::Ready;
+}
+
+uint32_t TextureManager::GetTextureCount() const
+{
+	uint32_t count = 0;
+	for (const Entry& entry : _entries)
+	{
+		if (entry.Texture)
+			count++;
+	}
+	return count;
+}
+
+uint32_t TextureManager::GetPendingCount() const
+{
+	return static_cast<uint32_t>(_jobs.size() + _uploads.size() + _backgroundUploads.size());
+}
+
+size_t TextureManager::GetMemoryUsage() const
+{
+	size_t bytes = 0;
+	for (const Entry& entry : _entries)
+	{
+		if (entry.Texture)
+			bytes += entry.MemoryBytes;
+	}
+	return bytes;
+}
+
+uint32_t TextureManager::GetDecodeCount() const
+{
+	return _decodeCount;
+}
@@ -0,0 +1,198 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <glad/glad.h>
+#include "PixelStagingBuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class KTX2File;
+class ThreadPool;
+class UploadContext;
+
+namespace TextureDefaults
+{
+	// GL thread time Update spends uploading per frame, one texture always goes up regardless
+	constexpr float UPLOAD_BUDGET_MILLISECONDS = 2.f;
+}
+
+// 0 is never a valid handle
+using TextureHandle = uint32_t;
+
+struct TextureOptions
+{
+	// Color data, the sampler decodes it to linear. Ignored for one and two channel images.
+	bool SRGB = false;
+	// OpenGL's first row is the bottom one, most image files start at the top
+	bool FlipVertically = false;
+	GLint Wrap = GL_REPEAT;
+	bool Mipmaps = true;
+};
+
+// Owns every file backed 2D texture. A path already loaded with the same options returns its
+// handle, a different path with byte identical contents shares its texture, so a texture used
+// by many materials is decoded and uploaded once. Handles are refcounted, the last Release
+// frees it. Storage is immutable (glTexStorage2D) on GL 4.2+, the format follows the channels.
+//
+// LoadAsync reads, hashes and decodes on the thread pool. Update uploads finished images on the
+// GL thread through a pixel buffer object within a time budget, until then the handle binds a
+// grey placeholder. On GL 4.4+ the decoder writes its output straight into a persistently
+// mapped staging buffer, so there is no heap image and no copy into the buffer. With an
+// UploadContext the uploads run on its thread instead, a texture is used once its fence signalled.
+//
+// A source cooked by "Cook textures" into a current KTX2 loads from that instead: the blocks are
+// mapped and go to glCompressedTex* as they are. Without S3TC support the source is decoded.
+class TextureManager
+{
+private:
+	enum class EntryState
+	{
+		Pending,
+		// Filled by the upload context, waiting for its fence
+		Uploading,
+		Ready,
+		Failed
+	};
+
+	struct Entry
+	{
+		unsigned int Texture = 0;
+		EntryState State = EntryState::Pending;
+		// Byte identical to this handle's image, its texture is used instead of a copy
+		TextureHandle Source = 0;
+		std::string Path;
+		std::string Key;
+		uint64_t ContentKey = 0;
+		uint32_t RefCount = 0;
+		TextureOptions Options;
+		int Width = 0;
+		int Height = 0;
+		int Channels = 0;
+		size_t MemoryBytes = 0;
+	};
+
+	// Owns the stb allocation, the staging block or the cooked file
+	struct DecodedImage
+	{
+		unsigned char* Pixels = nullptr;
+		// Pixels live in this buffer instead of the heap
+		PixelStagingBuffer* Staging = nullptr;
+		// Cooked levels instead of Pixels
+		std::unique_ptr<KTX2File> Compressed;
+		// Every level of Compressed back to back, flipped, when the options flip
+		std::vector<uint8_t> FlippedBlocks;
+		int Width = 0;
+		int Height = 0;
+		int Channels = 0;
+		uint64_t ContentKey = 0;
+		// Set instead of decoding when another handle already claimed the same bytes
+		TextureHandle DuplicateOf = 0;
+
+		DecodedImage() = default;
+		DecodedImage(DecodedImage&& other) noexcept;
+		DecodedImage& operator=(DecodedImage&& other) noexcept;
+		~DecodedImage();
+	};
+
+	struct DecodeJob
+	{
+		TextureHandle Handle;
+		std::future<DecodedImage> Result;
+	};
+
+	struct BackgroundUpload
+	{
+		TextureHandle Handle = 0;
+		unsigned int Texture = 0;
+		std::shared_ptr<DecodedImage> Image;
+		std::future<GLsync> Fence;
+		// Taken out of Fence once the task ran
+		GLsync Sync = nullptr;
+	};
+
+	// Slot 0 stays empty, handle i is _entries[i]
+	std::vector<Entry> _entries;
+	std::vector<TextureHandle> _freeSlots;
+	std::unordered_map<std::string, TextureHandle> _byPath;
+	// Claimed by the worker that hashed the bytes first, read and written from workers
+	std::unordered_map<uint64_t, TextureHandle> _byContent;
+	std::mutex _contentMutex;
+
+	// Outlives the decoded images below, they hand their blocks back to it
+	std::unique_ptr<PixelStagingBuffer> _staging;
+	UploadContext* _uploadContext;
+	std::vector<DecodeJob> _jobs;
+	// Decoded and waiting for GL thread time, oldest first
+	std::deque<std::pair<TextureHandle, DecodedImage>> _uploads;
+	std::vector<BackgroundUpload> _backgroundUploads;
+	unsigned int _uploadBuffer;
+	unsigned int _placeholder;
+	// Read by workers, set once on the GL thread
+	bool _blockCompression;
+	bool _blockCompressionSRGB;
+	std::atomic<uint32_t> _decodeCount;
+
+	TextureHandle AddEntry(Entry&& entry);
+	void FreeEntry(TextureHandle handle);
+	TextureHandle AddPending(const std::string& path, const std::string& key, const TextureOptions& options);
+	// Safe on any thread, the content claim is the only shared state it touches
+	DecodedImage Decode(TextureHandle handle, const std::string& path, const TextureOptions& options);
+	// False without a cooked file for exactly these source bytes, or one the options can't flip
+	static bool LoadCooked(const std::string& path, uint64_t sourceHash, const TextureOptions& options, DecodedImage& image);
+	static size_t GetImageMemory(const DecodedImage& image, const TextureOptions& options);
+	// Bookkeeping for a finished decode, true if the image still has to be uploaded
+	bool Complete(TextureHandle handle, DecodedImage& image);
+	// Any context, pixels from client memory without an upload buffer unless staged
+	static void FillTexture(unsigned int texture, const DecodedImage& image, const TextureOptions& options, unsigned int uploadBuffer);
+	static void FillCompressedLevels(const DecodedImage& image, const TextureOptions& options, int mipCount);
+	static void FillUncompressedLevels(const DecodedImage& image, const TextureOptions& options, int mipCount, unsigned int uploadBuffer);
+	void Upload(TextureHandle handle, DecodedImage& image);
+	void UploadInBackground(TextureHandle handle, DecodedImage&& image);
+	void AdoptBackgroundUploads(bool wait);
+	void CollectFinishedJobs(bool wait);
+
+public:
+	// Uploads on the calling thread without an upload context
+	explicit TextureManager(UploadContext* uploadContext = nullptr);
+	~TextureManager();
+
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	static bool HasImmutableStorage();
+
+	// Takes a reference, decoded and uploaded before returning. 0 if the file can't be read or decoded.
+	TextureHandle Load(const std::string& path, const TextureOptions& options = TextureOptions());
+	// Takes a reference and returns right away, the placeholder binds until Update uploads it
+	TextureHandle LoadAsync(const std::string& path, ThreadPool& pool, const TextureOptions& options = TextureOptions());
+	void Acquire(TextureHandle handle);
+	void Release(TextureHandle handle);
+
+	// GL thread, once per frame
+	void Update(float budgetMilliseconds = TextureDefaults::UPLOAD_BUDGET_MILLISECONDS);
+	// Blocks until everything loaded so far is uploaded
+	void Finish();
+
+	void Bind(TextureHandle handle, unsigned int unit) const;
+	// The placeholder until uploaded and for a failed load
+	unsigned int GetTexture(TextureHandle handle) const;
+	bool IsReady(TextureHandle handle) const;
+	// GL textures, byte identical images share one
+	uint32_t GetTextureCount() const;
+	// Decodes and uploads not done yet
+	uint32_t GetPendingCount() const;
+	// GPU bytes of the uploaded textures, mips included, 3 channel formats counted at 3 bytes a texel
+	size_t GetMemoryUsage() const;
+	// Images actually decoded or read cooked, every other Load was a cache hit
+	uint32_t GetDecodeCount() const;
+};
+
+#endif // TEXTURE_MANAGER_H
@@ -0,0 +1,82 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threadCount /*= 0*/)
+	: _stopping(false)
+{
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	_workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+		_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_condition.notify_all();
+
+	for (std::thread& worker : _workers)
+		worker.join();
+}
+
+unsigned int ThreadPool::GetThreadCount() const
+{
+	return static_cast<unsigned int>(_workers.size());
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+
+			// Drain what is left before shutting down so no future is left hanging
+			if (_tasks.empty())
+				return;
+
+			task = std::move(_tasks.front());
+			_tasks.pop();
+		}
+		task();
+	}
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_tasks.push(std::move(task));
+	}
+	_condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)>& func)
+{
+	if (count == 0)
+		return;
+
+	chunkSize = std::max(chunkSize, 1u);
+	std::vector<std::future<void>> pending;
+	pending.reserve((count + chunkSize - 1) / chunkSize);
+
+	for (uint32_t begin = 0; begin < count; begin += chunkSize)
+	{
+		uint32_t end = std::min(begin + chunkSize, count);
+		pending.push_back(Submit([&func, begin, end]() { func(begin, end); }));
+	}
+
+	for (std::future<void>& future : pending)
+		future.get();
+}
@@ -0,0 +1,51 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+private:
+	std::vector<std::thread> _workers;
+	std::queue<std::function<void()>> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	bool _stopping;
+
+	void WorkerLoop();
+	void Enqueue(std::function<void()> task);
+
+public:
+	// 0 picks one worker per hardware thread, minus the render thread
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned int GetThreadCount() const;
+
+	template<typename Func>
+	auto Submit(Func&& func) -> std::future<decltype(func())>
+	{
+		using Result = decltype(func());
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+		std::future<Result> future = task->get_future();
+		Enqueue([task]() { (*task)(); });
+		return future;
+	}
+
+	// Splits [0, count) into chunks and blocks until all of them ran.
+	// Must not be called from inside a pool task.
+	void ParallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)>& func);
+};
+
+#endif // THREAD_POOL_H
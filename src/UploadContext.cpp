@@ -0,0 +1,86 @@
+#include "UploadContext.h"
+
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+
+UploadContext::UploadContext(GLFWwindow* sharedWith)
+	: _window(nullptr), _stopping(false)
+{
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	_window = glfwCreateWindow(1, 1, "Upload", nullptr, sharedWith);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (!_window)
+	{
+		std::cout << "ERROR::UPLOAD_CONTEXT::CREATION_FAILED: uploads stay on the render thread\n";
+		return;
+	}
+
+	_thread = std::thread(&UploadContext::ThreadLoop, this);
+}
+
+UploadContext::~UploadContext()
+{
+	if (!_window)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_condition.notify_all();
+	_thread.join();
+	glfwDestroyWindow(_window);
+}
+
+bool UploadContext::IsValid() const
+{
+	return _window != nullptr;
+}
+
+void UploadContext::ThreadLoop()
+{
+	glfwMakeContextCurrent(_window);
+	while (true)
+	{
+		std::packaged_task<GLsync()> task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+
+			// Drain what is left before shutting down so no future is left hanging
+			if (_tasks.empty())
+				break;
+
+			task = std::move(_tasks.front());
+			_tasks.pop();
+		}
+		task();
+	}
+	glfwMakeContextCurrent(nullptr);
+}
+
+std::future<GLsync> UploadContext::Submit(std::function<void()> task)
+{
+	std::packaged_task<GLsync()> wrapped([task = std::move(task)]()
+		{
+			task();
+			GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			// An unflushed fence may never signal for a wait from another context
+			glFlush();
+			return fence;
+		});
+	std::future<GLsync> fence = wrapped.get_future();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_tasks.push(std::move(wrapped));
+	}
+	_condition.notify_one();
+	return fence;
+}
+
+bool UploadContext::IsSignalled(GLsync fence)
+{
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
@@ -0,0 +1,49 @@
+#ifndef UPLOAD_CONTEXT_H
+#define UPLOAD_CONTEXT_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+struct GLFWwindow;
+
+// Hidden window sharing its objects with the main one, its context current on a thread of its
+// own. Tasks create and fill textures and buffers there in submission order, each followed by
+// a fence, so large uploads don't compete with frame submission. The render thread may use
+// what a task made once its fence signalled.
+class UploadContext
+{
+private:
+	GLFWwindow* _window;
+	std::thread _thread;
+	std::queue<std::packaged_task<GLsync()>> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	bool _stopping;
+
+	void ThreadLoop();
+
+public:
+	// Call on the main thread, with the same window hints the shared window was created with
+	explicit UploadContext(GLFWwindow* sharedWith);
+	// Before glfwTerminate, runs what is queued first
+	~UploadContext();
+
+	UploadContext(const UploadContext&) = delete;
+	UploadContext& operator=(const UploadContext&) = delete;
+
+	// False when the shared context could not be created, upload on the render thread then
+	bool IsValid() const;
+
+	// The future holds the fence, already flushed so another context can wait on it
+	std::future<GLsync> Submit(std::function<void()> task);
+	// Zero timeout, for polling on the render thread
+	static bool IsSignalled(GLsync fence);
+};
+
+#endif // UPLOAD_CONTEXT_H
@@ -0,0 +1,31 @@
+#ifndef UTILITIES_H
+#define UTILITIES_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a, what the cooked files and caches key their sources with
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+inline void MixHash(uint64_t& hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+}
+
+// Full chain down to 1x1
+inline int GetMipCount(int width, int height)
+{
+	int count = 1;
+	for (int size = std::max(width, height); size > 1; size /= 2)
+		count++;
+	return count;
+}
+
+#endif // UTILITIES_H
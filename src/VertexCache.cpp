@@ -0,0 +1,233 @@
+#include "VertexCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace VertexCacheDefaults;
+
+namespace
+{
+	bool LessVertex(const Vertex& a, const Vertex& b)
+	{
+		return std::memcmp(&a, &b, sizeof(Vertex)) < 0;
+	}
+
+	bool SameVertex(const Vertex& a, const Vertex& b)
+	{
+		return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+	}
+
+	float VertexScore(int cachePosition, uint32_t remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+			return -1.f;
+
+		float score = 0.f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+				score = LAST_TRIANGLE_SCORE;
+			else
+				score = std::pow(1.f - static_cast<float>(cachePosition - 3) / (OPTIMIZE_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+		}
+		return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+	}
+}
+
+void DeduplicateVertices(MeshData& data)
+{
+	const uint32_t vertexCount = static_cast<uint32_t>(data.Vertices.size());
+	std::vector<uint32_t> order(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return LessVertex(data.Vertices[a], data.Vertices[b]); });
+
+	// Every vertex points at the first of its duplicates
+	std::vector<uint32_t> canonical(vertexCount);
+	for (size_t begin = 0; begin < order.size();)
+	{
+		size_t end = begin + 1;
+		while (end < order.size() && SameVertex(data.Vertices[order[begin]], data.Vertices[order[end]]))
+			end++;
+		for (size_t i = begin; i < end; i++)
+			canonical[order[i]] = order[begin];
+		begin = end;
+	}
+
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<Vertex> vertices;
+	vertices.reserve(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		if (canonical[i] == i)
+		{
+			remap[i] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(data.Vertices[i]);
+		}
+		else
+		{
+			remap[i] = remap[canonical[i]];
+		}
+	}
+
+	for (uint32_t& index : data.Indices)
+		index = remap[index];
+	data.Vertices.swap(vertices);
+}
+
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2)
+		return;
+
+	// Triangles around every vertex, CSR style; emitted ones get swapped out of the live range
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < indexCount; i++)
+		triangleOffsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		triangleOffsets[v + 1] += triangleOffsets[v];
+	std::vector<uint32_t> remaining(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		remaining[v] = triangleOffsets[v + 1] - triangleOffsets[v];
+	std::vector<uint32_t> vertexTriangles(indexCount);
+	std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+	for (size_t i = 0; i < indexCount; i++)
+		vertexTriangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+
+	// Three slots of slack for the vertices pushed in ahead of the ones falling out
+	std::vector<uint32_t> cache, nextCache;
+	cache.reserve(OPTIMIZE_CACHE_SIZE + 3);
+	nextCache.reserve(OPTIMIZE_CACHE_SIZE + 3);
+
+	int64_t best = static_cast<int64_t>(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+	size_t deadEndCursor = 0;
+	while (best >= 0)
+	{
+		const uint32_t* triangle = &indices[best * 3];
+		emitted[best] = true;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = triangle[corner];
+			output.push_back(vertex);
+
+			// Drop the triangle from the vertex's live list, once even if the triangle is degenerate
+			uint32_t* begin = &vertexTriangles[triangleOffsets[vertex]];
+			uint32_t* end = begin + remaining[vertex];
+			uint32_t* found = std::find(begin, end, static_cast<uint32_t>(best));
+			if (found != end)
+			{
+				*found = *(end - 1);
+				remaining[vertex]--;
+			}
+		}
+
+		// Most recently used first
+		nextCache.assign(triangle, triangle + 3);
+		for (uint32_t vertex : cache)
+		{
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+				nextCache.push_back(vertex);
+		}
+		for (size_t i = OPTIMIZE_CACHE_SIZE; i < nextCache.size(); i++)
+			vertexScores[nextCache[i]] = VertexScore(-1, remaining[nextCache[i]]);
+		if (nextCache.size() > OPTIMIZE_CACHE_SIZE)
+			nextCache.resize(OPTIMIZE_CACHE_SIZE);
+		cache.swap(nextCache);
+
+		for (size_t i = 0; i < cache.size(); i++)
+			vertexScores[cache[i]] = VertexScore(static_cast<int>(i), remaining[cache[i]]);
+
+		// Only triangles touching the cache changed score, the next one comes from among them
+		best = -1;
+		float bestScore = -1.f;
+		for (uint32_t vertex : cache)
+		{
+			for (uint32_t t = triangleOffsets[vertex]; t < triangleOffsets[vertex] + remaining[vertex]; t++)
+			{
+				uint32_t candidate = vertexTriangles[t];
+				const uint32_t* corners = &indices[candidate * 3];
+				float score = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+				triangleScores[candidate] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					best = candidate;
+				}
+			}
+		}
+
+		// Dead end, carry on with the first triangle not written yet
+		if (best < 0)
+		{
+			while (deadEndCursor < triangleCount && emitted[deadEndCursor])
+				deadEndCursor++;
+			if (deadEndCursor < triangleCount)
+				best = static_cast<int64_t>(deadEndCursor);
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+float ComputeACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize /*= VertexCacheDefaults::MEASURE_CACHE_SIZE*/)
+{
+	if (indexCount < 3)
+		return 0.f;
+
+	// Time stamp of each vertex's last insertion, a vertex is cached while fewer than cacheSize entered after it
+	std::vector<size_t> insertedAt(vertexCount, 0);
+	size_t misses = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		size_t& stamp = insertedAt[indices[i]];
+		if (stamp == 0 || misses + 1 - stamp > cacheSize)
+		{
+			misses++;
+			stamp = misses;
+		}
+	}
+	return static_cast<float>(misses) / (indexCount / 3);
+}
+
+VertexCacheStats OptimizeVertexCache(MeshData& data)
+{
+	VertexCacheStats stats;
+	if (data.LODs.empty())
+		data.LODs.push_back({ 0, static_cast<uint32_t>(data.Indices.size()), 0.f });
+
+	const size_t vertexCount = data.Vertices.size();
+	const MeshLOD& finest = data.LODs[0];
+	stats.ACMRBefore = ComputeACMR(&data.Indices[finest.FirstIndex], finest.IndexCount, vertexCount);
+
+	for (size_t lod = 0; lod < data.LODs.size(); lod++)
+	{
+		const MeshLOD& range = data.LODs[lod];
+		if (lod == 0 && !data.Meshlets.empty())
+		{
+			for (const Meshlet& meshlet : data.Meshlets)
+				OptimizeVertexCache(&data.Indices[meshlet.FirstIndex], meshlet.IndexCount, vertexCount);
+		}
+		else
+		{
+			OptimizeVertexCache(&data.Indices[range.FirstIndex], range.IndexCount, vertexCount);
+		}
+	}
+
+	stats.ACMRAfter = ComputeACMR(&data.Indices[finest.FirstIndex], finest.IndexCount, vertexCount);
+	return stats;
+}
@@ -0,0 +1,42 @@
+#ifndef VERTEX_CACHE_H
+#define VERTEX_CACHE_H
+
+#include "Mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace VertexCacheDefaults
+{
+	// LRU size the Forsyth scores are tuned for
+	constexpr uint32_t OPTIMIZE_CACHE_SIZE = 32;
+	constexpr float CACHE_DECAY_POWER = 1.5f;
+	// The last triangle's vertices score a bit lower so strips don't just turn back on themselves
+	constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+	// Favour vertices with few triangles left, finishing them frees their cache slot for good
+	constexpr float VALENCE_BOOST_SCALE = 2.f;
+	constexpr float VALENCE_BOOST_POWER = 0.5f;
+	// FIFO size the ACMR is measured with, close to what post-transform caches hold
+	constexpr uint32_t MEASURE_CACHE_SIZE = 16;
+}
+
+struct VertexCacheStats
+{
+	// Average cache misses per triangle of LOD 0, 0.5 is the limit for large regular grids, 3 means no reuse
+	float ACMRBefore = 0.f;
+	float ACMRAfter = 0.f;
+};
+
+// Welds bit identical vertices and remaps every index, the vertices keep their first use order
+void DeduplicateVertices(MeshData& data);
+
+// Forsyth's linear speed vertex cache optimization of one triangle list, reordered in place
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+// Misses per triangle in a FIFO post-transform cache
+float ComputeACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+	uint32_t cacheSize = VertexCacheDefaults::MEASURE_CACHE_SIZE);
+
+// Every LOD range on its own, LOD 0 meshlet by meshlet so the partition stays contiguous
+VertexCacheStats OptimizeVertexCache(MeshData& data);
+
+#endif // VERTEX_CACHE_H
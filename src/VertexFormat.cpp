@@ -0,0 +1,138 @@
+#include "VertexFormat.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+	uint16_t QuantizeUnorm16(float value)
+	{
+		return static_cast<uint16_t>(std::lround(std::clamp(value, 0.f, 1.f) * 65535.f));
+	}
+
+	uint32_t QuantizeSnorm10(float value)
+	{
+		return static_cast<uint32_t>(std::lround(std::clamp(value, -1.f, 1.f) * 511.f)) & 0x3ffu;
+	}
+
+	float SignNotZero(float value)
+	{
+		return value >= 0.f ? 1.f : -1.f;
+	}
+}
+
+uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	const uint32_t sign = (bits >> 16) & 0x8000u;
+	const uint32_t biasedExponent = (bits >> 23) & 0xffu;
+	uint32_t mantissa = bits & 0x7fffffu;
+
+	// Inf and NaN keep their class
+	if (biasedExponent == 0xffu)
+		return static_cast<uint16_t>(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+
+	const int exponent = static_cast<int>(biasedExponent) - 127 + 15;
+	if (exponent >= 31)
+		return static_cast<uint16_t>(sign | 0x7c00u);
+
+	// Denormal half, round to nearest even on whatever gets shifted out
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+			return static_cast<uint16_t>(sign);
+
+		mantissa |= 0x800000u;
+		const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+		const uint32_t halfway = 1u << (shift - 1u);
+		if (remainder > halfway || (remainder == halfway && (half & 1u)))
+			half++;
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	// A carry out of the mantissa bumps the exponent, which is the right result
+	uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	const uint32_t remainder = mantissa & 0x1fffu;
+	if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+		half++;
+	return static_cast<uint16_t>(sign | half);
+}
+
+glm::vec2 EncodeOctahedral(const glm::vec3& normal)
+{
+	float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (length <= 0.f)
+		return glm::vec2(0.f);
+
+	glm::vec3 octahedron = normal / length;
+	glm::vec2 encoded(octahedron.x, octahedron.y);
+	// The lower half folds over the diagonals
+	if (octahedron.z < 0.f)
+		encoded = glm::vec2((1.f - std::abs(octahedron.y)) * SignNotZero(octahedron.x), (1.f - std::abs(octahedron.x)) * SignNotZero(octahedron.y));
+	return encoded;
+}
+
+glm::vec3 DecodeOctahedral(const glm::vec2& encoded)
+{
+	glm::vec3 normal(encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y));
+	float fold = std::max(-normal.z, 0.f);
+	normal.x += normal.x >= 0.f ? -fold : fold;
+	normal.y += normal.y >= 0.f ? -fold : fold;
+	return glm::normalize(normal);
+}
+
+MeshQuantization ComputeQuantization(const AABB& bounds)
+{
+	MeshQuantization quantization;
+	if (bounds.IsEmpty())
+	{
+		quantization.Offset = glm::vec4(0.f);
+		quantization.Scale = glm::vec4(0.f);
+		return quantization;
+	}
+
+	quantization.Offset = glm::vec4(bounds.Min, 0.f);
+	quantization.Scale = glm::vec4(bounds.Max - bounds.Min, 0.f);
+	return quantization;
+}
+
+std::vector<PackedVertex> PackVertices(const std::vector<Vertex>& vertices, const AABB& bounds)
+{
+	const MeshQuantization quantization = ComputeQuantization(bounds);
+	std::vector<PackedVertex> packed(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const Vertex& vertex = vertices[i];
+		PackedVertex& out = packed[i];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			// Flat axes have no extent to spread over, everything sits on the offset
+			float extent = quantization.Scale[axis];
+			out.Position[axis] = extent > 0.f ? QuantizeUnorm16((vertex.Position[axis] - quantization.Offset[axis]) / extent) : 0;
+		}
+		out.Position[3] = 0;
+		out.TexCoord[0] = FloatToHalf(vertex.TexCoord.x);
+		out.TexCoord[1] = FloatToHalf(vertex.TexCoord.y);
+
+		glm::vec2 octahedral = EncodeOctahedral(vertex.Normal);
+		out.Normal = QuantizeSnorm10(octahedral.x) | (QuantizeSnorm10(octahedral.y) << 10);
+	}
+	return packed;
+}
+
+void SetupPackedVertexAttributes()
+{
+	GL_CHECK(glEnableVertexAttribArray(0));
+	GL_CHECK(glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position)));
+	GL_CHECK(glEnableVertexAttribArray(1));
+	GL_CHECK(glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoord)));
+	GL_CHECK(glEnableVertexAttribArray(2));
+	GL_CHECK(glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal)));
+}
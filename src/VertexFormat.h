@@ -0,0 +1,59 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "AABB.h"
+#include "Mesh.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace VertexFormatDefaults
+{
+	// Uniform block binding of the per mesh dequantization, see resources/shaders/vertex_format.glsl
+	constexpr GLuint QUANTIZATION_BINDING = 0;
+	constexpr const char* QUANTIZATION_BLOCK = "MeshQuantization";
+}
+
+// GPU side vertex, 16 bytes against 32 for Vertex. The vertex fetch normalizes positions
+// to [0, 1] inside the mesh bounds and the shader scales them back, uvs are half floats and
+// the normal is octahedral encoded in the x and y of a snorm 10_10_10_2 (z and w are spare).
+struct PackedVertex
+{
+	uint16_t Position[4];
+	uint16_t TexCoord[2];
+	uint32_t Normal;
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex is uploaded as is");
+
+// std140 layout of the MeshQuantization block
+struct MeshQuantization
+{
+	glm::vec4 Offset;
+	glm::vec4 Scale;
+};
+
+// Already packed geometry in memory that outlives the upload, like a mapped mesh cache
+struct PackedMeshView
+{
+	const PackedVertex* Vertices;
+	uint32_t VertexCount;
+	const uint32_t* Indices;
+	uint32_t IndexCount;
+	MeshQuantization Quantization;
+	AABB Bounds;
+};
+
+uint16_t FloatToHalf(float value);
+// Unit vector onto the [-1, 1] square
+glm::vec2 EncodeOctahedral(const glm::vec3& normal);
+glm::vec3 DecodeOctahedral(const glm::vec2& encoded);
+
+MeshQuantization ComputeQuantization(const AABB& bounds);
+std::vector<PackedVertex> PackVertices(const std::vector<Vertex>& vertices, const AABB& bounds);
+
+// Attribute pointers for the currently bound VAO and vertex buffer
+void SetupPackedVertexAttributes();
+
+#endif // VERTEX_FORMAT_H
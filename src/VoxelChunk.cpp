@@ -0,0 +1,181 @@
+#include "VoxelChunk.h"
+
+#include <algorithm>
+
+using namespace VoxelDefaults;
+
+namespace
+{
+	// Power of two widths only, a word then holds a whole number of indices
+	uint32_t GetBitsForPalette(size_t paletteSize)
+	{
+		uint32_t bits = 0;
+		while ((size_t(1) << bits) < paletteSize)
+			bits = bits == 0 ? 1 : bits * 2;
+		return bits;
+	}
+
+	size_t GetWordCount(uint32_t bits)
+	{
+		if (bits == 0)
+			return 0;
+		const uint32_t perWord = 64 / bits;
+		return (CHUNK_VOLUME + perWord - 1) / perWord;
+	}
+}
+
+VoxelChunk::VoxelChunk()
+	: _palette(1, VoxelBlocks::AIR), _counts(1, CHUNK_VOLUME), _bits(0)
+{
+}
+
+uint32_t VoxelChunk::ToVoxelIndex(int x, int y, int z)
+{
+	return static_cast<uint32_t>((z * CHUNK_SIZE + y) * CHUNK_SIZE + x);
+}
+
+uint32_t VoxelChunk::GetPaletteIndex(uint32_t voxel) const
+{
+	if (_bits == 0)
+		return 0;
+	const uint32_t perWord = 64 / _bits;
+	const uint64_t word = _words[voxel / perWord];
+	const uint32_t shift = (voxel % perWord) * _bits;
+	return static_cast<uint32_t>((word >> shift) & ((uint64_t(1) << _bits) - 1));
+}
+
+void VoxelChunk::SetPaletteIndex(uint32_t voxel, uint32_t index)
+{
+	const uint32_t perWord = 64 / _bits;
+	uint64_t& word = _words[voxel / perWord];
+	const uint32_t shift = (voxel % perWord) * _bits;
+	const uint64_t mask = ((uint64_t(1) << _bits) - 1) << shift;
+	word = (word & ~mask) | (static_cast<uint64_t>(index) << shift);
+}
+
+void VoxelChunk::Repack(uint32_t bits)
+{
+	std::vector<uint32_t> indices(CHUNK_VOLUME);
+	for (uint32_t voxel = 0; voxel < CHUNK_VOLUME; voxel++)
+		indices[voxel] = GetPaletteIndex(voxel);
+
+	_bits = bits;
+	_words.assign(GetWordCount(bits), 0);
+	for (uint32_t voxel = 0; voxel < CHUNK_VOLUME; voxel++)
+		SetPaletteIndex(voxel, indices[voxel]);
+}
+
+BlockID VoxelChunk::Get(int x, int y, int z) const
+{
+	return _palette[GetPaletteIndex(ToVoxelIndex(x, y, z))];
+}
+
+void VoxelChunk::Set(int x, int y, int z, BlockID block)
+{
+	const uint32_t voxel = ToVoxelIndex(x, y, z);
+	const uint32_t oldIndex = GetPaletteIndex(voxel);
+	if (_palette[oldIndex] == block)
+		return;
+
+	// Existing entry, else a freed slot, else a new one which may need wider indices
+	uint32_t newIndex = static_cast<uint32_t>(std::find(_palette.begin(), _palette.end(), block) - _palette.begin());
+	if (newIndex == _palette.size())
+	{
+		newIndex = static_cast<uint32_t>(std::find(_counts.begin(), _counts.end(), 0u) - _counts.begin());
+		if (newIndex == _palette.size())
+		{
+			_palette.push_back(block);
+			_counts.push_back(0);
+			const uint32_t bits = GetBitsForPalette(_palette.size());
+			if (bits != _bits)
+				Repack(bits);
+		}
+		else
+		{
+			_palette[newIndex] = block;
+		}
+	}
+
+	SetPaletteIndex(voxel, newIndex);
+	_counts[oldIndex]--;
+	_counts[newIndex]++;
+}
+
+void VoxelChunk::Assign(const BlockID* blocks)
+{
+	_palette.clear();
+	_counts.clear();
+	std::vector<uint32_t> indices(CHUNK_VOLUME);
+	// Runs of the same block are the common case, the last hit skips the palette search
+	uint32_t lastIndex = 0;
+	for (uint32_t voxel = 0; voxel < CHUNK_VOLUME; voxel++)
+	{
+		const BlockID block = blocks[voxel];
+		if (_palette.empty() || _palette[lastIndex] != block)
+		{
+			lastIndex = static_cast<uint32_t>(std::find(_palette.begin(), _palette.end(), block) - _palette.begin());
+			if (lastIndex == _palette.size())
+			{
+				_palette.push_back(block);
+				_counts.push_back(0);
+			}
+		}
+		indices[voxel] = lastIndex;
+		_counts[lastIndex]++;
+	}
+
+	_bits = GetBitsForPalette(_palette.size());
+	_words.assign(GetWordCount(_bits), 0);
+	if (_bits == 0)
+		return;
+	for (uint32_t voxel = 0; voxel < CHUNK_VOLUME; voxel++)
+		SetPaletteIndex(voxel, indices[voxel]);
+}
+
+void VoxelChunk::Decode(BlockID* outBlocks) const
+{
+	if (_bits == 0)
+	{
+		std::fill(outBlocks, outBlocks + CHUNK_VOLUME, _palette[0]);
+		return;
+	}
+
+	// Whole words at a time
+	const uint32_t perWord = 64 / _bits;
+	const uint64_t mask = (uint64_t(1) << _bits) - 1;
+	uint32_t voxel = 0;
+	for (uint64_t word : _words)
+	{
+		for (uint32_t i = 0; i < perWord && voxel < CHUNK_VOLUME; i++, voxel++)
+		{
+			outBlocks[voxel] = _palette[word & mask];
+			word >>= _bits;
+		}
+	}
+}
+
+bool VoxelChunk::IsEmpty() const
+{
+	return GetSolidCount() == 0;
+}
+
+uint32_t VoxelChunk::GetSolidCount() const
+{
+	uint32_t air = 0;
+	for (size_t i = 0; i < _palette.size(); i++)
+	{
+		if (_palette[i] == VoxelBlocks::AIR)
+			air += _counts[i];
+	}
+	return CHUNK_VOLUME - air;
+}
+
+uint32_t VoxelChunk::GetPaletteSize() const
+{
+	return static_cast<uint32_t>(_palette.size());
+}
+
+size_t VoxelChunk::GetMemoryUsage() const
+{
+	return _palette.size() * (sizeof(BlockID) + sizeof(uint32_t)) + _words.size() * sizeof(uint64_t);
+}
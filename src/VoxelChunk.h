@@ -0,0 +1,62 @@
+#ifndef VOXEL_CHUNK_H
+#define VOXEL_CHUNK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using BlockID = uint16_t;
+
+namespace VoxelDefaults
+{
+	constexpr int CHUNK_SIZE = 32;
+	constexpr int CHUNK_VOLUME = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+}
+
+namespace VoxelBlocks
+{
+	constexpr BlockID AIR = 0;
+	constexpr BlockID GRASS = 1;
+	constexpr BlockID DIRT = 2;
+	constexpr BlockID STONE = 3;
+	constexpr BlockID SAND = 4;
+	constexpr BlockID COUNT = 5;
+}
+
+// 32^3 blocks stored as indices into a per chunk palette. Indices are bit packed at the
+// narrowest power of two width the palette fits in and never straddle a 64 bit word, a chunk
+// of a single block type keeps no indices at all. Voxels are x fastest, then y, then z.
+class VoxelChunk
+{
+private:
+	std::vector<BlockID> _palette;
+	// Voxels using every palette entry, a slot that drops to zero is reused by the next new block
+	std::vector<uint32_t> _counts;
+	std::vector<uint64_t> _words;
+	uint32_t _bits;
+
+	uint32_t GetPaletteIndex(uint32_t voxel) const;
+	void SetPaletteIndex(uint32_t voxel, uint32_t index);
+	// Rewrites every index at a new width
+	void Repack(uint32_t bits);
+
+public:
+	// All air
+	VoxelChunk();
+
+	static uint32_t ToVoxelIndex(int x, int y, int z);
+
+	BlockID Get(int x, int y, int z) const;
+	void Set(int x, int y, int z, BlockID block);
+	// Replaces the whole chunk from CHUNK_VOLUME dense blocks, the palette is rebuilt from scratch
+	void Assign(const BlockID* blocks);
+	// Writes CHUNK_VOLUME dense blocks
+	void Decode(BlockID* outBlocks) const;
+
+	bool IsEmpty() const;
+	uint32_t GetSolidCount() const;
+	uint32_t GetPaletteSize() const;
+	size_t GetMemoryUsage() const;
+};
+
+#endif // VOXEL_CHUNK_H
@@ -0,0 +1,96 @@
+#include "VoxelMesher.h"
+
+using namespace VoxelDefaults;
+using namespace VoxelMesherDefaults;
+
+uint32_t PackVoxelVertex(uint32_t x, uint32_t y, uint32_t z, VoxelFace face, BlockID block)
+{
+	return x | (y << 6) | (z << 12) | (static_cast<uint32_t>(face) << 18) | (static_cast<uint32_t>(block) << 21);
+}
+
+void GreedyMeshChunk(const BlockID* paddedBlocks, std::vector<uint32_t>& outVertices)
+{
+	outVertices.clear();
+
+	const int strides[3] = { 1, PADDED_SIZE, PADDED_SIZE * PADDED_SIZE };
+	BlockID mask[CHUNK_SIZE * CHUNK_SIZE];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// u x v points along the axis, so (u, v) order is counter clockwise seen from the positive side
+		const int u = (axis + 1) % 3;
+		const int v = (axis + 2) % 3;
+		for (int side = 0; side < 2; side++)
+		{
+			const int direction = side == 0 ? 1 : -1;
+			const VoxelFace face = static_cast<VoxelFace>(axis * 2 + side);
+			const int neighbourOffset = direction * strides[axis];
+
+			for (int slice = 0; slice < CHUNK_SIZE; slice++)
+			{
+				// Block of every visible face in the slice, air where there is none
+				bool anyVisible = false;
+				for (int b = 0; b < CHUNK_SIZE; b++)
+				{
+					int voxel = (slice + 1) * strides[axis] + (b + 1) * strides[v] + strides[u];
+					for (int a = 0; a < CHUNK_SIZE; a++, voxel += strides[u])
+					{
+						const BlockID block = paddedBlocks[voxel];
+						const BlockID visible = paddedBlocks[voxel + neighbourOffset] == VoxelBlocks::AIR ? block : VoxelBlocks::AIR;
+						mask[b * CHUNK_SIZE + a] = visible;
+						anyVisible |= visible != VoxelBlocks::AIR;
+					}
+				}
+				if (!anyVisible)
+					continue;
+
+				// Widest run first, then as many rows of the same run as match
+				const uint32_t depth = static_cast<uint32_t>(slice + (direction > 0 ? 1 : 0));
+				for (int b = 0; b < CHUNK_SIZE; b++)
+				{
+					for (int a = 0; a < CHUNK_SIZE;)
+					{
+						const BlockID block = mask[b * CHUNK_SIZE + a];
+						if (block == VoxelBlocks::AIR)
+						{
+							a++;
+							continue;
+						}
+
+						int width = 1;
+						while (a + width < CHUNK_SIZE && mask[b * CHUNK_SIZE + a + width] == block)
+							width++;
+						int height = 1;
+						for (; b + height < CHUNK_SIZE; height++)
+						{
+							const BlockID* row = &mask[(b + height) * CHUNK_SIZE + a];
+							int i = 0;
+							while (i < width && row[i] == block)
+								i++;
+							if (i < width)
+								break;
+						}
+						for (int row = b; row < b + height; row++)
+						{
+							for (int i = a; i < a + width; i++)
+								mask[row * CHUNK_SIZE + i] = VoxelBlocks::AIR;
+						}
+
+						const int cornersU[4] = { a, a + width, a + width, a };
+						const int cornersV[4] = { b, b, b + height, b + height };
+						for (int corner = 0; corner < 4; corner++)
+						{
+							// Reversed on the negative side so the quad still faces out
+							const int c = direction > 0 ? corner : (4 - corner) % 4;
+							uint32_t position[3];
+							position[axis] = depth;
+							position[u] = static_cast<uint32_t>(cornersU[c]);
+							position[v] = static_cast<uint32_t>(cornersV[c]);
+							outVertices.push_back(PackVoxelVertex(position[0], position[1], position[2], face, block));
+						}
+						a += width;
+					}
+				}
+			}
+		}
+	}
+}
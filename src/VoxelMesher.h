@@ -0,0 +1,37 @@
+#ifndef VOXEL_MESHER_H
+#define VOXEL_MESHER_H
+
+#include "VoxelChunk.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace VoxelMesherDefaults
+{
+	// The chunk plus one voxel of every face neighbour, for culling faces across chunk borders
+	constexpr int PADDED_SIZE = VoxelDefaults::CHUNK_SIZE + 2;
+	constexpr int PADDED_VOLUME = PADDED_SIZE * PADDED_SIZE * PADDED_SIZE;
+}
+
+// Faces in +X, -X, +Y, -Y, +Z, -Z order
+enum class VoxelFace : uint32_t
+{
+	PositiveX,
+	NegativeX,
+	PositiveY,
+	NegativeY,
+	PositiveZ,
+	NegativeZ,
+	Count
+};
+
+// One vertex in 32 bits: chunk local corner in 6 bits per axis, the face in 3 and the block in the top 11.
+// Quads are 4 consecutive vertices, counter clockwise seen from outside, the shared index pattern draws them.
+uint32_t PackVoxelVertex(uint32_t x, uint32_t y, uint32_t z, VoxelFace face, BlockID block);
+
+// Face culled greedy mesh of one chunk. Every slice of every face direction is merged into the
+// fewest rectangles of one block type, faces against solid voxels are never emitted.
+// paddedBlocks is PADDED_VOLUME blocks, x fastest, the chunk itself at [1, CHUNK_SIZE] on every axis.
+void GreedyMeshChunk(const BlockID* paddedBlocks, std::vector<uint32_t>& outVertices);
+
+#endif // VOXEL_MESHER_H
@@ -0,0 +1,462 @@
+#include "VoxelWorld.h"
+#include "Logger.h"
+#include "ThreadPool.h"
+#include "VoxelMesher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace VoxelDefaults;
+using namespace VoxelMesherDefaults;
+using namespace VoxelWorldDefaults;
+
+const glm::vec3 BLOCK_COLORS[VoxelBlocks::COUNT] = {
+	glm::vec3(0.f),
+	glm::vec3(0.35f, 0.65f, 0.25f),
+	glm::vec3(0.55f, 0.38f, 0.22f),
+	glm::vec3(0.55f, 0.55f, 0.58f),
+	glm::vec3(0.85f, 0.8f, 0.55f)
+};
+
+namespace
+{
+	// Every quad is two triangles, every chunk holds at most a checkerboard of them
+	constexpr uint32_t MAX_QUADS_PER_CHUNK = CHUNK_VOLUME / 2 * 6;
+}
+
+VoxelWorld::VoxelWorld(const glm::ivec3& sizeInChunks, const glm::vec3& origin)
+	: _shader("resources/shaders/voxel.vert", "resources/shaders/voxel.frag"),
+	_size(sizeInChunks), _origin(origin), _dirtyQueueSorted(true), _revision(0), _quadEBO(0), _quadCapacity(0)
+{
+	const size_t chunkCount = static_cast<size_t>(_size.x) * _size.y * _size.z;
+	_chunks.resize(chunkCount);
+	_meshes.resize(chunkCount);
+	_dirty.assign(chunkCount, false);
+	_meshing.assign(chunkCount, false);
+	_chunkRevisions.assign(chunkCount, 0);
+
+	GL_CHECK(glGenBuffers(1, &_quadEBO));
+}
+
+VoxelWorld::~VoxelWorld()
+{
+	// Jobs only own their snapshot, nothing to wait for
+	for (ChunkMesh& mesh : _meshes)
+	{
+		if (mesh.VAO)
+		{
+			glDeleteVertexArrays(1, &mesh.VAO);
+			glDeleteBuffers(1, &mesh.VBO);
+		}
+	}
+	glDeleteBuffers(1, &_quadEBO);
+}
+
+uint32_t VoxelWorld::GetChunkIndex(const glm::ivec3& chunk) const
+{
+	return static_cast<uint32_t>((chunk.z * _size.y + chunk.y) * _size.x + chunk.x);
+}
+
+bool VoxelWorld::IsInside(const glm::ivec3& chunk) const
+{
+	return chunk.x >= 0 && chunk.y >= 0 && chunk.z >= 0 && chunk.x < _size.x && chunk.y < _size.y && chunk.z < _size.z;
+}
+
+void VoxelWorld::MarkDirty(const glm::ivec3& chunk)
+{
+	const uint32_t index = GetChunkIndex(chunk);
+	if (_dirty[index])
+		return;
+	_dirty[index] = true;
+	_dirtyQueue.push_back(index);
+	_dirtyQueueSorted = false;
+}
+
+void VoxelWorld::CopyPadded(const glm::ivec3& chunk, BlockID* outBlocks) const
+{
+	std::fill(outBlocks, outBlocks + PADDED_VOLUME, VoxelBlocks::AIR);
+
+	// Interior row by row
+	std::vector<BlockID> dense(CHUNK_VOLUME);
+	_chunks[GetChunkIndex(chunk)].Decode(dense.data());
+	for (int z = 0; z < CHUNK_SIZE; z++)
+	{
+		for (int y = 0; y < CHUNK_SIZE; y++)
+		{
+			std::memcpy(&outBlocks[((z + 1) * PADDED_SIZE + y + 1) * PADDED_SIZE + 1],
+				&dense[VoxelChunk::ToVoxelIndex(0, y, z)], CHUNK_SIZE * sizeof(BlockID));
+		}
+	}
+
+	// The facing layer of every neighbour, edges and corners never decide a face
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const int u = (axis + 1) % 3;
+		const int v = (axis + 2) % 3;
+		for (int side = 0; side < 2; side++)
+		{
+			glm::ivec3 neighbour = chunk;
+			neighbour[axis] += side == 0 ? -1 : 1;
+			if (!IsInside(neighbour))
+				continue;
+			const VoxelChunk& other = _chunks[GetChunkIndex(neighbour)];
+			if (other.IsEmpty())
+				continue;
+
+			int source[3];
+			int target[3];
+			source[axis] = side == 0 ? CHUNK_SIZE - 1 : 0;
+			target[axis] = side == 0 ? 0 : PADDED_SIZE - 1;
+			for (int b = 0; b < CHUNK_SIZE; b++)
+			{
+				source[v] = b;
+				target[v] = b + 1;
+				for (int a = 0; a < CHUNK_SIZE; a++)
+				{
+					source[u] = a;
+					target[u] = a + 1;
+					outBlocks[(target[2] * PADDED_SIZE + target[1]) * PADDED_SIZE + target[0]] = other.Get(source[0], source[1], source[2]);
+				}
+			}
+		}
+	}
+}
+
+void VoxelWorld::EnsureQuadCapacity(uint32_t quadCount)
+{
+	if (quadCount <= _quadCapacity)
+		return;
+	_quadCapacity = std::min(std::max(quadCount, _quadCapacity * 2), MAX_QUADS_PER_CHUNK);
+
+	std::vector<uint32_t> indices;
+	indices.reserve(static_cast<size_t>(_quadCapacity) * 6);
+	for (uint32_t quad = 0; quad < _quadCapacity; quad++)
+	{
+		const uint32_t first = quad * 4;
+		indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+	}
+
+	// Not through the element target, that would rebind whatever VAO is current
+	GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, _quadEBO));
+	GL_CHECK(glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW));
+	GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+void VoxelWorld::Upload(uint32_t chunk, const std::vector<uint32_t>& vertices)
+{
+	ChunkMesh& mesh = _meshes[chunk];
+	mesh.QuadCount = static_cast<uint32_t>(vertices.size() / 4);
+	if (mesh.QuadCount == 0)
+		return;
+
+	EnsureQuadCapacity(mesh.QuadCount);
+	if (mesh.VAO == 0)
+	{
+		GL_CHECK(glGenVertexArrays(1, &mesh.VAO));
+		GL_CHECK(glGenBuffers(1, &mesh.VBO));
+		GL_CHECK(glBindVertexArray(mesh.VAO));
+		GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO));
+		GL_CHECK(glEnableVertexAttribArray(0));
+		GL_CHECK(glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0));
+		GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _quadEBO));
+		GL_CHECK(glBindVertexArray(0));
+	}
+
+	// Fresh storage every time, the driver keeps the old one alive for frames still drawing it
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO));
+	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(uint32_t), vertices.data(), GL_STATIC_DRAW));
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+void VoxelWorld::GenerateTerrain(const HeightField& field, int minHeight, int maxHeight, ThreadPool& pool)
+{
+	const glm::ivec3 voxels = _size * CHUNK_SIZE;
+	const int sandHeight = minHeight + (maxHeight - minHeight) / 4;
+	pool.ParallelFor(GetChunkCount(), 1, [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<BlockID> blocks(CHUNK_VOLUME);
+			for (uint32_t index = begin; index < end; index++)
+			{
+				const glm::ivec3 chunk(index % _size.x, (index / _size.x) % _size.y, index / (_size.x * _size.y));
+				for (int z = 0; z < CHUNK_SIZE; z++)
+				{
+					for (int x = 0; x < CHUNK_SIZE; x++)
+					{
+						const float u = static_cast<float>(chunk.x * CHUNK_SIZE + x) / (voxels.x - 1);
+						const float v = static_cast<float>(chunk.z * CHUNK_SIZE + z) / (voxels.z - 1);
+						const int height = minHeight + static_cast<int>(field.Sample(u, v) * (maxHeight - minHeight));
+						for (int y = 0; y < CHUNK_SIZE; y++)
+						{
+							const int worldY = chunk.y * CHUNK_SIZE + y;
+							BlockID block = VoxelBlocks::AIR;
+							if (worldY == height - 1)
+								block = height <= sandHeight ? VoxelBlocks::SAND : VoxelBlocks::GRASS;
+							else if (worldY >= height - 4 && worldY < height)
+								block = VoxelBlocks::DIRT;
+							else if (worldY < height)
+								block = VoxelBlocks::STONE;
+							blocks[VoxelChunk::ToVoxelIndex(x, y, z)] = block;
+						}
+					}
+				}
+				_chunks[index].Assign(blocks.data());
+			}
+		});
+
+	for (int z = 0; z < _size.z; z++)
+	{
+		for (int y = 0; y < _size.y; y++)
+		{
+			for (int x = 0; x < _size.x; x++)
+				MarkDirty(glm::ivec3(x, y, z));
+		}
+	}
+	_revision++;
+	_chunkRevisions.assign(_chunks.size(), _revision);
+}
+
+BlockID VoxelWorld::GetVoxel(const glm::ivec3& voxel) const
+{
+	const glm::ivec3 voxels = _size * CHUNK_SIZE;
+	if (voxel.x < 0 || voxel.y < 0 || voxel.z < 0 || voxel.x >= voxels.x || voxel.y >= voxels.y || voxel.z >= voxels.z)
+		return VoxelBlocks::AIR;
+	const glm::ivec3 chunk = voxel / CHUNK_SIZE;
+	const glm::ivec3 local = voxel - chunk * CHUNK_SIZE;
+	return _chunks[GetChunkIndex(chunk)].Get(local.x, local.y, local.z);
+}
+
+void VoxelWorld::SetVoxel(const glm::ivec3& voxel, BlockID block)
+{
+	const glm::ivec3 voxels = _size * CHUNK_SIZE;
+	if (voxel.x < 0 || voxel.y < 0 || voxel.z < 0 || voxel.x >= voxels.x || voxel.y >= voxels.y || voxel.z >= voxels.z)
+		return;
+	const glm::ivec3 chunk = voxel / CHUNK_SIZE;
+	const glm::ivec3 local = voxel - chunk * CHUNK_SIZE;
+	VoxelChunk& target = _chunks[GetChunkIndex(chunk)];
+	if (target.Get(local.x, local.y, local.z) == block)
+		return;
+
+	target.Set(local.x, local.y, local.z, block);
+	_revision++;
+	_chunkRevisions[GetChunkIndex(chunk)] = _revision;
+	MarkDirty(chunk);
+	// Border faces are culled against this voxel from the other side too
+	for (int axis = 0; axis < 3; axis++)
+	{
+		glm::ivec3 neighbour = chunk;
+		if (local[axis] == 0)
+			neighbour[axis]--;
+		else if (local[axis] == CHUNK_SIZE - 1)
+			neighbour[axis]++;
+		if (neighbour != chunk && IsInside(neighbour))
+			MarkDirty(neighbour);
+	}
+}
+
+bool VoxelWorld::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, glm::ivec3& outHit, glm::ivec3& outBefore) const
+{
+	// Amanatides & Woo, t is the distance along the normalized direction
+	const glm::vec3 start = origin - _origin;
+	const glm::vec3 dir = glm::normalize(direction);
+	glm::ivec3 voxel;
+	glm::ivec3 step;
+	glm::vec3 tMax;
+	glm::vec3 tDelta;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		voxel[axis] = static_cast<int>(std::floor(start[axis]));
+		step[axis] = dir[axis] > 0.f ? 1 : (dir[axis] < 0.f ? -1 : 0);
+		tDelta[axis] = step[axis] != 0 ? std::abs(1.f / dir[axis]) : std::numeric_limits<float>::max();
+		if (step[axis] > 0)
+			tMax[axis] = (voxel[axis] + 1 - start[axis]) / dir[axis];
+		else if (step[axis] < 0)
+			tMax[axis] = (start[axis] - voxel[axis]) / -dir[axis];
+		else
+			tMax[axis] = std::numeric_limits<float>::max();
+	}
+
+	glm::ivec3 previous = voxel;
+	float t = 0.f;
+	while (t <= maxDistance)
+	{
+		if (GetVoxel(voxel) != VoxelBlocks::AIR)
+		{
+			outHit = voxel;
+			outBefore = previous;
+			return true;
+		}
+		previous = voxel;
+		int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+		voxel[axis] += step[axis];
+		t = tMax[axis];
+		tMax[axis] += tDelta[axis];
+	}
+	return false;
+}
+
+void VoxelWorld::Update(ThreadPool& pool, const glm::vec3& cameraPosition)
+{
+	// Finished meshes first, whatever is over the budget stays for the next frame
+	uint32_t uploads = 0;
+	for (size_t i = 0; i < _jobs.size() && uploads < MAX_UPLOADS_PER_FRAME;)
+	{
+		MeshJob& job = _jobs[i];
+		if (job.Result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			i++;
+			continue;
+		}
+		MeshResult result = job.Result.get();
+		Upload(job.Chunk, result.Vertices);
+		_stats.LastMeshMilliseconds = result.Milliseconds;
+		_meshing[job.Chunk] = false;
+		uploads++;
+		_jobs[i] = std::move(_jobs.back());
+		_jobs.pop_back();
+	}
+
+	if (!_dirtyQueueSorted)
+	{
+		const glm::vec3 camera = (cameraPosition - _origin) / static_cast<float>(CHUNK_SIZE);
+		auto distance = [&](uint32_t index)
+			{
+				const glm::vec3 center(index % _size.x + 0.5f, (index / _size.x) % _size.y + 0.5f, index / (_size.x * _size.y) + 0.5f);
+				const glm::vec3 delta = center - camera;
+				return glm::dot(delta, delta);
+			};
+		std::sort(_dirtyQueue.begin(), _dirtyQueue.end(), [&](uint32_t a, uint32_t b) { return distance(a) < distance(b); });
+		_dirtyQueueSorted = true;
+	}
+
+	// A chunk edited while its job runs stays queued and goes again once the job is back
+	size_t kept = 0;
+	for (size_t i = 0; i < _dirtyQueue.size(); i++)
+	{
+		const uint32_t index = _dirtyQueue[i];
+		if (_meshing[index] || _jobs.size() >= MAX_JOBS_IN_FLIGHT)
+		{
+			_dirtyQueue[kept++] = index;
+			continue;
+		}
+
+		_dirty[index] = false;
+		if (_chunks[index].IsEmpty())
+		{
+			_meshes[index].QuadCount = 0;
+			continue;
+		}
+
+		const glm::ivec3 chunk(index % _size.x, (index / _size.x) % _size.y, index / (_size.x * _size.y));
+		std::vector<BlockID> padded(PADDED_VOLUME);
+		CopyPadded(chunk, padded.data());
+		_meshing[index] = true;
+		_jobs.push_back({ index, pool.Submit([padded = std::move(padded)]()
+			{
+				auto start = std::chrono::steady_clock::now();
+				MeshResult result;
+				GreedyMeshChunk(padded.data(), result.Vertices);
+				result.Milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+				return result;
+			}) });
+	}
+	_dirtyQueue.resize(kept);
+	_stats.PendingChunks = static_cast<uint32_t>(_dirtyQueue.size() + _jobs.size());
+}
+
+void VoxelWorld::Draw(const glm::mat4& view, const glm::mat4& projection, const Frustum& frustum)
+{
+	_stats.ChunksDrawn = 0;
+	_stats.QuadsDrawn = 0;
+
+	_shader.Use();
+	_shader.SetUniformMat4fv("view", view);
+	_shader.SetUniformMat4fv("projection", projection);
+	_shader.SetUniformI("blockTexture", 0);
+	GL_CHECK(glUniform3fv(glGetUniformLocation(_shader.GetProgramID(), "blockColors"), VoxelBlocks::COUNT, &BLOCK_COLORS[0][0]));
+	const GLint originLocation = glGetUniformLocation(_shader.GetProgramID(), "chunkOrigin");
+
+	// Every quad faces out of its solid voxel, the back faces never need rasterizing
+	GL_CHECK(glEnable(GL_CULL_FACE));
+	for (int z = 0; z < _size.z; z++)
+	{
+		for (int y = 0; y < _size.y; y++)
+		{
+			for (int x = 0; x < _size.x; x++)
+			{
+				const ChunkMesh& mesh = _meshes[GetChunkIndex(glm::ivec3(x, y, z))];
+				if (mesh.QuadCount == 0)
+					continue;
+				const glm::vec3 chunkOrigin = _origin + glm::vec3(x, y, z) * static_cast<float>(CHUNK_SIZE);
+				if (!frustum.IntersectsAABB(AABB(chunkOrigin, chunkOrigin + glm::vec3(static_cast<float>(CHUNK_SIZE)))))
+					continue;
+
+				GL_CHECK(glUniform3f(originLocation, chunkOrigin.x, chunkOrigin.y, chunkOrigin.z));
+				GL_CHECK(glBindVertexArray(mesh.VAO));
+				GL_CHECK(glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.QuadCount * 6), GL_UNSIGNED_INT, (void*)0));
+				_stats.ChunksDrawn++;
+				_stats.QuadsDrawn += mesh.QuadCount;
+			}
+		}
+	}
+	GL_CHECK(glDisable(GL_CULL_FACE));
+	GL_CHECK(glBindVertexArray(0));
+}
+
+glm::ivec3 VoxelWorld::GetSizeInChunks() const
+{
+	return _size;
+}
+
+const glm::vec3& VoxelWorld::GetOrigin() const
+{
+	return _origin;
+}
+
+const VoxelChunk& VoxelWorld::GetChunk(const glm::ivec3& chunk) const
+{
+	return _chunks[GetChunkIndex(chunk)];
+}
+
+uint32_t VoxelWorld::GetRevision() const
+{
+	return _revision;
+}
+
+uint32_t VoxelWorld::GetChunkRevision(const glm::ivec3& chunk) const
+{
+	return _chunkRevisions[GetChunkIndex(chunk)];
+}
+
+uint32_t VoxelWorld::GetChunkCount() const
+{
+	return static_cast<uint32_t>(_chunks.size());
+}
+
+uint64_t VoxelWorld::GetSolidCount() const
+{
+	uint64_t count = 0;
+	for (const VoxelChunk& chunk : _chunks)
+		count += chunk.GetSolidCount();
+	return count;
+}
+
+size_t VoxelWorld::GetMemoryUsage() const
+{
+	size_t bytes = 0;
+	for (const VoxelChunk& chunk : _chunks)
+		bytes += chunk.GetMemoryUsage();
+	return bytes;
+}
+
+size_t VoxelWorld::GetDenseMemoryUsage() const
+{
+	return _chunks.size() * CHUNK_VOLUME * sizeof(BlockID);
+}
+
+const VoxelWorldStats& VoxelWorld::GetStats() const
+{
+	return _stats;
+}
@@ -0,0 +1,128 @@
+#ifndef VOXEL_WORLD_H
+#define VOXEL_WORLD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "AABB.h"
+#include "Frustum.h"
+#include "HeightField.h"
+#include "Shader.h"
+#include "VoxelChunk.h"
+
+#include <cstdint>
+#include <future>
+#include <vector>
+
+class ThreadPool;
+
+namespace VoxelWorldDefaults
+{
+	// Chunks being meshed on the pool at once, more would only queue up behind each other
+	constexpr uint32_t MAX_JOBS_IN_FLIGHT = 16;
+	// Finished meshes uploaded per frame, the rest wait so a big edit never spikes one frame
+	constexpr uint32_t MAX_UPLOADS_PER_FRAME = 16;
+}
+
+// Tint of every block type over the block texture, indexed by BlockID
+extern const glm::vec3 BLOCK_COLORS[VoxelBlocks::COUNT];
+
+struct VoxelWorldStats
+{
+	uint32_t ChunksDrawn = 0;
+	uint32_t QuadsDrawn = 0;
+	// Chunks still dirty or being meshed
+	uint32_t PendingChunks = 0;
+	// Worker time of the last finished mesh, snapshot not included
+	float LastMeshMilliseconds = 0.f;
+};
+
+// Fixed size block of chunks, one voxel per world unit. Edits mark the chunk and any face
+// neighbour the voxel touches dirty, dirty chunks are copied out with a one voxel border and
+// greedy meshed on the thread pool, finished meshes replace the chunk's vertex buffer.
+class VoxelWorld
+{
+private:
+	struct ChunkMesh
+	{
+		unsigned int VAO = 0;
+		unsigned int VBO = 0;
+		uint32_t QuadCount = 0;
+	};
+
+	struct MeshResult
+	{
+		std::vector<uint32_t> Vertices;
+		float Milliseconds;
+	};
+
+	struct MeshJob
+	{
+		uint32_t Chunk;
+		std::future<MeshResult> Result;
+	};
+
+	Shader _shader;
+	glm::ivec3 _size;
+	glm::vec3 _origin;
+	std::vector<VoxelChunk> _chunks;
+	std::vector<ChunkMesh> _meshes;
+	std::vector<bool> _dirty;
+	std::vector<bool> _meshing;
+	std::vector<uint32_t> _dirtyQueue;
+	bool _dirtyQueueSorted;
+	std::vector<MeshJob> _jobs;
+	// Bumped by every change to the blocks, for views built from them
+	uint32_t _revision;
+	// World revision of each chunk's last block change, views rebuild only the chunks that moved on
+	std::vector<uint32_t> _chunkRevisions;
+
+	// Quads all share one index pattern, sized for the largest mesh so far
+	unsigned int _quadEBO;
+	uint32_t _quadCapacity;
+
+	VoxelWorldStats _stats;
+
+	uint32_t GetChunkIndex(const glm::ivec3& chunk) const;
+	bool IsInside(const glm::ivec3& chunk) const;
+	void MarkDirty(const glm::ivec3& chunk);
+	// The chunk plus one voxel of its six face neighbours, air outside the world
+	void CopyPadded(const glm::ivec3& chunk, BlockID* outBlocks) const;
+	void EnsureQuadCapacity(uint32_t quadCount);
+	void Upload(uint32_t chunk, const std::vector<uint32_t>& vertices);
+
+public:
+	// Size in chunks, origin is the world position of voxel (0, 0, 0)'s minimum corner
+	VoxelWorld(const glm::ivec3& sizeInChunks, const glm::vec3& origin);
+	~VoxelWorld();
+
+	VoxelWorld(const VoxelWorld&) = delete;
+	VoxelWorld& operator=(const VoxelWorld&) = delete;
+
+	// Columns from the height field, grass over dirt over stone and sand in the low parts
+	void GenerateTerrain(const HeightField& field, int minHeight, int maxHeight, ThreadPool& pool);
+
+	// Voxel coordinates, outside the world reads as air and writes are dropped
+	BlockID GetVoxel(const glm::ivec3& voxel) const;
+	void SetVoxel(const glm::ivec3& voxel, BlockID block);
+	// Voxel walk along the ray, outBefore is the empty voxel the ray came through last
+	bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, glm::ivec3& outHit, glm::ivec3& outBefore) const;
+
+	// Collects finished meshes and starts jobs for dirty chunks, closest to the camera first
+	void Update(ThreadPool& pool, const glm::vec3& cameraPosition);
+	// Caller binds the block texture to unit 0
+	void Draw(const glm::mat4& view, const glm::mat4& projection, const Frustum& frustum);
+
+	glm::ivec3 GetSizeInChunks() const;
+	const glm::vec3& GetOrigin() const;
+	const VoxelChunk& GetChunk(const glm::ivec3& chunk) const;
+	uint32_t GetRevision() const;
+	uint32_t GetChunkRevision(const glm::ivec3& chunk) const;
+	uint32_t GetChunkCount() const;
+	uint64_t GetSolidCount() const;
+	// Palette compressed storage, and the same blocks as a dense array
+	size_t GetMemoryUsage() const;
+	size_t GetDenseMemoryUsage() const;
+	const VoxelWorldStats& GetStats() const;
+};
+
+#endif // VOXEL_WORLD_H
@@ -1,2 +1,67 @@
+#include "stb_image_loader.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	thread_local unsigned char* Target = nullptr;
+	thread_local size_t TargetSize = 0;
+	thread_local bool TargetInUse = false;
+
+	void* StbImageMalloc(size_t size)
+	{
+		// The JPEG decoder asks for one byte more than the pixels
+		if (Target && !TargetInUse && (size == TargetSize || size == TargetSize + 1))
+		{
+			TargetInUse = true;
+			return Target;
+		}
+		return malloc(size);
+	}
+
+	void StbImageFree(void* memory)
+	{
+		if (memory && memory == Target)
+		{
+			TargetInUse = false;
+			return;
+		}
+		free(memory);
+	}
+
+	void* StbImageRealloc(void* memory, size_t oldSize, size_t newSize)
+	{
+		if (!memory || memory != Target)
+			return realloc(memory, newSize);
+
+		// The target can't grow, move out of it
+		void* moved = malloc(newSize);
+		if (moved)
+		{
+			memcpy(moved, memory, oldSize < newSize ? oldSize : newSize);
+			TargetInUse = false;
+		}
+		return moved;
+	}
+}
+
+void SetStbImageTarget(unsigned char* memory, size_t size)
+{
+	Target = memory;
+	TargetSize = size;
+	TargetInUse = false;
+}
+
+void ClearStbImageTarget()
+{
+	Target = nullptr;
+	TargetSize = 0;
+	TargetInUse = false;
+}
+
+#define STBI_MALLOC(size) StbImageMalloc(size)
+#define STBI_REALLOC_SIZED(memory, oldSize, newSize) StbImageRealloc(memory, oldSize, newSize)
+#define STBI_FREE(memory) StbImageFree(memory)
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
\ No newline at end of file
+#include "stb_image.h"
@@ -0,0 +1,13 @@
+#ifndef STB_IMAGE_LOADER_H
+#define STB_IMAGE_LOADER_H
+
+#include <cstddef>
+
+// Hands caller owned memory to the next stb_image allocation of size bytes on this thread, which
+// for a decode without channel conversion is its output. The memory must hold size + 1 bytes.
+// The decode then lands in it, check the returned pointer against it. stb never frees or
+// reallocates the target itself, and nothing else is redirected until ClearStbImageTarget.
+void SetStbImageTarget(unsigned char* memory, size_t size);
+void ClearStbImageTarget();
+
+#endif // STB_IMAGE_LOADER_H
@@ -0,0 +1,281 @@
+// Offline asset cooking, run from the build directory so output lands next to the runtime resources
+#include "BlockCompression.h"
+#include "HLOD.h"
+#include "KTX2File.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshFile.h"
+#include "MeshImporter.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "PotentiallyVisibleSet.h"
+#include "Primitives.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+#include "VertexCache.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace CookPaths
+{
+	const std::string COOKED_DIR = "resources/cooked";
+	const std::string DEMO_PVS = COOKED_DIR + "/demo.pvs";
+	const std::string DEMO_SPHERE = COOKED_DIR + "/sphere.mesh";
+	const std::string DEMO_HLOD = COOKED_DIR + "/demo.hlod";
+	const std::string TEXTURE_DIR = "resources/textures";
+}
+
+void PrintUsage();
+bool CookPVS(ThreadPool& pool, const std::string& output, float cellSize);
+bool CookLOD(const std::string& output, uint32_t lodCount);
+bool CookHLOD(const std::string& output, float clusterSize);
+bool CookImport(ThreadPool& pool, const std::string& source, const std::string& output);
+bool CookTextures(ThreadPool& pool, const std::string& directory);
+bool CookTexture(ThreadPool& pool, const std::string& source, const std::string& output);
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	const std::string command = argv[1];
+	ThreadPool pool;
+	std::filesystem::create_directories(CookPaths::COOKED_DIR);
+
+	bool success = false;
+	if (command == "pvs")
+	{
+		std::string output = argc > 2 ? argv[2] : CookPaths::DEMO_PVS;
+		float cellSize = argc > 3 ? std::stof(argv[3]) : PVSDefaults::CELL_SIZE;
+		success = CookPVS(pool, output, cellSize);
+	}
+	else if (command == "lod")
+	{
+		std::string output = argc > 2 ? argv[2] : CookPaths::DEMO_SPHERE;
+		uint32_t lodCount = argc > 3 ? static_cast<uint32_t>(std::stoul(argv[3])) : MeshSimplifierDefaults::MAX_LOD_COUNT;
+		success = CookLOD(output, lodCount);
+	}
+	else if (command == "hlod")
+	{
+		std::string output = argc > 2 ? argv[2] : CookPaths::DEMO_HLOD;
+		float clusterSize = argc > 3 ? std::stof(argv[3]) : HLODDefaults::CLUSTER_SIZE;
+		success = CookHLOD(output, clusterSize);
+	}
+	else if (command == "import" && argc > 2)
+	{
+		std::string source = argv[2];
+		std::string output = argc > 3 ? argv[3] : GetMeshCachePath(source);
+		success = CookImport(pool, source, output);
+	}
+	else if (command == "textures")
+	{
+		std::string directory = argc > 2 ? argv[2] : CookPaths::TEXTURE_DIR;
+		success = CookTextures(pool, directory);
+	}
+	else if (command == "all")
+	{
+		success = CookPVS(pool, CookPaths::DEMO_PVS, PVSDefaults::CELL_SIZE)
+			&& CookLOD(CookPaths::DEMO_SPHERE, MeshSimplifierDefaults::MAX_LOD_COUNT)
+			&& CookHLOD(CookPaths::DEMO_HLOD, HLODDefaults::CLUSTER_SIZE)
+			&& CookTextures(pool, CookPaths::TEXTURE_DIR);
+	}
+	else
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	return success ? 0 : -1;
+}
+
+void PrintUsage()
+{
+	std::cout << "Usage: Cook <command> [args]\n"
+		<< "  pvs [output] [cellSize]      potentially visible sets for the demo scene\n"
+		<< "  lod [output] [lodCount]      simplified LOD chain and meshlets of the demo sphere\n"
+		<< "  hlod [output] [clusterSize]  merged proxies for clusters of static demo objects\n"
+		<< "  import <source> [output]     mesh cache of an .obj, .gltf or .glb, the runtime cooks it on first use too\n"
+		<< "  textures [directory]         BC1 or BC3 KTX2 with every mip of each image, the runtime falls back to decoding without\n"
+		<< "  all                          everything above but import with default settings\n";
+}
+
+bool CookPVS(ThreadPool& pool, const std::string& output, float cellSize)
+{
+	Scene scene;
+	BuildDemoScene(scene);
+	scene.BuildIndex();
+
+	auto start = std::chrono::steady_clock::now();
+	PotentiallyVisibleSet pvs;
+	pvs.Build(scene, pool, cellSize);
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+	if (!pvs.Save(output))
+		return false;
+
+	std::cout << "PVS: " << pvs.GetCellCount() << " cells, " << scene.GetObjectCount() << " objects, "
+		<< pvs.GetMemoryUsage() / 1024 << " KiB, " << seconds << "s on " << pool.GetThreadCount() << " threads -> " << output << "\n";
+	return true;
+}
+
+bool CookLOD(const std::string& output, uint32_t lodCount)
+{
+	auto start = std::chrono::steady_clock::now();
+	MeshData data = CreateUVSphere<SceneDefaults::SPHERE_SEGMENTS, SceneDefaults::SPHERE_RINGS>();
+	BuildLODChain(data, lodCount);
+	BuildMeshlets(data);
+	VertexCacheStats cacheStats = OptimizeVertexCache(data);
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+	if (!SaveMeshData(output, data))
+		return false;
+
+	std::cout << "LOD: " << data.Vertices.size() << " vertices, triangles";
+	for (const MeshLOD& lod : data.LODs)
+		std::cout << " " << lod.IndexCount / 3 << " (error " << lod.Error << ")";
+	std::cout << ", " << data.Meshlets.size() << " meshlets, ACMR " << cacheStats.ACMRBefore << " -> " << cacheStats.ACMRAfter
+		<< ", " << seconds << "s -> " << output << "\n";
+	return true;
+}
+
+bool CookHLOD(const std::string& output, float clusterSize)
+{
+	Scene scene;
+	BuildDemoScene(scene);
+	scene.BuildIndex();
+
+	// Indexed by SceneObject::MeshID, proxies merge each mesh's coarsest level
+	std::vector<MeshData> meshes(SceneDefaults::DEMO_MESH_COUNT);
+	meshes[SceneDefaults::CUBE_MESH] = CreateCube();
+	meshes[SceneDefaults::SPHERE_MESH] = CreateUVSphere<SceneDefaults::SPHERE_SEGMENTS, SceneDefaults::SPHERE_RINGS>();
+	BuildLODChain(meshes[SceneDefaults::SPHERE_MESH]);
+
+	auto start = std::chrono::steady_clock::now();
+	HLOD hlod;
+	VertexCacheStats cacheStats;
+	hlod.Build(scene, meshes, clusterSize, &cacheStats);
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+	if (!hlod.Save(output))
+		return false;
+
+	const MeshData& proxies = hlod.GetProxyData();
+	std::cout << "HLOD: " << hlod.GetClusterCount() << " clusters, " << proxies.Vertices.size() << " vertices, "
+		<< proxies.Indices.size() / 3 << " triangles, ACMR " << cacheStats.ACMRBefore << " -> " << cacheStats.ACMRAfter << ", " << seconds << "s -> " << output << "\n";
+	return true;
+}
+
+bool CookImport(ThreadPool& pool, const std::string& source, const std::string& output)
+{
+	auto start = std::chrono::steady_clock::now();
+	ImportedMesh mesh;
+	if (!ImportMesh(source, pool, mesh))
+		return false;
+	float importSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t sourceHash;
+	if (!HashMeshSource(source, mesh.Dependencies, sourceHash) || !SaveMeshCache(output, mesh, sourceHash))
+		return false;
+
+	// What the runtime does instead of importing
+	start = std::chrono::steady_clock::now();
+	MeshCache cache;
+	if (!cache.Open(output, source))
+		return false;
+	float openSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "Import: " << mesh.Data.Vertices.size() << " vertices, " << mesh.Data.Indices.size() / 3 << " triangles, "
+		<< mesh.SubMeshes.size() << " submeshes, " << importSeconds << "s on " << pool.GetThreadCount() << " threads, cache "
+		<< cache.GetFileSize() / 1024 << " KiB opened in " << openSeconds << "s -> " << output << "\n";
+	return true;
+}
+
+bool CookTextures(ThreadPool& pool, const std::string& directory)
+{
+	std::error_code error;
+	std::vector<std::string> sources;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		if (entry.is_regular_file() && (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp"))
+			sources.push_back(entry.path().generic_string());
+	}
+	if (error)
+	{
+		std::cout << "ERROR::COOK::DIRECTORY_NOT_FOUND: " << directory << "\n";
+		return false;
+	}
+
+	// Named after the path the runtime loads, relative to the build directory like the cook runs
+	std::sort(sources.begin(), sources.end());
+	for (const std::string& source : sources)
+	{
+		if (!CookTexture(pool, source, GetCookedTexturePath(source)))
+			return false;
+	}
+	return true;
+}
+
+bool CookTexture(ThreadPool& pool, const std::string& source, const std::string& output)
+{
+	MappedFile file;
+	if (!file.Open(source))
+	{
+		std::cout << "ERROR::COOK::FILE_NOT_FOUND: " << source << "\n";
+		return false;
+	}
+
+	// Rows stay top first, the runtime flips blocks for textures loaded flipped
+	auto start = std::chrono::steady_clock::now();
+	int width, height, channels;
+	unsigned char* pixels = stbi_load_from_memory(file.GetData(), static_cast<int>(file.GetSize()), &width, &height, &channels, 4);
+	if (!pixels)
+	{
+		std::cout << "ERROR::COOK::DECODE_FAILED: " << source << " " << stbi_failure_reason() << "\n";
+		return false;
+	}
+	std::vector<uint8_t> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(pixels);
+
+	// BC3 only when some texel is not opaque, it costs twice the memory of BC1
+	bool opaque = true;
+	for (size_t i = 3; i < level.size() && opaque; i += 4)
+		opaque = level[i] == 255;
+	const BlockFormat format = opaque ? BlockFormat::BC1 : BlockFormat::BC3;
+
+	std::vector<std::vector<uint8_t>> levels;
+	size_t uncompressedBytes = 0;
+	for (int levelWidth = width, levelHeight = height;; levelWidth = std::max(levelWidth / 2, 1), levelHeight = std::max(levelHeight / 2, 1))
+	{
+		levels.emplace_back(GetCompressedSize(format, levelWidth, levelHeight));
+		CompressImage(format, level.data(), levelWidth, levelHeight, levels.back().data(), pool);
+		uncompressedBytes += static_cast<size_t>(levelWidth) * levelHeight * (opaque ? 3 : 4);
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+		level = DownsampleImage(level.data(), levelWidth, levelHeight);
+	}
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+	if (!SaveKTX2(output, format, width, height, levels, HashTextureSource(file.GetData(), file.GetSize())))
+		return false;
+
+	size_t compressedBytes = 0;
+	for (const std::vector<uint8_t>& blocks : levels)
+		compressedBytes += blocks.size();
+	std::cout << "Texture: " << source << " " << width << "x" << height << " " << (opaque ? "BC1" : "BC3") << ", " << levels.size() << " levels, "
+		<< compressedBytes / 1024 << " KiB instead of " << uncompressedBytes / 1024 << " KiB, " << seconds << "s -> " << output << "\n";
+	return true;
+}